@@ -0,0 +1,300 @@
+#include <cerrno>
+
+#include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "entries.hpp"
+
+static void print_arguments(std::ostream &output, Execution &execution) {
+    for (auto u = execution.arguments.begin(); u != execution.arguments.end(); ++u) {
+        output << "\"" << *u << "\"";
+        if (u != execution.arguments.end() - 1)
+            output << ',';
+    }
+}
+
+void EntryPrinter::print_header(std::ostream &output, Process &process, size_t i) {
+    auto &execution = process.executions[i];
+
+    output << "{\"p\":" << execution.pid;
+    output << ",\"x\":" << execution.index;
+    output << ",\"s\":" << execution.timestamp;
+    output << ",\"e\":" << execution.elapsed_time;
+    output << ",\"b\":\"" << execution.program_path << "\"";
+    output << ",\"w\":\"" << execution.current_working_directory << "\"";
+    output << ",\"v\":[";
+
+    if (!i)
+        print_deferred(output, EntryField::Arguments, process, i);
+    else
+        print_arguments(output, execution);
+
+    output << "],\"c\":[";
+
+    for (auto u = execution.children.begin(); u != execution.children.end(); ++u) {
+        auto &child = *u;
+        output << "{\"p\":" << child.pid << ",\"f\":" << child.flags << "}";
+        if (u != execution.children.end() - 1)
+            output << ',';
+    }
+
+    output << "],\"r\":";
+    print_deferred(output, EntryField::Parent, process, i);
+    output << ",\"i\":[";
+    print_deferred(output, EntryField::Pipes, process, i);
+
+    output << "],\"u\":[";
+    for (auto u = execution.cpus.begin(); u != execution.cpus.end(); ++u) {
+        if (u != execution.cpus.begin())
+            output << ",";
+
+        output << "{\"c\":" << (*u).cpu << ",\"t\":" << (*u).timestamp << "}";
+    }
+    output << "]";
+}
+
+void EntryPrinter::print(std::ostream &output, Process &process, size_t i) {
+    auto &execution = process.executions[i];
+    size_t path_size = 0;
+
+    print_header(output, process, i);
+    if (i == process.executions.size() - 1)
+        output << ",\"!\":" << +execution.exit_code;
+
+    output << ",\"o\":[";
+
+    for (auto iter = execution.opened_files.cbegin(), end_iter = execution.opened_files.cend();
+            iter != end_iter; ++iter) {
+        auto &original_path = iter->first;
+        auto &file = iter->second;
+
+        output << "{\"p\":\"" << file.absolute_path << "\",";
+        path_size += file.absolute_path.size();
+
+        if (original_path != file.absolute_path) {
+            output << "\"o\":\"" << original_path << "\",";
+            path_size += original_path.size();
+        }
+
+        output << "\"b\":" << file.open_timestamp << ",\"e\":" << file.close_timestamp << ",";
+        output << "\"m\":" << file.mode << ",\"s\":" << file.size << '}';
+
+        if (m_split && path_size >= m_split && std::next(iter) != end_iter) {
+            output << "]},\n";
+            print_header(output, process, i);
+            output << ",\"o\":[";
+            path_size = 0;
+        }
+
+        if (std::next(iter) != end_iter)
+            output << ',';
+    }
+
+    output << "]}";
+}
+
+void ResolvedEntryPrinter::print_deferred(std::ostream &output, EntryField field, Process &process, size_t i) {
+    auto &execution = process.executions[i];
+
+    switch (field) {
+    case EntryField::Arguments:
+        print_arguments(output, execution);
+        break;
+    case EntryField::Parent: {
+        auto lookup = m_results.parent_map.find(execution.pid);
+        if (lookup != m_results.parent_map.end())
+            execution.parent = lookup->second;
+        else
+            execution.parent = std::pair<upid_t, unsigned>(-1, 0);
+
+        output << "{\"p\":" << execution.parent.first << ",\"x\":" << execution.parent.second << "}";
+    } break;
+    case EntryField::Pipes: {
+        auto lookup = m_pipe_map.find(std::make_pair(execution.pid, execution.index));
+        if (lookup == m_pipe_map.end())
+            break;
+
+        auto &pmv = lookup->second;
+        for (auto u = pmv.begin(); u != pmv.end(); ++u) {
+            if (u != pmv.begin())
+                output << ',';
+
+            output << "{\"p\":" << (*u).first << ",\"x\":" << (*u).second << '}';
+        }
+    } break;
+    }
+}
+
+/* Records the positions of the deferred fields instead of printing them */
+class EntrySpill::HolePrinter final : public EntryPrinter {
+public:
+    std::vector<Hole> holes;
+
+    HolePrinter(size_t split)
+        : EntryPrinter (split)
+        {};
+
+    void print_deferred(std::ostream &output, EntryField field, Process &, size_t) final override {
+        holes.push_back(Hole{static_cast<uint64_t>(output.tellp()), field, 0});
+    };
+};
+
+bool EntrySpill::open(const char *path, size_t split) {
+    close();
+
+    m_fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (m_fd < 0)
+        return false;
+
+    /* Nothing else should ever see the file */
+    unlink(path);
+
+    m_split = split;
+    m_size = 0;
+    m_failed = false;
+    m_buffer.reserve(ENTRY_SPILL_BUFFER_SIZE);
+
+    return true;
+}
+
+void EntrySpill::close(void) {
+    if (m_fd < 0)
+        return;
+
+    ::close(m_fd);
+    m_fd = -1;
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+    m_records.clear();
+}
+
+bool EntrySpill::flush(void) {
+    size_t written = 0;
+
+    while (!m_failed && written < m_buffer.size()) {
+        ssize_t ret = ::write(m_fd, m_buffer.data() + written, m_buffer.size() - written);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            m_failed = true;
+        else
+            written += ret;
+    }
+
+    m_buffer.clear();
+
+    return !m_failed;
+}
+
+void EntrySpill::store(Process &process) {
+    std::string record;
+
+    for (auto &execution : process.executions)
+        execution.close_open_files(process.last_event_time);
+
+    for (size_t i = 0; i < process.executions.size(); i++) {
+        /* ignore 0 pid, used as a placeholder pid in env branch */
+        if (!process.executions[i].pid)
+            continue;
+
+        HolePrinter printer(m_split);
+        std::ostringstream output;
+
+        printer.print(output, process, i);
+
+        std::string text = output.str();
+        EntryHeader header = {static_cast<uint32_t>(i), static_cast<uint32_t>(printer.holes.size()), text.size()};
+
+        record.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        record.append(reinterpret_cast<const char *>(printer.holes.data()), printer.holes.size() * sizeof(Hole));
+        record.append(text);
+    }
+
+    for (size_t i = 0; i < process.executions.size(); i++) {
+        auto &execution = process.executions[i];
+
+        std::map<std::string, File>().swap(execution.opened_files);
+        std::unordered_map<unsigned int, File>().swap(execution.fd_table);
+        std::string().swap(execution.program_path);
+        std::string().swap(execution.current_working_directory);
+        std::vector<CpuTime>().swap(execution.cpus);
+
+        /* The arguments are still needed for the propagation to the children */
+        if (i && execution.children.empty())
+            std::vector<std::string>().swap(execution.arguments);
+    }
+
+    std::unique_lock lock(m_mutex);
+
+    if (m_buffer.size() + record.size() > ENTRY_SPILL_BUFFER_SIZE)
+        flush();
+
+    m_records.insert_or_assign(process.pid, std::make_pair(m_size, record.size()));
+    m_size += record.size();
+
+    if (record.size() > ENTRY_SPILL_BUFFER_SIZE) {
+        m_buffer.swap(record);
+        flush();
+    } else {
+        m_buffer.append(record);
+    }
+}
+
+bool EntrySpill::load(upid_t pid, std::string &record) {
+    auto lookup = m_records.find(pid);
+    if (lookup == m_records.end())
+        return false;
+
+    if (!m_buffer.empty())
+        flush();
+
+    auto [offset, size] = lookup->second;
+    size_t read_size = 0;
+
+    record.resize(size);
+    while (!m_failed && read_size < size) {
+        ssize_t ret = pread(m_fd, record.data() + read_size, size - read_size, offset + read_size);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            m_failed = true;
+        else
+            read_size += ret;
+    }
+
+    if (m_failed)
+        record.clear();
+
+    return true;
+}
+
+void EntrySpill::print(std::ostream &output, const std::string &record, size_t &offset, Process &process,
+        EntryPrinter &printer) {
+    EntryHeader header;
+    std::vector<Hole> holes;
+
+    if (offset + sizeof(header) > record.size())
+        return;
+
+    std::memcpy(&header, record.data() + offset, sizeof(header));
+    offset += sizeof(header);
+
+    holes.resize(header.holes);
+    std::memcpy(holes.data(), record.data() + offset, header.holes * sizeof(Hole));
+    offset += header.holes * sizeof(Hole);
+
+    const char *text = record.data() + offset;
+    uint64_t printed = 0;
+
+    for (auto &hole : holes) {
+        output.write(text + printed, hole.offset - printed);
+        printer.print_deferred(output, hole.field, process, header.execution);
+        printed = hole.offset;
+    }
+    output.write(text + printed, header.size - printed);
+
+    offset += header.size;
+}
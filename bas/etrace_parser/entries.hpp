@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#include "parser.hpp"
+
+/* Size of the in-memory buffer collecting spilled entries before they are written out */
+#define ENTRY_SPILL_BUFFER_SIZE (1UL * 1024 * 1024)
+
+/*
+ * Parts of a .nfsdb.json entry which depend on other processes and are only known after the whole
+ * trace is parsed and the pipe map is created.
+ */
+enum class EntryField : uint32_t {
+    Arguments,      /* "v" of the first execution, may be propagated from the parent */
+    Parent,         /* "r" */
+    Pipes,          /* "i" */
+};
+
+/*
+ * Prints a single execution as a .nfsdb.json entry (or several entries when it is split at the
+ * given size of opened file paths). The fields listed in EntryField are delegated to
+ * print_deferred().
+ */
+class EntryPrinter {
+private:
+    size_t m_split;
+
+    void print_header(std::ostream &, Process &, size_t);
+
+public:
+    EntryPrinter(size_t split)
+        : m_split (split)
+        {};
+
+    virtual ~EntryPrinter() = default;
+
+    virtual void print_deferred(std::ostream &, EntryField, Process &, size_t) = 0;
+
+    void print(std::ostream &, Process &, size_t);
+};
+
+/* Prints the deferred fields using the final parsing results */
+class ResolvedEntryPrinter final : public EntryPrinter {
+private:
+    ParsingResults &m_results;
+    pipe_map_t &m_pipe_map;
+
+public:
+    ResolvedEntryPrinter(ParsingResults &results, pipe_map_t &pipe_map, size_t split)
+        : EntryPrinter (split)
+        , m_results (results)
+        , m_pipe_map (pipe_map)
+        {};
+
+    void print_deferred(std::ostream &, EntryField, Process &, size_t) final override;
+};
+
+/*
+ * Temporary storage of the printed entries for processes which are already parsed.
+ *
+ * The entries of a process are printed as soon as its events are processed, with the deferred
+ * fields left out, and appended to an unlinked temporary file. Afterwards only the parts of the
+ * process needed to compute the deferred fields and the mounts file (pids, execution indexes,
+ * children, mounts and the arguments used for the propagation to children) are kept in memory. The
+ * entries are read back and completed when the output is flushed.
+ *
+ * store() may be called from multiple threads at the same time.
+ */
+class EntrySpill {
+private:
+    struct EntryHeader {
+        uint32_t execution;
+        uint32_t holes;
+        uint64_t size;
+    };
+
+    struct Hole {
+        uint64_t offset;
+        EntryField field;
+        uint32_t reserved;
+    };
+
+    class HolePrinter;
+
+    int m_fd = -1;
+    bool m_failed = false;
+    size_t m_split = 0;
+    uint64_t m_size = 0;
+    std::string m_buffer;
+    std::unordered_map<upid_t, std::pair<uint64_t, uint64_t>> m_records;
+    std::mutex m_mutex;
+
+    bool flush(void);
+
+public:
+    EntrySpill(void) = default;
+    EntrySpill(const EntrySpill &) = delete;
+    EntrySpill& operator=(const EntrySpill &) = delete;
+
+    ~EntrySpill() {
+        close();
+    };
+
+    bool open(const char *path, size_t split);
+    void close(void);
+
+    bool failed(void) const {
+        return m_failed;
+    };
+
+    /* Prints all entries of the process and frees the parts of it which aren't needed anymore */
+    void store(Process &);
+
+    /* Reads back the entries of a process, returns false when it wasn't stored */
+    bool load(upid_t, std::string &);
+
+    /* Completes and prints the next entry of a record returned by load() */
+    void print(std::ostream &, const std::string &, size_t &, Process &, EntryPrinter &);
+};
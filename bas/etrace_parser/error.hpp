@@ -50,8 +50,9 @@ public:
 
 class BadSeparatorError : public BasicError<BadSeparatorError> {
 public:
-    BadSeparatorError(size_t line_number, const char *line) {
-        m_error_message = "err: No separator on line " + std::to_string(line_number) + ": " + line + '\n';
+    BadSeparatorError(size_t line_number, const char *line, const char *end) {
+        m_error_message = "err: No separator on line " + std::to_string(line_number) + ": "
+            + std::string(line, end) + '\n';
     }
 
     static char m_identifier;
@@ -61,9 +62,9 @@ class IntegerParseError : public BasicError<IntegerParseError> {
 private:
     static char m_identifier;
 public:
-    IntegerParseError(size_t line_number, const char *line, int err_num) {
+    IntegerParseError(size_t line_number, const char *line, const char *end, int err_num) {
         m_error_message = "err: Error while parsing an integer on line " + std::to_string(line_number)
-            + " " + std::strerror(err_num) + ": " + line + "\n";
+            + " " + std::strerror(err_num) + ": " + std::string(line, end) + "\n";
     }
 };
 
@@ -0,0 +1,158 @@
+#include <cerrno>
+#include <climits>
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "eventlog.hpp"
+
+bool EventLogWriter::open(const char *path) {
+    close();
+
+    m_fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0)
+        return false;
+
+    m_path = path;
+    m_failed = false;
+    m_buffer.reserve(EVENT_LOG_BUFFER_SIZE);
+
+    return true;
+}
+
+bool EventLogWriter::flush(void) {
+    size_t written = 0;
+
+    while (!m_failed && written < m_buffer.size()) {
+        ssize_t ret = ::write(m_fd, m_buffer.data() + written, m_buffer.size() - written);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            m_failed = true;
+        else
+            written += ret;
+    }
+
+    m_buffer.clear();
+
+    return !m_failed;
+}
+
+bool EventLogWriter::close(void) {
+    bool ret;
+
+    if (m_fd < 0)
+        return true;
+
+    ret = flush();
+    ret = !::close(m_fd) && ret;
+
+    m_fd = -1;
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+
+    return ret;
+}
+
+void EventLogWriter::write_record(const EventLogRecord &record, std::string_view payload) {
+    if (m_buffer.size() + sizeof(record) + payload.size() + 1 > EVENT_LOG_BUFFER_SIZE)
+        flush();
+
+    m_buffer.append(reinterpret_cast<const char *>(&record), sizeof(record));
+    m_buffer.append(payload);
+    m_buffer.push_back('\n');
+}
+
+void EventLogWriter::write_header(std::string_view initcwd) {
+    EventLogHeader header = {};
+
+    std::memcpy(header.magic, EVENT_LOG_MAGIC, sizeof(EVENT_LOG_MAGIC));
+    header.version = EVENT_LOG_VERSION;
+    header.initcwd_size = initcwd.size();
+
+    m_buffer.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    m_buffer.append(initcwd);
+    m_buffer.push_back('\n');
+}
+
+void EventLogWriter::write_event(const eventTuple_t &event, std::string_view line) {
+    EventLogRecord record = {};
+
+    /* Values that don't fit the record are extremely unlikely, keep such lines as text */
+    if (event.argument_index < INT32_MIN || event.argument_index > INT32_MAX || event.cpu > UINT16_MAX) {
+        write_raw_line(line);
+        return;
+    }
+
+    record.pid = event.pid;
+    record.timestamp = event.timestamp;
+    record.argument_index = event.argument_index;
+    record.tag = static_cast<int32_t>(event.tag);
+    record.size = event.event_arguments.size();
+    record.cpu = event.cpu;
+
+    write_record(record, event.event_arguments);
+}
+
+void EventLogWriter::write_raw_line(std::string_view line) {
+    EventLogRecord record = {};
+
+    record.size = line.size();
+    record.flags = EVENT_LOG_RAW_LINE;
+
+    write_record(record, line);
+}
+
+bool EventLogWriter::append(const char *path) {
+    char block[64 * 1024];
+    bool ret = flush();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        m_failed = true;
+        return false;
+    }
+
+    for (;;) {
+        ssize_t size = ::read(fd, block, sizeof(block));
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size <= 0) {
+            ret = ret && !size;
+            break;
+        }
+
+        m_buffer.assign(block, size);
+        if (!flush()) {
+            ret = false;
+            break;
+        }
+    }
+
+    ::close(fd);
+    unlink(path);
+
+    m_failed = m_failed || !ret;
+
+    return ret;
+}
+
+EventLogReader::EventLogReader(const InputBuffer &input)
+    : m_input (input)
+{
+    EventLogHeader header;
+
+    if (!probe(input))
+        return;
+
+    std::memcpy(&header, input.data(), sizeof(header));
+    if (header.version != EVENT_LOG_VERSION)
+        return;
+
+    if (sizeof(header) + header.initcwd_size + 1 > input.size())
+        return;
+
+    m_initcwd = std::string_view(input.data() + sizeof(header), header.initcwd_size);
+    m_begin = sizeof(header) + header.initcwd_size + 1;
+}
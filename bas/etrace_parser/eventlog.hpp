@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <string>
+#include <string_view>
+
+#include "parser.hpp"
+#include "reader.hpp"
+
+#define EVENT_LOG_MAGIC "ETRCLOG"
+#define EVENT_LOG_VERSION 1U
+
+/* Size of the in-memory buffer collecting records before they are written out */
+#define EVENT_LOG_BUFFER_SIZE (4UL * 1024 * 1024)
+
+/*
+ * Binary event log.
+ *
+ * Tokenized form of the tracer output that can be fed back to etrace_parser instead of the text
+ * trace. The log starts with a file header followed by the first line of the trace (INITCWD). Every
+ * further line of the trace is stored as a single record, in the original order, so the line
+ * numbers (used by the exit cache and the error messages) are implicit. A record is a fixed-size
+ * header followed by the payload (text after the tag separator) and a '\n' byte, which keeps the
+ * argument parsers working on the payload views exactly as they do on the mapped text lines.
+ *
+ * Lines which couldn't be tokenized are kept verbatim with EVENT_LOG_RAW_LINE set, so that they are
+ * reported in the same way when the log is parsed again.
+ *
+ * The log uses the native byte order and is meant to be consumed on the machine that created it.
+ */
+struct EventLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t initcwd_size;
+};
+
+#define EVENT_LOG_RAW_LINE 0x1
+
+struct EventLogRecord {
+    int64_t pid;
+    uint64_t timestamp;
+    int32_t argument_index;
+    int32_t tag;
+    uint32_t size;
+    uint16_t cpu;
+    uint16_t flags;
+};
+
+static_assert(sizeof(EventLogHeader) == 16, "unexpected event log header layout");
+static_assert(sizeof(EventLogRecord) == 32, "unexpected event log record layout");
+
+class EventLogWriter {
+private:
+    int m_fd = -1;
+    bool m_failed = false;
+    std::string m_path;
+    std::string m_buffer;
+
+    void write_record(const EventLogRecord &, std::string_view);
+    bool flush(void);
+
+public:
+    EventLogWriter(void) = default;
+    EventLogWriter(const EventLogWriter &) = delete;
+    EventLogWriter& operator=(const EventLogWriter &) = delete;
+
+    ~EventLogWriter() {
+        close();
+    };
+
+    /* Creates an empty log, write_header() has to be called before any record in a standalone log */
+    bool open(const char *path);
+    bool close(void);
+
+    const std::string& path(void) const {
+        return m_path;
+    };
+
+    void write_header(std::string_view initcwd);
+    /* The original line is stored instead when the event doesn't fit the record */
+    void write_event(const eventTuple_t &, std::string_view line);
+    void write_raw_line(std::string_view);
+
+    /* Moves the records of a closed headerless log (written by another thread) to the end of this one */
+    bool append(const char *path);
+};
+
+class EventLogReader {
+private:
+    const InputBuffer &m_input;
+    size_t m_begin = 0;
+    std::string_view m_initcwd;
+
+public:
+    EventLogReader(const InputBuffer &input);
+
+    static bool probe(const InputBuffer &input) {
+        return input.size() >= sizeof(EventLogHeader) &&
+               !std::memcmp(input.data(), EVENT_LOG_MAGIC, sizeof(EVENT_LOG_MAGIC));
+    };
+
+    /* False for unsupported versions and truncated headers */
+    bool valid(void) const {
+        return m_begin != 0;
+    };
+
+    /* Offset of the first record */
+    size_t begin(void) const {
+        return m_begin;
+    };
+
+    std::string_view initcwd(void) const {
+        return m_initcwd;
+    };
+
+    /*
+     * Decodes the record at offset within [offset, end). Records stored with EVENT_LOG_RAW_LINE set
+     * return raw == true and the original line in event.event_arguments, the remaining fields of the
+     * event are left untouched. Returns false at the end of the range and on truncated records.
+     */
+    bool next(size_t &offset, size_t end, eventTuple_t &event, bool &raw) const {
+        EventLogRecord record;
+
+        if (offset + sizeof(record) > end)
+            return false;
+
+        std::memcpy(&record, m_input.data() + offset, sizeof(record));
+        if (offset + sizeof(record) + record.size + 1 > end)
+            return false;
+
+        event.event_arguments = std::string_view(m_input.data() + offset + sizeof(record), record.size);
+        offset += sizeof(record) + record.size + 1;
+
+        raw = record.flags & EVENT_LOG_RAW_LINE;
+        if (raw)
+            return true;
+
+        event.pid = record.pid;
+        event.cpu = record.cpu;
+        event.timestamp = record.timestamp;
+        event.tag = static_cast<Tag>(record.tag);
+        event.argument_index = record.argument_index;
+
+        return true;
+    };
+
+    bool next(size_t &offset, eventTuple_t &event, bool &raw) const {
+        return next(offset, m_input.size(), event, raw);
+    };
+};
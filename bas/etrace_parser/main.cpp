@@ -8,9 +8,11 @@
 #include <algorithm>
 #include <iostream>
 #include <fstream>
-#include <filesystem>
 
 #include "parser.hpp"
+#include "reader.hpp"
+#include "eventlog.hpp"
+#include "entries.hpp"
 
 static volatile int interrupt = 0;
 static void intHandler(int signum) {
@@ -72,103 +74,18 @@ void print_mounts(ParsingResults& results, std::ostream& output) {
     output << " \n]\n";
 }
 
-void flush_entries(ParsingResults& results, pipe_map_t& pipe_map, std::ostream& output, size_t split = 0) {
+void flush_entries(ParsingResults& results, pipe_map_t& pipe_map, std::ostream& output, size_t split = 0,
+        EntrySpill *spill = nullptr) {
+    ResolvedEntryPrinter printer(results, pipe_map, split);
     size_t progress_counter = 0;
     size_t process_map_size = results.process_map.size();
+    std::string record;
 
     std::cout << "Flushing entries...\n";
     std::cout.flush();
 
     output << "[\n";
 
-    auto print_entry = [&](Execution& execution) {
-        if (results.parent_map.find(execution.pid) != results.parent_map.end())
-            execution.parent = results.parent_map[execution.pid];
-        else
-            execution.parent = std::pair<upid_t, unsigned>(-1, 0);
-
-        output << "{\"p\":" << execution.pid;
-        output << ",\"x\":" << execution.index;
-        output << ",\"s\":" << execution.timestamp;
-        output << ",\"e\":" << execution.elapsed_time;
-        output << ",\"b\":\"" << execution.program_path << "\"";
-        output << ",\"w\":\"" << execution.current_working_directory << "\"";
-        output << ",\"v\":[";
-
-        for (auto u = execution.arguments.begin(); u != execution.arguments.end(); ++u) {
-            output << "\"" << *u << "\"";
-            if (u != execution.arguments.end() - 1)
-                output << ',';
-        }
-
-        output << "],\"c\":[";
-
-        for (auto u = execution.children.begin(); u != execution.children.end(); ++u) {
-            auto &child = *u;
-            output << "{\"p\":" << child.pid << ",\"f\":" << child.flags << "}";
-            if (u != execution.children.end() - 1)
-                output << ',';
-        }
-
-        output << "],\"r\":{\"p\":" << execution.parent.first << ",\"x\":" << execution.parent.second << "},";
-        output << "\"i\":[";
-
-        std::pair<upid_t, unsigned> pipe_map_key(execution.pid, execution.index);
-        if (pipe_map.find(pipe_map_key) != pipe_map.end()) {
-            std::set<std::pair<upid_t, unsigned>> &pmv = pipe_map[pipe_map_key];
-            for (auto u = pmv.begin(); u != pmv.end(); ++u) {
-                if (u != pmv.begin())
-                    output << ',';
-
-                output << "{\"p\":" << (*u).first << ",\"x\":" << (*u).second << '}';
-            }
-        }
-
-        output << "],\"u\":[";
-        for (auto u = execution.cpus.begin(); u != execution.cpus.end(); ++u) {
-            if (u != execution.cpus.begin())
-                output << ",";
-
-            output << "{\"c\":" << (*u).cpu << ",\"t\":" << (*u).timestamp << "}";
-        }
-        output << "]";
-    };
-
-    auto print_files = [&](Execution& execution) {
-        size_t path_size = 0;
-
-        output << ",\"o\":[";
-
-        for (auto iter = execution.opened_files.cbegin(), end_iter = execution.opened_files.cend();
-                iter != end_iter; ++iter) {
-            auto &original_path = iter->first;
-            auto &file = iter->second;
-
-            output << "{\"p\":\"" << file.absolute_path << "\",";
-            path_size += file.absolute_path.size();
-
-            if (original_path != file.absolute_path) {
-                output << "\"o\":\"" << original_path << "\",";
-                path_size += original_path.size();
-            }
-
-            output << "\"b\":" << file.open_timestamp << ",\"e\":" << file.close_timestamp << ",";
-            output << "\"m\":" << file.mode << ",\"s\":" << file.size << '}';
-
-            if (split && path_size >= split && std::next(iter) != end_iter) {
-                output << "]},\n";
-                print_entry(execution);
-                output << ",\"o\":[";
-                path_size = 0;
-            }
-
-            if (std::next(iter) != end_iter)
-                output << ',';
-        }
-
-        output << "]}";
-    };
-
     /* Now update parent pid information in parsed entries and flush the entries */
     for (auto it = results.process_map.begin(), end_iter = results.process_map.end();
             it != end_iter; ++it) {
@@ -179,6 +96,9 @@ void flush_entries(ParsingResults& results, pipe_map_t& pipe_map, std::ostream&
         }
 
         auto& process = it->second;
+        size_t record_offset = 0;
+        bool spilled = spill && spill->load(process.pid, record);
+
         for (size_t i = 0; i < process.executions.size(); i++) {
             auto& execution = process.executions[i];
 
@@ -186,10 +106,10 @@ void flush_entries(ParsingResults& results, pipe_map_t& pipe_map, std::ostream&
             if (!execution.pid)
                 continue;
 
-            print_entry(execution);
-            if (i == process.executions.size() - 1)
-                output << ",\"!\":" << +execution.exit_code;
-            print_files(execution);
+            if (spilled)
+                spill->print(output, record, record_offset, process, printer);
+            else
+                printer.print(output, process, i);
 
             if (std::next(it) != results.process_map.end()
                 || (std::next(it) == results.process_map.end() && i != process.executions.size() - 1))
@@ -206,7 +126,7 @@ void flush_entries(ParsingResults& results, pipe_map_t& pipe_map, std::ostream&
 }
 
 void print_help() {
-    std::cout << "Usage: etrace_parser [-t] [-j <N>] [-c <N>] [-s <N>] <path to tracer output> <destination of outputted file>\n";
+    std::cout << "Usage: etrace_parser [-t] [-p] [-m] [-b <path>] [-j <N>] [-c <N>] [-s <N>] <path to tracer output> <destination of outputted file>\n";
     std::cout << "where:\n";
     std::cout << "\t<path to tracer output>: by default it is '.nfsdb' file in the current directory\n";
     std::cout << "\t<destination of outputted file>: by default it is '.nfsdb.json' file in the current directory\n";
@@ -217,13 +137,25 @@ void print_help() {
     std::cout << "\t-s <N>: specify amount of bytes at which the entry should be split, Specifying 0";
     std::cout << " means that the entries won't be split. This is especially useful when using versions";
     std::cout << " MongoDB that limit the single document size to 16M. Defaults to 0.\n";
+    std::cout << "\t-p: tokenize the input in parallel. The input is split into line aligned chunks, one per";
+    std::cout << " thread specified with -j, that are tokenized at the same time. Produces the same output";
+    std::cout << " as the default (streaming) mode\n";
+    std::cout << "\t-b <path>: store the tokenized events in a binary event log at <path>. The log can be";
+    std::cout << " passed as the input file instead of the tracer output, which skips the text tokenization.";
+    std::cout << " Binary input is detected automatically\n";
+    std::cout << "\t-m: keep the memory usage bounded. Entries are written to a temporary file next to the";
+    std::cout << " output as soon as a process is parsed and only the data needed to finish them is kept in";
+    std::cout << " memory. Events of processes that haven't exited yet are still buffered, so the memory";
+    std::cout << " usage follows the number of processes alive at the same time. Produces the same output\n";
     std::cout << "\t-t: print parsing statistics\n";
 }
 
 int parser_main(int argc, char **argv) {
     std::unique_ptr<StreamParser> parser;
-    std::error_code err;
-    std::ifstream input;
+    ChunkedParser *chunked_parser = nullptr;
+    InputBuffer input;
+    EventLogWriter event_log;
+    EntrySpill spill;
     std::ofstream output;
     std::ofstream mounts;
 
@@ -232,14 +164,16 @@ int parser_main(int argc, char **argv) {
     size_t entry_split = 0;
     size_t cache_lifetime = 10000;
     size_t file_size;
-    size_t total_read = 0;
+    size_t offset = 0;
     unsigned long line_count = 0;
     const char *input_path = nullptr;
     const char *output_path = nullptr;
-    char line[2048] = { 0 };
+    const char *event_log_path = nullptr;
+    std::string_view line;
     char *endptr = nullptr;
-    bool no_progress = false;
     bool print_stats = false;
+    bool parse_chunked = false;
+    bool bounded_memory = false;
 
     act.sa_handler = intHandler;
     sigaction(SIGINT, &act, 0);
@@ -350,6 +284,31 @@ int parser_main(int argc, char **argv) {
             continue;
         }
 
+        if (!std::strncmp(argv[i], "-p", 2)) {
+            parse_chunked = true;
+
+            continue;
+        }
+
+        if (!std::strncmp(argv[i], "-m", 2)) {
+            bounded_memory = true;
+
+            continue;
+        }
+
+        if (!std::strncmp(argv[i], "-b", 2)) {
+            if (argv[i][2]) {
+                event_log_path = argv[i] + 2;
+            } else if (i < argc - 1) {
+                event_log_path = argv[++i];
+            } else {
+                std::cerr << "missing path passed to -b argument, quitting\n";
+                return EXIT_FAILURE;
+            }
+
+            continue;
+        }
+
         if (!input_path) {
             input_path = argv[i];
             continue;
@@ -369,7 +328,11 @@ int parser_main(int argc, char **argv) {
     if (!output_path)
         output_path = ".nfsdb.json";
 
-    if (thread_count > 1)
+    if (parse_chunked) {
+        auto chunked = std::make_unique<ChunkedParser>(thread_count);
+        chunked_parser = chunked.get();
+        parser = std::move(chunked);
+    } else if (thread_count > 1)
         parser = std::make_unique<MultithreadedParser>(thread_count);
     else
         parser = std::make_unique<SinglethreadedParser>();
@@ -377,46 +340,106 @@ int parser_main(int argc, char **argv) {
     if (cache_lifetime)
         parser->set_cache_lifetime(cache_lifetime);
 
-    input.open(input_path);
-    if (!input.good()) {
+    if (!input.open(input_path)) {
         std::cerr << "couldn't open " << input_path << " for reading, quitting\n";
         return EXIT_FAILURE;
     }
 
-    file_size = std::filesystem::file_size(input_path, err);
-    if (err) {
-        no_progress = true;
-        std::cout << "couldn't get " << input_path << " size, continuing with no progress bar\n";
+    file_size = input.size();
+
+    EventLogReader reader(input);
+    bool binary_input = EventLogReader::probe(input);
+    if (binary_input && !reader.valid()) {
+        std::cerr << input_path << " is not a supported event log, quitting\n";
+        return EXIT_FAILURE;
+    }
+
+    if (bounded_memory) {
+        std::string spill_path = std::string(output_path) + ".spill";
+
+        if (!spill.open(spill_path.c_str(), entry_split)) {
+            std::cerr << "couldn't open " << spill_path << " for writing, quitting\n";
+            return EXIT_FAILURE;
+        }
+
+        parser->set_process_flush([&spill](Process &process) {
+            spill.store(process);
+        });
+    }
+
+    if (event_log_path) {
+        if (!event_log.open(event_log_path)) {
+            std::cerr << "couldn't open " << event_log_path << " for writing, quitting\n";
+            return EXIT_FAILURE;
+        }
+
+        parser->set_event_log(&event_log);
     }
 
     std::cout << "Parsing events...\n";
     std::cout.flush();
 
-    while (input.getline(line, 2048)) {
-        if (!input.good()) {
-            std::cerr << "error while reading the file, quitting\n";
-            return EXIT_FAILURE;
+    if (binary_input) {
+        eventTuple_t event;
+        bool raw;
+
+        /* The first line (INITCWD) is stored in the event log header */
+        line_count = 1;
+        offset = reader.begin();
+        if (event_log_path)
+            event_log.write_header(reader.initcwd());
+
+        if (chunked_parser)
+            chunked_parser->parse(reader, file_size, line_count + 1);
+
+        while (!chunked_parser && reader.next(offset, event, raw)) {
+            line_count++;
+
+            if (!(line_count % 10000) && isatty(STDOUT_FILENO)) {
+                std::cout << offset * 100 / file_size << "%\r";
+                std::cout.flush();
+            }
+
+            if (!raw) {
+                event.line_number = line_count;
+                if (event_log_path)
+                    event_log.write_event(event, std::string_view());
+            }
+
+            auto ret = raw ? parser->parse_line(event.event_arguments, line_count) : parser->parse_event(event);
+            if (ret.is_error())
+                std::cout << ret.explain();
+
+            if (interrupt)
+                break;
         }
 
+        if (!chunked_parser && !interrupt && offset != file_size)
+            std::cerr << "truncated event log record at offset " << offset << ", ignoring the rest of the input\n";
+    } else {
         /* Ignore first line (INITCWD) */
-        if (!line_count++)
-            continue;
+        line_count = input.next_line(offset, line) ? 1 : 0;
+        if (event_log_path)
+            event_log.write_header(line_count ? line : std::string_view());
+
+        if (chunked_parser)
+            chunked_parser->parse(input, offset, line_count + 1);
+    }
 
-        auto read = input.gcount();
+    while (!binary_input && !chunked_parser && input.next_line(offset, line)) {
+        line_count++;
 
-        if (!no_progress && !(line_count % 10000) && isatty(STDOUT_FILENO)) {
-            std::cout << total_read * 100 / file_size << "%\r";
+        if (file_size && !(line_count % 10000) && isatty(STDOUT_FILENO)) {
+            std::cout << offset * 100 / file_size << "%\r";
             std::cout.flush();
         }
 
-        auto ret = parser->parse_line(line, read, line_count);
+        auto ret = parser->parse_line(line, line_count);
         if (ret.is_error())
             std::cout << ret.explain();
 
         if (interrupt)
             break;
-
-        total_read += read;
     }
 
     if (!interrupt) {
@@ -426,6 +449,9 @@ int parser_main(int argc, char **argv) {
         return 2;
     }
 
+    if (event_log_path && !event_log.close())
+        std::cerr << "couldn't write the event log to " << event_log_path << '\n';
+
     parser->finish_parsing();
 
     input.close();
@@ -437,11 +463,7 @@ int parser_main(int argc, char **argv) {
         auto& process = it->second;
 
         for (auto& execution : process.executions)
-            for (auto& [fd, file] : execution.fd_table) {
-                file.close_timestamp = process.last_event_time;
-
-                execution.add_open_file(file);
-            }
+            execution.close_open_files(process.last_event_time);
     }
 
     if (print_stats) {
@@ -509,6 +531,7 @@ int parser_main(int argc, char **argv) {
     std::map<upid_t, std::set<upid_t>> fork_map;
     std::map<upid_t, upid_t> rev_fork_map;
     std::map<upid_t, fdmap_node*> fdmap_process_map;
+    stdpipe_index stdpipes;
     syscall_raw *root_sys = nullptr;
     fdmap_node *root_fdmap_node = nullptr;
 
@@ -552,8 +575,8 @@ int parser_main(int argc, char **argv) {
                 continue;
             }
             fdmap_node *fdmap = fdmap_process_map[sys.pid];
-            fdmap->fdmap.insert(std::pair<int, fdinfo>(sys.i0, fdinfo(1, 0, (sys.ul & O_CLOEXEC) != 0, pipe_index)));
-            fdmap->fdmap.insert(std::pair<int, fdinfo>(sys.i1, fdinfo(0, 1, (sys.ul & O_CLOEXEC) != 0, pipe_index)));
+            fdmap_insert(stdpipes, fdmap, sys.i0, fdinfo(1, 0, (sys.ul & O_CLOEXEC) != 0, pipe_index));
+            fdmap_insert(stdpipes, fdmap, sys.i1, fdinfo(0, 1, (sys.ul & O_CLOEXEC) != 0, pipe_index));
             pipe_index++;
         } else if (sys.sysname == syscall_raw::SYS_DUP) {
             /*
@@ -570,13 +593,15 @@ int parser_main(int argc, char **argv) {
                 /* We can duplicate fd which didn't originate from PIPE (and therefore isn't tracked) */
                 continue;
             }
-            struct fdinfo &old_fdinfo = fdmap->fdmap[sys.i0];
-            if (fdmap->fdmap.find(sys.i1) != fdmap->fdmap.end()) {
+            /* Copy, the entry goes away below when oldfd == newfd */
+            struct fdinfo old_fdinfo = fdmap->fdmap[sys.i0];
+            auto new_fd = fdmap->fdmap.find(sys.i1);
+            if (new_fd != fdmap->fdmap.end()) {
                 /* Silently close the destination fd */
-                fdmap->fdmap.erase(sys.i1);
+                fdmap_erase(stdpipes, fdmap, new_fd);
             }
-            fdmap->fdmap.insert(std::pair<int, fdinfo>(
-                sys.i1, fdinfo(old_fdinfo.piperd, old_fdinfo.pipewr, (sys.ul & O_CLOEXEC) != 0, old_fdinfo.pipe_mark)));
+            fdmap_insert(stdpipes, fdmap,
+                sys.i1, fdinfo(old_fdinfo.piperd, old_fdinfo.pipewr, (sys.ul & O_CLOEXEC) != 0, old_fdinfo.pipe_mark));
         } else if (sys.sysname == syscall_raw::SYS_FORK) {
             /*
              * sv -> pid of fork?
@@ -601,9 +626,8 @@ int parser_main(int argc, char **argv) {
                 fdmap_node *new_fdmap_node = new fdmap_node(sys.pv);
                 fdmap_process_map.insert(std::pair<upid_t, fdmap_node *>(sys.pv, new_fdmap_node));
                 for (auto u = fdmap->fdmap.begin(); u != fdmap->fdmap.end(); ++u) {
-                    new_fdmap_node->fdmap.insert(
-                        std::pair<int, fdinfo>((*u).first, fdinfo((*u).second.piperd, (*u).second.pipewr,
-                                                                  (*u).second.cloexec, (*u).second.pipe_mark)));
+                    fdmap_insert(stdpipes, new_fdmap_node, (*u).first, fdinfo((*u).second.piperd, (*u).second.pipewr,
+                                                                              (*u).second.cloexec, (*u).second.pipe_mark));
                 }
             }
             if (rev_fork_map.find(sys.pv) != rev_fork_map.end()) {
@@ -630,9 +654,8 @@ int parser_main(int argc, char **argv) {
             if (fdmap->refs.size() > 1) {
                 fdmap_node *new_fdmap_node = new fdmap_node(sys.pid);
                 for (auto u = fdmap->fdmap.begin(); u != fdmap->fdmap.end(); ++u) {
-                    new_fdmap_node->fdmap.insert(
-                        std::pair<int, fdinfo>((*u).first, fdinfo((*u).second.piperd, (*u).second.pipewr,
-                                                                  (*u).second.cloexec, (*u).second.pipe_mark)));
+                    fdmap_insert(stdpipes, new_fdmap_node, (*u).first, fdinfo((*u).second.piperd, (*u).second.pipewr,
+                                                                              (*u).second.cloexec, (*u).second.pipe_mark));
                 }
                 if (fdmap->refs.find(sys.pid) == fdmap->refs.end()) {
                     std::cerr << "ERROR: missing identifier for shared file descriptor table for process (" << sys.pid;
@@ -647,7 +670,7 @@ int parser_main(int argc, char **argv) {
             for (auto u = fdmap->fdmap.begin(); u != fdmap->fdmap.end(); ) {
                 auto &descriptor = u->second;
                 if (descriptor.cloexec) {
-                    u = fdmap->fdmap.erase(u);
+                    u = fdmap_erase(stdpipes, fdmap, u);
                     continue;
                 }
                 ++u;
@@ -690,18 +713,29 @@ int parser_main(int argc, char **argv) {
                 continue;
             }
             std::set<upid_t> &siblings_with_me = fork_map[ppid];
-            for (auto u = siblings_with_me.begin(); u != siblings_with_me.end(); ++u) {
-                if (*u != sys.pid) {
-                    if (fdmap_process_map.find(*u) != fdmap_process_map.end()) {
-                        fdmap_node *sibling_fdmap = fdmap_process_map[*u];
-                        if (pipe_open_for_write(fdmap, sibling_fdmap, 1)) {
-                            update_pipe_map(pipe_map, sys.pid, exeIdxMap[sys.pid], *u, exeIdxMap[*u]);
-                        }
-                        if (pipe_open_for_write(sibling_fdmap, fdmap, 1)) {
-                            update_pipe_map(pipe_map, *u, exeIdxMap[*u], sys.pid, exeIdxMap[sys.pid]);
-                        }
-                    }
-                }
+            auto for_each_sibling = [&](const std::set<fdmap_node *> &sibling_fdmaps, auto callback) {
+                for (auto sibling_fdmap : sibling_fdmaps)
+                    for (auto u = sibling_fdmap->refs.begin(); u != sibling_fdmap->refs.end(); ++u)
+                        if (*u != sys.pid && siblings_with_me.find(*u) != siblings_with_me.end())
+                            callback(*u);
+            };
+            /* Siblings reading from our stdout */
+            auto stdout_fd = fdmap->fdmap.find(1);
+            if (stdout_fd != fdmap->fdmap.end() && stdout_fd->second.pipewr) {
+                auto readers = stdpipes.readers.find(stdout_fd->second.pipe_mark);
+                if (readers != stdpipes.readers.end())
+                    for_each_sibling(readers->second, [&](upid_t u) {
+                        update_pipe_map(pipe_map, sys.pid, exeIdxMap[sys.pid], u, exeIdxMap[u]);
+                    });
+            }
+            /* Siblings writing to our stdin */
+            auto stdin_fd = fdmap->fdmap.find(0);
+            if (stdin_fd != fdmap->fdmap.end() && stdin_fd->second.piperd) {
+                auto writers = stdpipes.writers.find(stdin_fd->second.pipe_mark);
+                if (writers != stdpipes.writers.end())
+                    for_each_sibling(writers->second, [&](upid_t u) {
+                        update_pipe_map(pipe_map, u, exeIdxMap[u], sys.pid, exeIdxMap[sys.pid]);
+                    });
             }
 #endif
 
@@ -717,8 +751,9 @@ int parser_main(int argc, char **argv) {
                 continue;
             }
             fdmap_node *fdmap = fdmap_process_map[sys.pid];
-            if (fdmap->fdmap.find(sys.i0) != fdmap->fdmap.end()) {
-                fdmap->fdmap.erase(sys.i0);
+            auto fd = fdmap->fdmap.find(sys.i0);
+            if (fd != fdmap->fdmap.end()) {
+                fdmap_erase(stdpipes, fdmap, fd);
             } else {
                 /* We can close fd which didn't originate from PIPE (and therefore isn't tracked) */
             }
@@ -765,6 +800,7 @@ int parser_main(int argc, char **argv) {
                 }
                 fdmap->refs.erase(sys.pid);
             } else {
+                stdpipes.erase(fdmap);
                 delete fdmap;
             }
             fdmap_process_map.erase(sys.pid);
@@ -825,9 +861,14 @@ int parser_main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
-    flush_entries(results, pipe_map, output, entry_split);
+    flush_entries(results, pipe_map, output, entry_split, bounded_memory ? &spill : nullptr);
     print_mounts(results, mounts);
 
+    if (spill.failed()) {
+        std::cerr << "couldn't write or read back the flushed entries, the output is incomplete\n";
+        return EXIT_FAILURE;
+    }
+
     if (!interrupt)
         std::cout << "\r100%\r";
     else
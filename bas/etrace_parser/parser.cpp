@@ -1,7 +1,13 @@
 #include "parser.hpp"
+#include "eventlog.hpp"
+
+/* Bounded std::strchr replacement, event arguments aren't null-terminated */
+static inline const char *find_char(const char *begin, const char *end, char c) {
+    return static_cast<const char *>(std::memchr(begin, c, end - begin));
+}
 
 /* Refactored based on SimpleJSON */
-std::string json_escape(const std::string &input) {
+std::string json_escape(std::string_view input) {
     std::string result;
     for (size_t i = 0; i < input.length(); ++i) {
         switch (input[i]) {
@@ -39,20 +45,33 @@ std::string json_escape(const std::string &input) {
     return result;
 }
 
-Errorable<void> StreamParser::parse_line(const char *line, size_t size, uint64_t line_number) {
-    auto &_process_map = process_map();
-    auto &_stats_collector = stats_collector();
-    eventTuple_t event_tuple;
+Errorable<void> StreamParser::parse_line(std::string_view line, uint64_t line_number) {
+    std::string_view raw_line = line;
 
-    if (size < 4 || std::strncmp(line, "0: ", 3))
+    if (line.size() < 3 || line.compare(0, 3, "0: ")) {
+        if (m_event_log)
+            m_event_log->write_raw_line(raw_line);
         return BadFormatError(line_number);
+    }
 
-    auto ret = parse_generic_args(line + 3, line_number);
+    line.remove_prefix(3);
+    auto ret = parse_generic_args(line, line_number);
 
-    if (ret.is_error())
+    if (ret.is_error()) {
+        if (m_event_log)
+            m_event_log->write_raw_line(raw_line);
         return ret;
+    }
+
+    if (m_event_log)
+        m_event_log->write_event(ret.value(), raw_line);
+
+    return parse_event(ret.value());
+}
 
-    event_tuple = ret.value();
+Errorable<void> StreamParser::parse_event(eventTuple_t &event_tuple) {
+    auto &_process_map = process_map();
+    auto &_stats_collector = stats_collector();
 
     set_last_event_time(event_tuple.timestamp);
 
@@ -101,6 +120,12 @@ void CachingParser::schedule_processing(eventTuple_t &event) {
 }
 
 void CachingParser::cache_hit(Process &process, bool pending) {
+    if (process.flushed) {
+        format_print("events of process ", process.pid, " received after it was flushed, ignoring");
+        process.event_list.clear();
+        return;
+    }
+
     std::sort(process.event_list.begin(), process.event_list.end(),
             [] (const eventTuple_t &a, const eventTuple_t &b) {
                 return a.timestamp < b.timestamp;
@@ -140,16 +165,17 @@ void CachingParser::cleanup_cache(void) {
 
 Errorable<NewProcArguments> StreamParser::parse_newproc_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     uint64_t value;
     ShortArguments tag;
     NewProcArguments arguments = {};
 
     for (;;) {
-        separator = std::strchr(event_line, '=');
+        separator = find_char(event_line, event_end, '=');
         if (!separator)
-            return BadSeparatorError(event.line_number, event_line);
+            return BadSeparatorError(event.line_number, event_line, event_end);
 
         tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
         switch (tag) {
@@ -157,9 +183,9 @@ Errorable<NewProcArguments> StreamParser::parse_newproc_short_arguments(const ev
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
 
             arguments.argsize = value;
             event_line = ++endptr;
@@ -168,9 +194,9 @@ Errorable<NewProcArguments> StreamParser::parse_newproc_short_arguments(const ev
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
 
             arguments.prognameisize = value;
             event_line = ++endptr;
@@ -179,9 +205,9 @@ Errorable<NewProcArguments> StreamParser::parse_newproc_short_arguments(const ev
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
 
             arguments.prognamepsize = value;
             event_line = ++endptr;
@@ -190,9 +216,9 @@ Errorable<NewProcArguments> StreamParser::parse_newproc_short_arguments(const ev
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
-            else if (*endptr != 0) [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
+            else if (endptr != event_end) [[unlikely]]
+                return BadSeparatorError(event.line_number, separator, event_end);
 
             arguments.cwdsize = value;
             goto ret;
@@ -207,14 +233,15 @@ ret:
 
 Errorable<SchedForkArguments> StreamParser::parse_schedfork_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     ShortArguments tag;
     SchedForkArguments arguments;
 
-    separator = std::strchr(event_line, '=');
+    separator = find_char(event_line, event_end, '=');
     if (!separator)
-        return BadSeparatorError(event.line_number, event_line);
+        return BadSeparatorError(event.line_number, event_line, event_end);
 
     tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
     if (tag != ShortArguments::Pid)
@@ -223,23 +250,24 @@ Errorable<SchedForkArguments> StreamParser::parse_schedfork_short_arguments(cons
     errno = 0;
     arguments.cpid = std::strtoull(++separator, &endptr, 10);
     if (errno) [[unlikely]]
-        return IntegerParseError(event.line_number, separator, errno);
-    else if (*endptr != 0) [[unlikely]]
-        return BadSeparatorError(event.line_number, separator);
+        return IntegerParseError(event.line_number, separator, event_end, errno);
+    else if (endptr != event_end) [[unlikely]]
+        return BadSeparatorError(event.line_number, separator, event_end);
 
     return arguments;
 }
 
 Errorable<SysCloneArguments> StreamParser::parse_sysclone_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     ShortArguments tag;
     SysCloneArguments arguments;
 
-    separator = std::strchr(event_line, '=');
+    separator = find_char(event_line, event_end, '=');
     if (!separator)
-        return BadSeparatorError(event.line_number, event_line);
+        return BadSeparatorError(event.line_number, event_line, event_end);
 
     tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
     if (tag != ShortArguments::Flags)
@@ -248,25 +276,26 @@ Errorable<SysCloneArguments> StreamParser::parse_sysclone_short_arguments(const
     errno = 0;
     arguments.flags = std::strtoull(++separator, &endptr, 10);
     if (errno) [[unlikely]]
-        return IntegerParseError(event.line_number, separator, errno);
-    else if (*endptr != 0) [[unlikely]]
-        return BadSeparatorError(event.line_number, separator);
+        return IntegerParseError(event.line_number, separator, event_end, errno);
+    else if (endptr != event_end) [[unlikely]]
+        return BadSeparatorError(event.line_number, separator, event_end);
 
     return arguments;
 }
 
 Errorable<OpenArguments> StreamParser::parse_open_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     uint64_t value;
     ShortArguments tag;
     OpenArguments arguments = {};
 
     for (;;) {
-        separator = std::strchr(event_line, '=');
+        separator = find_char(event_line, event_end, '=');
         if (!separator)
-            return BadSeparatorError(event.line_number, event_line);
+            return BadSeparatorError(event.line_number, event_line, event_end);
 
         tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
         switch (tag) {
@@ -274,9 +303,9 @@ Errorable<OpenArguments> StreamParser::parse_open_short_arguments(const eventTup
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno)
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.fnamesize = value;
             event_line = ++endptr;
             break;
@@ -284,9 +313,9 @@ Errorable<OpenArguments> StreamParser::parse_open_short_arguments(const eventTup
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno)
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.forigsize = value;
             event_line = ++endptr;
             break;
@@ -294,9 +323,9 @@ Errorable<OpenArguments> StreamParser::parse_open_short_arguments(const eventTup
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno)
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.flags = value;
             event_line = ++endptr;
             break;
@@ -304,9 +333,9 @@ Errorable<OpenArguments> StreamParser::parse_open_short_arguments(const eventTup
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno)
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.mode = value;
             event_line = ++endptr;
             break;
@@ -314,9 +343,9 @@ Errorable<OpenArguments> StreamParser::parse_open_short_arguments(const eventTup
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno)
-                return IntegerParseError(event.line_number, separator, errno);
-            else if (*endptr != 0) [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
+            else if (endptr != event_end) [[unlikely]]
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.fd = value;
             goto ret;
         default:
@@ -330,14 +359,15 @@ ret:
 
 Errorable<CloseArguments> StreamParser::parse_close_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     ShortArguments tag;
     CloseArguments arguments;
 
-    separator = std::strchr(event_line, '=');
+    separator = find_char(event_line, event_end, '=');
     if (!separator)
-        return BadSeparatorError(event.line_number, event_line);
+        return BadSeparatorError(event.line_number, event_line, event_end);
 
     tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
     if (tag != ShortArguments::Fd)
@@ -346,25 +376,26 @@ Errorable<CloseArguments> StreamParser::parse_close_short_arguments(const eventT
     errno = 0;
     arguments.fd = std::strtoll(++separator, &endptr, 10);
     if (errno) [[unlikely]]
-        return IntegerParseError(event.line_number, separator, errno);
-    else if (*endptr != 0) [[unlikely]]
-        return BadSeparatorError(event.line_number, separator);
+        return IntegerParseError(event.line_number, separator, event_end, errno);
+    else if (endptr != event_end) [[unlikely]]
+        return BadSeparatorError(event.line_number, separator, event_end);
 
     return arguments;
 }
 
 Errorable<PipeArguments> StreamParser::parse_pipe_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     uint64_t value;
     ShortArguments tag;
     PipeArguments arguments = {};
 
     for (;;) {
-        separator = std::strchr(event_line, '=');
+        separator = find_char(event_line, event_end, '=');
         if (!separator)
-            return BadSeparatorError(event.line_number, event_line);
+            return BadSeparatorError(event.line_number, event_line, event_end);
 
         tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
         switch (tag) {
@@ -372,9 +403,9 @@ Errorable<PipeArguments> StreamParser::parse_pipe_short_arguments(const eventTup
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.fd1 = value;
             event_line = ++endptr;
             break;
@@ -383,9 +414,9 @@ Errorable<PipeArguments> StreamParser::parse_pipe_short_arguments(const eventTup
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.fd2 = value;
             event_line = ++endptr;
             break;
@@ -394,9 +425,9 @@ Errorable<PipeArguments> StreamParser::parse_pipe_short_arguments(const eventTup
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
-            else if (*endptr != 0) [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
+            else if (endptr != event_end) [[unlikely]]
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.flags = value;
             event_line = ++endptr;
             goto ret;
@@ -412,14 +443,15 @@ ret:
 
 Errorable<RenameArguments> StreamParser::parse_rename_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     ShortArguments tag;
     RenameArguments arguments = {};
 
-    separator = std::strchr(event_line, '=');
+    separator = find_char(event_line, event_end, '=');
     if (!separator)
-        return BadSeparatorError(event.line_number, event_line);
+        return BadSeparatorError(event.line_number, event_line, event_end);
 
     tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
     if (tag != ShortArguments::Fnamesize)
@@ -428,23 +460,24 @@ Errorable<RenameArguments> StreamParser::parse_rename_short_arguments(const even
     errno = 0;
     arguments.fnamesize = std::strtoull(++separator, &endptr, 10);
     if (errno) [[unlikely]]
-        return IntegerParseError(event.line_number, separator, errno);
-    else if (*endptr != 0) [[unlikely]]
-        return BadSeparatorError(event.line_number, separator);
+        return IntegerParseError(event.line_number, separator, event_end, errno);
+    else if (endptr != event_end) [[unlikely]]
+        return BadSeparatorError(event.line_number, separator, event_end);
 
     return arguments;
 }
 
 Errorable<LinkArguments> StreamParser::parse_link_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     ShortArguments tag;
     LinkArguments arguments = {};
 
-    separator = std::strchr(event_line, '=');
+    separator = find_char(event_line, event_end, '=');
     if (!separator)
-        return BadSeparatorError(event.line_number, event_line);
+        return BadSeparatorError(event.line_number, event_line, event_end);
 
     tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
     if (tag != ShortArguments::Fnamesize)
@@ -453,23 +486,24 @@ Errorable<LinkArguments> StreamParser::parse_link_short_arguments(const eventTup
     errno = 0;
     arguments.fnamesize = std::strtoull(++separator, &endptr, 10);
     if (errno) [[unlikely]]
-        return IntegerParseError(event.line_number, separator, errno);
-    else if (*endptr != 0) [[unlikely]]
-        return BadSeparatorError(event.line_number, separator);
+        return IntegerParseError(event.line_number, separator, event_end, errno);
+    else if (endptr != event_end) [[unlikely]]
+        return BadSeparatorError(event.line_number, separator, event_end);
 
     return arguments;
 }
 
 Errorable<ExitArguments> StreamParser::parse_exit_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     ShortArguments tag;
     ExitArguments arguments;
 
-    separator = std::strchr(event_line, '=');
+    separator = find_char(event_line, event_end, '=');
     if (!separator)
-        return BadSeparatorError(event.line_number, event_line);
+        return BadSeparatorError(event.line_number, event_line, event_end);
 
     tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
     if (tag != ShortArguments::Status)
@@ -478,24 +512,25 @@ Errorable<ExitArguments> StreamParser::parse_exit_short_arguments(const eventTup
     errno = 0;
     arguments.status = std::strtol(++separator, &endptr, 10);
     if (errno) [[unlikely]]
-        return IntegerParseError(event.line_number, separator, errno);
-    else if (*endptr != 0) [[unlikely]]
-        return BadSeparatorError(event.line_number, separator);
+        return IntegerParseError(event.line_number, separator, event_end, errno);
+    else if (endptr != event_end) [[unlikely]]
+        return BadSeparatorError(event.line_number, separator, event_end);
 
     return arguments;
 }
 
 Errorable<UmountArguments> StreamParser::parse_umount_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     uint64_t value;
     ShortArguments tag;
     UmountArguments arguments = {};
 
-    separator = std::strchr(event_line, '=');
+    separator = find_char(event_line, event_end, '=');
     if (!separator)
-        return BadSeparatorError(event.line_number, event_line);
+        return BadSeparatorError(event.line_number, event_line, event_end);
 
     tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
     switch (tag) {
@@ -503,9 +538,9 @@ Errorable<UmountArguments> StreamParser::parse_umount_short_arguments(const even
         errno = 0;
         value = std::strtoull(++separator, &endptr, 10);
         if (errno) [[unlikely]]
-            return IntegerParseError(event.line_number, separator, errno);
+            return IntegerParseError(event.line_number, separator, event_end, errno);
         else if (*endptr != ',') [[unlikely]]
-            return BadSeparatorError(event.line_number, separator);
+            return BadSeparatorError(event.line_number, separator, event_end);
         arguments.targetnamesize = value;
         event_line = ++endptr;
         break;
@@ -513,9 +548,9 @@ Errorable<UmountArguments> StreamParser::parse_umount_short_arguments(const even
         errno = 0;
         value = std::strtoull(++separator, &endptr, 10);
         if (errno) [[unlikely]]
-            return IntegerParseError(event.line_number, separator, errno);
-        else if (*endptr != 0) [[unlikely]]
-            return BadSeparatorError(event.line_number, separator);
+            return IntegerParseError(event.line_number, separator, event_end, errno);
+        else if (endptr != event_end) [[unlikely]]
+            return BadSeparatorError(event.line_number, separator, event_end);
         arguments.flags = value;
         goto ret;
     default:
@@ -528,15 +563,16 @@ ret:
 
 Errorable<RenameArguments> StreamParser::parse_rename2_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     uint64_t value;
     ShortArguments tag;
     RenameArguments arguments = {};
 
-    separator = std::strchr(event_line, '=');
+    separator = find_char(event_line, event_end, '=');
     if (!separator)
-        return BadSeparatorError(event.line_number, event_line);
+        return BadSeparatorError(event.line_number, event_line, event_end);
 
     tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
     switch (tag) {
@@ -544,9 +580,9 @@ Errorable<RenameArguments> StreamParser::parse_rename2_short_arguments(const eve
         errno = 0;
         value = std::strtoull(++separator, &endptr, 10);
         if (errno) [[unlikely]]
-            return IntegerParseError(event.line_number, separator, errno);
+            return IntegerParseError(event.line_number, separator, event_end, errno);
         else if (*endptr != ',') [[unlikely]]
-            return BadSeparatorError(event.line_number, separator);
+            return BadSeparatorError(event.line_number, separator, event_end);
         arguments.fnamesize = value;
         event_line = ++endptr;
         break;
@@ -554,9 +590,9 @@ Errorable<RenameArguments> StreamParser::parse_rename2_short_arguments(const eve
         errno = 0;
         value = std::strtoull(++separator, &endptr, 10);
         if (errno) [[unlikely]]
-            return IntegerParseError(event.line_number, separator, errno);
-        else if (*endptr != 0) [[unlikely]]
-            return BadSeparatorError(event.line_number, separator);
+            return IntegerParseError(event.line_number, separator, event_end, errno);
+        else if (endptr != event_end) [[unlikely]]
+            return BadSeparatorError(event.line_number, separator, event_end);
         arguments.flags = value;
         goto ret;
     default:
@@ -569,16 +605,17 @@ ret:
 
 Errorable<LinkArguments> StreamParser::parse_linkat_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     uint64_t value;
     ShortArguments tag;
     LinkArguments arguments = {};
 
     for (;;) {
-        separator = std::strchr(event_line, '=');
+        separator = find_char(event_line, event_end, '=');
         if (!separator)
-            return BadSeparatorError(event.line_number, event_line);
+            return BadSeparatorError(event.line_number, event_line, event_end);
 
         tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
         switch (tag) {
@@ -586,9 +623,9 @@ Errorable<LinkArguments> StreamParser::parse_linkat_short_arguments(const eventT
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.fnamesize = value;
             event_line = ++endptr;
             break;
@@ -596,9 +633,9 @@ Errorable<LinkArguments> StreamParser::parse_linkat_short_arguments(const eventT
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
-            else if (*endptr != 0) [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
+            else if (endptr != event_end) [[unlikely]]
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.flags = value;
             goto ret;
         default:
@@ -612,16 +649,17 @@ ret:
 
 Errorable<DupArguments> StreamParser::parse_dup_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     uint64_t value;
     ShortArguments tag;
     DupArguments arguments = {};
 
     for (;;) {
-        separator = std::strchr(event_line, '=');
+        separator = find_char(event_line, event_end, '=');
         if (!separator)
-            return BadSeparatorError(event.line_number, event_line);
+            return BadSeparatorError(event.line_number, event_line, event_end);
 
         tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
         switch (tag) {
@@ -629,9 +667,9 @@ Errorable<DupArguments> StreamParser::parse_dup_short_arguments(const eventTuple
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.oldfd = value;
             event_line = ++endptr;
             break;
@@ -639,9 +677,9 @@ Errorable<DupArguments> StreamParser::parse_dup_short_arguments(const eventTuple
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.newfd = value;
             event_line = ++endptr;
             break;
@@ -649,9 +687,9 @@ Errorable<DupArguments> StreamParser::parse_dup_short_arguments(const eventTuple
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
-            else if (*endptr != 0) [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
+            else if (endptr != event_end) [[unlikely]]
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.flags = value;
             goto ret;
         default:
@@ -665,17 +703,18 @@ ret:
 
 Errorable<SymlinkArguments> StreamParser::parse_symlink_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     uint64_t value;
     ShortArguments tag;
     SymlinkArguments arguments = {};
     arguments.resolvednamesize = -1;
 
     for (;;) {
-        separator = std::strchr(event_line, '=');
+        separator = find_char(event_line, event_end, '=');
         if (!separator)
-            return BadSeparatorError(event.line_number, event_line);
+            return BadSeparatorError(event.line_number, event_line, event_end);
 
         tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
         switch (tag) {
@@ -683,9 +722,9 @@ Errorable<SymlinkArguments> StreamParser::parse_symlink_short_arguments(const ev
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.targetnamesize = value;
             event_line = ++endptr;
             break;
@@ -693,9 +732,9 @@ Errorable<SymlinkArguments> StreamParser::parse_symlink_short_arguments(const ev
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.resolvednamesize = value;
             event_line = ++endptr;
             break;
@@ -703,9 +742,9 @@ Errorable<SymlinkArguments> StreamParser::parse_symlink_short_arguments(const ev
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
-            else if (*endptr != 0) [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
+            else if (endptr != event_end) [[unlikely]]
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.linknamesize = value;
             goto ret;
         default:
@@ -719,8 +758,9 @@ ret:
 
 Errorable<MountArguments> StreamParser::parse_mount_short_arguments(const eventTuple_t &event) {
     char *endptr;
-    char *separator;
-    char *event_line = const_cast<char *>(event.event_arguments.c_str());
+    const char *separator;
+    const char *event_line = event.event_arguments.data();
+    const char *event_end = event_line + event.event_arguments.size();
     uint64_t value;
     ShortArguments tag;
     MountArguments arguments = {};
@@ -728,9 +768,9 @@ Errorable<MountArguments> StreamParser::parse_mount_short_arguments(const eventT
     arguments.sourcenamesize = -1;
 
     for (;;) {
-        separator = std::strchr(event_line, '=');
+        separator = find_char(event_line, event_end, '=');
         if (!separator)
-            return BadSeparatorError(event.line_number, event_line);
+            return BadSeparatorError(event.line_number, event_line, event_end);
 
         tag = static_cast<ShortArguments>(hash(event_line, separator - event_line));
         switch (tag) {
@@ -738,9 +778,9 @@ Errorable<MountArguments> StreamParser::parse_mount_short_arguments(const eventT
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.targetnamesize = value;
             event_line = ++endptr;
             break;
@@ -748,9 +788,9 @@ Errorable<MountArguments> StreamParser::parse_mount_short_arguments(const eventT
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.sourcenamesize = value;
             event_line = ++endptr;
             break;
@@ -758,9 +798,9 @@ Errorable<MountArguments> StreamParser::parse_mount_short_arguments(const eventT
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.typenamesize = value;
             event_line = ++endptr;
             break;
@@ -768,9 +808,9 @@ Errorable<MountArguments> StreamParser::parse_mount_short_arguments(const eventT
             errno = 0;
             value = std::strtoull(++separator, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(event.line_number, separator, errno);
-            else if (*endptr != 0) [[unlikely]]
-                return BadSeparatorError(event.line_number, separator);
+                return IntegerParseError(event.line_number, separator, event_end, errno);
+            else if (endptr != event_end) [[unlikely]]
+                return BadSeparatorError(event.line_number, separator, event_end);
             arguments.flags = value;
             goto ret;
         default:
@@ -926,9 +966,11 @@ size_t StreamParser::parse_long_argument(std::vector<eventTuple_t>::iterator &it
     return size;
 }
 
-Errorable<eventTuple_t> StreamParser::parse_generic_args(const char *line, size_t line_number) {
-    char *event_separator;
-    char *argument_bracket;
+Errorable<eventTuple_t> StreamParser::parse_generic_args(std::string_view line_view, size_t line_number) {
+    const char *line = line_view.data();
+    const char *line_end = line + line_view.size();
+    const char *event_separator;
+    const char *argument_bracket;
     char *endptr;
     ssize_t argument_index = NOT_INDEXED;
     unsigned long long pid;
@@ -941,44 +983,44 @@ Errorable<eventTuple_t> StreamParser::parse_generic_args(const char *line, size_
     errno = 0;
     pid = std::strtoull(line, &endptr, 10);
     if (errno) [[unlikely]]
-        return IntegerParseError(line_number, line, errno);
+        return IntegerParseError(line_number, line, line_end, errno);
     else if (*endptr != ',') [[unlikely]]
-        return BadSeparatorError(line_number, line);
+        return BadSeparatorError(line_number, line, line_end);
     line = ++endptr;
 
     cpu = std::strtoul(line, &endptr, 10);
     if (errno) [[unlikely]]
-        return IntegerParseError(line_number, line, errno);
+        return IntegerParseError(line_number, line, line_end, errno);
     else if (*endptr != ',') [[unlikely]]
-        return BadSeparatorError(line_number, line);
+        return BadSeparatorError(line_number, line, line_end);
     line = ++endptr;
 
     time = std::strtoul(line, &endptr, 10);
     if (errno) [[unlikely]]
-        return IntegerParseError(line_number, line, errno);
+        return IntegerParseError(line_number, line, line_end, errno);
     else if (*endptr != ',') [[unlikely]]
-        return BadSeparatorError(line_number, line);
+        return BadSeparatorError(line_number, line, line_end);
     line = ++endptr;
 
     timen = std::strtoul(line, &endptr, 10);
     if (errno) [[unlikely]]
-        return IntegerParseError(line_number, line, errno);
+        return IntegerParseError(line_number, line, line_end, errno);
     else if (*endptr != '!') [[unlikely]]
-        return BadSeparatorError(line_number, line);
+        return BadSeparatorError(line_number, line, line_end);
     line = ++endptr;
 
-    event_separator = const_cast<char *>(std::strchr(line, '|'));
-    argument_bracket = const_cast<char *>(std::strchr(line, '['));
+    event_separator = find_char(line, line_end, '|');
+    argument_bracket = find_char(line, line_end, '[');
 
     if (!event_separator && !argument_bracket) {
-        return BadSeparatorError(line_number, line);
+        return BadSeparatorError(line_number, line, line_end);
     } else if ((event_separator && argument_bracket && event_separator > argument_bracket) || (!event_separator && argument_bracket)) {
         errno = 0;
         argument_index = std::strtoull(argument_bracket + 1, &endptr, 10);
         if (errno) [[unlikely]]
-            return IntegerParseError(line_number, line, errno);
+            return IntegerParseError(line_number, line, line_end, errno);
         else if (*endptr != ']') [[unlikely]]
-            return BadSeparatorError(line_number, line);
+            return BadSeparatorError(line_number, line, line_end);
 
         tag = static_cast<Tag>(hash(line, (argument_bracket + 1) - line));
         if (tag != Tag::ArrayedArguments && tag != Tag::ArrayedEnvs)
@@ -1001,16 +1043,16 @@ Errorable<eventTuple_t> StreamParser::parse_generic_args(const char *line, size_
         case Tag::MountTypeExtended:
         case Tag::MountTargetExtended:
         case Tag::MountSourceExtended:
-            argument_bracket = std::strchr(event_separator + 1, '[');
+            argument_bracket = find_char(event_separator + 1, line_end, '[');
             if (!argument_bracket)
-                return BadSeparatorError(line_number, event_separator + 1);
+                return BadSeparatorError(line_number, event_separator + 1, line_end);
 
             errno = 0;
             argument_index = std::strtoull(argument_bracket + 1, &endptr, 10);
             if (errno) [[unlikely]]
-                return IntegerParseError(line_number, line, errno);
+                return IntegerParseError(line_number, line, line_end, errno);
             else if (*endptr != ',') [[unlikely]]
-                return BadSeparatorError(line_number, line);
+                return BadSeparatorError(line_number, line, line_end);
             break;
         default:
             break;
@@ -1023,8 +1065,9 @@ Errorable<eventTuple_t> StreamParser::parse_generic_args(const char *line, size_
     event.argument_index = argument_index;
     event.timestamp = time * 1000000000UL + timen;
     event.line_number = line_number;
-    event.event_arguments = tag == Tag::ArrayedArguments || tag == Tag::ArrayedEnvs ? ++endptr
+    const char *event_arguments = tag == Tag::ArrayedArguments || tag == Tag::ArrayedEnvs ? ++endptr
         : ++event_separator;
+    event.event_arguments = std::string_view(event_arguments, line_end - event_arguments);
 
     return event;
 }
@@ -1591,6 +1634,351 @@ Errorable<void> StreamParser::process_events(Process &process) {
 
 upid_t StreamParser::parse_upid(const eventTuple_t &evln)
 {
-    char *event_line = const_cast<char *>(evln.event_arguments.c_str());
-    return std::strtoull(event_line, NULL, 10);
+    return std::strtoull(evln.event_arguments.data(), NULL, 10);
+}
+
+/* Side effects of the cache hit currently being processed by this thread */
+static thread_local std::vector<syscall_raw> *current_syscalls = nullptr;
+static thread_local std::vector<std::pair<upid_t, std::pair<upid_t, unsigned>>> *current_children = nullptr;
+static thread_local std::vector<std::pair<std::string, std::set<upid_t>>> *current_envs = nullptr;
+
+void ChunkedParser::append_syscall(syscall_raw &&syscall) {
+    current_syscalls->push_back(syscall);
+}
+
+void ChunkedParser::register_child(upid_t child, upid_t parent, size_t execution) {
+    current_children->push_back(std::make_pair(child, std::make_pair(parent, execution)));
+}
+
+void ChunkedParser::add_env(std::string &key, std::set<upid_t> val) {
+    current_envs->push_back(std::make_pair(key, std::move(val)));
+}
+
+ChunkedParser::Chunk::Chunk(void) = default;
+ChunkedParser::Chunk::Chunk(Chunk &&) = default;
+ChunkedParser::Chunk::~Chunk() = default;
+
+ChunkedParser::~ChunkedParser() {
+    m_pool.wait_for_tasks();
+}
+
+void ChunkedParser::add_event(Chunk &chunk, eventTuple_t &event) {
+    auto &_stats_collector = stats_collector();
+
+    chunk.has_events = true;
+    chunk.last_event_time = event.timestamp;
+    if (!chunk.first_event_time)
+        chunk.first_event_time = event.timestamp;
+
+    if (event.tag == Tag::ContEnd)
+        _stats_collector.increment_multilines();
+    else if (event.tag == Tag::Exit)
+        chunk.exits.push_back(std::make_pair(event.line_number, event.pid));
+
+    chunk.events[event.pid].push_back(event);
+}
+
+void ChunkedParser::tokenize_line(Chunk &chunk, std::string_view line, uint64_t line_number) {
+    std::string_view raw_line = line;
+
+    if (line.size() < 3 || line.compare(0, 3, "0: ")) {
+        if (chunk.event_log)
+            chunk.event_log->write_raw_line(raw_line);
+        chunk.bad_lines.push_back(line_number);
+        chunk.errors.push_back(std::string(BadFormatError(line_number).explain()));
+        return;
+    }
+
+    line.remove_prefix(3);
+    auto ret = parse_generic_args(line, line_number);
+    if (ret.is_error()) {
+        if (chunk.event_log)
+            chunk.event_log->write_raw_line(raw_line);
+        chunk.bad_lines.push_back(line_number);
+        chunk.errors.push_back(std::string(ret.explain()));
+        return;
+    }
+
+    if (chunk.event_log)
+        chunk.event_log->write_event(ret.value(), raw_line);
+
+    add_event(chunk, ret.value());
+}
+
+void ChunkedParser::tokenize(const InputBuffer &input, Chunk &chunk) {
+    uint64_t line_number = chunk.first_line;
+    size_t offset = chunk.begin;
+    std::string_view line;
+
+    while (input.next_line(offset, chunk.end, line))
+        tokenize_line(chunk, line, line_number++);
+}
+
+void ChunkedParser::tokenize(const EventLogReader &reader, Chunk &chunk) {
+    uint64_t line_number = chunk.first_line;
+    size_t offset = chunk.begin;
+    eventTuple_t event;
+    bool raw;
+
+    while (reader.next(offset, chunk.end, event, raw)) {
+        uint64_t current_line = line_number++;
+
+        if (raw) {
+            tokenize_line(chunk, event.event_arguments, current_line);
+            continue;
+        }
+
+        event.line_number = current_line;
+        if (chunk.event_log)
+            chunk.event_log->write_event(event, std::string_view());
+
+        add_event(chunk, event);
+    }
+}
+
+void ChunkedParser::tokenize_chunks(uint64_t first_line, const std::function<void(Chunk &)> &tokenize_chunk) {
+    size_t chunk_count = m_chunks.size();
+    auto _event_log = event_log();
+
+    for (size_t i = 0; i < chunk_count; i++)
+        m_chunks[i].first_line = i ? m_chunks[i - 1].first_line + m_chunks[i - 1].line_count : first_line;
+
+    /* Every chunk writes its records to a separate file, concatenated in the input order afterwards */
+    if (_event_log) {
+        for (size_t i = 0; i < chunk_count; i++) {
+            auto &chunk = m_chunks[i];
+
+            chunk.event_log = std::make_unique<EventLogWriter>();
+            if (!chunk.event_log->open((_event_log->path() + ".part" + std::to_string(i)).c_str())) {
+                std::cerr << "couldn't open " << _event_log->path() << ".part" << i << " for writing\n";
+                chunk.event_log.reset();
+            }
+        }
+    }
+
+    m_pool.push_loop(chunk_count, [&](const size_t a, const size_t b) {
+        for (size_t i = a; i < b; i++)
+            tokenize_chunk(m_chunks[i]);
+    }, chunk_count);
+    m_pool.wait_for_tasks();
+
+    for (size_t i = 0; _event_log && i < chunk_count; i++) {
+        auto &chunk = m_chunks[i];
+
+        if (chunk.event_log)
+            chunk.event_log->close();
+        _event_log->append((_event_log->path() + ".part" + std::to_string(i)).c_str());
+        chunk.event_log.reset();
+    }
+
+    for (auto &chunk : m_chunks) {
+        for (auto &error : chunk.errors)
+            std::cout << error;
+        chunk.errors.clear();
+
+        if (!chunk.has_events)
+            continue;
+
+        if (!first_event_time())
+            set_first_event_time(chunk.first_event_time);
+        set_last_event_time(chunk.last_event_time);
+    }
+}
+
+void ChunkedParser::parse(const InputBuffer &input, size_t offset, uint64_t first_line) {
+    const char *data = input.data();
+    size_t size = input.size();
+    size_t chunk_count = std::max<size_t>(m_pool.get_thread_count(), 1);
+    size_t chunk_size = offset < size ? (size - offset) / chunk_count + 1 : 0;
+
+    /* Split the input into ranges ending right after a new line character */
+    m_chunks.resize(chunk_count);
+    for (size_t i = 0; i < chunk_count; i++) {
+        auto &chunk = m_chunks[i];
+
+        chunk.begin = i ? m_chunks[i - 1].end : offset;
+        chunk.end = std::min(size, std::max(chunk.begin, offset + (i + 1) * chunk_size));
+
+        if (chunk.end < size && chunk.end > chunk.begin && data[chunk.end - 1] != '\n') {
+            auto newline = static_cast<const char *>(std::memchr(data + chunk.end, '\n', size - chunk.end));
+            chunk.end = newline ? newline - data + 1 : size;
+        }
+    }
+    m_chunks.back().end = std::max(m_chunks.back().begin, size);
+
+    /* Line numbers are needed during tokenization (errors and exit cache), count them first */
+    m_pool.push_loop(chunk_count, [&](const size_t a, const size_t b) {
+        for (size_t i = a; i < b; i++) {
+            auto &chunk = m_chunks[i];
+
+            chunk.line_count = std::count(data + chunk.begin, data + chunk.end, '\n');
+            if (chunk.end > chunk.begin && data[chunk.end - 1] != '\n')
+                chunk.line_count++;
+        }
+    }, chunk_count);
+    m_pool.wait_for_tasks();
+
+    tokenize_chunks(first_line, [&](Chunk &chunk) {
+        tokenize(input, chunk);
+    });
+}
+
+void ChunkedParser::parse(const EventLogReader &reader, size_t size, uint64_t first_line) {
+    size_t chunk_count = std::max<size_t>(m_pool.get_thread_count(), 1);
+    size_t chunk_size = (size - reader.begin()) / chunk_count + 1;
+    size_t offset = reader.begin();
+    eventTuple_t event;
+    bool raw;
+
+    /* Records have variable length, walk the headers to find the chunk boundaries and line counts */
+    m_chunks.resize(chunk_count);
+    for (size_t i = 0; i < chunk_count; i++) {
+        auto &chunk = m_chunks[i];
+        size_t limit = i == chunk_count - 1 ? size : reader.begin() + (i + 1) * chunk_size;
+
+        chunk.begin = offset;
+        while (offset < limit && reader.next(offset, size, event, raw))
+            chunk.line_count++;
+        chunk.end = offset;
+    }
+
+    if (offset != size)
+        std::cerr << "truncated event log record at offset " << offset << ", ignoring the rest of the input\n";
+
+    tokenize_chunks(first_line, [&](Chunk &chunk) {
+        tokenize(reader, chunk);
+    });
+}
+
+void ChunkedParser::replay_cache(void) {
+    auto &_process_map = process_map();
+    auto &_stats_collector = stats_collector();
+    auto _lifetime = cache_lifetime();
+    uint64_t last_line = m_chunks.front().first_line;
+    std::vector<uint64_t> bad_lines;
+    std::set<upid_t> exited;
+    size_t exit_count = 0;
+
+    for (auto &chunk : m_chunks) {
+        last_line = chunk.first_line + chunk.line_count;
+        bad_lines.insert(bad_lines.end(), chunk.bad_lines.begin(), chunk.bad_lines.end());
+        exit_count += chunk.exits.size();
+    }
+
+    m_firings.reserve(exit_count + _process_map.size());
+
+    bool blocked = false;
+    for (auto &chunk : m_chunks) {
+        for (auto &[line_number, pid] : chunk.exits) {
+            uint64_t hitcount = line_number + _lifetime;
+
+            if (!blocked && (hitcount >= last_line ||
+                        std::binary_search(bad_lines.begin(), bad_lines.end(), hitcount)))
+                blocked = true;
+
+            m_firings.emplace_back(pid, blocked ? ULLONG_MAX : hitcount, false);
+            exited.insert(pid);
+            if (blocked)
+                _stats_collector.increment_procs_at_exit();
+        }
+    }
+
+    for (auto it = _process_map.begin(), end_it = _process_map.end(); it != end_it; ++it) {
+        if (exited.find(it->first) != exited.end())
+            continue;
+
+        m_firings.emplace_back(it->first, ULLONG_MAX, true);
+        _stats_collector.increment_procs_at_exit();
+    }
+}
+
+void ChunkedParser::process(upid_t pid, const std::vector<size_t> &firings) {
+    auto &process = process_map().at(pid);
+    std::vector<eventTuple_t> events;
+
+    for (auto &chunk : m_chunks) {
+        auto lookup = chunk.events.find(pid);
+        if (lookup == chunk.events.end())
+            continue;
+
+        if (events.empty())
+            events = std::move(lookup->second);
+        else
+            events.insert(events.end(), lookup->second.begin(), lookup->second.end());
+
+        lookup->second.clear();
+        lookup->second.shrink_to_fit();
+    }
+
+    auto it = events.begin();
+    for (auto index : firings) {
+        auto &firing = m_firings[index];
+        auto segment_end = std::find_if(it, events.end(), [&](const eventTuple_t &event) {
+            return event.line_number > firing.hitcount;
+        });
+
+        if (it == segment_end)
+            continue;
+
+        process.event_list.assign(it, segment_end);
+        it = segment_end;
+
+        current_syscalls = &firing.syscalls;
+        current_children = &firing.children;
+        current_envs = &firing.envs;
+
+        cache_hit(process, firing.pending);
+    }
+
+    /* Not processed, same as events coming after the process was flushed from the cache */
+    process.event_list.assign(it, events.end());
+
+    flush_process(process);
+}
+
+void ChunkedParser::finish_parsing(void) {
+    auto &_process_map = process_map();
+    auto &_parent_map = parent_map();
+    auto &_syscalls = syscalls();
+
+    if (m_chunks.empty())
+        return;
+
+    for (auto &chunk : m_chunks)
+        for (auto &[pid, events] : chunk.events)
+            if (_process_map.find(pid) == _process_map.end())
+                _process_map.emplace(pid, Process(pid, events.front())).first->second.event_list.clear();
+
+    replay_cache();
+
+    std::unordered_map<upid_t, std::vector<size_t>> process_firings;
+    for (size_t i = 0; i < m_firings.size(); i++)
+        process_firings[m_firings[i].pid].push_back(i);
+
+    std::vector<upid_t> pids;
+    pids.reserve(_process_map.size());
+    for (auto it = _process_map.begin(), end_it = _process_map.end(); it != end_it; ++it)
+        pids.push_back(it->first);
+
+    const std::vector<size_t> no_firings;
+    m_pool.push_loop(pids.size(), [&](const size_t a, const size_t b) {
+        for (size_t i = a; i < b; i++) {
+            auto lookup = process_firings.find(pids[i]);
+            process(pids[i], lookup != process_firings.end() ? lookup->second : no_firings);
+        }
+    });
+    m_pool.wait_for_tasks();
+
+    for (auto &firing : m_firings) {
+        _syscalls.insert(_syscalls.end(), firing.syscalls.begin(), firing.syscalls.end());
+
+        for (auto &[child, parent] : firing.children)
+            _parent_map.insert_or_assign(child, parent);
+
+        for (auto &[key, val] : firing.envs)
+            StreamParser::add_env(key, val);
+    }
+
+    m_firings.clear();
+    m_chunks.clear();
 }
@@ -4,9 +4,13 @@
 #include <cstring>
 
 #include <string>
+#include <memory>
+#include <functional>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <algorithm>
 #include <optional>
 #include <iostream>
@@ -18,6 +22,7 @@
 
 #include "error.hpp"
 #include "tags.hpp"
+#include "reader.hpp"
 
 /* Generated using 'gperf phash.txt > phash.h' */
 #include "phash.h"
@@ -30,6 +35,8 @@ struct fdinfo;
 struct ParsingStatistics;
 class StreamParser;
 class CachingParser;
+class EventLogWriter;
+class EventLogReader;
 
 typedef int64_t upid_t;
 typedef std::map<int, fdinfo> fdmap_t;
@@ -131,7 +138,8 @@ typedef struct eventTuple {
     size_t line_number;
     Tag tag;
     ssize_t argument_index;
-    std::string event_arguments;
+    /* Points into the InputBuffer holding the trace, must not outlive it */
+    std::string_view event_arguments;
 } eventTuple_t;
 
 struct File {
@@ -247,6 +255,17 @@ struct Execution {
             registered_file.resolve_runtime_variables();
         }
     }
+
+    /* Files still open when the process is flushed are closed at the given time */
+    void close_open_files(uint64_t timestamp) {
+        for (auto& [fd, file] : fd_table) {
+            file.close_timestamp = timestamp;
+
+            add_open_file(file);
+        }
+
+        fd_table.clear();
+    }
 };
 
 
@@ -257,6 +276,7 @@ struct Process {
     uint64_t first_event_time;
     uint64_t last_event_time;
     bool exited;
+    bool flushed = false;
 
     std::vector<Execution> executions;
 
@@ -494,6 +514,8 @@ private:
     std::map<upid_t, std::pair<upid_t, unsigned>> m_parent_map;
     std::map<std::string, std::set<upid_t>> m_env_map;
     std::vector<syscall_raw> m_syscalls;
+    EventLogWriter *m_event_log = nullptr;
+    std::function<void(Process &)> m_process_flush;
 
 protected:
     static Errorable<NewProcArguments> parse_newproc_short_arguments(const eventTuple_t &);
@@ -520,14 +542,14 @@ protected:
                             std::vector<std::string> &);
     static size_t parse_long_argument(std::vector<eventTuple_t>::iterator &it,
             const std::vector<eventTuple_t>::iterator &, Tag, Tag, Tag, std::string &);
-    static Errorable<eventTuple_t> parse_generic_args(const char *, uint64_t);
+    static Errorable<eventTuple_t> parse_generic_args(std::string_view, uint64_t);
 
     virtual std::vector<CacheEntry>& cache(void) = 0;
 
     virtual void append_syscall(syscall_raw &&) = 0;
     virtual void register_child(upid_t, upid_t, size_t) = 0;
     virtual void schedule_processing(eventTuple_t &) = 0;
-    void add_env(std::string &key, std::set<upid_t> val) {
+    virtual void add_env(std::string &key, std::set<upid_t> val) {
         m_env_map[key] = val;
     };
 
@@ -565,6 +587,18 @@ protected:
         return m_parent_map;
     };
 
+    EventLogWriter *event_log(void) {
+        return m_event_log;
+    };
+
+    /* Called once all events of a process are processed */
+    void flush_process(Process &process) {
+        if (!m_process_flush)
+            return;
+
+        process.flushed = true;
+        m_process_flush(process);
+    };
 
 public:
     virtual ~StreamParser() = default;
@@ -593,7 +627,23 @@ public:
         return stats;
     };
 
-    Errorable<void> parse_line(const char *, size_t, uint64_t);
+    /* Every line passed to parse_line() is also stored in the binary event log, when set */
+    void set_event_log(EventLogWriter *event_log) {
+        m_event_log = event_log;
+    };
+
+    /*
+     * Processes are handed over to the callback as soon as their events are processed, instead of
+     * being kept in the process map until release_results(). May be called from the worker threads.
+     */
+    void set_process_flush(std::function<void(Process &)> callback) {
+        m_process_flush = callback;
+    };
+
+    Errorable<void> parse_line(std::string_view, uint64_t);
+
+    /* Like parse_line() for events that are already tokenized (binary event log) */
+    Errorable<void> parse_event(eventTuple_t &);
 };
 
 class CachingParser : public StreamParser {
@@ -638,6 +688,8 @@ private:
         auto result = process_events(process);
         if (result.is_error())
             std::cout << result.explain();
+
+        flush_process(process);
     };
 
     void append_syscall(syscall_raw &&syscall) final override {
@@ -671,6 +723,8 @@ private:
             auto result = process_events(process);
             if (result.is_error())
                 std::cout << result.explain();
+
+            flush_process(process);
         });
     };
 
@@ -702,6 +756,88 @@ public:
     };
 };
 
+/*
+ * Parser that tokenizes the whole input buffer at once instead of being fed line by line. The buffer
+ * is split into line aligned ranges which are tokenized in parallel into per-range maps of events
+ * keyed by upid. The exit cache of the streaming parsers is then replayed on the collected exit
+ * events to find out which events the streaming parsers would have processed together and in which
+ * order, so that the results stay identical to the SinglethreadedParser ones.
+ */
+class ChunkedParser final : public CachingParser {
+private:
+    struct Chunk {
+        size_t begin;
+        size_t end;
+        uint64_t first_line;
+        uint64_t line_count = 0;
+        bool has_events = false;
+        uint64_t first_event_time = 0;
+        uint64_t last_event_time = 0;
+        std::unordered_map<upid_t, std::vector<eventTuple_t>> events;
+        std::vector<std::pair<uint64_t, upid_t>> exits;
+        std::vector<uint64_t> bad_lines;
+        std::vector<std::string> errors;
+        std::unique_ptr<EventLogWriter> event_log;
+
+        /* Defined along with EventLogWriter in parser.cpp */
+        Chunk(void);
+        Chunk(Chunk &&);
+        ~Chunk();
+    };
+
+    /* Side effects of a single cache hit, applied in the streaming parser order afterwards */
+    struct Firing {
+        upid_t pid;
+        uint64_t hitcount;
+        bool pending;
+        std::vector<syscall_raw> syscalls;
+        std::vector<std::pair<upid_t, std::pair<upid_t, unsigned>>> children;
+        std::vector<std::pair<std::string, std::set<upid_t>>> envs;
+
+        Firing(upid_t pid, uint64_t hitcount, bool pending)
+            : pid (pid)
+            , hitcount (hitcount)
+            , pending (pending)
+        {};
+    };
+
+    BS::thread_pool m_pool;
+    std::vector<Chunk> m_chunks;
+    std::vector<Firing> m_firings;
+
+    void add_event(Chunk &, eventTuple_t &);
+    void tokenize_line(Chunk &, std::string_view, uint64_t);
+    void tokenize(const InputBuffer &, Chunk &);
+    void tokenize(const EventLogReader &, Chunk &);
+    void tokenize_chunks(uint64_t, const std::function<void(Chunk &)> &);
+    void replay_cache(void);
+    void process(upid_t, const std::vector<size_t> &);
+
+    void trigger_parsing(Process &process) final override {
+        auto result = process_events(process);
+        if (result.is_error())
+            std::cout << result.explain();
+    };
+
+    void append_syscall(syscall_raw &&) final override;
+    void register_child(upid_t, upid_t, size_t) final override;
+    void add_env(std::string &, std::set<upid_t>) final override;
+
+public:
+    ChunkedParser(size_t threads)
+        : m_pool (threads)
+        {};
+
+    ~ChunkedParser();
+
+    /* Tokenizes [offset, input.size()) where offset is the beginning of line number first_line */
+    void parse(const InputBuffer &input, size_t offset, uint64_t first_line);
+    /* Same for the records of a binary event log ending at size */
+    void parse(const EventLogReader &reader, size_t size, uint64_t first_line);
+
+    virtual void finish_parsing(void) final override;
+};
+
 struct fdinfo {
     fdinfo() : piperd(0), pipewr(0), cloexec(0), pipe_mark(0) {
     }
@@ -724,6 +860,59 @@ struct fdmap_node {
     std::set<upid_t> refs; /* collection of processes this file descriptor is shared with */
 };
 
+/*
+ * Index of the file descriptor tables holding a read end of a pipe at fd 0 (readers) or a write end
+ * of a pipe at fd 1 (writers) by the 'pipe_mark' of the pipe. The sibling pipe check only considers
+ * stdout to stdin connections, so a new execution has to be compared only with the tables found
+ * here for the 'pipe_mark' values of its own fd 0 and fd 1 instead of with all of its siblings.
+ * Has to be updated on every change of the file descriptor tables, see fdmap_insert() and
+ * fdmap_erase().
+ */
+struct stdpipe_index {
+    std::unordered_map<uint32_t, std::set<fdmap_node *>> readers;
+    std::unordered_map<uint32_t, std::set<fdmap_node *>> writers;
+
+    void insert(fdmap_node *node, int fd, const fdinfo &info) {
+        if (fd == 0 && info.piperd)
+            readers[info.pipe_mark].insert(node);
+        else if (fd == 1 && info.pipewr)
+            writers[info.pipe_mark].insert(node);
+    }
+
+    void erase(fdmap_node *node, int fd, const fdinfo &info) {
+        if (!((fd == 0 && info.piperd) || (fd == 1 && info.pipewr)))
+            return;
+
+        auto &ends = fd == 0 ? readers : writers;
+        auto lookup = ends.find(info.pipe_mark);
+        if (lookup == ends.end())
+            return;
+
+        lookup->second.erase(node);
+        if (lookup->second.empty())
+            ends.erase(lookup);
+    }
+
+    /* Removes a table which is about to be deleted */
+    void erase(fdmap_node *node) {
+        for (int fd = 0; fd <= 1; fd++) {
+            auto lookup = node->fdmap.find(fd);
+            if (lookup != node->fdmap.end())
+                erase(node, fd, lookup->second);
+        }
+    }
+};
+
+static inline void fdmap_insert(stdpipe_index &index, fdmap_node *node, int fd, const fdinfo &info) {
+    if (node->fdmap.insert(std::pair<int, fdinfo>(fd, info)).second)
+        index.insert(node, fd, info);
+}
+
+static inline fdmap_t::iterator fdmap_erase(stdpipe_index &index, fdmap_node *node, fdmap_t::iterator it) {
+    index.erase(node, it->first, it->second);
+    return node->fdmap.erase(it);
+}
+
 static inline void update_pipe_map(pipe_map_t &pipe_map, upid_t kpid, unsigned kexeIdx, upid_t vpid, unsigned vexeIdx) {
 
     std::pair<upid_t, unsigned> k(kpid, kexeIdx);
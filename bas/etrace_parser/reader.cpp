@@ -0,0 +1,90 @@
+#include <cerrno>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "reader.hpp"
+
+/* Size of a single read() call when the input can't be mapped */
+#define INPUT_READ_BLOCK_SIZE (16UL * 1024 * 1024)
+
+bool InputBuffer::read_all(int fd) {
+    size_t total = 0;
+
+    for (;;) {
+        m_buffer.resize(total + INPUT_READ_BLOCK_SIZE);
+
+        ssize_t ret = read(fd, m_buffer.data() + total, INPUT_READ_BLOCK_SIZE);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0)
+            return false;
+        if (ret == 0)
+            break;
+
+        total += ret;
+    }
+
+    m_buffer.resize(total);
+    m_data = m_buffer.c_str();
+    m_size = total;
+    m_mapped = false;
+
+    return true;
+}
+
+bool InputBuffer::open(const char *path) {
+    struct stat st;
+    bool ret;
+
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode) || !st.st_size) {
+        ret = read_all(fd);
+        ::close(fd);
+        return ret;
+    }
+
+    size_t size = st.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        ret = read_all(fd);
+        ::close(fd);
+        return ret;
+    }
+
+    const char *data = static_cast<const char *>(map);
+    if (data[size - 1] != '\n' && !(size % sysconf(_SC_PAGESIZE))) {
+        /* No readable byte after the last line, see the note in reader.hpp */
+        munmap(map, size);
+        ret = read_all(fd);
+        ::close(fd);
+        return ret;
+    }
+
+    madvise(map, size, MADV_SEQUENTIAL);
+    ::close(fd);
+
+    m_data = data;
+    m_size = size;
+    m_mapped = true;
+
+    return true;
+}
+
+void InputBuffer::close(void) {
+    if (m_mapped)
+        munmap(const_cast<char *>(m_data), m_size);
+
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include <string>
+#include <string_view>
+
+/*
+ * Read-only view of the whole tracer output.
+ *
+ * The file is mmap'ed whenever possible so that lines can be handed to the parser as
+ * std::string_view objects pointing directly into the page cache. Inputs that can't be mapped
+ * (pipes, character devices, ...) are read with large-block read() calls into a single owned
+ * buffer instead. Either way the data stays valid until close() is called, so the events created
+ * by the parser may reference it for the whole parsing phase.
+ *
+ * @NOTE: Argument parsing relies on every line being followed by a readable byte that is not a
+ * digit (the integer parsers run until the first non-digit character). This holds for every line
+ * ending with '\n'. When the last line isn't terminated and the file size is a multiple of the page
+ * size we fall back to the read() path, which always appends a null byte.
+ */
+class InputBuffer {
+private:
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+    std::string m_buffer;
+
+    bool read_all(int fd);
+
+public:
+    InputBuffer(void) = default;
+    InputBuffer(const InputBuffer &) = delete;
+    InputBuffer& operator=(const InputBuffer &) = delete;
+
+    ~InputBuffer() {
+        close();
+    };
+
+    bool open(const char *path);
+    void close(void);
+
+    const char *data(void) const {
+        return m_data;
+    };
+
+    size_t size(void) const {
+        return m_size;
+    };
+
+    /*
+     * Extracts the next line from the [offset, end) range of the buffer. The returned view doesn't
+     * include the trailing '\n'. Returns false when there are no more lines in the range.
+     */
+    bool next_line(size_t &offset, size_t end, std::string_view &line) const {
+        if (offset >= end)
+            return false;
+
+        const char *begin = m_data + offset;
+        const char *newline = static_cast<const char *>(std::memchr(begin, '\n', end - offset));
+        size_t length = newline ? static_cast<size_t>(newline - begin) : end - offset;
+
+        line = std::string_view(begin, length);
+        offset += length + 1;
+
+        return true;
+    };
+
+    bool next_line(size_t &offset, std::string_view &line) const {
+        return next_line(offset, m_size, line);
+    };
+};
@@ -5,7 +5,7 @@ import os
 import subprocess
 import struct
 
-from typing import List, Tuple, Optional
+from typing import Generator, List, Tuple, Optional, Union
 
 
 ###############################
@@ -15,11 +15,28 @@ class ExecWorkerException(Exception):
     pass
 
 
+# Values of the internal error field of worker responses
+INTERNAL_ERROR_FATAL = 1
+INTERNAL_ERROR_REQUEST = 2
+
+# Batch request flags
+BATCH_FLAG_CACHE = 0x1
+
+# Batch request: (cwd, cmd, args[, input[, cacheable]])
+BatchRequest = tuple
+
+
 class ExecWorker:
     initialized: bool = False
 
-    def __init__(self, workerPath: str = "./worker"):
+    """ With batchJobs > 0 the worker is started in batch mode - requests are sent in batches (see runBatch)
+        and executed by up to batchJobs concurrent subprocesses; results of cacheable requests are kept by
+        the worker (up to cacheSize MB) and reused for identical requests
+    """
+    def __init__(self, workerPath: str = "./worker", batchJobs: int = 0, cacheSize: int = 64):
         self.workerPath = workerPath
+        self.batchJobs = batchJobs
+        self.cacheSize = cacheSize
         self.initialize()
 
     def __del__(self):
@@ -50,7 +67,8 @@ class ExecWorker:
     def initialize(self) -> None:
         self.pRead, self.pChildWrite = os.pipe()
         self.pChildRead, self.pWrite = os.pipe()
-        self.worker = subprocess.Popen([self.workerPath, str(self.pChildRead), str(self.pChildWrite)], 
+        options = ["-b", str(self.batchJobs), "-c", str(self.cacheSize)] if self.batchJobs > 0 else []
+        self.worker = subprocess.Popen([self.workerPath, *options, str(self.pChildRead), str(self.pChildWrite)],
                 shell=False, pass_fds=(self.pChildRead, self.pChildWrite))
         
         os.close(self.pChildRead)
@@ -73,16 +91,11 @@ class ExecWorker:
         self.initialized = False
 
 
-    def runCmd(self, cwd: str, cmd: str, args: List[str], input: Optional[str] = None) -> Tuple[str, str, int]:
-        worker_status = self.worker.poll()
-        if worker_status is not None:
-            self.destroy()
-            raise ExecWorkerException(f"Cannot run command - worker exited with error code {worker_status}")
-
+    @staticmethod
+    def _pack_request(cwd: str, cmd: str, args: List[str], input: Optional[str]) -> bytes:
         if input is None:
             input = ""
 
-        # Send command to worker
         bCwd = cwd.encode()
         bInput = input.encode()
         dataToSend = struct.pack("III", len(bCwd), len(bInput), len(args) + 1)
@@ -92,15 +105,99 @@ class ExecWorker:
             bArg = arg.encode()
             dataToSend += struct.pack("I", len(bArg))
             dataToSend += bArg
-        self._safe_write(self.pWrite, dataToSend)
-        
-        # Hang on pipe read and retrieve output
+        return dataToSend
+
+    def _read_response(self) -> Tuple[bytes, bytes, int, int]:
         header = self._safe_read(self.pRead, 14)
         sizeOut, sizeErr, retCode, error = struct.unpack("IIiH", header)
         dataOut = self._safe_read(self.pRead, sizeOut)
         dataErr = self._safe_read(self.pRead, sizeErr)
+        return dataOut, dataErr, retCode, error
+
+    def _check_worker(self) -> None:
+        worker_status = self.worker.poll()
+        if worker_status is not None:
+            self.destroy()
+            raise ExecWorkerException(f"Cannot run command - worker exited with error code {worker_status}")
+
+
+    def runCmd(self, cwd: str, cmd: str, args: List[str], input: Optional[str] = None) -> Tuple[str, str, int]:
+        if self.batchJobs > 0:
+            result = self.runBatch([(cwd, cmd, args, input)])[0]
+            if isinstance(result, ExecWorkerException):
+                raise result
+            return result
+
+        self._check_worker()
+
+        # Send command to worker
+        self._safe_write(self.pWrite, self._pack_request(cwd, cmd, args, input))
+
+        # Hang on pipe read and retrieve output
+        dataOut, dataErr, retCode, error = self._read_response()
 
         if error:
             self.destroy()
             raise ExecWorkerException(f"Cannot run command - worker encountered an error {dataErr.decode()}")
         return dataOut.decode(), dataErr.decode(), retCode
+
+
+    """ Runs a batch of requests in a worker started in batch mode
+        Returns results in request order; a request that could not be executed gets an ExecWorkerException
+        in place of its result. Raises ExecWorkerException when the whole worker fails
+    """
+    def runBatch(self, requests: List[BatchRequest]) -> List[Union[Tuple[str, str, int], ExecWorkerException]]:
+        assert self.batchJobs > 0, "worker is not running in batch mode"
+        self._check_worker()
+
+        dataToSend = struct.pack("I", len(requests))
+        for request in requests:
+            cwd, cmd, args = request[:3]
+            input = request[3] if len(request) > 3 else None
+            cacheable = request[4] if len(request) > 4 else False
+            dataToSend += struct.pack("I", BATCH_FLAG_CACHE if cacheable else 0)
+            dataToSend += self._pack_request(cwd, cmd, args, input)
+        self._safe_write(self.pWrite, dataToSend)
+
+        results: List[Union[Tuple[str, str, int], ExecWorkerException]] = []
+        for _ in requests:
+            dataOut, dataErr, retCode, error = self._read_response()
+            if error == INTERNAL_ERROR_REQUEST:
+                results.append(ExecWorkerException(f"Cannot run command - {dataErr.decode(errors='replace').rstrip(chr(0))}"))
+            elif error:
+                self.destroy()
+                raise ExecWorkerException(f"Cannot run command - worker encountered an error {dataErr.decode()}")
+            else:
+                results.append((dataOut.decode(), dataErr.decode(), retCode))
+        return results
+
+
+""" Drives generators that yield batch requests and receive their results
+    Every generator processes a single item: it yields a request and gets back its (stdout, stderr, return code)
+    tuple or has the ExecWorkerException thrown in. Pending requests of all generators are sent to the worker
+    as one batch, so independent items are executed concurrently. When the worker fails as a whole it is
+    restarted and the failure is passed to every generator that waits for a result
+"""
+def run_batched(worker: ExecWorker, generators: List[Generator]) -> None:
+    pending = {}
+    for i, gen in enumerate(generators):
+        try:
+            pending[i] = next(gen)
+        except StopIteration:
+            pass
+
+    while pending:
+        ids = list(pending.keys())
+        try:
+            results = worker.runBatch([pending[i] for i in ids])
+        except ExecWorkerException as e:
+            worker.initialize()
+            results = [e] * len(ids)
+        for i, result in zip(ids, results):
+            try:
+                if isinstance(result, ExecWorkerException):
+                    pending[i] = generators[i].throw(result)
+                else:
+                    pending[i] = generators[i].send(result)
+            except StopIteration:
+                del pending[i]
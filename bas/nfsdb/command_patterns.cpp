@@ -0,0 +1,363 @@
+extern "C" {
+#include "pyetrace.h"
+}
+#include <vector>
+#include <string>
+#include <bitset>
+#include <thread>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+#include <fnmatch.h>
+
+/*
+ * Command patterns compiled for matching with the fnmatch(pattern,command,0) semantics.
+ *
+ * Every pattern is split on '*' into segments of single character tokens (literal characters, '?' and
+ * bracket expressions). The longest literal run of each pattern goes into a single Aho-Corasick automaton,
+ * so one pass over a command yields all the patterns that can possibly match it and only these candidates
+ * are verified against their segments. Bracket expressions are turned into character sets by asking
+ * fnmatch about every single character, which keeps ranges, classes and negation consistent with the
+ * current locale. Patterns with constructs that cannot be resolved this way (nested or unterminated
+ * brackets, trailing escapes) and non-ASCII commands in multibyte locales are still passed to fnmatch.
+ */
+
+/* Minimal number of commands matched by a single thread */
+#define COMMAND_PATTERNS_PER_THREAD	256
+
+enum {
+	PATTERN_TOKEN_CHAR,
+	PATTERN_TOKEN_ANY,
+	PATTERN_TOKEN_SET,
+};
+
+struct pattern_token {
+	unsigned char kind;
+	unsigned char c;
+	unsigned set;
+};
+
+typedef std::vector<pattern_token> pattern_segment;
+
+struct compiled_pattern {
+	const char* pattern;
+	bool star;
+	size_t min_length;
+	/* Tokens between consecutive stars (the first and the last segment are anchored) */
+	std::vector<pattern_segment> segments;
+};
+
+struct command_patterns {
+	std::vector<compiled_pattern> patterns;
+	std::vector<std::bitset<256>> sets;
+	/* Aho-Corasick automaton over the literals required by the patterns (256 transitions per state) */
+	std::vector<int> delta;
+	std::vector<std::vector<unsigned>> out;
+	/* Compiled patterns without any literal character to look for */
+	std::vector<unsigned> unfiltered;
+	/* Patterns always matched with fnmatch */
+	std::vector<unsigned> fallback;
+	bool multibyte;
+};
+
+struct command_patterns_scratch {
+	std::vector<unsigned> stamp;
+	std::vector<unsigned> candidates;
+	unsigned current;
+};
+
+static int compile_pattern(struct command_patterns* cp, const char* pattern, compiled_pattern& cpat) {
+
+	if (cp->multibyte) {
+		for (const char* p=pattern; *p; ++p) {
+			if ((unsigned char)*p>=0x80) return 0;
+		}
+	}
+
+	const char* negate = getenv("POSIXLY_CORRECT")?"!":"!^";
+	cpat.segments.push_back(pattern_segment());
+	for (const char* p=pattern; *p; ++p) {
+		pattern_token t = {PATTERN_TOKEN_CHAR,0,0};
+		if (*p=='*') {
+			cpat.star = true;
+			cpat.segments.push_back(pattern_segment());
+			continue;
+		}
+		else if (*p=='?') {
+			t.kind = PATTERN_TOKEN_ANY;
+		}
+		else if (*p=='\\') {
+			if (!*++p) return 0;
+			t.c = *p;
+		}
+		else if (*p=='[') {
+			const char* q = p+1;
+			if (*q && strchr(negate,*q)) ++q;
+			if (*q==']') ++q;
+			for (;; ++q) {
+				if (!*q || (*q=='[')) return 0;
+				if (*q=='\\') {
+					if (!*++q) return 0;
+					continue;
+				}
+				if (*q==']') break;
+			}
+			std::string expr(p,q+1);
+			std::bitset<256> set;
+			char probe[2] = {0,0};
+			for (int c=1; c<256; ++c) {
+				probe[0] = (char)c;
+				if (!fnmatch(expr.c_str(),probe,0)) set.set(c);
+			}
+			t.kind = PATTERN_TOKEN_SET;
+			t.set = cp->sets.size();
+			cp->sets.push_back(set);
+			p = q;
+		}
+		else {
+			t.c = *p;
+		}
+		cpat.segments.back().push_back(t);
+		cpat.min_length++;
+	}
+	return 1;
+}
+
+static std::string pattern_literal(const compiled_pattern& cpat) {
+
+	std::string literal;
+	for (auto& seg : cpat.segments) {
+		size_t i = 0;
+		while (i<seg.size()) {
+			size_t j = i;
+			while ((j<seg.size()) && (seg[j].kind==PATTERN_TOKEN_CHAR)) ++j;
+			if (j-i>literal.size()) {
+				literal.clear();
+				for (size_t k=i; k<j; ++k) literal.push_back(seg[k].c);
+			}
+			i = j+1;
+		}
+	}
+	return literal;
+}
+
+static void build_automaton(struct command_patterns* cp, const std::vector<std::string>& literals) {
+
+	cp->delta.assign(256,-1);
+	cp->out.resize(1);
+	for (size_t k=0; k<literals.size(); ++k) {
+		if (literals[k].empty()) continue;
+		int state = 0;
+		for (unsigned char c : literals[k]) {
+			size_t i = state*256+c;
+			if (cp->delta[i]<0) {
+				cp->delta[i] = cp->out.size();
+				cp->delta.resize(cp->delta.size()+256,-1);
+				cp->out.emplace_back();
+			}
+			state = cp->delta[i];
+		}
+		cp->out[state].push_back(k);
+	}
+
+	std::vector<int> fail(cp->out.size(),0);
+	std::vector<int> queue;
+	for (int c=0; c<256; ++c) {
+		int& s = cp->delta[c];
+		if (s<0) s = 0;
+		else queue.push_back(s);
+	}
+	for (size_t q=0; q<queue.size(); ++q) {
+		int r = queue[q];
+		for (int c=0; c<256; ++c) {
+			int s = cp->delta[r*256+c];
+			if (s<0) {
+				cp->delta[r*256+c] = cp->delta[fail[r]*256+c];
+			}
+			else {
+				fail[s] = cp->delta[fail[r]*256+c];
+				/* The failure state is shallower, hence its outputs are already complete */
+				cp->out[s].insert(cp->out[s].end(),cp->out[fail[s]].begin(),cp->out[fail[s]].end());
+				queue.push_back(s);
+			}
+		}
+	}
+}
+
+struct command_patterns* command_patterns_compile(const char** patterns, size_t count) {
+
+	struct command_patterns* cp = new command_patterns;
+	cp->multibyte = MB_CUR_MAX>1;
+	cp->patterns.resize(count);
+	std::vector<std::string> literals(count);
+	for (size_t k=0; k<count; ++k) {
+		compiled_pattern& cpat = cp->patterns[k];
+		cpat.pattern = patterns[k];
+		cpat.star = false;
+		cpat.min_length = 0;
+		if (!compile_pattern(cp,patterns[k],cpat)) {
+			cp->fallback.push_back(k);
+			continue;
+		}
+		literals[k] = pattern_literal(cpat);
+		if (literals[k].empty()) {
+			cp->unfiltered.push_back(k);
+		}
+	}
+	build_automaton(cp,literals);
+	return cp;
+}
+
+void command_patterns_destroy(struct command_patterns* cp) {
+
+	delete cp;
+}
+
+static inline bool segment_match(const struct command_patterns* cp, const pattern_segment& seg, const unsigned char* s) {
+
+	for (size_t i=0; i<seg.size(); ++i) {
+		const pattern_token& t = seg[i];
+		if (t.kind==PATTERN_TOKEN_CHAR) {
+			if (t.c!=s[i]) return false;
+		}
+		else if (t.kind==PATTERN_TOKEN_SET) {
+			if (!cp->sets[t.set].test(s[i])) return false;
+		}
+	}
+	return true;
+}
+
+static bool pattern_match(const struct command_patterns* cp, const compiled_pattern& cpat, const unsigned char* s, size_t n) {
+
+	if (n<cpat.min_length) return false;
+	const pattern_segment& first = cpat.segments.front();
+	if (!cpat.star) {
+		return (n==first.size()) && segment_match(cp,first,s);
+	}
+	const pattern_segment& last = cpat.segments.back();
+	if (!segment_match(cp,first,s) || !segment_match(cp,last,s+n-last.size())) {
+		return false;
+	}
+	/* Leftmost placement of every middle segment leaves the most room for the following ones */
+	size_t pos = first.size();
+	size_t end = n-last.size();
+	for (size_t i=1; i+1<cpat.segments.size(); ++i) {
+		const pattern_segment& seg = cpat.segments[i];
+		if (seg.empty()) continue;
+		for (;;) {
+			if (pos+seg.size()>end) return false;
+			if (seg[0].kind==PATTERN_TOKEN_CHAR) {
+				const void* f = memchr(s+pos,seg[0].c,end-seg.size()+1-pos);
+				if (!f) return false;
+				pos = (const unsigned char*)f-s;
+			}
+			if (segment_match(cp,seg,s+pos)) break;
+			++pos;
+		}
+		pos+=seg.size();
+	}
+	return true;
+}
+
+static void command_patterns_match(const struct command_patterns* cp, const char* command, unsigned char* bitmap,
+		struct command_patterns_scratch& scratch) {
+
+	size_t count = cp->patterns.size();
+	memset(bitmap,0,(count-1)/8+1);
+	const unsigned char* s = (const unsigned char*)command;
+	size_t n = strlen(command);
+
+	bool fallback = false;
+	if (cp->multibyte) {
+		for (size_t i=0; i<n; ++i) {
+			if (s[i]>=0x80) {
+				fallback = true;
+				break;
+			}
+		}
+	}
+	if (fallback) {
+		for (size_t k=0; k<count; ++k) {
+			if (!fnmatch(cp->patterns[k].pattern,command,0)) {
+				bitmap[k/8]|=0x01<<(7-k%8);
+			}
+		}
+		return;
+	}
+
+	if (++scratch.current==0) {
+		std::fill(scratch.stamp.begin(),scratch.stamp.end(),0);
+		scratch.current = 1;
+	}
+	scratch.candidates.assign(cp->unfiltered.begin(),cp->unfiltered.end());
+	int state = 0;
+	for (size_t i=0; i<n; ++i) {
+		state = cp->delta[state*256+s[i]];
+		for (unsigned k : cp->out[state]) {
+			if (scratch.stamp[k]!=scratch.current) {
+				scratch.stamp[k] = scratch.current;
+				scratch.candidates.push_back(k);
+			}
+		}
+	}
+
+	for (unsigned k : scratch.candidates) {
+		if (pattern_match(cp,cp->patterns[k],s,n)) {
+			bitmap[k/8]|=0x01<<(7-k%8);
+		}
+	}
+	for (unsigned k : cp->fallback) {
+		if (!fnmatch(cp->patterns[k].pattern,command,0)) {
+			bitmap[k/8]|=0x01<<(7-k%8);
+		}
+	}
+}
+
+/* Calls fn(scratch,begin,end) for contiguous ranges of [0,count) on separate threads */
+template <typename F>
+static void command_patterns_run(const struct command_patterns* cp, size_t count, size_t jobs, F&& fn) {
+
+	if (!jobs) {
+		jobs = std::max(1U,std::thread::hardware_concurrency());
+	}
+	jobs = std::max((size_t)1,std::min(jobs,count/COMMAND_PATTERNS_PER_THREAD));
+	std::vector<std::thread> threads;
+	auto part = [&](size_t n) {
+		struct command_patterns_scratch scratch;
+		scratch.stamp.assign(cp->patterns.size(),0);
+		scratch.current = 0;
+		fn(scratch,count*n/jobs,count*(n+1)/jobs);
+	};
+	for (size_t n=1; n<jobs; ++n) {
+		threads.emplace_back(part,n);
+	}
+	part(0);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+void command_patterns_match_strings(const struct command_patterns* cp, const char** commands, size_t count,
+		unsigned char* bitmaps, size_t jobs) {
+
+	size_t bsize = (cp->patterns.size()-1)/8+1;
+	command_patterns_run(cp,count,jobs,[&](struct command_patterns_scratch& scratch, size_t begin, size_t end) {
+		for (size_t u=begin; u<end; ++u) {
+			command_patterns_match(cp,commands[u],&bitmaps[u*bsize],scratch);
+		}
+	});
+}
+
+void command_patterns_match_nfsdb(const struct command_patterns* cp, const struct nfsdb* nfsdb,
+		unsigned long begin, unsigned long end, unsigned char* bitmaps, size_t jobs) {
+
+	size_t bsize = (cp->patterns.size()-1)/8+1;
+	command_patterns_run(cp,end-begin,jobs,[&](struct command_patterns_scratch& scratch, size_t first, size_t last) {
+		for (size_t u=first; u<last; ++u) {
+			struct nfsdb_entry* entry = &nfsdb->nfsdb_entry[begin+u];
+			const char* cmdstr = libetrace_nfsdb_string_handle_join(nfsdb,entry->argv,entry->argv_count," ");
+			command_patterns_match(cp,cmdstr,&bitmaps[u*bsize],scratch);
+			free((void*)cmdstr);
+		}
+	});
+}
@@ -7,6 +7,12 @@ extern "C" {
 #include <set>
 #include <map>
 #include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
 
 static inline int SET_MSB_INT(int i) {
 	return i|(1<<(CHAR_BIT*sizeof(int)-1));
@@ -49,12 +55,71 @@ static int pattern_match(const char* p, const char** excl_patterns, size_t excl_
     return 0;
 }
 
-struct libetrace_nfsdb_entry_openfile_object_less {
-    bool operator()(const libetrace_nfsdb_entry_openfile_object * lhs, const libetrace_nfsdb_entry_openfile_object * rhs) const {
-    	return memcmp(&lhs->parent,&rhs->parent,2*sizeof(unsigned long))<0;
+/* Opened file dependency: (nfsdb_index,open_index) */
+typedef std::pair<unsigned long,unsigned long> depproc_openfile;
+
+/* Keeps the order of the openfile objects used so far (i.e. memcmp over the parent and index fields) */
+struct depproc_openfile_less {
+    bool operator()(const depproc_openfile& lhs, const depproc_openfile& rhs) const {
+    	unsigned long l[2] = {lhs.first,lhs.second};
+    	unsigned long r[2] = {rhs.first,rhs.second};
+    	return memcmp(l,r,2*sizeof(unsigned long))<0;
     }
 };
 
+/* Process that have written to a file (with the wrapping process already resolved) */
+struct depproc_writer {
+	upid_t pid;
+	upid_t wrapping_pid;
+	unsigned long nfsdb_index;
+	unsigned long open_index;
+};
+
+/* Thread safe map of the memoized subresults (values never move once inserted) */
+template<typename T>
+struct depproc_memo_map {
+	static const unsigned long shard_count = 64;
+	struct shard {
+		std::mutex lock;
+		std::unordered_map<unsigned long,std::unique_ptr<T>> map;
+	};
+	shard shards[shard_count];
+
+	shard& get_shard(unsigned long key) {
+		return shards[(key*0x9e3779b97f4a7c15UL)>>58];
+	}
+
+	const T* find(unsigned long key) {
+		shard& s = get_shard(key);
+		std::lock_guard<std::mutex> guard(s.lock);
+		auto i = s.map.find(key);
+		return (i!=s.map.end())?(*i).second.get():0;
+	}
+
+	/* Returns the value already stored for the 'key' when some other thread was first */
+	const T* insert(unsigned long key, T&& value) {
+		shard& s = get_shard(key);
+		std::lock_guard<std::mutex> guard(s.lock);
+		auto i = s.map.find(key);
+		if (i!=s.map.end()) {
+			return (*i).second.get();
+		}
+		T* v = new T(std::move(value));
+		s.map.emplace(key,std::unique_ptr<T>(v));
+		return v;
+	}
+};
+
+/*
+ * Subresults shared by all the dependency computations of 'create_deps_image'
+ * They depend on the database only (and the 'wrap_deps' parameter in case of the writers) and not on the module
+ *  being processed, therefore every file and wrapping process is resolved once across all modules and both passes
+ */
+struct depproc_memo {
+	depproc_memo_map<std::vector<depproc_writer>> writers;			/* file handle -> processes that have written to it */
+	depproc_memo_map<std::vector<unsigned long>> wrapped_reads;		/* wrapping pid -> files read (and not written) by descendants */
+};
+
 struct depproc_context {
 	std::set<unsigned long> excl_set;					/* 'exclude_files' parameter */
 	const char** excl_patterns;							/* 'exclude_patterns' parameter */	/* ALLOC */
@@ -73,18 +138,23 @@ struct depproc_context {
 	int timeout;										/* 'timeout' paramater */
 	int use_pipes;										/* 'use_pipes' parameter */	/* Default: 1 */
 	std::set<unsigned long> all_modules_set;			/* 'all_modules' parameter */
+	const std::set<unsigned long>* all_modules;			/* Linked modules considered in direct dependencies (usually 'all_modules_set') */
+	std::set<unsigned long> roots;						/* Files the dependencies are computed for */
+	struct depproc_memo* memo;							/* Shared subresults (can be NULL) */
+	std::string error;									/* Internal error message */
 	timer_t timer_id;
 	std::deque<upid_t> qpid;
 	std::set<upid_t> writing_process_list;
 	std::set<upid_t> all_writing_process_list;
-	std::set<libetrace_nfsdb_entry_openfile_object*,libetrace_nfsdb_entry_openfile_object_less> openfile_deps;
+	std::set<depproc_openfile,depproc_openfile_less> openfile_deps;
 	std::deque<unsigned long> files;
 	std::unordered_set<unsigned long> files_set;
 	std::unordered_set<unsigned long> fdone;
 	depproc_context():
 		excl_patterns(0), excl_patterns_size(0), excl_commands(0), excl_commands_size(0),
 		excl_commands_index(0), excl_commands_index_size(0), direct_deps(0), debug(0), fd_debug(0),
-		dry_run(0), negate_pattern(0), dep_graph(0), wrap_deps(0), timeout(0), use_pipes(1), timer_id(0) {}
+		dry_run(0), negate_pattern(0), dep_graph(0), wrap_deps(0), timeout(0), use_pipes(1), all_modules(&all_modules_set),
+		memo(0), timer_id(0) {}
 };
 
 static volatile int interrupt = 0;
@@ -103,18 +173,13 @@ static void depproc_context_free(struct depproc_context* context) {
 	}
 	free(context->excl_commands);
 	free(context->excl_commands_index);
-	for (auto u = context->openfile_deps.begin(); u!=context->openfile_deps.end(); ++u) {
-		Py_DecRef((PyObject*)*u);
-	}
 }
 
-static int phs_find(std::vector<std::pair<unsigned long,const char*>>& phs, unsigned long phandle) {
+static void depproc_set_error(struct depproc_context* context, const char* fmt, unsigned long v) {
 
-	for (std::vector<std::pair<unsigned long,const char*>>::iterator i=phs.begin(); i!=phs.end(); ++i) {
-		if ((*i).first==phandle) return 1;
-	}
-
-	return 0;
+	char errmsg[ERRMSG_BUFFER_SIZE];
+	snprintf(errmsg,ERRMSG_BUFFER_SIZE,fmt,v);
+	context->error = errmsg;
 }
 
 static void phs_free(std::vector<std::pair<unsigned long,const char*>>& phs) {
@@ -124,8 +189,7 @@ static void phs_free(std::vector<std::pair<unsigned long,const char*>>& phs) {
 	}
 }
 
-static int depproc_parse_args(libetrace_nfsdb_object* self,std::vector<std::pair<unsigned long,const char*>>& phs,
-		PyObject* kwargs, struct depproc_context* context) {
+static int depproc_parse_args(libetrace_nfsdb_object* self, PyObject* kwargs, struct depproc_context* context) {
 
 	static char errmsg[ERRMSG_BUFFER_SIZE];
 
@@ -145,7 +209,7 @@ static int depproc_parse_args(libetrace_nfsdb_object* self,std::vector<std::pair
 			int u;
 			for (u=0; u<PyList_Size(exclude_files); ++u) {
 				const char* exclude_file = PyString_get_c_str(PyList_GetItem(exclude_files,u));
-				struct stringRefMap_node* efnode = stringRefMap_search(&self->nfsdb->revstringmap,exclude_file);
+				struct stringHashMap_node* efnode = stringHashMap_search(&self->nfsdb->revstringmap,exclude_file);
 				if (!efnode) {
 					snprintf(errmsg,ERRMSG_BUFFER_SIZE,"Invalid exclude file key [%s]",exclude_file);
 					PyErr_SetString(libetrace_nfsdbError, errmsg);
@@ -248,7 +312,7 @@ static int depproc_parse_args(libetrace_nfsdb_object* self,std::vector<std::pair
 			int u;
 			for (u=0; u<PyList_Size(all_modules); ++u) {
 				const char* module_name = PyString_get_c_str(PyList_GetItem(all_modules,u));
-				struct stringRefMap_node* mfnode = stringRefMap_search(&self->nfsdb->revstringmap,module_name);
+				struct stringHashMap_node* mfnode = stringHashMap_search(&self->nfsdb->revstringmap,module_name);
 				if (!mfnode) {
 					snprintf(errmsg,ERRMSG_BUFFER_SIZE,"Invalid module name key [%s]",module_name);
 					PyErr_SetString(libetrace_nfsdbError, errmsg);
@@ -259,11 +323,6 @@ static int depproc_parse_args(libetrace_nfsdb_object* self,std::vector<std::pair
 				DBG(context->debug,"        module: %s\n",module_name);
 				PYASSTR_DECREF(module_name);
 			}
-			for (std::vector<std::pair<unsigned long,const char*>>::iterator pi = phs.begin(); pi!=phs.end(); ++pi) {
-				if (context->all_modules_set.find((*pi).first)!=context->all_modules_set.end()) {
-					context->all_modules_set.erase((*pi).first);
-				}
-			}
 		}
 
 		PyObject* direct = PyDict_GetItemString(kwargs, "direct");
@@ -273,13 +332,11 @@ static int depproc_parse_args(libetrace_nfsdb_object* self,std::vector<std::pair
 		DBG(context->debug,"        direct=%s\n",context->direct_deps?"true":"false");
 		if (!all_modules) {
 			/* Fill the all modules set with all linked modules paths */
-			struct rb_node * p = rb_first(&self->nfsdb->linkedmap);
+			struct nfsdb_entryMap_node* p = nfsdb_entryMap_first(&self->nfsdb->linkedmap);
 			while(p) {
 				struct nfsdb_entryMap_node* data = (struct nfsdb_entryMap_node*)p;
-				if (!phs_find(phs, data->key)) {
-					context->all_modules_set.insert(data->key);
-				}
-				p = rb_next(p);
+				context->all_modules_set.insert(data->key);
+				p = nfsdb_entryMap_next(&self->nfsdb->linkedmap,p);
 			}
 		}
 	}
@@ -527,63 +584,59 @@ static long depproc_process_qpid(libetrace_nfsdb_object* self, struct depproc_co
 	return processed;
 }
 
-/* Returns the number of new processes marked as writing processes for further consideration
- * Returns -1 when interrupted */
-static long depproc_process_written_file(libetrace_nfsdb_object* self, struct depproc_context* context,
-		std::map<upid_t,std::string>& writing_pid_map, unsigned long fh) {
+/* Returns the processes that have written to the 'fh' file (sorted by pid)
+ * The list is taken from the shared memo when available, otherwise it's computed into 'writers'
+ * Returns NULL on error */
+static const std::vector<depproc_writer>* depproc_file_writers(libetrace_nfsdb_object* self, struct depproc_context* context,
+		unsigned long fh, std::vector<depproc_writer>& writers) {
 
-	long processed = 0;
-	static char errmsg[ERRMSG_BUFFER_SIZE];
+	if (context->memo) {
+		const std::vector<depproc_writer>* memo_writers = context->memo->writers.find(fh);
+		if (memo_writers) {
+			return memo_writers;
+		}
+	}
 
 	struct nfsdb_fileMap_node* fnode = fileMap_search(&self->nfsdb->filemap,fh);
-	ASSERT_RETURN_WITH_NFSDB_FORMAT_ERROR(fnode,"Internal nfsdb error at binary path handle [%lu]",-1,fh);
-
-	if ((fnode->wr_entry_count<=0) && (fnode->rw_entry_count<=0)) {
-		DBG(context->fd_debug,"   missing entry in rev_wr_map\n");
-		return processed;
+	if (!fnode) {
+		depproc_set_error(context,"Internal nfsdb error at binary path handle [%lu]",fh);
+		return 0;
 	}
 
-	/* Here we get a list of processes that have written to the 'fh' file */
-	DBG(context->fd_debug,"   writing process count: %ld\n",fnode->wr_entry_count+fnode->rw_entry_count);
 	/* Process the pids in sorted order (to simplify potential debugging) */
 	unsigned long wri=0, rwi=0;
 	upid_t lastpid = 0;
 	while(1) {
 		if ((wri>=fnode->wr_entry_count) && (rwi>=fnode->rw_entry_count)) break;
-		upid_t writing_pid;
 		struct nfsdb_entry* writing_entry;
 		unsigned long writing_open_index;
 		if ((wri<fnode->wr_entry_count) && (rwi>=fnode->rw_entry_count)) {
 			writing_entry = fnode->wr_entry_list[wri];
-			writing_pid = fnode->wr_entry_list[wri]->eid.pid;
 			writing_open_index = fnode->wr_entry_index[wri];
 			wri++;
 		}
 		else if ((wri>=fnode->wr_entry_count) && (rwi<fnode->rw_entry_count)) {
 			writing_entry = fnode->rw_entry_list[rwi];
-			writing_pid = fnode->rw_entry_list[rwi]->eid.pid;
 			writing_open_index = fnode->rw_entry_index[rwi];
 			rwi++;
 		}
 		else {
 			if (fnode->wr_entry_list[wri]->eid.pid<fnode->rw_entry_list[rwi]->eid.pid) {
 				writing_entry = fnode->wr_entry_list[wri];
-				writing_pid = fnode->wr_entry_list[wri]->eid.pid;
 				writing_open_index = fnode->wr_entry_index[wri];
 				wri++;
 			}
 			else {
 				writing_entry = fnode->rw_entry_list[rwi];
-				writing_pid = fnode->rw_entry_list[rwi]->eid.pid;
 				writing_open_index = fnode->rw_entry_index[rwi];
 				rwi++;
 			}
 		}
+		upid_t writing_pid = writing_entry->eid.pid;
 		if (writing_pid==lastpid) continue;
 		lastpid=writing_pid;
 		/* Handle executions by 'pid' */
 		upid_t wrapping_pid = writing_pid;
-		DBG(context->fd_debug,"     writing pid: " GENERIC_ARG_PID_FMT,writing_pid);
 		if (context->wrap_deps) {
 			/* Sometimes executed processes are intertwined together, for example:
 			 * /bin/bash -c "cat <...> | sort > out.f"
@@ -600,13 +653,48 @@ static long depproc_process_written_file(libetrace_nfsdb_object* self, struct de
 					if (entry->wrapper_pid!=ULONG_MAX) {
 						/* Tell the read dependency processor which runs later that this was the wrapping pid,
 						 * not the original pid by setting the MSB bit */
-						DBG(context->fd_debug,", wrapping pid: " GENERIC_ARG_PID_FMT, entry->eid.pid);
 						wrapping_pid = SET_MSB_UPID(entry->eid.pid);
 						break;
 					}
 				}
 			}
 		}
+		writers.push_back({writing_pid,wrapping_pid,writing_entry->nfsdb_index,writing_open_index});
+	}
+
+	if (context->memo) {
+		return context->memo->writers.insert(fh,std::move(writers));
+	}
+	return &writers;
+}
+
+/* Returns the number of new processes marked as writing processes for further consideration
+ * Returns -1 when interrupted (or on error) */
+static long depproc_process_written_file(libetrace_nfsdb_object* self, struct depproc_context* context,
+		std::map<upid_t,std::string>& writing_pid_map, unsigned long fh) {
+
+	long processed = 0;
+
+	std::vector<depproc_writer> file_writers;
+	const std::vector<depproc_writer>* writers = depproc_file_writers(self,context,fh,file_writers);
+	if (!writers) {
+		return -1;
+	}
+
+	if (writers->empty()) {
+		DBG(context->fd_debug,"   missing entry in rev_wr_map\n");
+		return processed;
+	}
+
+	/* Here we get a list of processes that have written to the 'fh' file */
+	DBG(context->fd_debug,"   writing process count: %zu\n",writers->size());
+	for (auto wi=writers->begin(); wi!=writers->end(); ++wi) {
+		upid_t writing_pid = (*wi).pid;
+		upid_t wrapping_pid = (*wi).wrapping_pid;
+		DBG(context->fd_debug,"     writing pid: " GENERIC_ARG_PID_FMT,writing_pid);
+		if (wrapping_pid!=writing_pid) {
+			DBG(context->fd_debug,", wrapping pid: " GENERIC_ARG_PID_FMT,(upid_t)CLEAR_MSB_UPID(wrapping_pid));
+		}
 		DBG(context->fd_debug,"\n");
 		long match=0;
 		if (context->excl_commands_index) {
@@ -638,11 +726,7 @@ static long depproc_process_written_file(libetrace_nfsdb_object* self, struct de
 			writing_pid_map[wrapping_pid] = self->nfsdb->string_table[fh];
 		}
 		context->all_writing_process_list.insert(writing_pid);
-		libetrace_nfsdb_entry_openfile_object* openfile = libetrace_nfsdb_create_openfile_entry(
-				self,writing_entry,writing_open_index,writing_entry->nfsdb_index);
-		if (!context->openfile_deps.insert(openfile).second) {
-			Py_DecRef((PyObject*)openfile);
-		}
+		context->openfile_deps.insert(depproc_openfile((*wi).nfsdb_index,(*wi).open_index));
 		context->qpid.push_back(wrapping_pid);
 		if (g_timer||interrupt) return -1;
 		std::string f = self->nfsdb->string_table[fh];
@@ -696,10 +780,17 @@ static void process_write_open_files_unique_with_children(libetrace_nfsdb_object
 	}
 }
 
-static long get_wrapping_process_descendants_read_files(libetrace_nfsdb_object* self, struct depproc_context* context,
-		upid_t pid, std::vector<unsigned long>& dep_flist) {
+/* Returns the files read (and not written) by the process 'pid' and all its descendants (sorted by handle)
+ * The list is taken from the shared memo when available, otherwise it's computed into 'reads' */
+static const std::vector<unsigned long>* depproc_wrapped_reads(libetrace_nfsdb_object* self, struct depproc_context* context,
+		upid_t pid, std::vector<unsigned long>& reads) {
 
-	long rcount = 0;
+	if (context->memo) {
+		const std::vector<unsigned long>* memo_reads = context->memo->wrapped_reads.find(pid);
+		if (memo_reads) {
+			return memo_reads;
+		}
+	}
 
 	std::set<unsigned long> rdfiles;
 	process_read_open_files_unique_with_children(self,pid,rdfiles);
@@ -709,10 +800,26 @@ static long get_wrapping_process_descendants_read_files(libetrace_nfsdb_object*
 	std::set<unsigned long> wrfiles;
 	process_write_open_files_unique_with_children(self,pid,wrfiles);
 	for (decltype(rdfiles)::iterator i=rdfiles.begin(); i!=rdfiles.end(); ++i) {
-		unsigned long rdh = (*i);
-		if (wrfiles.find(rdh)!=wrfiles.end()) {
-			continue;
+		if (wrfiles.find(*i)==wrfiles.end()) {
+			reads.push_back(*i);
 		}
+	}
+
+	if (context->memo) {
+		return context->memo->wrapped_reads.insert(pid,std::move(reads));
+	}
+	return &reads;
+}
+
+static long get_wrapping_process_descendants_read_files(libetrace_nfsdb_object* self, struct depproc_context* context,
+		upid_t pid, std::vector<unsigned long>& dep_flist) {
+
+	long rcount = 0;
+
+	std::vector<unsigned long> wrapped_reads;
+	const std::vector<unsigned long>* reads = depproc_wrapped_reads(self,context,pid,wrapped_reads);
+	for (auto i=reads->begin(); i!=reads->end(); ++i) {
+		unsigned long rdh = (*i);
 		if (context->dep_graph) {
 			dep_flist.push_back(rdh);
 		}
@@ -750,11 +857,7 @@ static long get_process_read_files(libetrace_nfsdb_object* self, struct depproc_
 						dep_flist.push_back(rdh);
 					}
 					if ((context->files_set.find(rdh)==context->files_set.end()) && (context->fdone.find(rdh)==context->fdone.end())) {
-						libetrace_nfsdb_entry_openfile_object* openfile = libetrace_nfsdb_create_openfile_entry(
-								self,entry,i,entry->nfsdb_index);
-						if (!context->openfile_deps.insert(openfile).second) {
-							Py_DecRef((PyObject*)openfile);
-						}
+						context->openfile_deps.insert(depproc_openfile(entry->nfsdb_index,i));
 						if ((context->excl_set.find(rdh)==context->excl_set.end()) &&
 								(pattern_match(self->nfsdb->string_table[rdh],
 										context->excl_patterns,context->excl_patterns_size)==context->negate_pattern)) {
@@ -777,8 +880,6 @@ static long get_process_read_files(libetrace_nfsdb_object* self, struct depproc_
 
 static int workaround_gcc_pipe_compilation_mode(libetrace_nfsdb_object* self, struct depproc_context* context, upid_t pid) {
 
-	static char errmsg[ERRMSG_BUFFER_SIZE];
-
 	struct nfsdb_entryMap_node* node = nfsdb_entryMap_search(&self->nfsdb->procmap,pid);
 	if (node) {
 		for (unsigned long u=0; u<node->entry_count; ++u) {
@@ -787,7 +888,10 @@ static int workaround_gcc_pipe_compilation_mode(libetrace_nfsdb_object* self, st
 			size_t len = strlen(bpath);
 			if (!strncmp(bpath+len-4,"/cc1",4)) {
 				struct ulongMap_node* node = ulongMap_search(&self->nfsdb->revforkmap, pid);
-				ASSERT_RETURN_WITH_NFSDB_FORMAT_ERROR(node,"Internal nfsdb error at parent search [%lu]",-1,pid);
+				if (!node) {
+					depproc_set_error(context,"Internal nfsdb error at parent search [%lu]",pid);
+					return -1;
+				}
 				context->all_writing_process_list.insert(node->value_list[0]);
 				break;
 			}
@@ -868,6 +972,121 @@ static int build_dep_graph_entry(libetrace_nfsdb_object* self, struct depproc_co
 	return 0;
 }
 
+
+/*
+ * Computes the dependencies of the files in 'context->roots'
+ * The results are left in the context ('fdone', 'all_writing_process_list' and 'openfile_deps')
+ * Returns 0 on success, 1 when interrupted (or timed out) and 2 on error
+ */
+static int depproc_run(libetrace_nfsdb_object* self, struct depproc_context* context, PyObject* dgraph) {
+
+	for (std::set<unsigned long>::iterator i=context->roots.begin(); i!=context->roots.end(); ++i) {
+		context->files.push_back(*i);
+		context->files_set.insert(*i);
+	}
+
+	/*
+	 * Given specific linked file (say vmlinux.o) we get a list of all processes (most probably the linker process) that ever written
+	 *  to this file ("writing_pid" variable). Now for each such process we get all the files read by this process (i.e. files read
+	 *  by the linker) and we repeat this procedure for each read file (i.e. subsequent object files) until there's no new read files.
+	 */
+
+	unsigned long pass_count = 0;
+	while(!context->files.empty()) {
+		context->writing_process_list.clear();
+		auto file_iter = context->files.begin();
+		std::map<upid_t,std::string> writing_pid_map;
+		DBG(context->debug,"@ main pass[%lu] files to proc: %zu\n",pass_count,context->files.size());
+		while(file_iter!=context->files.end()) {
+			/* fh - handle of the file that's been written to
+			 * Find all processes that have written to it */
+			unsigned long fh = *file_iter;
+			DBG(context->fd_debug,"   considering file: %s\n",self->nfsdb->string_table[fh]);
+			if ((!context->direct_deps) || (context->roots.find(fh)!=context->roots.end()) ||
+					(context->all_modules->find(fh)==context->all_modules->end())) {
+				/* Gets a list of processes that have written to the 'fh' file
+				 * For each such process:
+				 *  - check if wrapping process should be considered instead of the original ('wrapping_pid' vs 'writing_pid')
+				 *  - check if any command executed by this process matches the exclusion command pattern (skip this process in such a case)
+				 *  - mark this process as a writing process for further processing
+				 *      (fills 'writing_process_list' and 'all_writing_process_list')
+				 *  - check if this process could write to any other processes (parent or sibling) through pipe. In such case repeat
+				 *     the above steps for each such process (which can also be wrapped-up).
+				 */
+				long procs = depproc_process_written_file(self,context,writing_pid_map,fh);
+				if (procs<0) {
+					return context->error.empty()?1:2;
+				}
+				DBG(context->fd_debug,"   number of new writing processes to consider: %ld\n",procs);
+			}
+			else {
+				DBG(context->fd_debug,"   skipped file: %s\n",self->nfsdb->string_table[fh]);
+				/* If the file on the dependency list is a linked module and we want only direct dependencies
+				 * skip further processing for this file */
+			}
+			unsigned long pending = context->files.front();
+			context->files.pop_front();
+			context->files_set.erase(pending);
+			context->fdone.insert(pending);
+			file_iter++;
+			if (g_timer||interrupt) {
+				return 1;
+			}
+		} /* while(files.iter) */
+
+		/* Process all writing processes */
+		DBG(context->debug,"@ read pass[%lu] writing processes to consider: %zu\n",pass_count++,context->writing_process_list.size());
+		auto pid_iter = context->writing_process_list.begin();
+
+		while (pid_iter!=context->writing_process_list.end()) {
+			upid_t pid = *pid_iter;
+			upid_t wrapping_pid = pid;
+			if ((context->wrap_deps)&&(MSB_IS_SET_UPID(pid))) {
+				/* We have a pid of the wrapping process, get the real pid */
+				pid = CLEAR_MSB_UPID(pid);
+			}
+			std::vector<unsigned long> dep_flist;
+			DBG(context->fd_debug,"   considering process: " GENERIC_ARG_PID_FMT "\n",pid);
+			ulongMap_node* node = ulongMap_search(&self->nfsdb->rdmap, pid);
+			if (node) {
+				if ((context->wrap_deps)&&(MSB_IS_SET_UPID(wrapping_pid))) {
+					/* Get files opened for read for all descendants of the wrapping process
+					 *  Fills 'files', 'files_set' and 'fdone' upon completion
+					 */
+					get_wrapping_process_descendants_read_files(self,context,pid,dep_flist);
+				}
+				else {
+					/* Get files opened for read for this process
+					 *  Fills 'files', 'files_set' and 'fdone' upon completion
+					 */
+					get_process_read_files(self,context,pid,dep_flist);
+				}
+			}
+			/* When gcc uses -pipe then driver process doesn't open the file being compiled and the driver pid
+			 * is not listed in the writing process list. On the other hand the driver process is detected as a compiler
+			 * but is missing in the list of processes that wrote to dependencies of some higher level module.
+			 * All that lead to the Eclipse project generation errors.
+			 * Let's have a workaround for this: detect *cc1 compilers and add it's parent (i.e. the driver process) to the
+			 * writing process list */
+			if (workaround_gcc_pipe_compilation_mode(self,context,pid)) {
+				return 2;
+			}
+			pid_iter++;
+			if (context->dep_graph) {
+				if (build_dep_graph_entry(self,context,wrapping_pid,writing_pid_map,dgraph,dep_flist)) {
+					return 2;
+				}
+			}
+			if (g_timer||interrupt) {
+				return 1;
+			}
+		} /* while(pid.iter) */
+		DBG( context->debug, "   done files: %zu\n",context->fdone.size());
+	}
+
+	return 0;
+}
+
 /*
  *	file_dependencies(<PATH>,
  *	  exclude_files = [<PATH>,...],
@@ -907,11 +1126,13 @@ PyObject* libetrace_nfsdb_file_dependencies(libetrace_nfsdb_object *self, PyObje
 					PyList_Append(path_args,__arg);
 				}
 				else {
+					Py_DecRef(path_args);
 					ASSERT_WITH_NFSDB_ERROR(0,"Invalid argument type: not (str) or (list)");
 				}
 			}
 		}
 		else {
+			Py_DecRef(path_args);
 			ASSERT_WITH_NFSDB_ERROR(0,"Invalid argument type: not (str) or (list)");
 		}
 	}
@@ -920,11 +1141,22 @@ PyObject* libetrace_nfsdb_file_dependencies(libetrace_nfsdb_object *self, PyObje
 	for (Py_ssize_t i=0; i<PyList_Size(path_args); ++i) {
 		PyObject* arg = PyList_GetItem(path_args,i);
 		const char* arg_cstr = PyString_get_c_str(arg);
-		struct stringRefMap_node* pnode = stringRefMap_search(&self->nfsdb->revstringmap, arg_cstr);
-		ASSERT_WITH_NFSDB_FORMAT_ERROR(pnode,"Invalid pathname key [%s]",arg_cstr);
+		struct stringHashMap_node* pnode = stringHashMap_search(&self->nfsdb->revstringmap, arg_cstr);
+		struct nfsdb_fileMap_node* node = pnode?fileMap_search(&self->nfsdb->filemap,pnode->value):0;
+		if (!node) {
+			if (!pnode) {
+				snprintf(errmsg,ERRMSG_BUFFER_SIZE,"Invalid pathname key [%s]",arg_cstr);
+			}
+			else {
+				snprintf(errmsg,ERRMSG_BUFFER_SIZE,"Internal nfsdb error at binary path handle [%lu]",pnode->value);
+			}
+			PyErr_SetString(libetrace_nfsdbError, errmsg);
+			PYASSTR_DECREF(arg_cstr);
+			phs_free(phs);
+			Py_DecRef(path_args);
+			return 0;
+		}
 		unsigned long phandle = pnode->value;
-		struct nfsdb_fileMap_node* node = fileMap_search(&self->nfsdb->filemap,phandle);
-		ASSERT_WITH_NFSDB_FORMAT_ERROR(node,"Internal nfsdb error at binary path handle [%lu]",phandle);
 		if ((node->wr_entry_count<=0) && (node->rw_entry_count<=0)) {
 			/* Do not process files that weren't open for write.
 			 * They don't depend on other files in dependency processing context */
@@ -935,8 +1167,9 @@ PyObject* libetrace_nfsdb_file_dependencies(libetrace_nfsdb_object *self, PyObje
 	}
 	Py_DecRef(path_args);
 
-	if (!depproc_parse_args(self,phs,kwargs,&context)) {
+	if (!depproc_parse_args(self,kwargs,&context)) {
 		phs_free(phs);
+		depproc_context_free(&context);
 		return 0;
 	}
 
@@ -975,7 +1208,6 @@ PyObject* libetrace_nfsdb_file_dependencies(libetrace_nfsdb_object *self, PyObje
 		PyTuple_SetItem(argv,3,dgraph);
 	}
 
-	std::set<unsigned long> _phs;
 	for (std::vector<std::pair<unsigned long,const char*>>::iterator i=phs.begin(); i<phs.end(); ++i) {
 		unsigned long phandle = (*i).first;
 		const char* pathname = (*i).second;
@@ -984,10 +1216,10 @@ PyObject* libetrace_nfsdb_file_dependencies(libetrace_nfsdb_object *self, PyObje
 			// We're matching the root path for exclusion; no dependencies and no processes that's written to any of its dependencies
 			continue;
 		}
-		_phs.insert(phandle);
+		context.roots.insert(phandle);
 	}
 
-	if (_phs.size()<=0) {
+	if (context.roots.size()<=0) {
 		/* Nothing left to process */
 		if (context.timeout>0) {
 			timer_delete(context.timer_id);
@@ -1008,118 +1240,10 @@ PyObject* libetrace_nfsdb_file_dependencies(libetrace_nfsdb_object *self, PyObje
 		return argv;
 	}
 
-	for (std::set<unsigned long>::iterator i=_phs.begin(); i!=_phs.end(); ++i) {
-		context.files.push_back(*i);
-		context.files_set.insert(*i);
-	}
 	start = clock();
-
-	/*
-	 * Given specific linked file (say vmlinux.o) we get a list of all processes (most probably the linker process) that ever written
-	 *  to this file ("writing_pid" variable). Now for each such process we get all the files read by this process (i.e. files read
-	 *  by the linker) and we repeat this procedure for each read file (i.e. subsequent object files) until there's no new read files.
-	 */
-
-	while(!context.files.empty()) {
-		static unsigned long pass_count = 0;
-		context.writing_process_list.clear();
-		auto file_iter = context.files.begin();
-		std::map<upid_t,std::string> writing_pid_map;
-		DBG(context.debug,"@ main pass[%lu] files to proc: %zu\n",pass_count,context.files.size());
-		while(file_iter!=context.files.end()) {
-			/* fh - handle of the file that's been written to
-			 * Find all processes that have written to it */
-			unsigned long fh = *file_iter;
-			DBG(context.fd_debug,"   considering file: %s\n",self->nfsdb->string_table[fh]);
-			if ((!context.direct_deps) ||
-					(context.all_modules_set.find(fh)==context.all_modules_set.end())) {
-				/* Gets a list of processes that have written to the 'fh' file
-				 * For each such process:
-				 *  - check if wrapping process should be considered instead of the original ('wrapping_pid' vs 'writing_pid')
-				 *  - check if any command executed by this process matches the exclusion command pattern (skip this process in such a case)
-				 *  - mark this process as a writing process for further processing
-				 *      (fills 'writing_process_list' and 'all_writing_process_list')
-				 *  - check if this process could write to any other processes (parent or sibling) through pipe. In such case repeat
-				 *     the above steps for each such process (which can also be wrapped-up).
-				 */
-				long procs = depproc_process_written_file(self,&context,writing_pid_map,fh);
-				if (procs<0) {
-					expired = 2;
-					goto maybe_expired;
-				}
-				DBG(context.fd_debug,"   number of new writing processes to consider: %ld\n",procs);
-			}
-			else {
-				DBG(context.fd_debug,"   skipped file: %s\n",self->nfsdb->string_table[fh]);
-				/* If the file on the dependency list is a linked module and we want only direct dependencies
-				 * skip further processing for this file */
-			}
-			unsigned long pending = context.files.front();
-			context.files.pop_front();
-			context.files_set.erase(pending);
-			context.fdone.insert(pending);
-			file_iter++;
-			if (g_timer||interrupt) {
-				expired = 1;
-				goto maybe_expired;
-			}
-		} /* while(files.iter) */
-
-		/* Process all writing processes */
-		DBG(context.debug,"@ read pass[%lu] writing processes to consider: %zu\n",pass_count++,context.writing_process_list.size());
-		auto pid_iter = context.writing_process_list.begin();
-
-		while (pid_iter!=context.writing_process_list.end()) {
-			upid_t pid = *pid_iter;
-			upid_t wrapping_pid = pid;
-			if ((context.wrap_deps)&&(MSB_IS_SET_UPID(pid))) {
-				/* We have a pid of the wrapping process, get the real pid */
-				pid = CLEAR_MSB_UPID(pid);
-			}
-			std::vector<unsigned long> dep_flist;
-			DBG(context.fd_debug,"   considering process: " GENERIC_ARG_PID_FMT "\n",pid);
-			ulongMap_node* node = ulongMap_search(&self->nfsdb->rdmap, pid);
-			if (node) {
-				if ((context.wrap_deps)&&(MSB_IS_SET_UPID(wrapping_pid))) {
-					/* Get files opened for read for all descendants of the wrapping process
-					 *  Fills 'files', 'files_set' and 'fdone' upon completion
-					 */
-					get_wrapping_process_descendants_read_files(self,&context,pid,dep_flist);
-				}
-				else {
-					/* Get files opened for read for this process
-					 *  Fills 'files', 'files_set' and 'fdone' upon completion
-					 */
-					get_process_read_files(self,&context,pid,dep_flist);
-				}
-			}
-			/* When gcc uses -pipe then driver process doesn't open the file being compiled and the driver pid
-			 * is not listed in the writing process list. On the other hand the driver process is detected as a compiler
-			 * but is missing in the list of processes that wrote to dependencies of some higher level module.
-			 * All that lead to the Eclipse project generation errors.
-			 * Let's have a workaround for this: detect *cc1 compilers and add it's parent (i.e. the driver process) to the
-			 * writing process list */
-			if (workaround_gcc_pipe_compilation_mode(self,&context,pid)) {
-				expired = 2;
-				goto maybe_expired;
-			}
-			pid_iter++;
-			if (context.dep_graph) {
-				if (build_dep_graph_entry(self,&context,wrapping_pid,writing_pid_map,dgraph,dep_flist)) {
-					expired = 2;
-					goto maybe_expired;
-				}
-			}
-			if (g_timer||interrupt) {
-				expired = 1;
-				goto maybe_expired;
-			}
-		} /* while(pid.iter) */
-		DBG( context.debug, "   done files: %zu\n",context.fdone.size());
-	}
+	expired = depproc_run(self,&context,dgraph);
 	end = clock();
 
-maybe_expired:
 	if (expired) {
 		timer_delete(context.timer_id);
 		g_timer = 0;
@@ -1131,11 +1255,14 @@ maybe_expired:
 			DBG(context.debug,"--- file_dependencies(...): TIMEOUT\n");
 			PyErr_SetString(PyExc_ValueError, "Timeout for command");
 		}
+		else if (!context.error.empty()) {
+			PyErr_SetString(libetrace_nfsdbError, context.error.c_str());
+		}
 
 		return NULL;
 	}
 
-	for (std::set<unsigned long>::iterator i=_phs.begin(); i!=_phs.end(); ++i) {
+	for (std::set<unsigned long>::iterator i=context.roots.begin(); i!=context.roots.end(); ++i) {
 		context.fdone.erase(*i);
 	}
 	auto file_iter = context.fdone.begin();
@@ -1158,8 +1285,10 @@ maybe_expired:
 		pid_iter++;
 	}
 	while(openfile_iter!=context.openfile_deps.end()) {
-		PyObject* openfile = (PyObject*)*openfile_iter;
+		const struct nfsdb_entry* entry = &self->nfsdb->nfsdb_entry[(*openfile_iter).first];
+		PyObject* openfile = (PyObject*)libetrace_nfsdb_create_openfile_entry(self,entry,(*openfile_iter).second,(*openfile_iter).first);
 		PyList_Append(openfile_deps,openfile);
+		Py_DECREF(openfile);
 		openfile_iter++;
 	}
 
@@ -1203,3 +1332,449 @@ maybe_expired:
 
 	return argv;
 }
+
+struct depproc_module {
+	unsigned long handle;		/* Module path handle */
+	size_t config;				/* Index of the module parameters ('excludes' parameter) */
+};
+
+/* Computes the dependencies of a single module (exactly as 'file_dependencies' does) into 'deps'
+ * Doesn't touch any Python objects so it can run without the GIL
+ * Returns 0 on success, 1 when interrupted and 2 on error (with the message in 'error') */
+static int depproc_module_dependencies(libetrace_nfsdb_object* self, const struct depproc_context* config,
+		const std::set<unsigned long>* all_modules, struct depproc_memo* memo, int direct, unsigned long mhandle,
+		std::vector<depproc_openfile>& deps, std::string& error) {
+
+	struct depproc_context context(*config);
+	context.all_modules = all_modules;
+	context.memo = memo;
+	context.direct_deps = direct;
+
+	struct nfsdb_fileMap_node* node = fileMap_search(&self->nfsdb->filemap,mhandle);
+	if (!node) {
+		depproc_set_error(&context,"Internal nfsdb error at binary path handle [%lu]",mhandle);
+		error = context.error;
+		return 2;
+	}
+	if ((node->wr_entry_count<=0) && (node->rw_entry_count<=0)) {
+		return 0;
+	}
+	if ((context.excl_set.find(mhandle)!=context.excl_set.end()) ||
+			(pattern_match(self->nfsdb->string_table[mhandle],context.excl_patterns,context.excl_patterns_size)!=context.negate_pattern)) {
+		return 0;
+	}
+	context.roots.insert(mhandle);
+
+	int err = depproc_run(self,&context,0);
+	if (err) {
+		error = context.error;
+		return err;
+	}
+	deps.assign(context.openfile_deps.begin(),context.openfile_deps.end());
+	return 0;
+}
+
+/* Computes the dependencies of all 'modules' on 'jobs' threads (modules are picked one by one by the idle threads)
+ * Returns 0 on success, 1 when interrupted and 2 on error (with the message in 'error') */
+static int depproc_modules_dependencies(libetrace_nfsdb_object* self, const std::vector<depproc_context>& configs,
+		const std::vector<depproc_module>& modules, const std::set<unsigned long>* all_modules, struct depproc_memo* memo,
+		int direct, unsigned long jobs, std::vector<std::vector<depproc_openfile>>& results, std::string& error) {
+
+	results.assign(modules.size(),std::vector<depproc_openfile>());
+	std::atomic<size_t> next(0);
+	std::atomic<int> failed(0);
+	std::mutex error_lock;
+
+	auto worker = [&]() {
+		while(!failed && !interrupt) {
+			size_t i = next++;
+			if (i>=modules.size()) break;
+			const struct depproc_context& config = configs[modules[i].config];
+			std::string module_error;
+			int err = depproc_module_dependencies(self,&config,all_modules,&memo[config.wrap_deps],direct,
+					modules[i].handle,results[i],module_error);
+			if (err) {
+				std::lock_guard<std::mutex> guard(error_lock);
+				if (!failed) {
+					error = module_error;
+					failed = err;
+				}
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned long j=1; j<jobs; ++j) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	if (failed) {
+		return failed;
+	}
+	return interrupt?1:0;
+}
+
+/* Appends the JSON string literal (escaped the way Python json module does by default) */
+static void depproc_json_string(std::string& out, const char* s) {
+
+	static const char hex[] = "0123456789abcdef";
+	out.push_back('"');
+	const unsigned char* p = (const unsigned char*)s;
+	while(*p) {
+		unsigned c = *p++;
+		if (c=='"') out.append("\\\"");
+		else if (c=='\\') out.append("\\\\");
+		else if (c=='\n') out.append("\\n");
+		else if (c=='\r') out.append("\\r");
+		else if (c=='\t') out.append("\\t");
+		else if (c=='\b') out.append("\\b");
+		else if (c=='\f') out.append("\\f");
+		else if ((c>=0x20)&&(c<0x7f)) out.push_back(c);
+		else {
+			/* Decode UTF-8 sequence (invalid bytes are escaped as they are) */
+			unsigned n = 0;
+			if ((c&0xe0)==0xc0) { c&=0x1f; n=1; }
+			else if ((c&0xf0)==0xe0) { c&=0x0f; n=2; }
+			else if ((c&0xf8)==0xf0) { c&=0x07; n=3; }
+			unsigned k;
+			for (k=0; k<n; ++k) {
+				if ((p[k]&0xc0)!=0x80) break;
+			}
+			if (k==n) {
+				for (k=0; k<n; ++k) {
+					c = (c<<6)|(*p++&0x3f);
+				}
+			}
+			else {
+				c = *(p-1);
+			}
+			unsigned units[2] = {c,0};
+			unsigned unit_count = 1;
+			if (c>=0x10000) {
+				c-=0x10000;
+				units[0] = 0xd800|(c>>10);
+				units[1] = 0xdc00|(c&0x3ff);
+				unit_count = 2;
+			}
+			for (k=0; k<unit_count; ++k) {
+				out.append("\\u");
+				out.push_back(hex[(units[k]>>12)&0xf]);
+				out.push_back(hex[(units[k]>>8)&0xf]);
+				out.push_back(hex[(units[k]>>4)&0xf]);
+				out.push_back(hex[units[k]&0xf]);
+			}
+		}
+	}
+	out.push_back('"');
+}
+
+/* Writes the dependency map in the same format as json.dump(depmap,indent=4) does for
+ *  { <MODULE_PATH>: [ [<NFSDB_INDEX>,<OPEN_INDEX>,<PATH>], ... ], ... } */
+static int depproc_write_depmap_json(libetrace_nfsdb_object* self, const char* fn, const std::vector<depproc_module>& modules,
+		const std::vector<std::vector<depproc_openfile>>& results) {
+
+	FILE* f = fopen(fn,"w");
+	if (!f) {
+		return -1;
+	}
+
+	std::string out;
+	fputs(modules.size()?"{\n":"{}",f);
+	for (size_t i=0; i<modules.size(); ++i) {
+		out.clear();
+		out.append("    ");
+		depproc_json_string(out,self->nfsdb->string_table[modules[i].handle]);
+		out.append(results[i].size()?": [\n":": []");
+		for (size_t j=0; j<results[i].size(); ++j) {
+			const depproc_openfile& openfile = results[i][j];
+			const struct nfsdb_entry* entry = &self->nfsdb->nfsdb_entry[openfile.first];
+			out.append("        [\n            ");
+			out.append(std::to_string(openfile.first));
+			out.append(",\n            ");
+			out.append(std::to_string(openfile.second));
+			out.append(",\n            ");
+			depproc_json_string(out,self->nfsdb->string_table[entry->open_files[openfile.second].path]);
+			out.append((j+1<results[i].size())?"\n        ],\n":"\n        ]\n");
+		}
+		if (results[i].size()) {
+			out.append("    ]");
+		}
+		out.append((i+1<modules.size())?",\n":"\n}");
+		fputs(out.c_str(),f);
+	}
+
+	return fclose(f)?-1:0;
+}
+
+static PyObject* depproc_counts(libetrace_nfsdb_object* self, const std::vector<depproc_module>& modules,
+		const std::vector<std::vector<depproc_openfile>>& results) {
+
+	PyObject* counts = PyDict_New();
+	for (size_t i=0; i<modules.size(); ++i) {
+		PyObject* count = PyLong_FromUnsignedLong(results[i].size());
+		PyDict_SetItemString(counts,self->nfsdb->string_table[modules[i].handle],count);
+		Py_DECREF(count);
+	}
+	return counts;
+}
+
+static int depproc_exceeds_threshold(const std::vector<std::vector<depproc_openfile>>& results, unsigned long deps_threshold) {
+
+	if (deps_threshold) {
+		for (auto i=results.begin(); i!=results.end(); ++i) {
+			if ((*i).size()>deps_threshold) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/*
+ *	create_deps_image(<DEPS_IMAGE_PATH>, [<MODULE_PATH>|(<MODULE_PATH>,<EXCLUDES_INDEX>),...],
+ *	  excludes = [{<file_dependencies keyword arguments>},...],
+ *	  jobs = N,
+ *	  deps_threshold = N,
+ *	  ddepmap_filename = <PATH>,
+ *	  depmap_filename = <PATH>,
+ *	  show_stats = True/False,
+ *	  debug = True/False
+ *	)
+ *
+ *	Computes the direct and full dependencies of all the given modules (as 'file_dependencies' does with the 'all_modules'
+ *	 parameter set to the list of given modules) on a pool of threads and writes them directly into the dependency image.
+ *	Each module is processed with the 'file_dependencies' parameters taken from the 'excludes' list at the given index
+ *	 (repeated modules are processed once).
+ *	When the number of dependencies of any module exceeds the 'deps_threshold' the processing stops and nothing else is written.
+ *	Returns a tuple of dictionaries with direct and full dependency counts for each module (the full dependency counts are
+ *	 None when the direct dependencies already exceeded the threshold).
+ */
+PyObject* libetrace_nfsdb_create_deps_image(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs) {
+
+	if (PyTuple_Size(args)<2) {
+		ASSERT_WITH_NFSDB_ERROR(0,"Invalid number of arguments");
+	}
+	PyObject* dbfn = PyTuple_GetItem(args,0);
+	PyObject* module_list = PyTuple_GetItem(args,1);
+	if (!PyUnicode_Check(dbfn) || !PyList_Check(module_list)) {
+		ASSERT_WITH_NFSDB_ERROR(0,"Invalid argument type: expected (str,list)");
+	}
+
+	unsigned long jobs = std::max(1U,std::thread::hardware_concurrency());
+	unsigned long deps_threshold = 0;
+	int show_stats = 0, debug = self->debug;
+	PyObject* excludes = 0;
+	PyObject* ddepmap_filename = 0;
+	PyObject* depmap_filename = 0;
+	if (kwargs) {
+		excludes = PyDict_GetItemString(kwargs,"excludes");
+		if (excludes && !PyList_Check(excludes)) {
+			ASSERT_WITH_NFSDB_ERROR(0,"Invalid type of 'excludes' argument: expected (list)");
+		}
+		PyObject* py_jobs = PyDict_GetItemString(kwargs,"jobs");
+		if (py_jobs && (PyLong_AsLong(py_jobs)>0)) {
+			jobs = PyLong_AsLong(py_jobs);
+		}
+		PyObject* py_threshold = PyDict_GetItemString(kwargs,"deps_threshold");
+		if (py_threshold && (py_threshold!=Py_None)) {
+			deps_threshold = PyLong_AsUnsignedLong(py_threshold);
+		}
+		ddepmap_filename = PyDict_GetItemString(kwargs,"ddepmap_filename");
+		depmap_filename = PyDict_GetItemString(kwargs,"depmap_filename");
+		PyObject* py_show_stats = PyDict_GetItemString(kwargs,"show_stats");
+		if (py_show_stats) {
+			show_stats = PyObject_IsTrue(py_show_stats);
+		}
+		PyObject* py_debug = PyDict_GetItemString(kwargs,"debug");
+		if (py_debug) {
+			debug = PyObject_IsTrue(py_debug);
+		}
+		if (PyErr_Occurred()) {
+			return 0;
+		}
+	}
+
+	/* Parse the parameters of each modules group the same way as the 'file_dependencies' arguments
+	 *  ('all_modules' is replaced with the list of all given modules) */
+	std::vector<depproc_context> configs;
+	auto free_configs = [&configs]() {
+		for (auto i=configs.begin(); i!=configs.end(); ++i) {
+			depproc_context_free(&(*i));
+		}
+	};
+	Py_ssize_t config_count = excludes?PyList_Size(excludes):0;
+	configs.reserve(config_count?config_count:1);
+	PyObject* no_modules = PyList_New(0);
+	for (Py_ssize_t i=0; i<(config_count?config_count:1); ++i) {
+		PyObject* config_kwargs = (config_count)?PyDict_Copy(PyList_GetItem(excludes,i)):PyDict_New();
+		if (!config_kwargs) {
+			Py_DecRef(no_modules);
+			free_configs();
+			return 0;
+		}
+		PyDict_SetItemString(config_kwargs,"all_modules",no_modules);
+		PyDict_DelItemString(config_kwargs,"direct");
+		PyErr_Clear();
+		configs.emplace_back();
+		int ok = depproc_parse_args(self,config_kwargs,&configs.back());
+		Py_DecRef(config_kwargs);
+		if (ok && configs.back().dep_graph) {
+			/* Dependency graphs are built with Python objects which can't be touched by the worker threads */
+			PyErr_SetString(libetrace_nfsdbError,"The 'dep_graph' parameter is not supported when creating the dependency image");
+			ok = 0;
+		}
+		if (!ok) {
+			Py_DecRef(no_modules);
+			free_configs();
+			return 0;
+		}
+	}
+	Py_DecRef(no_modules);
+
+	std::vector<depproc_module> modules;
+	std::set<unsigned long> all_modules;
+	for (Py_ssize_t i=0; i<PyList_Size(module_list); ++i) {
+		PyObject* item = PyList_GetItem(module_list,i);
+		PyObject* path = item;
+		size_t config = 0;
+		if (PyTuple_Check(item) && (PyTuple_Size(item)==2)) {
+			path = PyTuple_GetItem(item,0);
+			config = PyLong_AsUnsignedLong(PyTuple_GetItem(item,1));
+		}
+		const char* path_cstr = PyUnicode_Check(path)?PyString_get_c_str(path):0;
+		struct stringHashMap_node* mnode = path_cstr?stringHashMap_search(&self->nfsdb->revstringmap,path_cstr):0;
+		if (path_cstr) {
+			PYASSTR_DECREF(path_cstr);
+		}
+		if (!mnode || (config>=configs.size())) {
+			free_configs();
+			PyErr_Format(libetrace_nfsdbError,"Invalid module entry at index [%zd]",i);
+			return 0;
+		}
+		if (all_modules.insert(mnode->value).second) {
+			modules.push_back({mnode->value,config});
+		}
+	}
+
+	struct sigaction act;
+	act.sa_handler = intHandler;
+	sigaction(SIGINT, &act, 0);
+	interrupt = 0;
+
+	DBG(debug,"--- create_deps_image(): modules(%zu) configs(%zu) jobs(%lu)\n",modules.size(),configs.size(),jobs);
+
+	/* The memo of the writing processes depends on the 'wrap_deps' parameter */
+	struct depproc_memo memo[2];
+	std::vector<std::vector<depproc_openfile>> ddeps, deps;
+	std::string error;
+	int err = 0;
+	PyObject* ddeps_counts = 0;
+	PyObject* deps_counts = 0;
+
+	Py_BEGIN_ALLOW_THREADS
+	err = depproc_modules_dependencies(self,configs,modules,&all_modules,memo,1,jobs,ddeps,error);
+	Py_END_ALLOW_THREADS
+	if (err) goto error;
+	DBG(debug,"--- create_deps_image(): direct dependencies done\n");
+
+	ddeps_counts = depproc_counts(self,modules,ddeps);
+	if (depproc_exceeds_threshold(ddeps,deps_threshold)) {
+		free_configs();
+		return Py_BuildValue("(NO)",ddeps_counts,Py_None);
+	}
+	if (ddepmap_filename && (ddepmap_filename!=Py_None)) {
+		const char* fn = PyString_get_c_str(ddepmap_filename);
+		int werr = depproc_write_depmap_json(self,fn,modules,ddeps);
+		PYASSTR_DECREF(fn);
+		if (werr) {
+			error = "Failed to write direct dependency map";
+			err = 2;
+			goto error;
+		}
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	err = depproc_modules_dependencies(self,configs,modules,&all_modules,memo,0,jobs,deps,error);
+	Py_END_ALLOW_THREADS
+	if (err) goto error;
+	DBG(debug,"--- create_deps_image(): full dependencies done\n");
+
+	deps_counts = depproc_counts(self,modules,deps);
+	if (!depproc_exceeds_threshold(deps,deps_threshold)) {
+		if (depmap_filename && (depmap_filename!=Py_None)) {
+			const char* fn = PyString_get_c_str(depmap_filename);
+			int werr = depproc_write_depmap_json(self,fn,modules,deps);
+			PYASSTR_DECREF(fn);
+			if (werr) {
+				error = "Failed to write dependency map";
+				err = 2;
+				goto error;
+			}
+		}
+
+		struct nfsdb_deps nfsdb_deps = {};
+		nfsdb_deps.db_magic = NFSDB_DEPS_MAGIC_NUMBER;
+		nfsdb_deps.db_version = LIBETRACE_VERSION;
+		unsigned long depmap_vals = 0, ddepmap_vals = 0;
+		for (size_t i=0; i<modules.size(); ++i) {
+			unsigned long* values = (unsigned long*)malloc(deps[i].size()*2*sizeof(unsigned long));
+			for (size_t j=0; j<deps[i].size(); ++j) {
+				values[2*j+0] = deps[i][j].first;
+				values[2*j+1] = deps[i][j].second;
+			}
+			nfsdb_deps_insert_module(self->nfsdb,&nfsdb_deps.depmap,&nfsdb_deps.revdepmap,modules[i].handle,values,deps[i].size());
+			depmap_vals+=deps[i].size();
+			std::vector<depproc_openfile>().swap(deps[i]);
+		}
+		for (size_t i=0; i<modules.size(); ++i) {
+			unsigned long* values = (unsigned long*)malloc(ddeps[i].size()*2*sizeof(unsigned long));
+			for (size_t j=0; j<ddeps[i].size(); ++j) {
+				values[2*j+0] = ddeps[i][j].first;
+				values[2*j+1] = ddeps[i][j].second;
+			}
+			nfsdb_deps_insert_module(self->nfsdb,&nfsdb_deps.ddepmap,&nfsdb_deps.revddepmap,modules[i].handle,values,ddeps[i].size());
+			ddepmap_vals+=ddeps[i].size();
+			std::vector<depproc_openfile>().swap(ddeps[i]);
+		}
+
+		if (show_stats) {
+			printf("depmap entries: %zu\n",modules.size());
+			printf("depmap values: %ld\n",depmap_vals);
+			printf("reverse depmap entries: %ld\n",ulongPairMap_count(&nfsdb_deps.revdepmap));
+			printf("reverse depmap values: %ld\n",ulongPairMap_entry_count(&nfsdb_deps.revdepmap));
+			printf("ddepmap entries: %zu\n",modules.size());
+			printf("ddepmap values: %ld\n",ddepmap_vals);
+			printf("reverse rdepmap entries: %ld\n",ulongPairMap_count(&nfsdb_deps.revddepmap));
+			printf("reverse rdepmap values: %ld\n",ulongPairMap_entry_count(&nfsdb_deps.revddepmap));
+		}
+
+		const char* dbfn_s = PyString_get_c_str(dbfn);
+		int werr = nfsdb_deps_image_write(&nfsdb_deps,dbfn_s,0,0);
+		PYASSTR_DECREF(dbfn_s);
+		destroy_nfsdb_deps(&nfsdb_deps);
+		if (werr) {
+			error = "Failed to write dependency image";
+			err = 2;
+			goto error;
+		}
+	}
+
+	free_configs();
+	return Py_BuildValue("(NN)",ddeps_counts,deps_counts);
+
+error:
+	free_configs();
+	Py_XDECREF(ddeps_counts);
+	Py_XDECREF(deps_counts);
+	if (err==1) {
+		PyErr_SetNone(PyExc_KeyboardInterrupt);
+	}
+	else {
+		PyErr_SetString(libetrace_nfsdbError,error.c_str());
+	}
+	return 0;
+}
@@ -10,89 +10,63 @@
 #include "nfsdb.h"
 #include "maps.h"
 
-struct nfsdb_entryMap_node* nfsdb_entryMap_search(const struct rb_root* nfsdb_entryMap, unsigned long key) {
-
-	struct rb_node *node = nfsdb_entryMap->rb_node;
+/*
+ * Returns the position of the key in the sorted array of keys (or -1 if it's not there).
+ * The search doesn't branch on the comparison result which keeps it fast for large arrays.
+ */
+static long sorted_keys_find(const unsigned long* keys, unsigned long count, unsigned long key) {
 
-	while (node) {
-		struct nfsdb_entryMap_node* data = container_of(node, struct nfsdb_entryMap_node, node);
+	if (!count) return -1;
 
-		if (key<data->key) {
-			node = node->rb_left;
-		}
-		else if (key>data->key) {
-			node = node->rb_right;
-		}
-		else
-			return data;
+	const unsigned long* base = keys;
+	while (count>1) {
+		unsigned long half = count/2;
+		base = (base[half]<=key)?base+half:base;
+		count-=half;
 	}
 
-	return 0;
+	return (*base==key)?(long)(base-keys):-1;
 }
 
-int nfsdb_entryMap_insert(struct rb_root* nfsdb_entryMap, unsigned long key, struct nfsdb_entry** entry_list,
-		unsigned long count) {
+void nfsdb_entryMap_create(struct nfsdb_entryMap* nfsdb_entryMap, unsigned long count) {
 
-	struct nfsdb_entryMap_node* data = calloc(1,sizeof(struct nfsdb_entryMap_node));
-	data->key = key;
-	data->entry_list = entry_list;
-	data->entry_count = count;
-	struct rb_node **new = &(nfsdb_entryMap->rb_node), *parent = 0;
+	nfsdb_entryMap->keys = malloc(count*sizeof(unsigned long));
+	nfsdb_entryMap->nodes = calloc(count,sizeof(struct nfsdb_entryMap_node));
+	nfsdb_entryMap->count = count;
+}
 
-	/* Figure out where to put new node */
-	while (*new) {
-		struct nfsdb_entryMap_node* this = container_of(*new, struct nfsdb_entryMap_node, node);
+struct nfsdb_entryMap_node* nfsdb_entryMap_search(const struct nfsdb_entryMap* nfsdb_entryMap, unsigned long key) {
 
-		parent = *new;
-		if (data->key<this->key)
-			new = &((*new)->rb_left);
-		else if (data->key>this->key)
-			new = &((*new)->rb_right);
-		else {
-			free(data->entry_list);
-		    free(data);
-		    return 0;
-		}
+	long pos = sorted_keys_find(nfsdb_entryMap->keys,nfsdb_entryMap->count,key);
+	if (pos<0) {
+		return 0;
 	}
 
-	/* Add new node and rebalance tree. */
-	rb_link_node(&data->node, parent, new);
-	rb_insert_color(&data->node, nfsdb_entryMap);
-
-	return 1;
+	return &nfsdb_entryMap->nodes[pos];
 }
 
-void nfsdb_entryMap_destroy(struct rb_root* nfsdb_entryMap) {
+void nfsdb_entryMap_destroy(struct nfsdb_entryMap* nfsdb_entryMap) {
 
-    struct rb_node * p = rb_first(nfsdb_entryMap);
-    while(p) {
-        struct nfsdb_entryMap_node* data = (struct nfsdb_entryMap_node*)p;
-        rb_erase(p, nfsdb_entryMap);
-        p = rb_next(p);
-        free(data->entry_list);
-        free(data);
-    }
+	for (unsigned long u=0; u<nfsdb_entryMap->count; ++u) {
+		free(nfsdb_entryMap->nodes[u].entry_list);
+	}
+	free(nfsdb_entryMap->keys);
+	free(nfsdb_entryMap->nodes);
+	nfsdb_entryMap->keys = 0;
+	nfsdb_entryMap->nodes = 0;
+	nfsdb_entryMap->count = 0;
 }
 
-size_t nfsdb_entryMap_count(const struct rb_root* nfsdb_entryMap) {
+size_t nfsdb_entryMap_count(const struct nfsdb_entryMap* nfsdb_entryMap) {
 
-	struct rb_node * p = rb_first(nfsdb_entryMap);
-	size_t count = 0;
-	while(p) {
-		count++;
-		p = rb_next(p);
-	}
-	return count;
+	return nfsdb_entryMap->count;
 }
 
-size_t nfsdb_entryMap_entry_count(const struct rb_root* nfsdb_entryMap) {
+size_t nfsdb_entryMap_entry_count(const struct nfsdb_entryMap* nfsdb_entryMap) {
 
-	struct rb_node * p = rb_first(nfsdb_entryMap);
 	size_t count = 0;
-	while(p) {
-		struct nfsdb_entryMap_node* data = (struct nfsdb_entryMap_node*)p;
-		count+=data->entry_count;
-		p = rb_next(p);
+	for (unsigned long u=0; u<nfsdb_entryMap->count; ++u) {
+		count+=nfsdb_entryMap->nodes[u].entry_count;
 	}
 	return count;
 }
@@ -149,6 +123,28 @@ int ulongMap_insert(struct rb_root* ulongMap, unsigned long key, unsigned long*
 	return 1;
 }
 
+/*
+ * Bulk construction from sorted input: appends a node with a key greater than all the keys in the map.
+ * The node appended previously (or NULL for an empty map) is passed as 'last'. Appending the nodes in
+ * the ascending key order builds exactly the same tree as inserting them one by one, without walking
+ * down the tree for every node.
+ */
+struct ulongMap_node* ulongMap_append(struct rb_root* ulongMap, struct ulongMap_node* last, unsigned long key,
+		unsigned long* value, unsigned long count, unsigned long alloc_size) {
+
+	struct ulongMap_node* data = calloc(1,sizeof(struct ulongMap_node));
+	data->key = key;
+	data->value_list = value;
+	data->value_count = count;
+	data->value_alloc = alloc_size;
+
+	assert(!last || last->key<key);
+	rb_link_node(&data->node, last?&last->node:0, last?&last->node.rb_right:&ulongMap->rb_node);
+	rb_insert_color(&data->node, ulongMap);
+
+	return data;
+}
+
 void ulongMap_destroy(struct rb_root* ulongMap) {
 
     struct rb_node * p = rb_first(ulongMap);
@@ -362,110 +358,136 @@ size_t stringRefMap_count(const struct rb_root* stringRefMap) {
 	return count;
 }
 
-struct nfsdb_fileMap_node* fileMap_search(const struct rb_root* fileMap, unsigned long key) {
+/* FNV-1a */
+static unsigned long string_hash(const char* s) {
 
-	struct rb_node *node = fileMap->rb_node;
+	unsigned long h = 0xcbf29ce484222325UL;
+	for (; *s; ++s) {
+		h^=(unsigned char)*s;
+		h*=0x100000001b3UL;
+	}
+	return h;
+}
 
-	while (node) {
-		struct nfsdb_fileMap_node* data = container_of(node, struct nfsdb_fileMap_node, node);
+void stringHashMap_create(struct stringHashMap* stringHashMap, unsigned long count) {
 
-		if (key<data->key) {
-			node = node->rb_left;
+	/* Keep the load factor at most 3/4 */
+	unsigned long size = 1;
+	while (size*3<count*4) size*=2;
+	stringHashMap->nodes = calloc(size,sizeof(struct stringHashMap_node));
+	stringHashMap->size = size;
+	stringHashMap->count = 0;
+}
+
+struct stringHashMap_node* stringHashMap_search(const struct stringHashMap* stringHashMap, const char* key) {
+
+	if (!stringHashMap->size) return 0;
+
+	unsigned long mask = stringHashMap->size-1;
+	for (unsigned long u=string_hash(key)&mask;; u=(u+1)&mask) {
+		struct stringHashMap_node* node = &stringHashMap->nodes[u];
+		if (!node->key) {
+			return 0;
 		}
-		else if (key>data->key) {
-			node = node->rb_right;
+		if (!strcmp(node->key,key)) {
+			return node;
 		}
-		else
-			return data;
 	}
-
-	return 0;
 }
 
-struct nfsdb_fileMap_node* fileMap_insert_key(struct rb_root* fileMap, unsigned long key) {
-
-	struct nfsdb_fileMap_node* data = calloc(1,sizeof(struct nfsdb_fileMap_node));
-	data->key = key;
-	struct rb_node **new = &(fileMap->rb_node), *parent = 0;
+/* Returns 0 when the key is already in the map (the map is never resized so it mustn't get full) */
+int stringHashMap_insert(struct stringHashMap* stringHashMap, const char* key, unsigned long value) {
 
-	/* Figure out where to put new node */
-	while (*new) {
-		struct nfsdb_fileMap_node* this = container_of(*new, struct nfsdb_fileMap_node, node);
+	assert(stringHashMap->count<stringHashMap->size);
 
-		parent = *new;
-		if (data->key<this->key)
-			new = &((*new)->rb_left);
-		else if (data->key>this->key)
-			new = &((*new)->rb_right);
-		else {
-		    return 0;
+	unsigned long mask = stringHashMap->size-1;
+	for (unsigned long u=string_hash(key)&mask;; u=(u+1)&mask) {
+		struct stringHashMap_node* node = &stringHashMap->nodes[u];
+		if (!node->key) {
+			node->key = key;
+			node->value = value;
+			stringHashMap->count++;
+			return 1;
+		}
+		if (!strcmp(node->key,key)) {
+			return 0;
 		}
 	}
+}
 
-	/* Add new node and rebalance tree. */
-	rb_link_node(&data->node, parent, new);
-	rb_insert_color(&data->node, fileMap);
+void stringHashMap_destroy(struct stringHashMap* stringHashMap) {
 
-	return data;
+	free(stringHashMap->nodes);
+	stringHashMap->nodes = 0;
+	stringHashMap->size = 0;
+	stringHashMap->count = 0;
 }
 
-void fileMap_destroy(struct rb_root* fileMap) {
+size_t stringHashMap_count(const struct stringHashMap* stringHashMap) {
 
-    struct rb_node * p = rb_first(fileMap);
-    while(p) {
-        struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)p;
-        rb_erase(p, fileMap);
-        p = rb_next(p);
-        free(data->rd_entry_list);
-        free(data->wr_entry_list);
-        free(data->rw_entry_list);
-        free(data);
-    }
+	return stringHashMap->count;
 }
 
-size_t fileMap_count(const struct rb_root* fileMap) {
+void fileMap_create(struct nfsdb_fileMap* fileMap, unsigned long count) {
 
-	struct rb_node * p = rb_first(fileMap);
-	size_t count = 0;
-	while(p) {
-		count++;
-		p = rb_next(p);
+	fileMap->keys = malloc(count*sizeof(unsigned long));
+	fileMap->nodes = calloc(count,sizeof(struct nfsdb_fileMap_node));
+	fileMap->count = count;
+}
+
+struct nfsdb_fileMap_node* fileMap_search(const struct nfsdb_fileMap* fileMap, unsigned long key) {
+
+	long pos = sorted_keys_find(fileMap->keys,fileMap->count,key);
+	if (pos<0) {
+		return 0;
 	}
-	return count;
+
+	return &fileMap->nodes[pos];
+}
+
+void fileMap_destroy(struct nfsdb_fileMap* fileMap) {
+
+	for (unsigned long u=0; u<fileMap->count; ++u) {
+		struct nfsdb_fileMap_node* data = &fileMap->nodes[u];
+		free(data->rd_entry_list);
+		free(data->wr_entry_list);
+		free(data->rw_entry_list);
+	}
+	free(fileMap->keys);
+	free(fileMap->nodes);
+	fileMap->keys = 0;
+	fileMap->nodes = 0;
+	fileMap->count = 0;
 }
 
-size_t fileMap_rd_entry_count(const struct rb_root* fileMap) {
+size_t fileMap_count(const struct nfsdb_fileMap* fileMap) {
+
+	return fileMap->count;
+}
+
+size_t fileMap_rd_entry_count(const struct nfsdb_fileMap* fileMap) {
 
-	struct rb_node * p = rb_first(fileMap);
 	size_t count = 0;
-	while(p) {
-		struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)p;
-		count+=data->rd_entry_count;
-		p = rb_next(p);
+	for (unsigned long u=0; u<fileMap->count; ++u) {
+		count+=fileMap->nodes[u].rd_entry_count;
 	}
 	return count;
 }
 
-size_t fileMap_wr_entry_count(const struct rb_root* fileMap) {
+size_t fileMap_wr_entry_count(const struct nfsdb_fileMap* fileMap) {
 
-	struct rb_node * p = rb_first(fileMap);
 	size_t count = 0;
-	while(p) {
-		struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)p;
-		count+=data->wr_entry_count;
-		p = rb_next(p);
+	for (unsigned long u=0; u<fileMap->count; ++u) {
+		count+=fileMap->nodes[u].wr_entry_count;
 	}
 	return count;
 }
 
-size_t fileMap_rw_entry_count(const struct rb_root* fileMap) {
+size_t fileMap_rw_entry_count(const struct nfsdb_fileMap* fileMap) {
 
-	struct rb_node * p = rb_first(fileMap);
 	size_t count = 0;
-	while(p) {
-		struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)p;
-		count+=data->rw_entry_count;
-		p = rb_next(p);
+	for (unsigned long u=0; u<fileMap->count; ++u) {
+		count+=fileMap->nodes[u].rw_entry_count;
 	}
 	return count;
 }
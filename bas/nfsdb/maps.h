@@ -5,7 +5,6 @@
 #include "rbtree.h"
 
 struct nfsdb_entryMap_node {
-	struct rb_node node;
 	unsigned long key;
 	struct nfsdb_entry** entry_list;
 	unsigned long entry_count;
@@ -42,7 +41,6 @@ enum file_access_type {
 };
 
 struct nfsdb_fileMap_node {
-	struct rb_node node;
 	unsigned long key;
 	struct nfsdb_entry** rd_entry_list;
 	unsigned long* rd_entry_index;
@@ -60,14 +58,44 @@ struct nfsdb_fileMap_node {
 	enum file_access_type access_type;
 };
 
-struct nfsdb_entryMap_node* nfsdb_entryMap_search(const struct rb_root* nfsdb_entryMap, unsigned long key);
-int nfsdb_entryMap_insert(struct rb_root* nfsdb_entryMap, unsigned long key, struct nfsdb_entry** entry_list,
-		unsigned long count);
-void nfsdb_entryMap_destroy(struct rb_root* nfsdb_entryMap);
-size_t nfsdb_entryMap_count(const struct rb_root* nfsdb_entryMap);
-size_t nfsdb_entryMap_entry_count(const struct rb_root* nfsdb_entryMap);
+/*
+ * Read-only maps of the database image are stored as arrays of nodes sorted by the key. The keys are
+ * also kept in a separate contiguous array which is binary searched on lookup (and the nodes are only
+ * touched for the matching key).
+ */
+struct nfsdb_entryMap {
+	unsigned long* keys;
+	struct nfsdb_entryMap_node* nodes;
+	unsigned long count;
+};
+
+struct nfsdb_fileMap {
+	unsigned long* keys;
+	struct nfsdb_fileMap_node* nodes;
+	unsigned long count;
+};
+
+/* Hash table of strings with open addressing (linear probing), the key of an empty slot is NULL */
+struct stringHashMap_node {
+	const char* key;
+	unsigned long value;
+};
+
+struct stringHashMap {
+	struct stringHashMap_node* nodes;
+	unsigned long size;
+	unsigned long count;
+};
+
+void nfsdb_entryMap_create(struct nfsdb_entryMap* nfsdb_entryMap, unsigned long count);
+struct nfsdb_entryMap_node* nfsdb_entryMap_search(const struct nfsdb_entryMap* nfsdb_entryMap, unsigned long key);
+void nfsdb_entryMap_destroy(struct nfsdb_entryMap* nfsdb_entryMap);
+size_t nfsdb_entryMap_count(const struct nfsdb_entryMap* nfsdb_entryMap);
+size_t nfsdb_entryMap_entry_count(const struct nfsdb_entryMap* nfsdb_entryMap);
 struct ulongMap_node* ulongMap_search(const struct rb_root* ulongMap, unsigned long key);
 int ulongMap_insert(struct rb_root* ulongMap, unsigned long key, unsigned long* value, unsigned long count, unsigned long alloc_size);
+struct ulongMap_node* ulongMap_append(struct rb_root* ulongMap, struct ulongMap_node* last, unsigned long key,
+		unsigned long* value, unsigned long count, unsigned long alloc_size);
 void ulongMap_destroy(struct rb_root* ulongMap);
 size_t ulongMap_count(const struct rb_root* ulongMap);
 size_t ulongMap_entry_count(const struct rb_root* ulongMap);
@@ -82,13 +110,37 @@ struct stringRefMap_node* stringRefMap_insert(struct rb_root* stringMap, const c
 void stringRefMap_remove(struct rb_root* stringRefMap, struct stringRefMap_node* node);
 void stringRefMap_destroy(struct rb_root* stringMap);
 size_t stringRefMap_count(const struct rb_root* stringMap);
-struct nfsdb_fileMap_node* fileMap_search(const struct rb_root* fileMap, unsigned long key);
-struct nfsdb_fileMap_node* fileMap_insert_key(struct rb_root* fileMap, unsigned long key);
-void fileMap_destroy(struct rb_root* fileMap);
-size_t fileMap_count(const struct rb_root* fileMap);
-size_t fileMap_rd_entry_count(const struct rb_root* fileMap);
-size_t fileMap_wr_entry_count(const struct rb_root* fileMap);
-size_t fileMap_rw_entry_count(const struct rb_root* fileMap);
+void stringHashMap_create(struct stringHashMap* stringHashMap, unsigned long count);
+struct stringHashMap_node* stringHashMap_search(const struct stringHashMap* stringHashMap, const char* key);
+int stringHashMap_insert(struct stringHashMap* stringHashMap, const char* key, unsigned long value);
+void stringHashMap_destroy(struct stringHashMap* stringHashMap);
+size_t stringHashMap_count(const struct stringHashMap* stringHashMap);
+void fileMap_create(struct nfsdb_fileMap* fileMap, unsigned long count);
+struct nfsdb_fileMap_node* fileMap_search(const struct nfsdb_fileMap* fileMap, unsigned long key);
+void fileMap_destroy(struct nfsdb_fileMap* fileMap);
+size_t fileMap_count(const struct nfsdb_fileMap* fileMap);
+size_t fileMap_rd_entry_count(const struct nfsdb_fileMap* fileMap);
+size_t fileMap_wr_entry_count(const struct nfsdb_fileMap* fileMap);
+size_t fileMap_rw_entry_count(const struct nfsdb_fileMap* fileMap);
+
+/* Iteration over the nodes of sorted maps in the key order, NULL is returned past the last node */
+static inline struct nfsdb_entryMap_node* nfsdb_entryMap_first(const struct nfsdb_entryMap* nfsdb_entryMap) {
+	return (nfsdb_entryMap->count>0)?&nfsdb_entryMap->nodes[0]:0;
+}
+
+static inline struct nfsdb_entryMap_node* nfsdb_entryMap_next(const struct nfsdb_entryMap* nfsdb_entryMap,
+		const struct nfsdb_entryMap_node* node) {
+	return (node+1<nfsdb_entryMap->nodes+nfsdb_entryMap->count)?(struct nfsdb_entryMap_node*)node+1:0;
+}
+
+static inline struct nfsdb_fileMap_node* fileMap_first(const struct nfsdb_fileMap* fileMap) {
+	return (fileMap->count>0)?&fileMap->nodes[0]:0;
+}
+
+static inline struct nfsdb_fileMap_node* fileMap_next(const struct nfsdb_fileMap* fileMap,
+		const struct nfsdb_fileMap_node* node) {
+	return (node+1<fileMap->nodes+fileMap->count)?(struct nfsdb_fileMap_node*)node+1:0;
+}
 
 struct ulong_entryMap_node {
 	struct rb_node node;
@@ -122,6 +174,7 @@ struct stringRef_entryListMap_node {
 };
 
 typedef struct stringRef_entryListMap_node ftdb_stringRef_func_entryListMap;
+typedef struct stringRef_entryListMap_node ftdb_stringRef_funcdecl_entryListMap;
 typedef struct stringRef_entryListMap_node ftdb_stringRef_global_entryListMap;
 
 struct ulong_entryMap_node* ulong_entryMap_search(const struct rb_root* ulong_entryMap, unsigned long key);
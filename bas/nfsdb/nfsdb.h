@@ -13,7 +13,7 @@
  */
 #define NFSDB_MAGIC_NUMBER			0x424453464e42494cULL	/* b'LIBNFSDB' */
 #define NFSDB_DEPS_MAGIC_NUMBER		0x5350454442494cULL		/* b'LIBDEPS\0' */
-#define LIBETRACE_VERSION			5ULL
+#define LIBETRACE_VERSION			6ULL
 
 
 struct eid {
@@ -133,17 +133,17 @@ struct nfsdb {
 	unsigned long pcp_pattern_list_size;
 	unsigned long* shared_argv_list;
 	unsigned long shared_argv_list_size;
-	struct rb_root procmap;
-	struct rb_root bmap;
+	struct nfsdb_entryMap procmap;
+	struct nfsdb_entryMap bmap;
 	struct rb_root forkmap;
 	struct rb_root revforkmap;
 	struct rb_root pipemap;
 	struct rb_root wrmap;
 	struct rb_root revwrmap;
 	struct rb_root rdmap;
-	struct rb_root revstringmap;
-	struct rb_root filemap;
-	struct rb_root linkedmap;
+	struct stringHashMap revstringmap;
+	struct nfsdb_fileMap filemap;
+	struct nfsdb_entryMap linkedmap;
 	unsigned long* threads;
 	unsigned long threads_count;
 };
@@ -0,0 +1,787 @@
+extern "C" {
+#include "pyetrace.h"
+#include "utils.h"
+}
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+#include <limits.h>
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Native loader of the .nfsdb.json database.
+ *
+ * The JSON file is mapped into memory and parsed in a single pass with a callback driven parser,
+ * one entry at a time, without building any intermediate document. Strings of an entry are kept as
+ * views into the mapped file (or decoded into a small per-entry scratch when they contain escape
+ * sequences) until the entry is complete and are then interned into the nfsdb string table through
+ * a hash table.
+ *
+ * Strings of an entry are interned in the same order as libetrace_create_nfsdb() does it for the
+ * json.load()-ed list (regardless of the order of keys in the file), so both functions assign the
+ * same string handles.
+ */
+
+#define JSON_STRING_BLOCK_SIZE	(16UL * 1024 * 1024)
+
+class JSONReader {
+private:
+	const char* m_begin;
+	const char* m_pos;
+	const char* m_end;
+	std::string m_error;
+	std::deque<std::string> m_key_scratch;
+	std::deque<std::string> m_skip_scratch;
+
+	void skip_ws() {
+		while ((m_pos<m_end) && ((*m_pos==' ') || (*m_pos=='\n') || (*m_pos=='\r') || (*m_pos=='\t'))) {
+			++m_pos;
+		}
+	}
+
+	bool read_hex4(unsigned* cp) {
+		if (m_end-m_pos<4) return fail("truncated unicode escape");
+		*cp = 0;
+		for (int i=0; i<4; ++i) {
+			char c = *m_pos++;
+			*cp<<=4;
+			if ((c>='0') && (c<='9')) *cp|=c-'0';
+			else if ((c>='a') && (c<='f')) *cp|=c-'a'+10;
+			else if ((c>='A') && (c<='F')) *cp|=c-'A'+10;
+			else return fail("invalid unicode escape");
+		}
+		return true;
+	}
+
+	static void append_utf8(std::string& out, unsigned cp) {
+		if (cp<0x80) {
+			out.push_back(cp);
+		}
+		else if (cp<0x800) {
+			out.push_back(0xC0|(cp>>6));
+			out.push_back(0x80|(cp&0x3F));
+		}
+		else if (cp<0x10000) {
+			out.push_back(0xE0|(cp>>12));
+			out.push_back(0x80|((cp>>6)&0x3F));
+			out.push_back(0x80|(cp&0x3F));
+		}
+		else {
+			out.push_back(0xF0|(cp>>18));
+			out.push_back(0x80|((cp>>12)&0x3F));
+			out.push_back(0x80|((cp>>6)&0x3F));
+			out.push_back(0x80|(cp&0x3F));
+		}
+	}
+
+	bool skip_literal(const char* literal) {
+		size_t size = strlen(literal);
+		if (((size_t)(m_end-m_pos)<size) || memcmp(m_pos,literal,size)) {
+			return fail("unexpected value");
+		}
+		m_pos+=size;
+		return true;
+	}
+
+public:
+	JSONReader(const char* data, size_t size) : m_begin(data), m_pos(data), m_end(data+size) {}
+
+	const std::string& error() const {
+		return m_error;
+	}
+
+	bool fail(const char* what) {
+		if (m_error.empty()) {
+			char errmsg[256];
+			snprintf(errmsg,sizeof(errmsg),"Invalid JSON at offset %zu: %s",(size_t)(m_pos-m_begin),what);
+			m_error = errmsg;
+		}
+		return false;
+	}
+
+	bool expect_end() {
+		skip_ws();
+		if (m_pos<m_end) return fail("unexpected data after the end of the database");
+		return true;
+	}
+
+	/* Consumes the next non-whitespace character if it matches */
+	bool consume(char c) {
+		skip_ws();
+		if ((m_pos<m_end) && (*m_pos==c)) {
+			++m_pos;
+			return true;
+		}
+		return false;
+	}
+
+	bool expect(char c) {
+		if (consume(c)) return true;
+		char what[32];
+		snprintf(what,sizeof(what),"expected '%c'",c);
+		return fail(what);
+	}
+
+	/*
+	 * Reads a string value. Strings without escape sequences point directly into the input, the
+	 * decoded ones are stored in the scratch (which has to outlive the returned view).
+	 */
+	bool read_string(std::string_view& s, std::deque<std::string>& scratch) {
+		if (!expect('"')) return false;
+		const char* start = m_pos;
+		while ((m_pos<m_end) && (*m_pos!='"') && (*m_pos!='\\')) ++m_pos;
+		if (m_pos>=m_end) return fail("unterminated string");
+		if (*m_pos=='"') {
+			s = std::string_view(start,m_pos-start);
+			++m_pos;
+			return true;
+		}
+		std::string& out = scratch.emplace_back(start,m_pos-start);
+		while (m_pos<m_end) {
+			char c = *m_pos++;
+			if (c=='"') {
+				s = out;
+				return true;
+			}
+			if (c!='\\') {
+				out.push_back(c);
+				continue;
+			}
+			if (m_pos>=m_end) break;
+			switch (*m_pos++) {
+				case '"': out.push_back('"'); break;
+				case '\\': out.push_back('\\'); break;
+				case '/': out.push_back('/'); break;
+				case 'b': out.push_back('\b'); break;
+				case 'f': out.push_back('\f'); break;
+				case 'n': out.push_back('\n'); break;
+				case 'r': out.push_back('\r'); break;
+				case 't': out.push_back('\t'); break;
+				case 'u': {
+					unsigned cp;
+					if (!read_hex4(&cp)) return false;
+					if ((cp>=0xD800) && (cp<0xDC00) && (m_end-m_pos>=6) && (m_pos[0]=='\\') && (m_pos[1]=='u')) {
+						const char* low_start = m_pos;
+						unsigned low;
+						m_pos+=2;
+						if (!read_hex4(&low)) return false;
+						if ((low>=0xDC00) && (low<0xE000)) {
+							cp = 0x10000+((cp-0xD800)<<10)+(low-0xDC00);
+						}
+						else {
+							/* Not a surrogate pair, leave the second escape for the next iteration */
+							m_pos = low_start;
+						}
+					}
+					append_utf8(out,cp);
+				}
+				break;
+				default:
+					--m_pos;
+					return fail("invalid escape sequence");
+			}
+		}
+		return fail("unterminated string");
+	}
+
+	/* Reads an integer value, negative values are stored in two's complement */
+	bool read_integer(unsigned long& v) {
+		skip_ws();
+		int negative = 0;
+		if ((m_pos<m_end) && (*m_pos=='-')) {
+			negative = 1;
+			++m_pos;
+		}
+		if ((m_pos>=m_end) || (*m_pos<'0') || (*m_pos>'9')) return fail("expected an integer");
+		unsigned long x = 0;
+		while ((m_pos<m_end) && (*m_pos>='0') && (*m_pos<='9')) {
+			x = x*10+(*m_pos++-'0');
+		}
+		if ((m_pos<m_end) && ((*m_pos=='.') || (*m_pos=='e') || (*m_pos=='E'))) return fail("expected an integer");
+		v = negative?-x:x;
+		return true;
+	}
+
+	bool skip_value() {
+		skip_ws();
+		if (m_pos>=m_end) return fail("unexpected end of input");
+		switch (*m_pos) {
+			case '{':
+				return parse_object([this](std::string_view) { return skip_value(); });
+			case '[':
+				return parse_array([this]() { return skip_value(); });
+			case '"': {
+				std::string_view s;
+				bool ok = read_string(s,m_skip_scratch);
+				m_skip_scratch.clear();
+				return ok;
+			}
+			case 't':
+				return skip_literal("true");
+			case 'f':
+				return skip_literal("false");
+			case 'n':
+				return skip_literal("null");
+			default: {
+				const char* start = m_pos;
+				while ((m_pos<m_end) && *m_pos && strchr("+-.0123456789eE",*m_pos)) ++m_pos;
+				if (m_pos==start) return fail("unexpected character");
+				return true;
+			}
+		}
+	}
+
+	/* Calls element() for every element of an array, element() consumes the value */
+	template <typename F>
+	bool parse_array(F&& element) {
+		if (!expect('[')) return false;
+		if (consume(']')) return true;
+		do {
+			if (!element()) return false;
+		} while (consume(','));
+		return expect(']');
+	}
+
+	/*
+	 * Calls member(key) for every member of an object, member() consumes the value. The key is only
+	 * valid until the value is parsed.
+	 */
+	template <typename F>
+	bool parse_object(F&& member) {
+		if (!expect('{')) return false;
+		if (consume('}')) return true;
+		do {
+			std::string_view key;
+			skip_ws();
+			if ((m_pos<m_end) && (*m_pos=='"') && (m_end-m_pos>=3) && (m_pos[1]!='\\') && (m_pos[2]=='"')) {
+				/* Fast path for the single character keys used all over the database */
+				key = std::string_view(m_pos+1,1);
+				m_pos+=3;
+			}
+			else if (m_key_scratch.clear(), !read_string(key,m_key_scratch)) {
+				return false;
+			}
+			if (!expect(':')) return false;
+			if (!member(key)) return false;
+		} while (consume(','));
+		return expect('}');
+	}
+};
+
+struct json_openfile {
+	std::string_view path;
+	std::string_view original_path;
+	int has_original_path;
+	int has_open_timestamp;
+	int has_close_timestamp;
+	int has_size;
+	unsigned long open_timestamp;
+	unsigned long close_timestamp;
+	unsigned long mode;
+	unsigned long size;
+};
+
+struct json_pp_def {
+	std::string_view name;
+	std::string_view value;
+};
+
+/* Contents of a single .nfsdb.json entry before its strings are interned */
+struct json_entry {
+	struct eid eid;
+	struct eid parent_eid;
+	int has_stime, has_etime, has_return_code, has_wrapper_pid, has_pcp, has_linked_file, has_compilation_info;
+	unsigned long stime, etime, return_code, wrapper_pid, linked_type;
+	std::string_view binary;
+	std::string_view cwd;
+	std::string_view pcp;
+	std::string_view linked_file;
+	std::vector<std::string_view> argv;
+	std::vector<struct cid> child_ids;
+	std::vector<struct eid> pipe_eids;
+	std::vector<struct cputime> cpu;
+	std::vector<json_openfile> open_files;
+	/* compilation info */
+	std::vector<std::string_view> compiled_list;
+	std::vector<std::string_view> include_paths;
+	std::vector<json_pp_def> pp_defs;
+	std::vector<json_pp_def> pp_udefs;
+	std::vector<std::string_view> header_list;
+	std::vector<std::string_view> object_list;
+	unsigned long compilation_type;
+	unsigned long integrated;
+	/* Decoded strings with escape sequences */
+	std::deque<std::string> scratch;
+
+	void clear() {
+		eid = {0,0};
+		parent_eid = {0,0};
+		has_stime = has_etime = has_return_code = has_wrapper_pid = has_pcp = has_linked_file = has_compilation_info = 0;
+		stime = etime = return_code = wrapper_pid = linked_type = 0;
+		binary = cwd = pcp = linked_file = std::string_view();
+		argv.clear();
+		child_ids.clear();
+		pipe_eids.clear();
+		cpu.clear();
+		open_files.clear();
+		compiled_list.clear();
+		include_paths.clear();
+		pp_defs.clear();
+		pp_udefs.clear();
+		header_list.clear();
+		object_list.clear();
+		compilation_type = 0;
+		integrated = 0;
+		scratch.clear();
+	}
+};
+
+class NFSDBJSONLoader {
+private:
+	JSONReader m_reader;
+	std::vector<struct nfsdb_entry> m_entries;
+	std::vector<const char*> m_string_table;
+	std::vector<uint32_t> m_string_size_table;
+	std::unordered_map<std::string_view,unsigned long> m_string_map;
+	std::vector<std::unique_ptr<char[]>> m_string_blocks;
+	std::vector<std::unique_ptr<char[]>> m_long_strings;
+	size_t m_string_block_used = JSON_STRING_BLOCK_SIZE;
+	std::vector<unsigned long> m_shared_argv_list;
+	std::set<unsigned long> m_threads;
+	json_entry m_entry;
+
+	const char* store_string(std::string_view s) {
+		char* copy;
+		if (s.size()+1>JSON_STRING_BLOCK_SIZE/16) {
+			m_long_strings.emplace_back(new char[s.size()+1]);
+			copy = m_long_strings.back().get();
+		}
+		else {
+			if (m_string_block_used+s.size()+1>JSON_STRING_BLOCK_SIZE) {
+				m_string_blocks.emplace_back(new char[JSON_STRING_BLOCK_SIZE]);
+				m_string_block_used = 0;
+			}
+			copy = m_string_blocks.back().get()+m_string_block_used;
+			m_string_block_used+=s.size()+1;
+		}
+		memcpy(copy,s.data(),s.size());
+		copy[s.size()] = 0;
+		return copy;
+	}
+
+	template <typename T>
+	static T* copy_array(const std::vector<T>& v) {
+		T* a = (T*)malloc(v.size()*sizeof(T));
+		if (v.size()) memcpy(a,v.data(),v.size()*sizeof(T));
+		return a;
+	}
+
+	unsigned long* string_list(const std::vector<std::string_view>& v) {
+		unsigned long* a = (unsigned long*)malloc(v.size()*sizeof(unsigned long));
+		for (size_t u=0; u<v.size(); ++u) {
+			a[u] = string_table_add(v[u]);
+		}
+		return a;
+	}
+
+	struct pp_def* pp_def_list(const std::vector<json_pp_def>& v) {
+		struct pp_def* a = (struct pp_def*)malloc(v.size()*sizeof(struct pp_def));
+		for (size_t u=0; u<v.size(); ++u) {
+			a[u].name = string_table_add(v[u].name);
+			a[u].value = string_table_add(v[u].value);
+		}
+		return a;
+	}
+
+	bool parse_string_list(std::vector<std::string_view>& v) {
+		return m_reader.parse_array([&]() {
+			std::string_view s;
+			if (!m_reader.read_string(s,m_entry.scratch)) return false;
+			v.push_back(s);
+			return true;
+		});
+	}
+
+	bool parse_ulong_pair(char k1, unsigned long& v1, char k2, unsigned long& v2) {
+		return m_reader.parse_object([&](std::string_view key) {
+			if (key.size()==1 && key[0]==k1) return m_reader.read_integer(v1);
+			if (key.size()==1 && key[0]==k2) return m_reader.read_integer(v2);
+			return m_reader.skip_value();
+		});
+	}
+
+	bool parse_pp_def_list(std::vector<json_pp_def>& v) {
+		return m_reader.parse_array([&]() {
+			json_pp_def def;
+			bool ok = m_reader.parse_object([&](std::string_view key) {
+				if (key=="n") return m_reader.read_string(def.name,m_entry.scratch);
+				if (key=="v") return m_reader.read_string(def.value,m_entry.scratch);
+				return m_reader.skip_value();
+			});
+			v.push_back(def);
+			return ok;
+		});
+	}
+
+	bool parse_openfile() {
+		json_openfile openfile = {};
+		bool ok = m_reader.parse_object([&](std::string_view key) {
+			if (key.size()!=1) return m_reader.skip_value();
+			switch (key[0]) {
+				case 'p': return m_reader.read_string(openfile.path,m_entry.scratch);
+				case 'o':
+					openfile.has_original_path = 1;
+					return m_reader.read_string(openfile.original_path,m_entry.scratch);
+				case 'b':
+					openfile.has_open_timestamp = 1;
+					return m_reader.read_integer(openfile.open_timestamp);
+				case 'e':
+					openfile.has_close_timestamp = 1;
+					return m_reader.read_integer(openfile.close_timestamp);
+				case 'm': return m_reader.read_integer(openfile.mode);
+				case 's':
+					openfile.has_size = 1;
+					return m_reader.read_integer(openfile.size);
+				default: return m_reader.skip_value();
+			}
+		});
+		m_entry.open_files.push_back(openfile);
+		return ok;
+	}
+
+	bool parse_compilation_info() {
+		m_entry.has_compilation_info = 1;
+		return m_reader.parse_object([&](std::string_view key) {
+			if (key.size()!=1) return m_reader.skip_value();
+			switch (key[0]) {
+				case 'f': return parse_string_list(m_entry.compiled_list);
+				case 'i': return parse_string_list(m_entry.include_paths);
+				case 'd': return parse_pp_def_list(m_entry.pp_defs);
+				case 'u': return parse_pp_def_list(m_entry.pp_udefs);
+				case 'h': return parse_string_list(m_entry.header_list);
+				case 's': return m_reader.read_integer(m_entry.compilation_type);
+				case 'o': return parse_string_list(m_entry.object_list);
+				case 'p': return m_reader.read_integer(m_entry.integrated);
+				default: return m_reader.skip_value();
+			}
+		});
+	}
+
+	bool parse_entry() {
+		m_entry.clear();
+		return m_reader.parse_object([&](std::string_view key) {
+			if (key.size()!=1) return m_reader.skip_value();
+			switch (key[0]) {
+				case 'p': return m_reader.read_integer(m_entry.eid.pid);
+				case 'x': return m_reader.read_integer(m_entry.eid.exeidx);
+				case 's':
+					m_entry.has_stime = 1;
+					return m_reader.read_integer(m_entry.stime);
+				case 'e':
+					m_entry.has_etime = 1;
+					return m_reader.read_integer(m_entry.etime);
+				case 'r': return parse_ulong_pair('p',m_entry.parent_eid.pid,'x',m_entry.parent_eid.exeidx);
+				case 'c':
+					return m_reader.parse_array([&]() {
+						struct cid cid = {0,0};
+						bool ok = parse_ulong_pair('p',cid.pid,'f',cid.flags);
+						m_entry.child_ids.push_back(cid);
+						return ok;
+					});
+				case 'b': return m_reader.read_string(m_entry.binary,m_entry.scratch);
+				case 'w': return m_reader.read_string(m_entry.cwd,m_entry.scratch);
+				case 'v': return parse_string_list(m_entry.argv);
+				case '!':
+					m_entry.has_return_code = 1;
+					return m_reader.read_integer(m_entry.return_code);
+				case 'o': return m_reader.parse_array([&]() { return parse_openfile(); });
+				case 'n':
+					m_entry.has_pcp = 1;
+					return m_reader.read_string(m_entry.pcp,m_entry.scratch);
+				case 'm':
+					m_entry.has_wrapper_pid = 1;
+					return m_reader.read_integer(m_entry.wrapper_pid);
+				case 'i':
+					return m_reader.parse_array([&]() {
+						struct eid eid = {0,0};
+						bool ok = parse_ulong_pair('p',eid.pid,'x',eid.exeidx);
+						m_entry.pipe_eids.push_back(eid);
+						return ok;
+					});
+				case 'd': return parse_compilation_info();
+				case 'l':
+					m_entry.has_linked_file = 1;
+					return m_reader.read_string(m_entry.linked_file,m_entry.scratch);
+				case 't': return m_reader.read_integer(m_entry.linked_type);
+				case 'u':
+					return m_reader.parse_array([&]() {
+						struct cputime cputime = {0,0};
+						bool ok = parse_ulong_pair('c',cputime.cpu,'t',cputime.timestamp);
+						m_entry.cpu.push_back(cputime);
+						return ok;
+					});
+				default: return m_reader.skip_value();
+			}
+		});
+	}
+
+	/* Converts the parsed entry into a new nfsdb entry (the same way as libetrace_create_nfsdb does) */
+	void add_entry() {
+		json_entry& e = m_entry;
+		struct nfsdb_entry* new_entry = &m_entries.emplace_back();
+		new_entry->nfsdb_index = m_entries.size()-1;
+		new_entry->eid = e.eid;
+		new_entry->stime = e.has_stime?e.stime:ULONG_MAX;
+		new_entry->etime = e.has_etime?e.etime:ULONG_MAX;
+		new_entry->parent_eid = e.parent_eid;
+		if (new_entry->nfsdb_index==0) {
+			/* fix parent process of the root entry */
+			new_entry->parent_eid.pid = 0;
+		}
+		new_entry->child_ids_count = e.child_ids.size();
+		new_entry->child_ids = copy_array(e.child_ids);
+		new_entry->binary = string_table_add(e.binary);
+		new_entry->cwd = string_table_add(e.cwd);
+		const char* bpath = joinpath(m_string_table[new_entry->cwd],m_string_table[new_entry->binary]);
+		new_entry->bpath = string_table_add(bpath?bpath:"");
+		if (bpath && bpath[0]) free((void*)bpath);
+		new_entry->argv_count = e.argv.size();
+		new_entry->argv = string_list(e.argv);
+		if (e.has_return_code) {
+			new_entry->return_code = (int)e.return_code;
+		}
+		new_entry->open_files_count = e.open_files.size();
+		new_entry->open_files = (struct openfile*)calloc(new_entry->open_files_count,sizeof(struct openfile));
+		for (size_t u=0; u<e.open_files.size(); ++u) {
+			json_openfile& openfile = e.open_files[u];
+			if (openfile.has_open_timestamp) {
+				new_entry->open_files[u].open_timestamp = openfile.open_timestamp;
+			}
+			if (openfile.has_close_timestamp) {
+				new_entry->open_files[u].close_timestamp = openfile.close_timestamp;
+			}
+			new_entry->open_files[u].path = string_table_add(openfile.path);
+			new_entry->open_files[u].mode = openfile.mode;
+			if (openfile.has_size) {
+				new_entry->open_files[u].size = openfile.size;
+			}
+			if (openfile.has_original_path) {
+				new_entry->open_files[u].original_path = (unsigned long*)malloc(sizeof(unsigned long));
+				*(new_entry->open_files[u].original_path) = string_table_add(openfile.original_path);
+			}
+		}
+		if (e.has_pcp) {
+			std::string pcp(e.pcp);
+			size_t pcp_count = 0;
+			new_entry->pcp = base64_decode(pcp.c_str(),&pcp_count);
+			new_entry->pcp_count = pcp_count;
+		}
+		new_entry->wrapper_pid = e.has_wrapper_pid?e.wrapper_pid:ULONG_MAX;
+		new_entry->pipe_eids_count = e.pipe_eids.size();
+		new_entry->pipe_eids = copy_array(e.pipe_eids);
+		if (e.has_compilation_info) {
+			struct compilation_info* ci = (struct compilation_info*)calloc(1,sizeof(struct compilation_info));
+			ci->compiled_count = e.compiled_list.size();
+			ci->compiled_list = string_list(e.compiled_list);
+			ci->compiled_index = (struct nfsdb_entry_file_index*)calloc(1,ci->compiled_count*sizeof(struct nfsdb_entry_file_index));
+			ci->include_paths_count = e.include_paths.size();
+			ci->include_paths = string_list(e.include_paths);
+			ci->pp_defs_count = e.pp_defs.size();
+			ci->pp_defs = pp_def_list(e.pp_defs);
+			ci->pp_udefs_count = e.pp_udefs.size();
+			ci->pp_udefs = pp_def_list(e.pp_udefs);
+			ci->header_list_count = e.header_list.size();
+			ci->header_list = string_list(e.header_list);
+			ci->header_index = (struct nfsdb_entry_file_index*)calloc(1,ci->header_list_count*sizeof(struct nfsdb_entry_file_index));
+			ci->compilation_type = (int)e.compilation_type;
+			ci->object_list_count = e.object_list.size();
+			ci->object_list = string_list(e.object_list);
+			ci->object_index = (struct nfsdb_entry_file_index*)calloc(1,ci->object_list_count*sizeof(struct nfsdb_entry_file_index));
+			ci->integrated_compilation = (e.integrated==0);
+			new_entry->compilation_info = ci;
+		}
+		if (e.has_linked_file) {
+			unsigned long* linked_file = (unsigned long*)calloc(1,sizeof(unsigned long));
+			*linked_file = string_table_add(e.linked_file);
+			new_entry->linked_file = linked_file;
+			new_entry->linked_type = (int)e.linked_type;
+		}
+		for (unsigned long u=0; u<new_entry->argv_count; ++u) {
+			for (unsigned long j=0; j<m_shared_argv_list.size(); ++j) {
+				if (new_entry->argv[u]==m_shared_argv_list[j]) {
+					new_entry->has_shared_argv = 1;
+					break;
+				}
+			}
+			if (new_entry->has_shared_argv) break;
+		}
+		if (e.cpu.size()) {
+			new_entry->cpu_count = e.cpu.size();
+			new_entry->cpu = copy_array(e.cpu);
+			for (auto& cputime : e.cpu) {
+				m_threads.insert(cputime.cpu);
+			}
+		}
+	}
+
+public:
+	NFSDBJSONLoader(const char* data, size_t size) : m_reader(data,size) {
+		unsigned long empty_string_id = string_table_add("");
+		assert(empty_string_id==LIBETRACE_EMPTY_STRING_HANDLE);
+		(void)empty_string_id;
+	}
+
+	const std::string& error() const {
+		return m_reader.error();
+	}
+
+	unsigned long string_table_add(std::string_view s) {
+		auto i = m_string_map.find(s);
+		if (i!=m_string_map.end()) {
+			return i->second;
+		}
+		const char* copy = store_string(s);
+		unsigned long string_index = m_string_table.size();
+		m_string_table.push_back(copy);
+		m_string_size_table.push_back(strlen(copy));
+		m_string_map.emplace(std::string_view(copy,s.size()),string_index);
+		return string_index;
+	}
+
+	void add_shared_argv(std::string_view s) {
+		m_shared_argv_list.push_back(string_table_add(s));
+	}
+
+	/* Parses the whole database, returns false on malformed input */
+	bool parse() {
+		bool ok = m_reader.parse_array([&]() {
+			if (!parse_entry()) return false;
+			add_entry();
+			return true;
+		});
+		return ok && m_reader.expect_end();
+	}
+
+	/* Fills the nfsdb with the parsed data (which is still owned by the loader) */
+	void fill(struct nfsdb* nfsdb) {
+		if (m_entries.empty()) return;
+		nfsdb->string_table = m_string_table.data();
+		nfsdb->string_size_table = m_string_size_table.data();
+		nfsdb->string_table_size = m_string_table.size();
+		nfsdb->string_count = m_string_table.size();
+		nfsdb->shared_argv_list = m_shared_argv_list.data();
+		nfsdb->shared_argv_list_size = m_shared_argv_list.size();
+		nfsdb->nfsdb_entry = m_entries.data();
+		nfsdb->nfsdb_count = m_entries.size();
+		nfsdb->threads_count = m_threads.size();
+		nfsdb->threads = (unsigned long*)malloc(nfsdb->threads_count*sizeof(unsigned long));
+		unsigned long u = 0;
+		for (auto thread : m_threads) {
+			nfsdb->threads[u++] = thread;
+		}
+	}
+};
+
+PyObject * libetrace_create_nfsdb_from_json(PyObject *self, PyObject *args, PyObject* kwargs) {
+
+	const char* json_fn;
+	const char* source_root;
+	const char* dbversion;
+	PyObject* pcp_patterns;
+	PyObject* shared_argvs;
+	const char* dbfn;
+	int show_stats = 0, verbose_mode = 0, debug_mode = 0;
+
+	if (!PyArg_ParseTuple(args,"sssO!O!s|p",&json_fn,&source_root,&dbversion,&PyList_Type,&pcp_patterns,
+			&PyList_Type,&shared_argvs,&dbfn,&show_stats)) {
+		return 0;
+	}
+
+	if (KWARGS_HAVE(kwargs,"verbose"))
+		verbose_mode = !!PyLong_AsLong(KWARGS_GET(kwargs,"verbose"));
+	if (KWARGS_HAVE(kwargs,"debug"))
+		debug_mode = !!PyLong_AsLong(KWARGS_GET(kwargs,"debug"));
+	size_t jobs = 0;
+	if (KWARGS_HAVE(kwargs,"jobs") && PyLong_AsLong(KWARGS_GET(kwargs,"jobs"))>0)
+		jobs = PyLong_AsLong(KWARGS_GET(kwargs,"jobs"));
+
+	int fd = open(json_fn,O_RDONLY);
+	if (fd<0) {
+		PyErr_Format(libetrace_nfsdbError,"Cannot open the JSON database %s: %s",json_fn,strerror(errno));
+		return 0;
+	}
+	struct stat st;
+	if (fstat(fd,&st)) {
+		PyErr_Format(libetrace_nfsdbError,"Cannot stat the JSON database %s: %s",json_fn,strerror(errno));
+		close(fd);
+		return 0;
+	}
+	size_t size = st.st_size;
+	const char* data = "";
+	if (size) {
+		void* map = mmap(0,size,PROT_READ,MAP_PRIVATE,fd,0);
+		if (map==MAP_FAILED) {
+			PyErr_Format(libetrace_nfsdbError,"Cannot map the JSON database %s: %s",json_fn,strerror(errno));
+			close(fd);
+			return 0;
+		}
+		madvise(map,size,MADV_SEQUENTIAL);
+		data = (const char*)map;
+	}
+	close(fd);
+
+	NFSDBJSONLoader loader(data,size);
+	for (Py_ssize_t i=0; i<PyList_Size(shared_argvs); ++i) {
+		const char* s = PyUnicode_AsUTF8(PyList_GetItem(shared_argvs,i));
+		if (!s) {
+			if (size) munmap((void*)data,size);
+			return 0;
+		}
+		loader.add_shared_argv(s);
+	}
+
+	bool ok = loader.parse();
+	if (size) {
+		munmap((void*)data,size);
+	}
+	if (!ok) {
+		PyErr_Format(libetrace_nfsdbError,"Cannot parse the JSON database %s: %s",json_fn,loader.error().c_str());
+		return 0;
+	}
+
+	struct nfsdb nfsdb = {0};
+	nfsdb.db_magic = NFSDB_MAGIC_NUMBER;
+	nfsdb.db_version = LIBETRACE_VERSION;
+	nfsdb.source_root = source_root;
+	nfsdb.source_root_size = strlen(nfsdb.source_root);
+	nfsdb.dbversion = dbversion;
+	std::vector<const char*> pcp_pattern_list;
+	loader.fill(&nfsdb);
+	if (nfsdb.nfsdb_count) {
+		for (Py_ssize_t i=0; i<PyList_Size(pcp_patterns); ++i) {
+			/* Owned by the pattern objects which outlive the call */
+			const char* s = PyUnicode_AsUTF8(PyList_GetItem(pcp_patterns,i));
+			if (!s) return 0;
+			pcp_pattern_list.push_back(s);
+		}
+		nfsdb.pcp_pattern_list = pcp_pattern_list.data();
+		nfsdb.pcp_pattern_list_size = pcp_pattern_list.size();
+		nfsdb_image_prepare(&nfsdb,show_stats,jobs);
+	}
+
+	int err = nfsdb_image_write(&nfsdb,dbfn,verbose_mode,debug_mode);
+
+	if (err) {
+		Py_RETURN_FALSE;
+	}
+	Py_RETURN_TRUE;
+}
@@ -8,7 +8,10 @@ extern "C" {
 #include <vector>
 #include <algorithm>
 #include <string>
-#include <list>
+#include <thread>
+#include <functional>
+#include <iterator>
+#include <stdint.h>
 
 struct eid_cmp {
     bool operator() (const struct eid& a, const struct eid& b) const {
@@ -31,70 +34,170 @@ unsigned long nfsdb_has_unique_keys(const struct nfsdb* nfsdb) {
 	return 0;
 }
 
-#define BUILD_NFSDB_ENTRY_MAP(__name,__member)	\
+#define BUILD_STRINGREF_ENTRYLIST_MAP(__ob,__name,__member)	\
 	do {	\
 		for (decltype(__name)::iterator i=__name.begin(); i!=__name.end(); ++i) {	\
-			struct nfsdb_entry** entry_list = (struct nfsdb_entry**)malloc((*i).second.size()*sizeof(struct nfsdb_entry*));	\
+			void** entry_list = (void**)malloc((*i).second.size()*sizeof(void*));	\
 			size_t u=0;	\
 			for (decltype((*i).second)::iterator j=(*i).second.begin(); j!=(*i).second.end(); ++j,++u) {	\
-				entry_list[u] = (*j);	\
+				entry_list[u] = (void*)(*j);	\
 			}	\
-			nfsdb_entryMap_insert(&nfsdb->__member,(*i).first,entry_list,(*i).second.size());	\
+			stringRef_entryListMap_insert(&__ob->__member,strdup((*i).first.c_str()),entry_list,(*i).second.size());	\
 		}	\
 		if (show_stats) {	\
-			printf(#__name " keys: %zu:%zu\n",__name.size(),nfsdb_entryMap_count(&nfsdb->__member));	\
+			printf(#__name " keys: %zu:%zu\n",__name.size(),stringRef_entryListMap_count(&__ob->__member));	\
 			size_t __name##EntryCount = 0;	\
 			for (decltype(__name)::iterator i=__name.begin(); i!=__name.end(); ++i) {	\
 				__name##EntryCount+=(*i).second.size();	\
 			}	\
-			printf(#__name " entry count: %zu:%zu\n",__name##EntryCount,nfsdb_entryMap_entry_count(&nfsdb->__member));	\
+			printf(#__name " entry count: %zu:%zu\n",__name##EntryCount,stringRef_entryListMap_entry_count(&__ob->__member));	\
 		}	\
 	} while(0)
 
-#define BUILD_ULONG_MAP(__name,__member)	\
+typedef std::pair<unsigned long,unsigned long> ulong_pair_t;
+typedef std::pair<unsigned long,ulong_pair_t> openfile_ref_t;
+
+/* Minimal number of nfsdb entries scanned by a single thread */
+#define NFSDB_MAPS_ENTRIES_PER_THREAD	4096
+/* Minimal number of binary paths checked by a single thread */
+#define NFSDB_MAPS_PATHS_PER_THREAD		256
+
+/*
+ * Records of the maps collected from a contiguous range of nfsdb entries.
+ * Each vector is sorted by the key. Where the order of values matters it is the order of nfsdb entries,
+ * which is preserved when the parts (created for consecutive ranges) are merged.
+ */
+struct nfsdb_maps_part {
+	std::vector<ulong_pair_t> processes;					/* <pid>, <entry index> */
+	std::vector<std::pair<unsigned long,long>> binaries;	/* <bpath>, <position in the list> */
+	std::vector<ulong_pair_t> forks;						/* <pid>, <child pid> */
+	std::vector<ulong_pair_t> pipes;						/* <pipe pid>, <pid> */
+	std::vector<ulong_pair_t> writes;						/* <pid>, <path> */
+	std::vector<ulong_pair_t> reads;						/* <pid>, <path> */
+	std::vector<openfile_ref_t> file_writes;				/* <path>, <entry index, openfile index> */
+	std::vector<openfile_ref_t> file_reads;					/* <path>, <entry index, openfile index> */
+	std::vector<ulong_pair_t> linked;						/* <linked path>, <entry index> */
+};
+
+template <typename T>
+static bool key_less(const T& a, const T& b) {
+	return a.first<b.first;
+}
+
+/* Calls fn(n) for every n in [0,count) on a separate thread */
+template <typename F>
+static void run_parallel(size_t count, F&& fn) {
+	std::vector<std::thread> threads;
+	for (size_t n=1; n<count; ++n) {
+		threads.emplace_back([&fn,n]() { fn(n); });
+	}
+	fn(0);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+/*
+ * Moves the sorted vectors of all parts into a single sorted vector.
+ * The merge is stable, i.e. values of equal keys keep the order of parts.
+ */
+template <typename T, typename Cmp>
+static std::vector<T> merge_parts(std::vector<nfsdb_maps_part>& parts, std::vector<T> nfsdb_maps_part::*member, Cmp cmp) {
+	std::vector<T> out;
+	std::vector<size_t> bounds(1,0);
+	size_t total = 0;
+	for (auto& part : parts) {
+		total+=(part.*member).size();
+	}
+	out.reserve(total);
+	for (auto& part : parts) {
+		out.insert(out.end(),(part.*member).begin(),(part.*member).end());
+		std::vector<T>().swap(part.*member);
+		bounds.push_back(out.size());
+	}
+	for (size_t width=1; width<parts.size(); width*=2) {
+		for (size_t i=0; i+width<parts.size(); i+=2*width) {
+			size_t end = std::min(i+2*width,parts.size());
+			std::inplace_merge(out.begin()+bounds[i],out.begin()+bounds[i+width],out.begin()+bounds[end],cmp);
+		}
+	}
+	return out;
+}
+
+/* Calls fn(key,begin,end) for every range of elements with the same key in a sorted vector */
+template <typename T, typename F>
+static void for_each_key(const std::vector<T>& v, F&& fn) {
+	for (size_t i=0; i<v.size();) {
+		size_t j = i+1;
+		while ((j<v.size()) && (v[j].first==v[i].first)) ++j;
+		fn(v[i].first,i,j);
+		i = j;
+	}
+}
+
+/* Builds the nfsdb entry map from values sorted by the key, returns the number of keys */
+template <typename T, typename F>
+static size_t build_nfsdb_entry_map(struct nfsdb_entryMap* map, const std::vector<T>& v, F&& value_entry) {
+	size_t keys = 0;
+	for_each_key(v,[&](unsigned long key, size_t begin, size_t end) {
+		keys++;
+	});
+	nfsdb_entryMap_create(map,keys);
+	size_t n = 0;
+	for_each_key(v,[&](unsigned long key, size_t begin, size_t end) {
+		struct nfsdb_entryMap_node* node = &map->nodes[n];
+		map->keys[n++] = key;
+		node->key = key;
+		node->entry_list = (struct nfsdb_entry**)malloc((end-begin)*sizeof(struct nfsdb_entry*));
+		node->entry_count = end-begin;
+		for (size_t u=begin; u<end; ++u) {
+			node->entry_list[u-begin] = value_entry(v[u]);
+		}
+	});
+	return keys;
+}
+
+/* Builds the ulong map from values sorted by the key, returns the number of keys */
+static size_t build_ulong_map(struct rb_root* map, const std::vector<ulong_pair_t>& v) {
+	struct ulongMap_node* last = 0;
+	size_t keys = 0;
+	for_each_key(v,[&](unsigned long key, size_t begin, size_t end) {
+		unsigned long* value_list = (unsigned long*)malloc((end-begin)*sizeof(unsigned long));
+		for (size_t u=begin; u<end; ++u) {
+			value_list[u-begin] = v[u].second;
+		}
+		last = ulongMap_append(map,last,key,value_list,end-begin,end-begin);
+		keys++;
+	});
+	return keys;
+}
+
+#define SHOW_NFSDB_ENTRY_MAP_STATS(__name,__member,__keys,__entries)	\
 	do {	\
-		for (decltype(__name)::iterator i=__name.begin(); i!=__name.end(); ++i) {	\
-			unsigned long* value_list = (unsigned long*)malloc((*i).second.size()*sizeof(unsigned long));	\
-			size_t u=0;	\
-			for (decltype((*i).second)::iterator j=(*i).second.begin(); j!=(*i).second.end(); ++j,++u) {	\
-				value_list[u] = (*j);	\
-			}	\
-			ulongMap_insert(&nfsdb->__member,(*i).first,value_list,(*i).second.size(),(*i).second.size());	\
-		}	\
 		if (show_stats) {	\
-			printf(#__name " keys: %zu:%zu\n",__name.size(),ulongMap_count(&nfsdb->__member));	\
-			size_t __name##EntryCount = 0;	\
-			for (decltype(__name)::iterator i=__name.begin(); i!=__name.end(); ++i) {	\
-				__name##EntryCount+=(*i).second.size();	\
-			}	\
-			printf(#__name " entry count: %zu:%zu\n",__name##EntryCount,ulongMap_entry_count(&nfsdb->__member));	\
+			printf(#__name " keys: %zu:%zu\n",(size_t)(__keys),nfsdb_entryMap_count(&nfsdb->__member));	\
+			printf(#__name " entry count: %zu:%zu\n",(size_t)(__entries),nfsdb_entryMap_entry_count(&nfsdb->__member));	\
 		}	\
-	}	\
-	while(0)
+	} while(0)
 
-#define BUILD_STRINGREF_ENTRYLIST_MAP(__ob,__name,__member)	\
+#define SHOW_ULONG_MAP_STATS(__name,__member,__keys,__entries)	\
 	do {	\
-		for (decltype(__name)::iterator i=__name.begin(); i!=__name.end(); ++i) {	\
-			void** entry_list = (void**)malloc((*i).second.size()*sizeof(void*));	\
-			size_t u=0;	\
-			for (decltype((*i).second)::iterator j=(*i).second.begin(); j!=(*i).second.end(); ++j,++u) {	\
-				entry_list[u] = (void*)(*j);	\
-			}	\
-			stringRef_entryListMap_insert(&__ob->__member,strdup((*i).first.c_str()),entry_list,(*i).second.size());	\
-		}	\
 		if (show_stats) {	\
-			printf(#__name " keys: %zu:%zu\n",__name.size(),stringRef_entryListMap_count(&__ob->__member));	\
-			size_t __name##EntryCount = 0;	\
-			for (decltype(__name)::iterator i=__name.begin(); i!=__name.end(); ++i) {	\
-				__name##EntryCount+=(*i).second.size();	\
-			}	\
-			printf(#__name " entry count: %zu:%zu\n",__name##EntryCount,stringRef_entryListMap_entry_count(&__ob->__member));	\
+			printf(#__name " keys: %zu:%zu\n",(size_t)(__keys),ulongMap_count(&nfsdb->__member));	\
+			printf(#__name " entry count: %zu:%zu\n",(size_t)(__entries),ulongMap_entry_count(&nfsdb->__member));	\
 		}	\
 	} while(0)
 
-typedef std::vector<struct nfsdb_entry*> vexecs_t;
-typedef std::list<struct nfsdb_entry*> lexecs_t;
-typedef std::map<unsigned long,std::vector<unsigned long>> forkMap_t;
+static void set_openfile_list(struct nfsdb* nfsdb, const std::vector<ulong_pair_t>& v,
+		struct nfsdb_entry*** entry_list, unsigned long** entry_index, unsigned long* entry_count) {
+	*entry_list = (struct nfsdb_entry**)malloc(v.size()*sizeof(struct nfsdb_entry*));
+	*entry_index = (unsigned long*)malloc(v.size()*sizeof(unsigned long));
+	*entry_count = v.size();
+	for (size_t u=0; u<v.size(); ++u) {
+		(*entry_list)[u] = &nfsdb->nfsdb_entry[v[u].first];
+		(*entry_index)[u] = v[u].second;
+	}
+}
 
 /*
  * processMap:
@@ -154,225 +257,303 @@ typedef std::map<unsigned long,std::vector<unsigned long>> forkMap_t;
  *
  * linkedMap:
  *  Maps a unique linked file path to a nfsdb entry that created this linked file path
+ *
+ * The maps (and so the image) don't depend on the number of threads used ('jobs', 0 for all available cores)
  */
 
-int nfsdb_maps(struct nfsdb* nfsdb, int show_stats) {
-
-	std::map<unsigned long,vexecs_t> processMap;
-	std::map<unsigned long,lexecs_t> bexeMap;
-	forkMap_t forkMap;
-	typedef std::pair<unsigned long,unsigned long> openfileHandle;
-	typedef std::set<openfileHandle> openfileHandleSet;
-	std::map<unsigned long,std::set<unsigned long>> pipeMap;
-	std::map<unsigned long,std::set<unsigned long>> wrMap;
-	std::map<unsigned long,std::set<unsigned long>> rdMap;
-	std::map<unsigned long,std::tuple<openfileHandleSet,openfileHandleSet,openfileHandleSet,openfileHandleSet,unsigned long>> fileMap;
-	std::map<unsigned long,struct nfsdb_entry*> linkedMap;
-	for (unsigned long u=0; u<nfsdb->nfsdb_count; ++u) {
-
-		struct nfsdb_entry* entry = &nfsdb->nfsdb_entry[u];
+int nfsdb_maps(struct nfsdb* nfsdb, int show_stats, size_t jobs) {
 
-		unsigned long pid = entry->eid.pid;
-		processMap[pid].push_back(entry);
+	if (!jobs) {
+		jobs = std::max(1U,std::thread::hardware_concurrency());
+	}
 
-		if ((entry->bpath!=LIBETRACE_EMPTY_STRING_HANDLE)&&(entry->argv_count>0)) {
-			/* If the entry is a compiler or linker move the first such entry at the beginning of the 'bexeMap'
-			   (it can ease the burden of checking whether a given path is a compiler or linker) */
-			if ((entry->compilation_info)||(entry->linked_file)) {
-				bexeMap[entry->bpath].push_front(entry);
-			}
-			else {
-				bexeMap[entry->bpath].push_back(entry);
+	/*
+	 * The nfsdb entries are scanned in parallel, each thread collects sorted records for a contiguous
+	 * range of entries. The records are merged afterwards and the maps are built in a single pass
+	 * over the sorted input.
+	 */
+	size_t part_count = jobs;
+	part_count = std::max((size_t)1,std::min(part_count,(size_t)(nfsdb->nfsdb_count/NFSDB_MAPS_ENTRIES_PER_THREAD)));
+	std::vector<nfsdb_maps_part> parts(part_count);
+
+	run_parallel(part_count,[&](size_t n) {
+		nfsdb_maps_part& part = parts[n];
+		unsigned long begin = nfsdb->nfsdb_count*n/part_count;
+		unsigned long end = nfsdb->nfsdb_count*(n+1)/part_count;
+
+		for (unsigned long u=begin; u<end; ++u) {
+
+			struct nfsdb_entry* entry = &nfsdb->nfsdb_entry[u];
+
+			unsigned long pid = entry->eid.pid;
+			part.processes.push_back(ulong_pair_t(pid,u));
+
+			if ((entry->bpath!=LIBETRACE_EMPTY_STRING_HANDLE)&&(entry->argv_count>0)) {
+				/* If the entry is a compiler or linker move the first such entry at the beginning of the 'bexeMap'
+				   (it can ease the burden of checking whether a given path is a compiler or linker) */
+				if ((entry->compilation_info)||(entry->linked_file)) {
+					part.binaries.push_back(std::pair<unsigned long,long>(entry->bpath,-(long)u-1));
+				}
+				else {
+					part.binaries.push_back(std::pair<unsigned long,long>(entry->bpath,u));
+				}
 			}
-		}
 
-		for (unsigned long i=0; i<entry->child_ids_count; ++i) {
-			forkMap[pid].push_back(entry->child_ids[i].pid);
-		}
+			for (unsigned long i=0; i<entry->child_ids_count; ++i) {
+				part.forks.push_back(ulong_pair_t(pid,entry->child_ids[i].pid));
+			}
 
-		for (unsigned long i=0; i<entry->pipe_eids_count; ++i) {
-			pipeMap[entry->pipe_eids[i].pid].insert(pid);
-		}
+			for (unsigned long i=0; i<entry->pipe_eids_count; ++i) {
+				part.pipes.push_back(ulong_pair_t(entry->pipe_eids[i].pid,pid));
+			}
 
-		for (unsigned long i=0; i<entry->open_files_count; ++i) {
-			if ((entry->open_files[i].mode&3)>=1) {
-				wrMap[pid].insert(entry->open_files[i].path);
-				std::get<1>(fileMap[entry->open_files[i].path]).insert(openfileHandle(u,i));
+			for (unsigned long i=0; i<entry->open_files_count; ++i) {
+				if ((entry->open_files[i].mode&3)>=1) {
+					part.writes.push_back(ulong_pair_t(pid,entry->open_files[i].path));
+					part.file_writes.push_back(openfile_ref_t(entry->open_files[i].path,ulong_pair_t(u,i)));
+				}
+				if ((entry->open_files[i].mode&3)!=1) {
+					part.reads.push_back(ulong_pair_t(pid,entry->open_files[i].path));
+					part.file_reads.push_back(openfile_ref_t(entry->open_files[i].path,ulong_pair_t(u,i)));
+				}
 			}
-			if ((entry->open_files[i].mode&3)!=1) {
-				rdMap[pid].insert(entry->open_files[i].path);
-				std::get<0>(fileMap[entry->open_files[i].path]).insert(openfileHandle(u,i));
+
+			if (entry->linked_file) {
+				part.linked.push_back(ulong_pair_t(*(entry->linked_file),u));
 			}
 		}
 
-		if (entry->linked_file) {
-			linkedMap[*(entry->linked_file)] = entry;
+		std::sort(part.processes.begin(),part.processes.end());
+		std::sort(part.binaries.begin(),part.binaries.end());
+		std::stable_sort(part.forks.begin(),part.forks.end(),key_less<ulong_pair_t>);
+		std::sort(part.pipes.begin(),part.pipes.end());
+		part.pipes.erase(std::unique(part.pipes.begin(),part.pipes.end()),part.pipes.end());
+		std::sort(part.writes.begin(),part.writes.end());
+		part.writes.erase(std::unique(part.writes.begin(),part.writes.end()),part.writes.end());
+		std::sort(part.reads.begin(),part.reads.end());
+		part.reads.erase(std::unique(part.reads.begin(),part.reads.end()),part.reads.end());
+		std::sort(part.file_writes.begin(),part.file_writes.end());
+		std::sort(part.file_reads.begin(),part.file_reads.end());
+		std::sort(part.linked.begin(),part.linked.end());
+	});
+
+	std::vector<ulong_pair_t> processMap;
+	std::vector<std::pair<unsigned long,long>> bexeMap;
+	std::vector<ulong_pair_t> forkMap;
+	std::vector<ulong_pair_t> pipeMap;
+	std::vector<ulong_pair_t> wrMap;
+	std::vector<ulong_pair_t> rdMap;
+	std::vector<openfile_ref_t> fileWrMap;
+	std::vector<openfile_ref_t> fileRdMap;
+	std::vector<ulong_pair_t> linkedMap;
+	run_parallel(9,[&](size_t n) {
+		switch (n) {
+			case 0: processMap = merge_parts(parts,&nfsdb_maps_part::processes,std::less<ulong_pair_t>()); break;
+			case 1: bexeMap = merge_parts(parts,&nfsdb_maps_part::binaries,std::less<std::pair<unsigned long,long>>()); break;
+			case 2: forkMap = merge_parts(parts,&nfsdb_maps_part::forks,key_less<ulong_pair_t>); break;
+			case 3:
+				pipeMap = merge_parts(parts,&nfsdb_maps_part::pipes,std::less<ulong_pair_t>());
+				pipeMap.erase(std::unique(pipeMap.begin(),pipeMap.end()),pipeMap.end());
+				break;
+			case 4:
+				wrMap = merge_parts(parts,&nfsdb_maps_part::writes,std::less<ulong_pair_t>());
+				wrMap.erase(std::unique(wrMap.begin(),wrMap.end()),wrMap.end());
+				break;
+			case 5:
+				rdMap = merge_parts(parts,&nfsdb_maps_part::reads,std::less<ulong_pair_t>());
+				rdMap.erase(std::unique(rdMap.begin(),rdMap.end()),rdMap.end());
+				break;
+			case 6: fileWrMap = merge_parts(parts,&nfsdb_maps_part::file_writes,std::less<openfile_ref_t>()); break;
+			case 7: fileRdMap = merge_parts(parts,&nfsdb_maps_part::file_reads,std::less<openfile_ref_t>()); break;
+			case 8: linkedMap = merge_parts(parts,&nfsdb_maps_part::linked,std::less<ulong_pair_t>()); break;
 		}
-	}
+	});
 
 	/* Populate the return value of the last execution in a process to all other executions */
-	for (std::map<unsigned long,vexecs_t>::iterator i=processMap.begin(); i!=processMap.end(); ++i) {
-		vexecs_t& execs = (*i).second;
-		struct nfsdb_entry* last_entry = execs.back();
-		for (vexecs_t::iterator j=execs.begin(); j!=execs.end(); ++j) {
-			(*j)->return_code = last_entry->return_code;
+	for_each_key(processMap,[&](unsigned long pid, size_t begin, size_t end) {
+		struct nfsdb_entry* last_entry = &nfsdb->nfsdb_entry[processMap[end-1].second];
+		for (size_t u=begin; u<end; ++u) {
+			nfsdb->nfsdb_entry[processMap[u].second].return_code = last_entry->return_code;
 		}
-	}
+	});
 
-	std::map<unsigned long,unsigned long> revforkMap;
-	for (forkMap_t::iterator i=forkMap.begin(); i!=forkMap.end(); ++i) {
-		auto vc = (*i).second;
-		for (decltype(vc)::iterator j=vc.begin(); j!=vc.end(); ++j) {
-			if (revforkMap.find((*j))!=revforkMap.end()) {
-				printf("ERROR: multiple parents for process %lu\n",*j);
-				return 0;
-			}
-			else {
-				revforkMap.insert(std::pair<unsigned long,unsigned long>(*j,(*i).first));
-			}
+	/* <child pid>, <position in the forkMap, parent pid> */
+	std::vector<openfile_ref_t> revforkMap;
+	revforkMap.reserve(forkMap.size());
+	for (size_t u=0; u<forkMap.size(); ++u) {
+		revforkMap.push_back(openfile_ref_t(forkMap[u].second,ulong_pair_t(u,forkMap[u].first)));
+	}
+	std::sort(revforkMap.begin(),revforkMap.end());
+	/* Report the process which is found with another parent first when walking through the forkMap */
+	size_t multiple_parents_pos = SIZE_MAX;
+	unsigned long multiple_parents_pid = 0;
+	for_each_key(revforkMap,[&](unsigned long pid, size_t begin, size_t end) {
+		if ((end-begin>1)&&(revforkMap[begin+1].second.first<multiple_parents_pos)) {
+			multiple_parents_pos = revforkMap[begin+1].second.first;
+			multiple_parents_pid = pid;
 		}
+	});
+	if (multiple_parents_pos!=SIZE_MAX) {
+		printf("ERROR: multiple parents for process %lu\n",multiple_parents_pid);
+		return 0;
 	}
 
-	BUILD_NFSDB_ENTRY_MAP(processMap,procmap);
-	BUILD_NFSDB_ENTRY_MAP(bexeMap,bmap);
-	BUILD_ULONG_MAP(forkMap,forkmap);
+	size_t keys = build_nfsdb_entry_map(&nfsdb->procmap,processMap,[&](const ulong_pair_t& v) {
+		return &nfsdb->nfsdb_entry[v.second];
+	});
+	SHOW_NFSDB_ENTRY_MAP_STATS(processMap,procmap,keys,processMap.size());
+	keys = build_nfsdb_entry_map(&nfsdb->bmap,bexeMap,[&](const std::pair<unsigned long,long>& v) {
+		return &nfsdb->nfsdb_entry[(v.second<0)?(-v.second-1):v.second];
+	});
+	SHOW_NFSDB_ENTRY_MAP_STATS(bexeMap,bmap,keys,bexeMap.size());
+	keys = build_ulong_map(&nfsdb->forkmap,forkMap);
+	SHOW_ULONG_MAP_STATS(forkMap,forkmap,keys,forkMap.size());
 
 	/* Check if the executed binary path exists after the build */
-	struct rb_node * p = rb_first(&nfsdb->bmap);
-	while(p) {
-		struct nfsdb_entryMap_node* data = (struct nfsdb_entryMap_node*)p;
-		const char* binary_path = nfsdb->string_table[data->key];
-		if (access(binary_path, F_OK) == 0) {
-			/* exists */
-			data->custom_data = 1;
-			/* is this a link? */
-			struct stat stat_buf;
-			if (!lstat(binary_path,&stat_buf)) {
-				if (S_ISLNK(stat_buf.st_mode)) data->custom_data++;
+	size_t check_count = jobs;
+	check_count = std::max((size_t)1,std::min(check_count,(size_t)(nfsdb->bmap.count/NFSDB_MAPS_PATHS_PER_THREAD)));
+	run_parallel(check_count,[&](size_t n) {
+		for (size_t u=n; u<nfsdb->bmap.count; u+=check_count) {
+			struct nfsdb_entryMap_node* data = &nfsdb->bmap.nodes[u];
+			const char* binary_path = nfsdb->string_table[data->key];
+			if (access(binary_path, F_OK) == 0) {
+				/* exists */
+				data->custom_data = 1;
+				/* is this a link? */
+				struct stat stat_buf;
+				if (!lstat(binary_path,&stat_buf)) {
+					if (S_ISLNK(stat_buf.st_mode)) data->custom_data++;
+				}
 			}
 		}
-		p = rb_next(p);
-	}
+	});
 
-	for (decltype(revforkMap)::iterator i=revforkMap.begin(); i!=revforkMap.end(); ++i) {
+	struct ulongMap_node* last_revfork = 0;
+	for (size_t u=0; u<revforkMap.size(); ++u) {
 		unsigned long* value_list = (unsigned long*)malloc(sizeof(unsigned long));
-		value_list[0] = (*i).second;
-		ulongMap_insert(&nfsdb->revforkmap,(*i).first,value_list,1,1);
+		value_list[0] = revforkMap[u].second.second;
+		last_revfork = ulongMap_append(&nfsdb->revforkmap,last_revfork,revforkMap[u].first,value_list,1,1);
 	}
 	if (show_stats) {
 		printf("revforkMap keys: %zu:%zu\n",revforkMap.size(),ulongMap_count(&nfsdb->revforkmap));
 	}
 
-	BUILD_ULONG_MAP(pipeMap,pipemap);
-	BUILD_ULONG_MAP(wrMap,wrmap);
-	BUILD_ULONG_MAP(rdMap,rdmap);
+	keys = build_ulong_map(&nfsdb->pipemap,pipeMap);
+	SHOW_ULONG_MAP_STATS(pipeMap,pipemap,keys,pipeMap.size());
+	keys = build_ulong_map(&nfsdb->wrmap,wrMap);
+	SHOW_ULONG_MAP_STATS(wrMap,wrmap,keys,wrMap.size());
+	keys = build_ulong_map(&nfsdb->rdmap,rdMap);
+	SHOW_ULONG_MAP_STATS(rdMap,rdmap,keys,rdMap.size());
 
+	stringHashMap_create(&nfsdb->revstringmap,nfsdb->string_count);
 	for (unsigned long i=0; i<nfsdb->string_count; ++i) {
 		const char* s = nfsdb->string_table[i];
-		stringRefMap_insert(&nfsdb->revstringmap, s, i);
+		stringHashMap_insert(&nfsdb->revstringmap, s, i);
 	}
 
-	for (decltype(fileMap)::iterator i=fileMap.begin(); i!=fileMap.end(); ++i) {
-		openfileHandleSet& rdSet = std::get<0>((*i).second);
-		openfileHandleSet& wrSet = std::get<1>((*i).second);
-		openfileHandleSet& rwSet = std::get<2>((*i).second);
-		openfileHandleSet& gaSet = std::get<3>((*i).second);
+	/* The fileMap contains the opened paths and the paths of executed binaries */
+	std::vector<unsigned long> filePaths, tmpPaths;
+	for (size_t u=0; u<fileRdMap.size(); ++u) {
+		if ((!u)||(fileRdMap[u].first!=fileRdMap[u-1].first)) filePaths.push_back(fileRdMap[u].first);
+	}
+	for (size_t u=0; u<fileWrMap.size(); ++u) {
+		if ((!u)||(fileWrMap[u].first!=fileWrMap[u-1].first)) tmpPaths.push_back(fileWrMap[u].first);
+	}
+	std::vector<unsigned long> openPaths;
+	std::set_union(filePaths.begin(),filePaths.end(),tmpPaths.begin(),tmpPaths.end(),std::back_inserter(openPaths));
+	filePaths.clear();
+	std::set_union(openPaths.begin(),openPaths.end(),nfsdb->bmap.keys,nfsdb->bmap.keys+nfsdb->bmap.count,
+			std::back_inserter(filePaths));
+	fileMap_create(&nfsdb->filemap,filePaths.size());
+
+	/* Walk through the paths opened for reading and writing at the same time */
+	size_t fileMapKeys = 0;
+	size_t fileMapRdEntryCount = 0;
+	size_t fileMapWrEntryCount = 0;
+	size_t fileMapRwEntryCount = 0;
+	std::vector<ulong_pair_t> rdSet, wrSet, rwSet, gaSet, tmpSet;
+	for (size_t n=0, r=0, w=0, b=0; n<filePaths.size(); ++n) {
+		unsigned long path = filePaths[n];
+		struct nfsdb_fileMap_node* node = &nfsdb->filemap.nodes[n];
+		nfsdb->filemap.keys[n] = path;
+		node->key = path;
+
+		/* Mark the paths of executed binaries accordingly */
+		bool executed = (b<nfsdb->bmap.count)&&(nfsdb->bmap.keys[b]==path);
+		if (executed) b++;
+
+		if (((r>=fileRdMap.size())||(fileRdMap[r].first!=path))&&((w>=fileWrMap.size())||(fileWrMap[w].first!=path))) {
+			node->access_type = FILE_ACCESS_TYPE_EXEC;
+			continue;
+		}
+
+		rdSet.clear();
+		wrSet.clear();
+		rwSet.clear();
+		gaSet.clear();
+		for (; (r<fileRdMap.size())&&(fileRdMap[r].first==path); ++r) {
+			rdSet.push_back(fileRdMap[r].second);
+		}
+		for (; (w<fileWrMap.size())&&(fileWrMap[w].first==path); ++w) {
+			wrSet.push_back(fileWrMap[w].second);
+		}
 
 		/* Fill the global access set that will be used for filtering of referenced files */
+		unsigned long global_access;
 		if ((rdSet.size()>0)&&(wrSet.size()>0)) {
-			gaSet.insert(rdSet.begin(),rdSet.end());
-			gaSet.insert(wrSet.begin(),wrSet.end());
-			std::get<4>((*i).second) = ACCESS_RW;
+			std::set_union(rdSet.begin(),rdSet.end(),wrSet.begin(),wrSet.end(),std::back_inserter(gaSet));
+			global_access = ACCESS_RW;
 		}
 		else if (rdSet.size()>0) {
-			gaSet.insert(rdSet.begin(),rdSet.end());
-			std::get<4>((*i).second) = ACCESS_READ;
+			gaSet = rdSet;
+			global_access = ACCESS_READ;
 		}
 		else {
-			gaSet.insert(wrSet.begin(),wrSet.end());
-			std::get<4>((*i).second) = ACCESS_WRITE;
+			gaSet = wrSet;
+			global_access = ACCESS_WRITE;
 		}
 
 		std::set_intersection(rdSet.begin(), rdSet.end(),
 							  wrSet.begin(), wrSet.end(),
-							  std::inserter(rwSet,rwSet.begin()));
-		for (openfileHandleSet::iterator u=rwSet.begin(); u!=rwSet.end(); ++u) {
-			rdSet.erase(*u);
-			wrSet.erase(*u);
+							  std::back_inserter(rwSet));
+		if (rwSet.size()>0) {
+			tmpSet.clear();
+			std::set_difference(rdSet.begin(),rdSet.end(),rwSet.begin(),rwSet.end(),std::back_inserter(tmpSet));
+			rdSet.swap(tmpSet);
+			tmpSet.clear();
+			std::set_difference(wrSet.begin(),wrSet.end(),rwSet.begin(),rwSet.end(),std::back_inserter(tmpSet));
+			wrSet.swap(tmpSet);
 		}
 
 		/* Flush file map entries to cache structures */
-		struct nfsdb_fileMap_node* node = fileMap_insert_key(&nfsdb->filemap, (*i).first);
-		node->rd_entry_list = (struct nfsdb_entry**)malloc(rdSet.size()*sizeof(struct nfsdb_entry*));
-		node->rd_entry_index = (unsigned long*)malloc(rdSet.size()*sizeof(unsigned long));
-		node->rd_entry_count = rdSet.size();
-		size_t u=0;
-		for (openfileHandleSet::iterator j=rdSet.begin(); j!=rdSet.end(); ++j,++u) {
-			node->rd_entry_list[u] = &nfsdb->nfsdb_entry[(*j).first];
-			node->rd_entry_index[u] = (*j).second;
-		}
-		node->wr_entry_list = (struct nfsdb_entry**)malloc(wrSet.size()*sizeof(struct nfsdb_entry*));
-		node->wr_entry_index = (unsigned long*)malloc(wrSet.size()*sizeof(unsigned long));
-		node->wr_entry_count = wrSet.size();
-		u=0;
-		for (openfileHandleSet::iterator j=wrSet.begin(); j!=wrSet.end(); ++j,++u) {
-			node->wr_entry_list[u] = &nfsdb->nfsdb_entry[(*j).first];
-			node->wr_entry_index[u] = (*j).second;
-		}
-		node->rw_entry_list = (struct nfsdb_entry**)malloc(rwSet.size()*sizeof(struct nfsdb_entry*));
-		node->rw_entry_index = (unsigned long*)malloc(rwSet.size()*sizeof(unsigned long));
-		node->rw_entry_count = rwSet.size();
-		u=0;
-		for (openfileHandleSet::iterator j=rwSet.begin(); j!=rwSet.end(); ++j,++u) {
-			node->rw_entry_list[u] = &nfsdb->nfsdb_entry[(*j).first];
-			node->rw_entry_index[u] = (*j).second;
-		}
-		node->ga_entry_list = (struct nfsdb_entry**)malloc(gaSet.size()*sizeof(struct nfsdb_entry*));
-		node->ga_entry_index = (unsigned long*)malloc(gaSet.size()*sizeof(unsigned long));
-		node->ga_entry_count = gaSet.size();
-		u=0;
-		for (openfileHandleSet::iterator j=gaSet.begin(); j!=gaSet.end(); ++j,++u) {
-			node->ga_entry_list[u] = &nfsdb->nfsdb_entry[(*j).first];
-			node->ga_entry_index[u] = (*j).second;
-		}
-		node->global_access = std::get<4>((*i).second);
-		node->access_type = FILE_ACCESS_TYPE_OPEN;
-	}
-	/* Now add the paths of executed binaries to the fileMap and mark the entries as executables accordingly */
-	p = rb_first(&nfsdb->bmap);
-	while(p) {
-		struct nfsdb_entryMap_node* data = (struct nfsdb_entryMap_node*)p;
-		struct nfsdb_fileMap_node* node = fileMap_search(&nfsdb->filemap,data->key);
-		if (!node) {
-			node = fileMap_insert_key(&nfsdb->filemap, data->key);
-			node->access_type = FILE_ACCESS_TYPE_EXEC;
-		}
-		else {
-			node->access_type = FILE_ACCESS_TYPE_OPENEXEC;
-		}
-		p = rb_next(p);
+		set_openfile_list(nfsdb,rdSet,&node->rd_entry_list,&node->rd_entry_index,&node->rd_entry_count);
+		set_openfile_list(nfsdb,wrSet,&node->wr_entry_list,&node->wr_entry_index,&node->wr_entry_count);
+		set_openfile_list(nfsdb,rwSet,&node->rw_entry_list,&node->rw_entry_index,&node->rw_entry_count);
+		set_openfile_list(nfsdb,gaSet,&node->ga_entry_list,&node->ga_entry_index,&node->ga_entry_count);
+		node->global_access = global_access;
+		node->access_type = executed?FILE_ACCESS_TYPE_OPENEXEC:FILE_ACCESS_TYPE_OPEN;
+
+		fileMapKeys++;
+		fileMapRdEntryCount+=rdSet.size();
+		fileMapWrEntryCount+=wrSet.size();
+		fileMapRwEntryCount+=rwSet.size();
 	}
 
 	if (show_stats) {
-		printf("fileMap" " keys: %zu:%zu\n",fileMap.size(),fileMap_count(&nfsdb->filemap));
-		size_t fileMapRdEntryCount = 0;
-		size_t fileMapWrEntryCount = 0;
-		size_t fileMapRwEntryCount = 0;
-		for (decltype(fileMap)::iterator i=fileMap.begin(); i!=fileMap.end(); ++i) {
-			fileMapRdEntryCount+=std::get<0>((*i).second).size();
-			fileMapWrEntryCount+=std::get<1>((*i).second).size();
-			fileMapRwEntryCount+=std::get<2>((*i).second).size();
-		}
+		printf("fileMap" " keys: %zu:%zu\n",fileMapKeys,fileMap_count(&nfsdb->filemap));
 		printf("fileMap" " rd entry count: %zu:%zu\n",fileMapRdEntryCount,fileMap_rd_entry_count(&nfsdb->filemap));
 		printf("fileMap" " wr entry count: %zu:%zu\n",fileMapWrEntryCount,fileMap_wr_entry_count(&nfsdb->filemap));
 		printf("fileMap" " rw entry count: %zu:%zu\n",fileMapRwEntryCount,fileMap_rw_entry_count(&nfsdb->filemap));
 	}
 
-	for (decltype(linkedMap)::iterator i=linkedMap.begin(); i!=linkedMap.end(); ++i) {
-		struct nfsdb_entry** entry_list = (struct nfsdb_entry**)malloc(sizeof(struct nfsdb_entry*));
-		entry_list[0] = (*i).second;
-		nfsdb_entryMap_insert(&nfsdb->linkedmap,(*i).first,entry_list,1);
-	}
+	/* The last entry which created the linked file is kept */
+	std::vector<ulong_pair_t> linkedLast;
+	for_each_key(linkedMap,[&](unsigned long path, size_t begin, size_t end) {
+		linkedLast.push_back(linkedMap[end-1]);
+	});
+	build_nfsdb_entry_map(&nfsdb->linkedmap,linkedLast,[&](const ulong_pair_t& v) {
+		return &nfsdb->nfsdb_entry[v.second];
+	});
 	if (show_stats) {
 		printf("linkedMap entry count: %zu\n",nfsdb_entryMap_count(&nfsdb->linkedmap));
 	}
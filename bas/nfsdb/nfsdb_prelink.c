@@ -0,0 +1,28 @@
+#include <stdint.h>
+#include "nfsdb.h"
+
+#define PRELINK_RECIPES
+#include <prelink.h>
+#include "recipe.h"
+
+int nfsdb_prelink(const char* image_path, const struct nfsdb* nfsdb) {
+
+	struct prelink* pl = prelink_init(image_path);
+	if (!pl) {
+		return -1;
+	}
+	int err = prelink_write(pl,prelink_struct_array_nfsdb(pl,nfsdb,1));
+	prelink_fini(pl);
+	return err;
+}
+
+int nfsdb_deps_prelink(const char* image_path, const struct nfsdb_deps* nfsdb_deps) {
+
+	struct prelink* pl = prelink_init(image_path);
+	if (!pl) {
+		return -1;
+	}
+	int err = prelink_write(pl,prelink_struct_array_nfsdb_deps(pl,nfsdb_deps,1));
+	prelink_fini(pl);
+	return err;
+}
@@ -0,0 +1,501 @@
+extern "C" {
+#include "pyetrace.h"
+}
+#include <vector>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+/*
+ * Candidate extraction for the linked modules and compilations passes of the database post processing.
+ *
+ * The spec patterns are matched once against every distinct binary path. A pool of threads then scans the
+ * entries and resolves the output of linker and archiver executions (command line with response files
+ * expanded, as done by CASDatabase.get_effective_args) and collects the written paths and forked processes
+ * of successful executions. Only the compiler specific probing is left to the Python side.
+ */
+
+/* Minimal number of entries scanned by a single thread */
+#define POST_PROCESS_SCAN_PER_THREAD	4096
+
+enum {
+	SPEC_LD,
+	SPEC_AR,
+	SPEC_COUNT,
+};
+
+/* Python os.path equivalents */
+static bool path_isabs(const std::string& path) {
+	return !path.empty() && path[0]=='/';
+}
+
+static std::string path_join(const std::string& cwd, const std::string& path) {
+	if (path_isabs(path) || cwd.empty()) return path;
+	if (cwd.back()=='/') return cwd+path;
+	return cwd+"/"+path;
+}
+
+static std::string path_normpath(const std::string& path) {
+	if (path.empty()) return ".";
+	size_t initial = 0;
+	if (path[0]=='/') {
+		/* POSIX allows one implementation defined leading '//' */
+		initial = (path.size()>1 && path[1]=='/' && (path.size()==2 || path[2]!='/'))?2:1;
+	}
+	std::vector<std::string> comps;
+	size_t i = 0;
+	while (i<path.size()) {
+		size_t j = path.find('/',i);
+		if (j==std::string::npos) j = path.size();
+		std::string comp = path.substr(i,j-i);
+		i = j+1;
+		if (comp.empty() || comp==".") continue;
+		if (comp==".." && ((!initial && comps.empty()) || (!comps.empty() && comps.back()==".."))) {
+			comps.push_back(comp);
+		}
+		else if (comp=="..") {
+			if (!comps.empty()) comps.pop_back();
+		}
+		else {
+			comps.push_back(comp);
+		}
+	}
+	std::string out(initial,'/');
+	for (size_t k=0; k<comps.size(); ++k) {
+		if (k) out.push_back('/');
+		out+=comps[k];
+	}
+	return out.empty()?".":out;
+}
+
+static std::string path_basename(const std::string& path) {
+	size_t i = path.rfind('/');
+	return (i==std::string::npos)?path:path.substr(i+1);
+}
+
+static std::string path_splitext_ext(const std::string& path) {
+	std::string base = path_basename(path);
+	size_t first = base.find_first_not_of('.');
+	if (first==std::string::npos) return "";
+	size_t dot = base.rfind('.');
+	if (dot==std::string::npos || dot<first) return "";
+	return base.substr(dot);
+}
+
+static bool ends_with(const std::string& s, const char* suffix) {
+	size_t n = strlen(suffix);
+	return s.size()>=n && !s.compare(s.size()-n,n,suffix);
+}
+
+static bool starts_with(const std::string& s, const char* prefix) {
+	return !s.compare(0,strlen(prefix),prefix);
+}
+
+static std::string path_realpath(const std::string& path) {
+	char buf[PATH_MAX];
+	if (realpath(path.c_str(),buf)) return buf;
+	return path_normpath(path);
+}
+
+/*
+ * Rewrites a spec pattern with the Python fnmatch semantics (used by the Python post processing) into the equivalent
+ * fnmatch(3) pattern: backslashes and a '[' without the closing ']' are literal characters, and a leading '^' or
+ * any '[' inside a set (e.g. "[^a]" or "[[:alpha:]]") are literal set members
+ */
+static std::string python_fnmatch_pattern(const char* pattern) {
+	std::string out;
+	size_t n = strlen(pattern);
+	for (size_t i=0; i<n; ++i) {
+		if (pattern[i]=='\\') {
+			out+="\\\\";
+			continue;
+		}
+		if (pattern[i]!='[') {
+			out.push_back(pattern[i]);
+			continue;
+		}
+		/* Find the end of the set the same way fnmatch.translate() does */
+		size_t j = i+1;
+		if (j<n && pattern[j]=='!') ++j;
+		if (j<n && pattern[j]==']') ++j;
+		while (j<n && pattern[j]!=']') ++j;
+		if (j>=n) {
+			out+="\\[";
+			continue;
+		}
+		size_t k = i+1;
+		out.push_back('[');
+		if (pattern[k]=='!') {
+			out.push_back(pattern[k++]);
+		}
+		else if (pattern[k]=='^') {
+			out+="\\^";
+			++k;
+		}
+		for (; k<j; ++k) {
+			if (pattern[k]=='\\' || pattern[k]=='[') out.push_back('\\');
+			out.push_back(pattern[k]);
+		}
+		out.push_back(']');
+		i = j;
+	}
+	return out;
+}
+
+/* Returns for every given string whether it matches any of the patterns (an empty pattern list matches everything) */
+static std::vector<char> match_specs(const std::vector<const char*>& patterns, const std::vector<const char*>& strings, size_t jobs) {
+
+	if (patterns.empty()) {
+		return std::vector<char>(strings.size(),1);
+	}
+	std::vector<char> matched(strings.size(),0);
+	if (strings.empty()) {
+		return matched;
+	}
+	std::vector<std::string> fnmatch_patterns;
+	std::vector<const char*> fnmatch_patterns_cstr;
+	for (auto pattern : patterns) {
+		fnmatch_patterns.push_back(python_fnmatch_pattern(pattern));
+	}
+	for (auto& pattern : fnmatch_patterns) {
+		fnmatch_patterns_cstr.push_back(pattern.c_str());
+	}
+	struct command_patterns* cp = command_patterns_compile(fnmatch_patterns_cstr.data(),fnmatch_patterns_cstr.size());
+	size_t bsize = (patterns.size()-1)/8+1;
+	std::vector<unsigned char> bitmaps(strings.size()*bsize);
+	command_patterns_match_strings(cp,(const char**)strings.data(),strings.size(),bitmaps.data(),jobs);
+	command_patterns_destroy(cp);
+	for (size_t i=0; i<strings.size(); ++i) {
+		for (size_t k=0; k<bsize; ++k) {
+			if (bitmaps[i*bsize+k]) {
+				matched[i] = 1;
+				break;
+			}
+		}
+	}
+	return matched;
+}
+
+struct scan_linked {
+	unsigned long ptr;
+	int type;
+	std::string path;
+	bool written;
+};
+
+struct scan_result {
+	std::vector<scan_linked> linked;
+	std::vector<std::pair<unsigned long,int>> compilers;
+	std::vector<std::string> messages;
+};
+
+struct scan_context {
+	const struct nfsdb* nfsdb;
+	/* Per binary string handle: bit SPEC_LD/SPEC_AR set when matched, compiler spec index+1 (0 for none) */
+	std::vector<unsigned char> binary_specs;
+	std::vector<signed char> binary_compiler;
+	bool linked;
+	bool compilations;
+};
+
+static std::vector<std::string> effective_args(const struct nfsdb* nfsdb, const struct nfsdb_entry* entry,
+		std::vector<std::string>& messages) {
+
+	std::vector<std::string> args;
+	bool expand = false;
+	for (unsigned long u=0; u<entry->argv_count; ++u) {
+		args.push_back(nfsdb->string_table[entry->argv[u]]);
+		if (args.back()[0]=='@') expand = true;
+	}
+	if (!expand) return args;
+
+	std::string cwd = nfsdb->string_table[entry->cwd];
+	std::vector<std::string> ret;
+	for (auto& arg : args) {
+		if (arg[0]!='@') {
+			ret.push_back(arg);
+			continue;
+		}
+		std::string f = path_normpath(path_join(cwd,arg.substr(1)));
+		struct stat st;
+		if (!stat(f.c_str(),&st) && S_ISREG(st.st_mode)) {
+			std::ifstream in(f);
+			std::string word;
+			while (in>>word) ret.push_back(word);
+		}
+		else {
+			std::string joined;
+			for (auto& a : args) joined+=(joined.empty()?"":" ")+a;
+			messages.push_back("Parsing args failed! "+joined);
+			messages.push_back("Argfile does not exists "+f);
+		}
+	}
+	return ret;
+}
+
+static void scan_entry(const scan_context& ctx, const struct nfsdb_entry* entry, scan_result& result) {
+
+	const struct nfsdb* nfsdb = ctx.nfsdb;
+	unsigned char specs = ctx.binary_specs[entry->binary];
+
+	if (ctx.linked && (specs&(1<<SPEC_LD))) {
+		std::vector<std::string> args = effective_args(nfsdb,entry,result.messages);
+		std::string cwd = nfsdb->string_table[entry->cwd];
+		auto o = std::find(args.begin(),args.end(),"-o");
+		if (o!=args.end()) {
+			size_t outidx = o-args.begin();
+			if (outidx<args.size()-1) {
+				std::string lnkm = path_normpath(path_join(cwd,args[outidx+1]));
+				bool skip = (path_splitext_ext(lnkm)==".o") && (outidx<args.size()-2) &&
+						(path_basename(args[outidx+2])==".tmp_"+path_basename(lnkm));
+				if (!skip && !starts_with(lnkm,"/dev/")) {
+					result.linked.push_back({entry->nfsdb_index,1,lnkm,false});
+				}
+			}
+		}
+		else {
+			auto out = std::find(args.begin(),args.end(),"--output");
+			if (out!=args.end() && (size_t)(out-args.begin())<args.size()-1) {
+				result.linked.push_back({entry->nfsdb_index,1,path_normpath(path_join(cwd,*(out+1))),false});
+			}
+		}
+	}
+
+	if (ctx.linked && (specs&(1<<SPEC_AR))) {
+		std::vector<std::string> args = effective_args(nfsdb,entry,result.messages);
+		auto armod = std::find_if(args.begin(),args.end(),[](const std::string& x) {
+			return ends_with(x,".a") || ends_with(x,".a.tmp") || ends_with(x,".lib") || ends_with(x,"built-in.o");
+		});
+		if (armod!=args.end()) {
+			std::string path = *armod;
+			if (!path_isabs(path)) {
+				path = path_normpath(path_join(nfsdb->string_table[entry->cwd],path));
+			}
+			/* Archives not opened for write (e.g. ar t <archive_file>) are not linked files */
+			bool written = false;
+			for (unsigned long u=0; u<entry->open_files_count; ++u) {
+				const struct openfile* openfile = &entry->open_files[u];
+				if ((openfile->mode&0x03)>0 && path==nfsdb->string_table[openfile->path]) {
+					written = true;
+					break;
+				}
+			}
+			result.linked.push_back({entry->nfsdb_index,0,path,written});
+		}
+	}
+
+	if (ctx.compilations && entry->return_code==0) {
+		int compiler = ctx.binary_compiler[entry->binary];
+		if (compiler>0) {
+			result.compilers.push_back({entry->nfsdb_index,compiler-1});
+		}
+	}
+}
+
+/*
+ * nfsdb.post_process_scan(ld_spec, ar_spec, compiler_specs, linked=True, compilations=True, jobs=0)
+ *
+ * Returns a dictionary with the following keys:
+ *   "linked":    [(ptr, type, path, written)] for linker (type 1) and archiver (type 0) executions in entry order;
+ *                'path' is the output file and 'written' tells whether the archive was opened for write
+ *   "compilers": [(ptr, spec_index)] for successful executions of a binary matched by compiler_specs[spec_index]
+ *                (the first matching spec wins, paths of /cc and /c++ binaries are resolved first)
+ *   "written":   {pid: set(paths)} written by successful executions
+ *   "forks":     {pid: set(child pids)} of successful executions
+ */
+PyObject* libetrace_nfsdb_post_process_scan(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs) {
+
+	if (PyTuple_Size(args)<3) {
+		ASSERT_WITH_NFSDB_ERROR(0,"Invalid number of arguments");
+	}
+
+	size_t jobs = 0;
+	bool linked = true, compilations = true;
+	if (kwargs) {
+		PyObject* py_jobs = PyDict_GetItemString(kwargs,"jobs");
+		if (py_jobs && (PyLong_AsLong(py_jobs)>0)) {
+			jobs = PyLong_AsLong(py_jobs);
+		}
+		PyObject* py_linked = PyDict_GetItemString(kwargs,"linked");
+		if (py_linked) {
+			linked = PyObject_IsTrue(py_linked);
+		}
+		PyObject* py_compilations = PyDict_GetItemString(kwargs,"compilations");
+		if (py_compilations) {
+			compilations = PyObject_IsTrue(py_compilations);
+		}
+	}
+	if (!jobs) {
+		jobs = std::max(1U,std::thread::hardware_concurrency());
+	}
+
+	std::vector<std::vector<const char*>> specs;
+	for (Py_ssize_t i=0; i<3; ++i) {
+		PyObject* spec_list = PyTuple_GetItem(args,i);
+		if (!PyList_Check(spec_list)) {
+			ASSERT_WITH_NFSDB_ERROR(0,"Invalid argument type: expected (list,list,list)");
+		}
+		if (i<2) {
+			specs.emplace_back();
+			for (Py_ssize_t j=0; j<PyList_Size(spec_list); ++j) {
+				specs.back().push_back(PyString_get_c_str(PyList_GetItem(spec_list,j)));
+			}
+		}
+		else {
+			for (Py_ssize_t k=0; k<PyList_Size(spec_list); ++k) {
+				PyObject* compiler_spec = PyList_GetItem(spec_list,k);
+				if (!PyList_Check(compiler_spec)) {
+					ASSERT_WITH_NFSDB_ERROR(0,"Invalid compiler spec type: expected (list)");
+				}
+				specs.emplace_back();
+				for (Py_ssize_t j=0; j<PyList_Size(compiler_spec); ++j) {
+					specs.back().push_back(PyString_get_c_str(PyList_GetItem(compiler_spec,j)));
+				}
+			}
+		}
+	}
+
+	const struct nfsdb* nfsdb = self->nfsdb;
+	scan_context ctx;
+	ctx.nfsdb = nfsdb;
+	ctx.linked = linked;
+	ctx.compilations = compilations;
+	ctx.binary_specs.assign(nfsdb->string_count,0);
+	ctx.binary_compiler.assign(nfsdb->string_count,0);
+
+	std::vector<scan_result> results;
+	Py_BEGIN_ALLOW_THREADS
+
+	/* Every spec is matched once per distinct binary */
+	std::vector<char> seen(nfsdb->string_count,0);
+	std::vector<unsigned long> binaries;
+	for (unsigned long i=0; i<nfsdb->nfsdb_count; ++i) {
+		unsigned long binary = nfsdb->nfsdb_entry[i].binary;
+		if (!seen[binary]) {
+			seen[binary] = 1;
+			binaries.push_back(binary);
+		}
+	}
+	std::vector<const char*> binary_paths;
+	std::vector<std::string> resolved;
+	for (unsigned long binary : binaries) {
+		std::string b = nfsdb->string_table[binary];
+		binary_paths.push_back(nfsdb->string_table[binary]);
+		resolved.push_back((ends_with(b,"/cc") || ends_with(b,"/c++"))?path_realpath(b):b);
+	}
+	std::vector<const char*> resolved_paths;
+	for (auto& r : resolved) {
+		resolved_paths.push_back(r.c_str());
+	}
+	for (int s=SPEC_LD; s<SPEC_COUNT; ++s) {
+		std::vector<char> matched = match_specs(specs[s],binary_paths,jobs);
+		for (size_t u=0; u<binaries.size(); ++u) {
+			if (matched[u]) ctx.binary_specs[binaries[u]]|=1<<s;
+		}
+	}
+	for (size_t s=SPEC_COUNT; s<specs.size(); ++s) {
+		std::vector<char> matched = match_specs(specs[s],resolved_paths,jobs);
+		for (size_t u=0; u<binaries.size(); ++u) {
+			if (matched[u] && !ctx.binary_compiler[binaries[u]] && nfsdb->string_table[binaries[u]][0]) {
+				ctx.binary_compiler[binaries[u]] = s-SPEC_COUNT+1;
+			}
+		}
+	}
+
+	/* Contiguous ranges of entries keep the entry order of the results */
+	unsigned long count = nfsdb->nfsdb_count;
+	size_t parts = std::max((size_t)1,std::min(jobs,(size_t)(count/POST_PROCESS_SCAN_PER_THREAD)));
+	results.resize(parts);
+	std::vector<std::thread> threads;
+	auto part = [&](size_t n) {
+		for (unsigned long i=count*n/parts; i<count*(n+1)/parts; ++i) {
+			scan_entry(ctx,&nfsdb->nfsdb_entry[i],results[n]);
+		}
+	};
+	for (size_t n=1; n<parts; ++n) {
+		threads.emplace_back(part,n);
+	}
+	part(0);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	Py_END_ALLOW_THREADS
+
+	for (auto& spec : specs) {
+		for (const char* pattern : spec) {
+			PYASSTR_DECREF(pattern);
+		}
+	}
+
+	PyObject* linked_list = PyList_New(0);
+	PyObject* compilers_list = PyList_New(0);
+	for (auto& result : results) {
+		for (auto& message : result.messages) {
+			printf("%s\n",message.c_str());
+		}
+		for (auto& l : result.linked) {
+			PyObject* item = Py_BuildValue("(kisO)",l.ptr,l.type,l.path.c_str(),l.written?Py_True:Py_False);
+			PyList_Append(linked_list,item);
+			Py_DecRef(item);
+		}
+		for (auto& c : result.compilers) {
+			PyObject* item = Py_BuildValue("(ki)",c.first,c.second);
+			PyList_Append(compilers_list,item);
+			Py_DecRef(item);
+		}
+	}
+
+	/* Written paths and forked processes of successful executions (keyed by pid) */
+	PyObject* written = PyDict_New();
+	PyObject* forks = PyDict_New();
+	if (compilations) {
+		for (unsigned long i=0; i<nfsdb->nfsdb_count; ++i) {
+			const struct nfsdb_entry* entry = &nfsdb->nfsdb_entry[i];
+			if (entry->return_code!=0) continue;
+			PyObject* pid = PyLong_FromUnsignedLong(entry->eid.pid);
+			for (unsigned long u=0; u<entry->open_files_count; ++u) {
+				const struct openfile* openfile = &entry->open_files[u];
+				if ((openfile->mode&0x03)==0) continue;
+				PyObject* paths = PyDict_GetItem(written,pid);
+				if (!paths) {
+					paths = PySet_New(0);
+					PyDict_SetItem(written,pid,paths);
+					Py_DecRef(paths);
+				}
+				PyObject* path = PyUnicode_FromString(nfsdb->string_table[openfile->path]);
+				PySet_Add(paths,path);
+				Py_DecRef(path);
+			}
+			for (unsigned long u=0; u<entry->child_ids_count; ++u) {
+				if (!nfsdb_entryMap_search(&nfsdb->procmap,entry->child_ids[u].pid)) continue;
+				PyObject* childs = PyDict_GetItem(forks,pid);
+				if (!childs) {
+					childs = PySet_New(0);
+					PyDict_SetItem(forks,pid,childs);
+					Py_DecRef(childs);
+				}
+				PyObject* child = PyLong_FromUnsignedLong(entry->child_ids[u].pid);
+				PySet_Add(childs,child);
+				Py_DecRef(child);
+			}
+			Py_DecRef(pid);
+		}
+	}
+
+	PyObject* ret = PyDict_New();
+	PyDict_SetItemString(ret,"linked",linked_list);
+	PyDict_SetItemString(ret,"compilers",compilers_list);
+	PyDict_SetItemString(ret,"written",written);
+	PyDict_SetItemString(ret,"forks",forks);
+	Py_DecRef(linked_list);
+	Py_DecRef(compilers_list);
+	Py_DecRef(written);
+	Py_DecRef(forks);
+	return ret;
+}
@@ -345,12 +345,22 @@ err:
 	Py_RETURN_FALSE;
 }
 
-static int pattern_match_single(const char* p, const char* exclude_pattern) {
-
-	if (!fnmatch(exclude_pattern,p,0)) {
-		return 1;
+/* Number of commands matched against the compiled patterns at once (with the GIL released) */
+#define PRECOMPUTE_COMMAND_PATTERNS_CHUNK	65536
+
+static void precompute_command_patterns_chunk(const struct command_patterns* cp, PyObject* pcp_map, PyObject** keys,
+		const char** cmds, size_t count, unsigned char* b, size_t bsize, size_t jobs) {
+
+	Py_BEGIN_ALLOW_THREADS
+	command_patterns_match_strings(cp,cmds,count,b,jobs);
+	Py_END_ALLOW_THREADS
+	for (size_t i=0; i<count; ++i) {
+		PyObject* bytes = PyBytes_FromStringAndSize((const char*)&b[i*bsize],bsize);
+		PyDict_SetItem(pcp_map, keys[i], bytes);
+		Py_DecRef(keys[i]);
+		Py_DecRef(bytes);
+		PYASSTR_DECREF(cmds[i]);
 	}
-	return 0;
 }
 
 PyObject * libetrace_precompute_command_patterns(PyObject *self, PyObject *args, PyObject* kwargs) {
@@ -367,6 +377,14 @@ PyObject * libetrace_precompute_command_patterns(PyObject *self, PyObject *args,
 
 	Py_DecRef(py_debug);
 
+	size_t jobs = 0;
+	if (kwargs) {
+		PyObject* py_jobs = PyDict_GetItemString(kwargs,"jobs");
+		if (py_jobs && (PyLong_AsLong(py_jobs)>0)) {
+			jobs = PyLong_AsLong(py_jobs);
+		}
+	}
+
 	DBG(debug,"--- libetrace_precompute_command_patterns()\n");
 
     struct sigaction act;
@@ -410,6 +428,14 @@ PyObject * libetrace_precompute_command_patterns(PyObject *self, PyObject *args,
 
     DBG(1,"Precomputing exclude command patterns...");
 
+    struct command_patterns* cp = command_patterns_compile(excl_commands,excl_commands_size);
+    size_t bsize = (excl_commands_size-1)/8+1;
+    unsigned char* b = malloc(PRECOMPUTE_COMMAND_PATTERNS_CHUNK*bsize);
+    PyObject** chunk_keys = malloc(PRECOMPUTE_COMMAND_PATTERNS_CHUNK*sizeof(PyObject*));
+    const char** chunk_cmds = malloc(PRECOMPUTE_COMMAND_PATTERNS_CHUNK*sizeof(const char*));
+    assert(b!=0 && chunk_keys!=0 && chunk_cmds!=0 && "Out of memory for allocating precompute pattern map");
+    size_t chunk_size = 0;
+
     unsigned long cmdi = 0;
     PyObject* keys = PyDict_Keys(pm);
     PyObject* vkey = PyUnicode_FromString("v");
@@ -421,40 +447,27 @@ PyObject * libetrace_precompute_command_patterns(PyObject *self, PyObject *args,
 			PyObject* e = PyList_GetItem(eL,v);
 			PyObject* cmdv = PyDict_GetItem(e,vkey);
 			PyObject* cmds = PyUnicode_Join(py_space,cmdv);
-			const char* cmdstr = PyString_get_c_str(cmds);
-			cmdi++;
-			if (isatty(fileno(stdin))){
-				if ((cmdi%1000)==0) {
-					DBG(1,"\rPrecomputing exclude command patterns...%lu%%",(cmdi*100)/cmd_count);
-				}
-			}
-			size_t bsize = (excl_commands_size-1)/8+1;
-			unsigned char* b = calloc(bsize,1);
-			assert(b!=0 && "Out of memory for allocating precompute pattern map");
-			size_t k;
-			for (k=0; k<excl_commands_size; ++k) {
-				unsigned byte_index = k/8;
-				unsigned bit_index = k%8;
-				if (pattern_match_single(cmdstr,excl_commands[k])) {
-					b[byte_index]|=0x01<<(7-bit_index);
-				}
-			}
-			PYASSTR_DECREF(cmdstr);
+			chunk_cmds[chunk_size] = PyString_get_c_str(cmds);
 			Py_DecRef(cmds);
 			PyObject* pidext = PyTuple_New(2);
 			PyTuple_SetItem(pidext, 0,Py_BuildValue("l",pid));
 			PyTuple_SetItem(pidext, 1,Py_BuildValue("l",v));
-			PyObject* bytes = PyBytes_FromStringAndSize((const char*)b,bsize);
-			PyDict_SetItem(pcp_map, pidext, bytes);
-			Py_DecRef(pidext);
-			Py_DecRef(bytes);
-			free(b);
+			chunk_keys[chunk_size++] = pidext;
+			cmdi++;
+			if (chunk_size==PRECOMPUTE_COMMAND_PATTERNS_CHUNK) {
+				precompute_command_patterns_chunk(cp,pcp_map,chunk_keys,chunk_cmds,chunk_size,b,bsize,jobs);
+				chunk_size = 0;
+				if (isatty(fileno(stdin))){
+					DBG(1,"\rPrecomputing exclude command patterns...%lu%%",(cmdi*100)/cmd_count);
+				}
+			}
 		}
 		Py_DecRef(py_space);
 		if (interrupt) {
 			goto interrupted;
 		}
 	}
+    precompute_command_patterns_chunk(cp,pcp_map,chunk_keys,chunk_cmds,chunk_size,b,bsize,jobs);
     DBG(1,"\n");
 	Py_DecRef(keys);
     Py_DecRef(vkey);
@@ -462,14 +475,26 @@ PyObject * libetrace_precompute_command_patterns(PyObject *self, PyObject *args,
     	PYASSTR_DECREF(excl_commands[u]);
     }
 	free(excl_commands);
+	command_patterns_destroy(cp);
+	free(b);
+	free(chunk_keys);
+	free(chunk_cmds);
 	return pcp_map;
 interrupted:
+	for (size_t i=0; i<chunk_size; ++i) {
+		Py_DecRef(chunk_keys[i]);
+		PYASSTR_DECREF(chunk_cmds[i]);
+	}
 	Py_DecRef(keys);
     Py_DecRef(vkey);
     for (size_t u=0; u<excl_commands_size; ++u) {
     	PYASSTR_DECREF(excl_commands[u]);
     }
 	free(excl_commands);
+	command_patterns_destroy(cp);
+	free(b);
+	free(chunk_keys);
+	free(chunk_cmds);
 	Py_DecRef(pcp_map);
 	Py_RETURN_NONE;
 }
@@ -533,142 +558,7 @@ const char* joinpath(const char* cwd, const char* path) {
 	}
 }
 
-FUNCTION_DEFINE_FLATTEN_STRUCT(eid);
-FUNCTION_DEFINE_FLATTEN_STRUCT(cid);
-FUNCTION_DEFINE_FLATTEN_STRUCT(pp_def);
-FUNCTION_DEFINE_FLATTEN_STRUCT(cputime);
-FUNCTION_DEFINE_FLATTEN_STRUCT(nfsdb_entry_file_index);
-
-FUNCTION_DECLARE_FLATTEN_STRUCT(nfsdb_entry);
-
-FUNCTION_DEFINE_FLATTEN_STRUCT(openfile,
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,original_path,1);
-	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entry,opaque_entry,1);
-);
-
-FUNCTION_DEFINE_FLATTEN_STRUCT(compilation_info,
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,compiled_list,ATTR(compiled_count));
-	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entry_file_index,compiled_index,ATTR(compiled_count));
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,include_paths,ATTR(include_paths_count));
-	AGGREGATE_FLATTEN_STRUCT_ARRAY(pp_def,pp_defs,ATTR(pp_defs_count));
-	AGGREGATE_FLATTEN_STRUCT_ARRAY(pp_def,pp_udefs,ATTR(pp_udefs_count));
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,header_list,ATTR(header_list_count));
-	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entry_file_index,header_index,ATTR(header_list_count));
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,object_list,ATTR(object_list_count));
-	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entry_file_index,object_index,ATTR(object_list_count));
-);
-
-FUNCTION_DEFINE_FLATTEN_STRUCT(nfsdb_entry,
-	AGGREGATE_FLATTEN_STRUCT_ARRAY(cid,child_ids,ATTR(child_ids_count));
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,argv,ATTR(argv_count));
-	AGGREGATE_FLATTEN_STRUCT_ARRAY(openfile,open_files,ATTR(open_files_count));
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned char,pcp,ATTR(pcp_count));
-	AGGREGATE_FLATTEN_STRUCT_ARRAY(eid,pipe_eids,ATTR(pipe_eids_count));
-	AGGREGATE_FLATTEN_STRUCT(compilation_info,compilation_info);
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,linked_file,1);
-	AGGREGATE_FLATTEN_STRUCT_ARRAY(cputime,cpu,ATTR(cpu_count));
-);
-
-FUNCTION_DECLARE_FLATTEN_STRUCT(nfsdb_entryMap_node);
-
-FUNCTION_DEFINE_FLATTEN_STRUCT(nfsdb_entryMap_node,
-	STRUCT_ALIGN(4);
-	AGGREGATE_FLATTEN_STRUCT_EMBEDDED_POINTER(nfsdb_entryMap_node,node.__rb_parent_color,
-			ptr_clear_2lsb_bits,flatten_ptr_restore_2lsb_bits);
-	AGGREGATE_FLATTEN_STRUCT(nfsdb_entryMap_node,node.rb_right);
-	AGGREGATE_FLATTEN_STRUCT(nfsdb_entryMap_node,node.rb_left);
-	AGGREGATE_FLATTEN_TYPE_ARRAY(struct nfsdb_entry*,entry_list,ATTR(entry_count));
-	FOREACH_POINTER(struct nfsdb_entry*,entry,ATTR(entry_list),ATTR(entry_count),
-		FLATTEN_STRUCT(nfsdb_entry,entry);
-	);
-);
-
-FUNCTION_DECLARE_FLATTEN_STRUCT(ulongMap_node);
-
-
-FUNCTION_DEFINE_FLATTEN_STRUCT(ulongMap_node,
-	STRUCT_ALIGN(4);
-	AGGREGATE_FLATTEN_STRUCT_EMBEDDED_POINTER(ulongMap_node,node.__rb_parent_color,
-			ptr_clear_2lsb_bits,flatten_ptr_restore_2lsb_bits);
-	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,node.rb_right);
-	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,node.rb_left);
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,value_list,ATTR(value_count));
-);
-
-FUNCTION_DECLARE_FLATTEN_STRUCT(stringRefMap_node);
-
-FUNCTION_DEFINE_FLATTEN_STRUCT(stringRefMap_node,
-	STRUCT_ALIGN(4);
-	AGGREGATE_FLATTEN_STRUCT_EMBEDDED_POINTER(stringRefMap_node,node.__rb_parent_color,
-			ptr_clear_2lsb_bits,flatten_ptr_restore_2lsb_bits);
-	AGGREGATE_FLATTEN_STRUCT(stringRefMap_node,node.rb_right);
-	AGGREGATE_FLATTEN_STRUCT(stringRefMap_node,node.rb_left);
-	AGGREGATE_FLATTEN_STRING(key);
-);
-
-FUNCTION_DECLARE_FLATTEN_STRUCT(nfsdb_fileMap_node);
-
-
-FUNCTION_DEFINE_FLATTEN_STRUCT(nfsdb_fileMap_node,
-	STRUCT_ALIGN(4);
-	AGGREGATE_FLATTEN_STRUCT_EMBEDDED_POINTER(nfsdb_fileMap_node,node.__rb_parent_color,
-			ptr_clear_2lsb_bits,flatten_ptr_restore_2lsb_bits);
-	AGGREGATE_FLATTEN_STRUCT(nfsdb_fileMap_node,node.rb_right);
-	AGGREGATE_FLATTEN_STRUCT(nfsdb_fileMap_node,node.rb_left);
-	AGGREGATE_FLATTEN_TYPE_ARRAY(struct nfsdb_entry*,rd_entry_list,ATTR(rd_entry_count));
-	FOREACH_POINTER(struct nfsdb_entry*,entry,ATTR(rd_entry_list),ATTR(rd_entry_count),
-		FLATTEN_STRUCT(nfsdb_entry,entry);
-	);
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,rd_entry_index,ATTR(rd_entry_count));
-	AGGREGATE_FLATTEN_TYPE_ARRAY(struct nfsdb_entry*,wr_entry_list,ATTR(wr_entry_count));
-	FOREACH_POINTER(struct nfsdb_entry*,entry,ATTR(wr_entry_list),ATTR(wr_entry_count),
-		FLATTEN_STRUCT(nfsdb_entry,entry);
-	);
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,wr_entry_index,ATTR(wr_entry_count));
-	AGGREGATE_FLATTEN_TYPE_ARRAY(struct nfsdb_entry*,rw_entry_list,ATTR(rw_entry_count));
-	FOREACH_POINTER(struct nfsdb_entry*,entry,ATTR(rw_entry_list),ATTR(rw_entry_count),
-		FLATTEN_STRUCT(nfsdb_entry,entry);
-	);
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,rw_entry_index,ATTR(rw_entry_count));
-	AGGREGATE_FLATTEN_TYPE_ARRAY(struct nfsdb_entry*,ga_entry_list,ATTR(ga_entry_count));
-	FOREACH_POINTER(struct nfsdb_entry*,entry,ATTR(ga_entry_list),ATTR(ga_entry_count),
-		FLATTEN_STRUCT(nfsdb_entry,entry);
-	);
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,ga_entry_index,ATTR(ga_entry_count));
-);
-
-FUNCTION_DEFINE_FLATTEN_STRUCT(nfsdb,
-	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entry,nfsdb_entry,ATTR(nfsdb_count));
-	AGGREGATE_FLATTEN_STRING(source_root);
-	AGGREGATE_FLATTEN_STRING(dbversion);
-	AGGREGATE_FLATTEN_TYPE_ARRAY(const char*,string_table,ATTR(string_count));
-	FOREACH_POINTER(const char*,s,ATTR(string_table),ATTR(string_count),
-		FLATTEN_STRING(s);
-	);
-	AGGREGATE_FLATTEN_TYPE_ARRAY(uint32_t,string_size_table,ATTR(string_count));
-	AGGREGATE_FLATTEN_TYPE_ARRAY(const char*,pcp_pattern_list,ATTR(pcp_pattern_list_size));
-	FOREACH_POINTER(const char*,s,ATTR(pcp_pattern_list),ATTR(pcp_pattern_list_size),
-		FLATTEN_STRING(s);
-	);
-	AGGREGATE_FLATTEN_STRUCT(nfsdb_entryMap_node,procmap.rb_node);
-	AGGREGATE_FLATTEN_STRUCT(nfsdb_entryMap_node,bmap.rb_node);
-	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,forkmap.rb_node);
-	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,revforkmap.rb_node);
-	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,pipemap.rb_node);
-	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,wrmap.rb_node);
-	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,rdmap.rb_node);
-	AGGREGATE_FLATTEN_STRUCT(stringRefMap_node,revstringmap.rb_node);
-	AGGREGATE_FLATTEN_STRUCT(nfsdb_fileMap_node,filemap.rb_node);
-	AGGREGATE_FLATTEN_STRUCT(nfsdb_entryMap_node,linkedmap.rb_node);
-	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,threads,ATTR(threads_count));
-);
-
-FUNCTION_DEFINE_FLATTEN_STRUCT(nfsdb_deps,
-	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,depmap.rb_node);
-	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,ddepmap.rb_node);
-	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,revdepmap.rb_node);
-	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,revddepmap.rb_node);
-);
+#include "recipe.h"
 
 unsigned long string_table_add(struct nfsdb* nfsdb, PyObject* s, PyObject* stringMap) {
 
@@ -902,6 +792,99 @@ void libetrace_nfsdb_entry_precompute_compilation_info_objects(struct nfsdb* nfs
 	}
 }
 
+/* Creates the auxiliary maps and precomputed file locations for the filled nfsdb entries */
+void nfsdb_image_prepare(struct nfsdb* nfsdb, int show_stats, size_t jobs) {
+
+	/* Create auxiliary maps used by the Python API */
+	int ok = nfsdb_maps(nfsdb,show_stats,jobs);
+	(void)ok;
+
+	/* Precompute the values of openfile entry locations for some specific files
+	 *  like linked file, compiled file etc.
+	 */
+	for (unsigned long u=0; u<nfsdb->nfsdb_count; ++u) {
+		struct nfsdb_entry* entry = &nfsdb->nfsdb_entry[u];
+		if (entry->linked_file) {
+			libetrace_nfsdb_entry_precompute_linked_file(nfsdb,entry);
+		}
+		if (entry->compilation_info) {
+			libetrace_nfsdb_entry_precompute_compilation_info_files(nfsdb,entry);
+			libetrace_nfsdb_entry_precompute_compilation_info_headers(nfsdb,entry);
+			libetrace_nfsdb_entry_precompute_compilation_info_objects(nfsdb,entry);
+		}
+	}
+
+	/* If there is an opaque entry in the global access list place it at the beginning of the list */
+	struct nfsdb_fileMap_node* p = fileMap_first(&nfsdb->filemap);
+	while(p) {
+		struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)p;
+		unsigned long vu;
+		for (vu=0; vu<data->ga_entry_count; ++vu) {
+			struct openfile* openfile = &data->ga_entry_list[vu]->open_files[data->ga_entry_index[vu]];
+			if (openfile->opaque_entry) {
+				break;
+			}
+		}
+		if (vu<data->ga_entry_count) {
+			struct nfsdb_entry* first_entry = data->ga_entry_list[0];
+			unsigned long first_index = data->ga_entry_index[0];
+			data->ga_entry_list[0] = data->ga_entry_list[vu];
+			data->ga_entry_index[0] = data->ga_entry_index[vu];
+			data->ga_entry_list[vu] = first_entry;
+			data->ga_entry_index[vu] = first_index;
+		}
+		p = fileMap_next(&nfsdb->filemap,p);
+	}
+}
+
+/* Flattens the database into the image file, returns 0 on success */
+int nfsdb_image_write(struct nfsdb* nfsdb, const char* dbfn, int verbose_mode, int debug_mode) {
+
+	struct uflat* uflat = uflat_init(dbfn);
+	if(uflat == NULL) {
+		printf("uflat_init(): failed\n");
+		goto uflat_error_exit;
+	}
+
+	int rv = uflat_set_option(uflat, UFLAT_OPT_OUTPUT_SIZE, 50ULL * 1024 * 1024 * 1024);
+	if(rv) {
+		printf("uflat_set_option(OUTPUT_SIZE): %d\n", rv);
+		goto uflat_error_exit;
+	}
+
+	rv = uflat_set_option(uflat, UFLAT_OPT_SKIP_MEM_FRAGMENTS, 1);
+	if(rv) {
+		printf("uflat_set_option(SKIP_MEM_FRAGMENTS)\n");
+		goto uflat_error_exit;
+	}
+
+	uflat_set_option(uflat, UFLAT_OPT_SKIP_MEM_COPY, 1);
+
+	if(verbose_mode)
+		uflat_set_option(uflat, UFLAT_OPT_VERBOSE, 1);
+	if(debug_mode)
+		uflat_set_option(uflat, UFLAT_OPT_DEBUG, 1);
+
+	FOR_ROOT_POINTER(nfsdb,
+		FLATTEN_STRUCT(nfsdb, nfsdb);
+	);
+
+	int err = uflat_write(uflat);
+	if (err != 0) {
+		printf("flatten_write(): %d\n", err);
+		goto uflat_error_exit;
+	}
+
+	uflat_fini(uflat);
+
+	return 0;
+
+uflat_error_exit:
+	if(uflat != NULL)
+		uflat_fini(uflat);
+	return -1;
+}
+
 PyObject * libetrace_create_nfsdb(PyObject *self, PyObject *args, PyObject* kwargs) {
 
 	PyObject* stringMap = PyDict_New();
@@ -930,6 +913,14 @@ PyObject * libetrace_create_nfsdb(PyObject *self, PyObject *args, PyObject* kwar
 	Py_DecRef(py_debug);
 	Py_DecRef(py_quiet);
 
+	size_t jobs = 0;
+	if (kwargs) {
+		PyObject* py_jobs = PyDict_GetItemString(kwargs,"jobs");
+		if (py_jobs && (PyLong_AsLong(py_jobs)>0)) {
+			jobs = PyLong_AsLong(py_jobs);
+		}
+	}
+
 	PyObject* osModuleString = PyUnicode_FromString((char*)"os.path");
 	PyObject* osModule = PyImport_Import(osModuleString);
 	PyObject* pathJoinFunction = PyObject_GetAttrString(osModule,(char*)"join");
@@ -1177,54 +1168,65 @@ PyObject * libetrace_create_nfsdb(PyObject *self, PyObject *args, PyObject* kwar
 	}
 	Py_DecRef(threads);
 
-	/* Create auxiliary maps used by the Python API */
-	int ok = nfsdb_maps(&nfsdb,show_stats);
-	(void)ok;
+	nfsdb_image_prepare(&nfsdb,show_stats,jobs);
 
-	/* Precompute the values of openfile entry locations for some specific files
-	 *  like linked file, compiled file etc.
-	 */
-	for (unsigned long u=0; u<nfsdb.nfsdb_count; ++u) {
-		struct nfsdb_entry* entry = &nfsdb.nfsdb_entry[u];
-		if (entry->linked_file) {
-			libetrace_nfsdb_entry_precompute_linked_file(&nfsdb,entry);
-		}
-		if (entry->compilation_info) {
-			libetrace_nfsdb_entry_precompute_compilation_info_files(&nfsdb,entry);
-			libetrace_nfsdb_entry_precompute_compilation_info_headers(&nfsdb,entry);
-			libetrace_nfsdb_entry_precompute_compilation_info_objects(&nfsdb,entry);
-		}
+flatten_start: ;
+	const char* dbfn_s =  PyString_get_c_str(dbfn);
+	int err = nfsdb_image_write(&nfsdb,dbfn_s,verbose_mode,debug_mode);
+	PYASSTR_DECREF(dbfn_s);
+
+	destroy_nfsdb(&nfsdb);
+
+	Py_DECREF(pathJoinFunction);
+	Py_DECREF(osModule);
+	Py_DECREF(osModuleString);
+
+	if (err) {
+		Py_RETURN_FALSE;
 	}
+	Py_RETURN_TRUE;
+}
 
-	/* If there is an opaque entry in the global access list place it at the beginning of the list */
-	struct rb_node * p = rb_first(&nfsdb.filemap);
-	while(p) {
-		struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)p;
-		unsigned long vu;
-		for (vu=0; vu<data->ga_entry_count; ++vu) {
-			struct openfile* openfile = &data->ga_entry_list[vu]->open_files[data->ga_entry_index[vu]];
-			if (openfile->opaque_entry) {
-				break;
+void destroy_nfsdb_deps(struct nfsdb_deps* nfsdb_deps) {
+
+	// TODO
+}
+
+/* Inserts the dependency list of the module 'mhandle' into the 'map' and updates the 'revmap' accordingly
+ * The 'values' array holds 'count' pairs of (nfsdb_index,open_index) and it's owned by the map afterwards */
+void nfsdb_deps_insert_module(const struct nfsdb* nfsdb, struct rb_root* map, struct rb_root* revmap,
+		unsigned long mhandle, unsigned long* values, unsigned long count) {
+
+	ulongMap_insert(map, mhandle, values, 2*count, 2*count);
+
+	for (unsigned long j=0; j<count; ++j) {
+		unsigned long nfsdb_index = values[2*j+0];
+		unsigned long open_index = values[2*j+1];
+		struct openfile* openfile = &nfsdb->nfsdb_entry[nfsdb_index].open_files[open_index];
+		struct ulongMap_node* node = ulongMap_search(revmap, openfile->path);
+		if (node) {
+			node->value_list[node->value_count++] = mhandle;
+			if (node->value_count>=node->value_alloc) {
+				/* We've reached the capacity, expand the array */
+				node->value_list = realloc(node->value_list,((node->value_alloc*3)/2)*sizeof(unsigned long));
+				node->value_alloc = (node->value_alloc*3)/2;
 			}
 		}
-		if (vu<data->ga_entry_count) {
-			struct nfsdb_entry* first_entry = data->ga_entry_list[0];
-			unsigned long first_index = data->ga_entry_index[0];
-			data->ga_entry_list[0] = data->ga_entry_list[vu];
-			data->ga_entry_index[0] = data->ga_entry_index[vu];
-			data->ga_entry_list[vu] = first_entry;
-			data->ga_entry_index[vu] = first_index;
+		else {
+			unsigned long* rvalues = malloc(16*sizeof(unsigned long));
+			rvalues[0] = mhandle;
+			ulongMap_insert(revmap, openfile->path, rvalues, 1, 16);
 		}
-		p = rb_next(p);
 	}
+}
 
-flatten_start: ;
-	const char* dbfn_s =  PyString_get_c_str(dbfn);
-	struct uflat* uflat = uflat_init(dbfn_s);
-	PYASSTR_DECREF(dbfn_s);
-	if(uflat == NULL) {
-		printf("uflat_init(): failed\n");
-		goto uflat_error_exit;
+/* Flattens the dependency maps into the deps image file, returns 0 on success */
+int nfsdb_deps_image_write(struct nfsdb_deps* nfsdb_deps, const char* dbfn, int verbose_mode, int debug_mode) {
+
+	struct uflat* uflat = uflat_init(dbfn);
+	if(UFLAT_IS_ERR(uflat)) {
+		printf("uflat_init(): %s\n", strerror(UFLAT_PTR_ERR(uflat)));
+		return -1;
 	}
 
 	int rv = uflat_set_option(uflat, UFLAT_OPT_OUTPUT_SIZE, 50ULL * 1024 * 1024 * 1024);
@@ -1246,40 +1248,35 @@ flatten_start: ;
 	if(debug_mode)
 		uflat_set_option(uflat, UFLAT_OPT_DEBUG, 1);
 
-	FOR_ROOT_POINTER(&nfsdb,
-		FLATTEN_STRUCT(nfsdb, &nfsdb);
+	FOR_ROOT_POINTER(nfsdb_deps,
+		FLATTEN_STRUCT(nfsdb_deps,nfsdb_deps);
 	);
 
 	int err = uflat_write(uflat);
 	if (err != 0) {
-		printf("flatten_write(): %d\n", err);
+		printf("flatten_write(): %s\n", strerror(err));
 		goto uflat_error_exit;
 	}
 
 	uflat_fini(uflat);
 
-	destroy_nfsdb(&nfsdb);
-
-	Py_DECREF(pathJoinFunction);
-	Py_DECREF(osModule);
-	Py_DECREF(osModuleString);
-
-	Py_RETURN_TRUE;
+	return 0;
 
 uflat_error_exit:
 	if(uflat != NULL)
 		uflat_fini(uflat);
-	destroy_nfsdb(&nfsdb);
-
-	Py_DECREF(pathJoinFunction);
-	Py_DECREF(osModule);
-	Py_DECREF(osModuleString);
-	Py_RETURN_FALSE;
+	return -1;
 }
 
-static void destroy_nfsdb_deps(struct nfsdb_deps* nfsdb_deps) {
+static unsigned long* deps_cache_values(PyObject* deps) {
 
-	// TODO
+	unsigned long* values = malloc(PyList_Size(deps)*2*sizeof(unsigned long));
+	for (Py_ssize_t j=0; j<PyList_Size(deps); ++j) {
+		PyObject* dtuple = PyList_GetItem(deps,j);
+		values[2*j+0] = PyLong_AsUnsignedLong(PyTuple_GetItem(dtuple,0));
+		values[2*j+1] = PyLong_AsUnsignedLong(PyTuple_GetItem(dtuple,1));
+	}
+	return values;
 }
 
 PyObject* libetrace_nfsdb_create_deps_cache(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs) {
@@ -1327,41 +1324,9 @@ PyObject* libetrace_nfsdb_create_deps_cache(libetrace_nfsdb_object *self, PyObje
 		assert(PyDict_Contains(stringTable, mpath));
 		PyObject* mpath_handle = PyDict_GetItem(stringTable, mpath);
 		PyObject* deps = PyDict_GetItem(depmap,mpath);
-		unsigned long* values = malloc(PyList_Size(deps)*2*sizeof(unsigned long));
 		depmap_vals+=PyList_Size(deps);
-		for (Py_ssize_t j=0; j<PyList_Size(deps); ++j) {
-			PyObject* dtuple = PyList_GetItem(deps,j);
-			values[2*j+0] = PyLong_AsUnsignedLong(PyTuple_GetItem(dtuple,0));
-			values[2*j+1] = PyLong_AsUnsignedLong(PyTuple_GetItem(dtuple,1));
-		}
-		ulongMap_insert(&nfsdb_deps.depmap, PyLong_AsUnsignedLong(mpath_handle), values, 2*PyList_Size(deps), 2*PyList_Size(deps));
-	}
-
-	for (Py_ssize_t i=0; i<PyList_Size(depmap_keys); ++i) {
-		PyObject* mpath = PyList_GetItem(depmap_keys,i);
-		assert(PyDict_Contains(stringTable, mpath));
-		PyObject* mpath_handle = PyDict_GetItem(stringTable, mpath);
-		PyObject* deps = PyDict_GetItem(depmap,mpath);
-		for (Py_ssize_t j=0; j<PyList_Size(deps); ++j) {
-			PyObject* dtuple = PyList_GetItem(deps,j);
-			unsigned long nfsdb_index = PyLong_AsUnsignedLong(PyTuple_GetItem(dtuple,0));
-			unsigned long open_index = PyLong_AsUnsignedLong(PyTuple_GetItem(dtuple,1));
-			struct openfile* openfile = &self->nfsdb->nfsdb_entry[nfsdb_index].open_files[open_index];
-			struct ulongMap_node* node = ulongMap_search(&nfsdb_deps.revdepmap, openfile->path);
-			if (node) {
-				node->value_list[node->value_count++] = PyLong_AsUnsignedLong(mpath_handle);
-				if (node->value_count>=node->value_alloc) {
-					/* We've reached the capacity, expand the array */
-					node->value_list = realloc(node->value_list,((node->value_alloc*3)/2)*sizeof(unsigned long));
-					node->value_alloc = (node->value_alloc*3)/2;
-				}
-			}
-			else {
-				unsigned long* values = malloc(16*sizeof(unsigned long));
-				values[0] = PyLong_AsUnsignedLong(mpath_handle);
-				ulongMap_insert(&nfsdb_deps.revdepmap, openfile->path, values, 1, 16);
-			}
-		}
+		nfsdb_deps_insert_module(self->nfsdb, &nfsdb_deps.depmap, &nfsdb_deps.revdepmap,
+				PyLong_AsUnsignedLong(mpath_handle), deps_cache_values(deps), PyList_Size(deps));
 	}
 
 	if (show_stats) {
@@ -1379,41 +1344,9 @@ PyObject* libetrace_nfsdb_create_deps_cache(libetrace_nfsdb_object *self, PyObje
 		assert(PyDict_Contains(stringTable, mpath));
 		PyObject* mpath_handle = PyDict_GetItem(stringTable, mpath);
 		PyObject* ddeps = PyDict_GetItem(ddepmap,mpath);
-		unsigned long* values = malloc(PyList_Size(ddeps)*2*sizeof(unsigned long));
 		ddepmap_vals+=PyList_Size(ddeps);
-		for (Py_ssize_t j=0; j<PyList_Size(ddeps); ++j) {
-			PyObject* ddtuple = PyList_GetItem(ddeps,j);
-			values[2*j+0] = PyLong_AsUnsignedLong(PyTuple_GetItem(ddtuple,0));
-			values[2*j+1] = PyLong_AsUnsignedLong(PyTuple_GetItem(ddtuple,1));
-		}
-		ulongMap_insert(&nfsdb_deps.ddepmap, PyLong_AsUnsignedLong(mpath_handle), values, 2*PyList_Size(ddeps), 2*PyList_Size(ddeps));
-	}
-
-	for (Py_ssize_t i=0; i<PyList_Size(ddepmap_keys); ++i) {
-		PyObject* mpath = PyList_GetItem(ddepmap_keys,i);
-		assert(PyDict_Contains(stringTable, mpath));
-		PyObject* mpath_handle = PyDict_GetItem(stringTable, mpath);
-		PyObject* ddeps = PyDict_GetItem(ddepmap,mpath);
-		for (Py_ssize_t j=0; j<PyList_Size(ddeps); ++j) {
-			PyObject* dtuple = PyList_GetItem(ddeps,j);
-			unsigned long nfsdb_index = PyLong_AsUnsignedLong(PyTuple_GetItem(dtuple,0));
-			unsigned long open_index = PyLong_AsUnsignedLong(PyTuple_GetItem(dtuple,1));
-			struct openfile* openfile = &self->nfsdb->nfsdb_entry[nfsdb_index].open_files[open_index];
-			struct ulongMap_node* node = ulongMap_search(&nfsdb_deps.revddepmap, openfile->path);
-			if (node) {
-				node->value_list[node->value_count++] = PyLong_AsUnsignedLong(mpath_handle);
-				if (node->value_count>=node->value_alloc) {
-					/* We've reached the capacity, expand the array */
-					node->value_list = realloc(node->value_list,((node->value_alloc*3)/2)*sizeof(unsigned long));
-					node->value_alloc = (node->value_alloc*3)/2;
-				}
-			}
-			else {
-				unsigned long* values = malloc(16*sizeof(unsigned long));
-				values[0] = PyLong_AsUnsignedLong(mpath_handle);
-				ulongMap_insert(&nfsdb_deps.revddepmap, openfile->path, values, 1, 16);
-			}
-		}
+		nfsdb_deps_insert_module(self->nfsdb, &nfsdb_deps.ddepmap, &nfsdb_deps.revddepmap,
+				PyLong_AsUnsignedLong(mpath_handle), deps_cache_values(ddeps), PyList_Size(ddeps));
 	}
 
 	if (show_stats) {
@@ -1425,54 +1358,16 @@ PyObject* libetrace_nfsdb_create_deps_cache(libetrace_nfsdb_object *self, PyObje
 	Py_DecRef(ddepmap_keys);
 
 	const char* dbfn_s =  PyString_get_c_str(dbfn);
-	struct uflat* uflat = uflat_init(dbfn_s);
+	int err = nfsdb_deps_image_write(&nfsdb_deps,dbfn_s,verbose_mode,debug_mode);
 	PYASSTR_DECREF(dbfn_s);
-	if(UFLAT_IS_ERR(uflat)) {
-		printf("uflat_init(): %s\n", strerror(UFLAT_PTR_ERR(uflat)));
-		Py_RETURN_FALSE;
-	}
-
-	int rv = uflat_set_option(uflat, UFLAT_OPT_OUTPUT_SIZE, 50ULL * 1024 * 1024 * 1024);
-	if(rv) {
-		printf("uflat_set_option(OUTPUT_SIZE): %d\n", rv);
-		goto uflat_error_exit;
-	}
-
-	rv = uflat_set_option(uflat, UFLAT_OPT_SKIP_MEM_FRAGMENTS, 1);
-	if(rv) {
-		printf("uflat_set_option(SKIP_MEM_FRAGMENTS)\n");
-		goto uflat_error_exit;
-	}
-
-	uflat_set_option(uflat, UFLAT_OPT_SKIP_MEM_COPY, 1);
-
-	if(verbose_mode)
-		uflat_set_option(uflat, UFLAT_OPT_VERBOSE, 1);
-	if(debug_mode)
-		uflat_set_option(uflat, UFLAT_OPT_DEBUG, 1);
-
-	FOR_ROOT_POINTER(&nfsdb_deps,
-		FLATTEN_STRUCT(nfsdb_deps,&nfsdb_deps);
-	);
 
-	int err = uflat_write(uflat);
-	if (err != 0) {
-		printf("flatten_write(): %s\n", strerror(err));
-		goto uflat_error_exit;
-	}
-
-	uflat_fini(uflat);
 	destroy_nfsdb_deps(&nfsdb_deps);
-
 	Py_DecRef(stringTable);
-	Py_RETURN_TRUE;
 
-uflat_error_exit:
-	if(uflat != NULL)
-		uflat_fini(uflat);
-	destroy_nfsdb_deps(&nfsdb_deps);
-	Py_DecRef(stringTable);
-	Py_RETURN_FALSE;
+	if (err) {
+		Py_RETURN_FALSE;
+	}
+	Py_RETURN_TRUE;
 }
 
 PyObject* libetrace_nfsdb_precompute_command_patterns(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs) {
@@ -1489,6 +1384,14 @@ PyObject* libetrace_nfsdb_precompute_command_patterns(libetrace_nfsdb_object *se
 
 	Py_DecRef(py_debug);
 
+	size_t jobs = 0;
+	if (kwargs) {
+		PyObject* py_jobs = PyDict_GetItemString(kwargs,"jobs");
+		if (py_jobs && (PyLong_AsLong(py_jobs)>0)) {
+			jobs = PyLong_AsLong(py_jobs);
+		}
+	}
+
 	DBG(debug,"--- libetrace_precompute_command_patterns()\n");
 
     struct sigaction act;
@@ -1523,34 +1426,32 @@ PyObject* libetrace_nfsdb_precompute_command_patterns(libetrace_nfsdb_object *se
 
     DBG(1,"Precomputing exclude command patterns...");
 
-    for (unsigned long cmdi=0; cmdi<self->nfsdb->nfsdb_count; ++cmdi) {
-    	struct nfsdb_entry* entry = &self->nfsdb->nfsdb_entry[cmdi];
-    	const char* cmdstr = libetrace_nfsdb_string_handle_join(self->nfsdb,entry->argv,entry->argv_count," ");
+    struct command_patterns* cp = command_patterns_compile(excl_commands,excl_commands_size);
+    size_t bsize = (excl_commands_size-1)/8+1;
+    unsigned char* b = malloc(PRECOMPUTE_COMMAND_PATTERNS_CHUNK*bsize);
+    assert(b!=0 && "Out of memory for allocating precompute pattern map");
+
+    for (unsigned long chunk=0; chunk<self->nfsdb->nfsdb_count; chunk+=PRECOMPUTE_COMMAND_PATTERNS_CHUNK) {
+    	unsigned long chunk_end = chunk+PRECOMPUTE_COMMAND_PATTERNS_CHUNK;
+    	if (chunk_end>self->nfsdb->nfsdb_count) {
+    		chunk_end = self->nfsdb->nfsdb_count;
+    	}
+    	Py_BEGIN_ALLOW_THREADS
+    	command_patterns_match_nfsdb(cp,self->nfsdb,chunk,chunk_end,b,jobs);
+    	Py_END_ALLOW_THREADS
+    	for (unsigned long cmdi=chunk; cmdi<chunk_end; ++cmdi) {
+    		struct nfsdb_entry* entry = &self->nfsdb->nfsdb_entry[cmdi];
+			PyObject* pidext = PyTuple_New(2);
+			PyTuple_SetItem(pidext, 0,Py_BuildValue("l",entry->eid.pid));
+			PyTuple_SetItem(pidext, 1,Py_BuildValue("l",entry->eid.exeidx));
+			PyObject* bytes = PyBytes_FromStringAndSize((const char*)&b[(cmdi-chunk)*bsize],bsize);
+			PyDict_SetItem(pcp_map, pidext, bytes);
+			Py_DecRef(pidext);
+			Py_DecRef(bytes);
+    	}
     	if (isatty(fileno(stdin))){
-			if ((cmdi%1000)==0) {
-				DBG(1,"\rPrecomputing exclude command patterns...%lu%%",(cmdi*100)/self->nfsdb->nfsdb_count);
-			}
-		}
-		size_t bsize = (excl_commands_size-1)/8+1;
-		unsigned char* b = calloc(bsize,1);
-		assert(b!=0 && "Out of memory for allocating precompute pattern map");
-		size_t k;
-		for (k=0; k<excl_commands_size; ++k) {
-			unsigned byte_index = k/8;
-			unsigned bit_index = k%8;
-			if (pattern_match_single(cmdstr,excl_commands[k])) {
-				b[byte_index]|=0x01<<(7-bit_index);
-			}
-		}
-		PyObject* pidext = PyTuple_New(2);
-		PyTuple_SetItem(pidext, 0,Py_BuildValue("l",entry->eid.pid));
-		PyTuple_SetItem(pidext, 1,Py_BuildValue("l",entry->eid.exeidx));
-		PyObject* bytes = PyBytes_FromStringAndSize((const char*)b,bsize);
-		PyDict_SetItem(pcp_map, pidext, bytes);
-		Py_DecRef(pidext);
-		Py_DecRef(bytes);
-		free(b);
-		free((void*)cmdstr);
+			DBG(1,"\rPrecomputing exclude command patterns...%lu%%",(chunk_end*100)/self->nfsdb->nfsdb_count);
+		}
 		if (interrupt) {
 			goto interrupted;
 		}
@@ -1560,12 +1461,16 @@ PyObject* libetrace_nfsdb_precompute_command_patterns(libetrace_nfsdb_object *se
     	PYASSTR_DECREF(excl_commands[u]);
     }
 	free(excl_commands);
+	command_patterns_destroy(cp);
+	free(b);
 	return pcp_map;
 interrupted:
     for (size_t u=0; u<excl_commands_size; ++u) {
     	PYASSTR_DECREF(excl_commands[u]);
     }
 	free(excl_commands);
+	command_patterns_destroy(cp);
+	free(b);
 	Py_DecRef(pcp_map);
 	Py_RETURN_NONE;
 }
@@ -1621,8 +1526,14 @@ void libetrace_nfsdb_dealloc(libetrace_nfsdb_object* self) {
 
 	PyTypeObject *tp = Py_TYPE(self);
 	if (self->init_done) {
-		unflatten_deinit(self->unflatten);
-		unflatten_deinit(self->unflatten_deps);
+		if (self->mapped)
+			prelink_unmap(self->mapped);
+		else
+			unflatten_deinit(self->unflatten);
+		if (self->mapped_deps)
+			prelink_unmap(self->mapped_deps);
+		else
+			unflatten_deinit(self->unflatten_deps);
 	}
 	Py_DecRef(self->libetrace_nfsdb_entry_openfile_filterMap);
 	Py_DecRef(self->libetrace_nfsdb_entry_command_filterMap);
@@ -1766,7 +1677,7 @@ static int libetrace_nfsdb_entry_from_string(libetrace_nfsdb_object* self, PyObj
 	static char errmsg[ERRMSG_BUFFER_SIZE];
 
 	const char* bpath = PyString_get_c_str(slice_string);
-	struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb->revstringmap, bpath);
+	struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb->revstringmap, bpath);
 	if (!srefnode) {
 		snprintf(errmsg,ERRMSG_BUFFER_SIZE,"Invalid binary path key [%s] at nfsdb entry",bpath);
 		PyErr_SetString(libetrace_nfsdbError, errmsg);
@@ -2010,7 +1921,7 @@ PyObject* libetrace_nfsdb_opens_list(libetrace_nfsdb_object *self, PyObject *arg
 PyObject* libetrace_nfsdb_opens_paths(libetrace_nfsdb_object *self, PyObject *args) {
 
     PyObject* paths = PyList_New(0);
-	struct rb_node * p = rb_first(&self->nfsdb->filemap);
+	struct nfsdb_fileMap_node* p = fileMap_first(&self->nfsdb->filemap);
     while(p) {
         struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)p;
         if (data->access_type!=FILE_ACCESS_TYPE_EXEC) {
@@ -2018,7 +1929,7 @@ PyObject* libetrace_nfsdb_opens_paths(libetrace_nfsdb_object *self, PyObject *ar
 	        PyList_Append(paths,s);
 	        Py_DecRef(s);
 	    }
-        p = rb_next(p);
+        p = fileMap_next(&self->nfsdb->filemap,p);
     }
     return paths;
 }
@@ -2959,7 +2870,7 @@ PyObject* libetrace_nfsdb_filtered_opens_paths(libetrace_nfsdb_object *self, PyO
 	}
 
 	/* Make filtering */
-	struct rb_node * p = rb_first(&self->nfsdb->filemap);
+	struct nfsdb_fileMap_node* p = fileMap_first(&self->nfsdb->filemap);
     while(p) {
         struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)p;
 		if ((data->access_type!=FILE_ACCESS_TYPE_EXEC) && ((fast_filter ? libetrace_nfsdb_filtered_opens_paths_filter_once(self,data,fflts,fflts_size,1) : true) &&
@@ -2969,7 +2880,7 @@ PyObject* libetrace_nfsdb_filtered_opens_paths(libetrace_nfsdb_object *self, PyO
 	        PyList_Append(paths,s);
 	        Py_DecRef(s);
 		}
-        p = rb_next(p);
+        p = fileMap_next(&self->nfsdb->filemap,p);
     }
 
 cleanup_and_exit:
@@ -3195,7 +3106,7 @@ PyObject* libetrace_nfsdb_filtered_opens(libetrace_nfsdb_object *self, PyObject
 		/* Make filtering
 		 * Faster filtering; we basically filter only based on paths and feed all the opens accordingly
 		 */
-		struct rb_node * p = rb_first(&self->nfsdb->filemap);
+		struct nfsdb_fileMap_node* p = fileMap_first(&self->nfsdb->filemap);
 		while(p) {
 			struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)p;
 			if ((data->access_type!=FILE_ACCESS_TYPE_EXEC) && ((fast_filter ? libetrace_nfsdb_filtered_opens_paths_filter_once(self,data,fflts,fflts_size,1) : true) &&
@@ -3209,12 +3120,12 @@ PyObject* libetrace_nfsdb_filtered_opens(libetrace_nfsdb_object *self, PyObject
 					Py_DecRef((PyObject*)py_openfile);
 				}
 			}
-			p = rb_next(p);
+			p = fileMap_next(&self->nfsdb->filemap,p);
 		}
 	}
 	else {
 		/* Make standard filtering */
-		struct rb_node * p = rb_first(&self->nfsdb->filemap);
+		struct nfsdb_fileMap_node* p = fileMap_first(&self->nfsdb->filemap);
 		while(p) {
 			struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)p;
 			for (unsigned long i=0; i<data->ga_entry_count; ++i) {
@@ -3228,7 +3139,7 @@ PyObject* libetrace_nfsdb_filtered_opens(libetrace_nfsdb_object *self, PyObject
 					Py_DecRef((PyObject*)py_openfile);
 				}
 			}
-			p = rb_next(p);
+			p = fileMap_next(&self->nfsdb->filemap,p);
 		}
 	}
 
@@ -3369,73 +3280,368 @@ PyObject* libetrace_nfsdb_filtered_execs(libetrace_nfsdb_object *self, PyObject
 		}
 	}
 
-	fast_filter = calloc(sizeof(struct command_filter),1);
-	if (!parse_commands_fast_filter(self,kwargs,fast_filter)) {
-		free(fast_filter);
-		fast_filter = 0;
-		if (PyErr_Occurred()) {
-			Py_DecRef(execs);
-			execs = 0;
-			goto cleanup_and_exit;
-		}
+	fast_filter = calloc(sizeof(struct command_filter),1);
+	if (!parse_commands_fast_filter(self,kwargs,fast_filter)) {
+		free(fast_filter);
+		fast_filter = 0;
+		if (PyErr_Occurred()) {
+			Py_DecRef(execs);
+			execs = 0;
+			goto cleanup_and_exit;
+		}
+	}
+	else {
+		fflts[0] = fast_filter;
+	}
+
+	/* Make filtering */
+	for (unsigned long i=0; i<self->nfsdb->nfsdb_count; ++i) {
+		struct nfsdb_entry* entry = &self->nfsdb->nfsdb_entry[i];
+		if ((fast_filter ? libetrace_nfsdb_filtered_commands_filter_once(self,entry,fflts,fflts_size,1): true) &&
+			(cflts_size > 0 ? libetrace_nfsdb_filtered_commands_filter_once(self,entry,cflts,cflts_size,filter_count): true)) {
+			/* filter returned true */
+			PyObject* args = PyTuple_New(2);
+			PYTUPLE_SET_ULONG(args,0,(uintptr_t)self);
+			PYTUPLE_SET_ULONG(args,1,i);
+			PyObject *entry = PyObject_CallObject((PyObject *) &libetrace_nfsdbEntryType, args);
+			Py_DECREF(args);
+			PyList_Append(execs,entry);
+			Py_DecRef(entry);
+		}
+	}
+
+cleanup_and_exit:
+	if (cflts_size > 0) {
+		destroy_command_filters(filter_count,cflts,cflts_size);
+	}
+	if (fast_filter) {
+		destroy_command_filters(1,fflts,fflts_size);
+	}
+
+	free(cflts);
+	free(cflts_size);
+	free(fast_filter);
+	return execs;
+}
+
+PyObject* libetrace_nfsdb_filtered_execs_iter(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs) {
+
+	Py_ssize_t patch_size = 1;
+	if (PyTuple_Size(args)>1) {
+		patch_size = PyLong_AsLong(PyTuple_GetItem(args,1));
+	}
+	else {
+		if (KWARGS_HAVE(kwargs,"patch_size")) {
+			patch_size = PyLong_AsLong(KWARGS_GET(kwargs,"patch_size"));
+		}
+	}
+
+	PyObject* iter_args = PyTuple_New(4);
+	PYTUPLE_SET_ULONG(iter_args,0,(uintptr_t)self);
+	PyTuple_SetItem(iter_args,1,args);
+	Py_XINCREF(args);
+	PYTUPLE_SET_ULONG(iter_args,2,patch_size); /* step */
+	PyTuple_SetItem(iter_args,3,kwargs);
+	Py_XINCREF(kwargs);
+
+	PyObject *iter = PyObject_CallObject((PyObject *) &libetrace_nfsdbFilteredCommandsIterType, iter_args);
+	Py_DecRef(iter_args);
+	return iter;
+}
+
+/* Compiled filters of opened files and executions
+ * The filter specification (the same as in the 'filtered_opens' and 'filtered_execs' functions) is parsed once
+ *  into the native predicates which are then evaluated directly on the given nfsdbEntryOpenfile (or nfsdbEntry)
+ *  objects, i.e. the filters can be applied to the opens and executions obtained from any other query
+ *  (dependencies, opens of a given process etc.)
+ */
+PyObject* libetrace_nfsdb_opens_filter(libetrace_nfsdb_object *self, PyObject *args) {
+
+	PyObject* filters = Py_None;
+	if (!PyArg_ParseTuple(args,"|O",&filters)) {
+		return 0;
+	}
+	ASSERT_WITH_NFSDB_ERROR((filters==Py_None)||PyList_Check(filters),"Invalid type of filter argument (expected 'list' or None)");
+
+	PyObject* filter_args = PyTuple_New(2);
+	PYTUPLE_SET_ULONG(filter_args,0,(uintptr_t)self);
+	PyTuple_SetItem(filter_args,1,filters);
+	Py_XINCREF(filters);
+
+	PyObject *filter = PyObject_CallObject((PyObject *) &libetrace_nfsdbOpensFilterType, filter_args);
+	Py_DecRef(filter_args);
+	return filter;
+}
+
+PyObject* libetrace_nfsdb_commands_filter(libetrace_nfsdb_object *self, PyObject *args) {
+
+	PyObject* filters = Py_None;
+	if (!PyArg_ParseTuple(args,"|O",&filters)) {
+		return 0;
+	}
+	ASSERT_WITH_NFSDB_ERROR((filters==Py_None)||PyList_Check(filters),"Invalid type of filter argument (expected 'list' or None)");
+
+	PyObject* filter_args = PyTuple_New(2);
+	PYTUPLE_SET_ULONG(filter_args,0,(uintptr_t)self);
+	PyTuple_SetItem(filter_args,1,filters);
+	Py_XINCREF(filters);
+
+	PyObject *filter = PyObject_CallObject((PyObject *) &libetrace_nfsdbCommandsFilterType, filter_args);
+	Py_DecRef(filter_args);
+	return filter;
+}
+
+void libetrace_nfsdb_opens_filter_dealloc(libetrace_nfsdb_opens_filter_object* self) {
+
+	if (self->cflts_size) {
+		destroy_opens_paths_filters(self->filter_count,self->cflts,self->cflts_size);
+		for (Py_ssize_t i=0; i<self->filter_count; ++i) {
+			free(self->cflts[i]);
+		}
+	}
+	free(self->cflts);
+	free(self->cflts_size);
+	Py_XDECREF(self->nfsdb_object);
+
+	PyTypeObject *tp = Py_TYPE(self);
+	tp->tp_free(self);
+}
+
+PyObject* libetrace_nfsdb_opens_filter_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds) {
+
+	libetrace_nfsdb_opens_filter_object* self;
+
+	self = (libetrace_nfsdb_opens_filter_object*)subtype->tp_alloc(subtype, 0);
+	if (self != 0) {
+		libetrace_nfsdb_object* nfsdb_object = (libetrace_nfsdb_object*)PyLong_AsLong(PyTuple_GetItem(args,0));
+		PyObject* filters = PyTuple_GetItem(args,1);
+		self->nfsdb_object = nfsdb_object;
+		Py_XINCREF(self->nfsdb_object);
+		self->cflts = 0;
+		self->cflts_size = 0;
+		self->filter_count = 0;
+
+		if ((filters != Py_None) && (PyList_Size(filters)>0)) {
+			Py_ssize_t filter_count = PyList_Size(filters);
+			self->cflts = calloc(sizeof(struct file_filter*),filter_count);
+			self->cflts_size = malloc(filter_count*sizeof(size_t));
+			if (!parse_opens_filters(nfsdb_object,filters,self->cflts,self->cflts_size,0)) {
+				for (Py_ssize_t i=0; i<filter_count; ++i) {
+					free(self->cflts[i]);
+				}
+				free(self->cflts);
+				free(self->cflts_size);
+				self->cflts = 0;
+				self->cflts_size = 0;
+				Py_DecRef((PyObject*)self);
+				return 0;
+			}
+			self->filter_count = filter_count;
+		}
+	}
+
+	return (PyObject *)self;
+}
+
+/* Returns 1 if a given opened file passes the filter, 0 if it doesn't and -1 on error */
+static int libetrace_nfsdb_opens_filter_match(libetrace_nfsdb_opens_filter_object* self, PyObject* item) {
+
+	if (!(PyObject_TypeCheck(item,&libetrace_nfsdbEntryOpenfileType))) {
+		PyErr_SetString(libetrace_nfsdbError,"Invalid type of filtered object (expected 'nfsdbEntryOpenfile')");
+		return -1;
+	}
+	libetrace_nfsdb_entry_openfile_object* openfile = (libetrace_nfsdb_entry_openfile_object*)item;
+	if (!(openfile->nfsdb_object==self->nfsdb_object)) {
+		PyErr_SetString(libetrace_nfsdbError,"Filtered opened file comes from a different database");
+		return -1;
+	}
+
+	if (!self->filter_count) {
+		return 1;
+	}
+
+	const struct nfsdb* nfsdb = self->nfsdb_object->nfsdb;
+	struct nfsdb_fileMap_node* node = fileMap_search(&nfsdb->filemap,openfile->path);
+	if ((!node) || (node->access_type==FILE_ACCESS_TYPE_EXEC)) {
+		return 0;
+	}
+
+	/* The file filters address the opens through the path node; make this open the only one of its path */
+	struct nfsdb_fileMap_node open_node = *node;
+	struct nfsdb_entry* entry_list[1] = {&nfsdb->nfsdb_entry[openfile->parent]};
+	unsigned long entry_index[1] = {openfile->index};
+	open_node.ga_entry_list = entry_list;
+	open_node.ga_entry_index = entry_index;
+	open_node.ga_entry_count = 1;
+
+	return libetrace_nfsdb_filtered_opens_filter_once(self->nfsdb_object,&open_node,0,self->cflts,self->cflts_size,self->filter_count);
+}
+
+PyObject* libetrace_nfsdb_opens_filter_call(PyObject *self, PyObject *args, PyObject* kwargs) {
+
+	PyObject* item;
+	if (!PyArg_ParseTuple(args,"O",&item)) {
+		return 0;
+	}
+
+	int match = libetrace_nfsdb_opens_filter_match((libetrace_nfsdb_opens_filter_object*)self,item);
+	if (match<0) {
+		return 0;
+	}
+	return PyBool_FromLong(match);
+}
+
+PyObject* libetrace_nfsdb_opens_filter_filter(PyObject *self, PyObject *args) {
+
+	PyObject* items;
+	if (!PyArg_ParseTuple(args,"O",&items)) {
+		return 0;
+	}
+
+	PyObject* iter = PyObject_GetIter(items);
+	if (!iter) {
+		return 0;
+	}
+
+	PyObject* matched = PyList_New(0);
+	PyObject* item;
+	while ((item = PyIter_Next(iter))) {
+		int match = libetrace_nfsdb_opens_filter_match((libetrace_nfsdb_opens_filter_object*)self,item);
+		if (match>0) {
+			PyList_Append(matched,item);
+		}
+		Py_DecRef(item);
+		if (match<0) {
+			break;
+		}
+	}
+	Py_DecRef(iter);
+
+	if (PyErr_Occurred()) {
+		Py_DecRef(matched);
+		return 0;
+	}
+	return matched;
+}
+
+void libetrace_nfsdb_commands_filter_dealloc(libetrace_nfsdb_commands_filter_object* self) {
+
+	if (self->cflts_size) {
+		destroy_command_filters(self->filter_count,self->cflts,self->cflts_size);
+		for (Py_ssize_t i=0; i<self->filter_count; ++i) {
+			free(self->cflts[i]);
+		}
+	}
+	free(self->cflts);
+	free(self->cflts_size);
+	Py_XDECREF(self->nfsdb_object);
+
+	PyTypeObject *tp = Py_TYPE(self);
+	tp->tp_free(self);
+}
+
+PyObject* libetrace_nfsdb_commands_filter_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds) {
+
+	libetrace_nfsdb_commands_filter_object* self;
+
+	self = (libetrace_nfsdb_commands_filter_object*)subtype->tp_alloc(subtype, 0);
+	if (self != 0) {
+		libetrace_nfsdb_object* nfsdb_object = (libetrace_nfsdb_object*)PyLong_AsLong(PyTuple_GetItem(args,0));
+		PyObject* filters = PyTuple_GetItem(args,1);
+		self->nfsdb_object = nfsdb_object;
+		Py_XINCREF(self->nfsdb_object);
+		self->cflts = 0;
+		self->cflts_size = 0;
+		self->filter_count = 0;
+
+		if ((filters != Py_None) && (PyList_Size(filters)>0)) {
+			Py_ssize_t filter_count = PyList_Size(filters);
+			self->cflts = calloc(sizeof(struct command_filter*),filter_count);
+			self->cflts_size = malloc(filter_count*sizeof(size_t));
+			if (!parse_command_filters(nfsdb_object,filters,self->cflts,self->cflts_size)) {
+				for (Py_ssize_t i=0; i<filter_count; ++i) {
+					free(self->cflts[i]);
+				}
+				free(self->cflts);
+				free(self->cflts_size);
+				self->cflts = 0;
+				self->cflts_size = 0;
+				Py_DecRef((PyObject*)self);
+				return 0;
+			}
+			self->filter_count = filter_count;
+		}
+	}
+
+	return (PyObject *)self;
+}
+
+/* Returns 1 if a given execution passes the filter, 0 if it doesn't and -1 on error */
+static int libetrace_nfsdb_commands_filter_match(libetrace_nfsdb_commands_filter_object* self, PyObject* item) {
+
+	if (!(PyObject_TypeCheck(item,&libetrace_nfsdbEntryType))) {
+		PyErr_SetString(libetrace_nfsdbError,"Invalid type of filtered object (expected 'nfsdbEntry')");
+		return -1;
 	}
-	else {
-		fflts[0] = fast_filter;
+	libetrace_nfsdb_entry_object* entry = (libetrace_nfsdb_entry_object*)item;
+	if (!(entry->nfsdb_object==self->nfsdb_object)) {
+		PyErr_SetString(libetrace_nfsdbError,"Filtered execution comes from a different database");
+		return -1;
 	}
 
-	/* Make filtering */
-	for (unsigned long i=0; i<self->nfsdb->nfsdb_count; ++i) {
-		struct nfsdb_entry* entry = &self->nfsdb->nfsdb_entry[i];
-		if ((fast_filter ? libetrace_nfsdb_filtered_commands_filter_once(self,entry,fflts,fflts_size,1): true) &&
-			(cflts_size > 0 ? libetrace_nfsdb_filtered_commands_filter_once(self,entry,cflts,cflts_size,filter_count): true)) {
-			/* filter returned true */
-			PyObject* args = PyTuple_New(2);
-			PYTUPLE_SET_ULONG(args,0,(uintptr_t)self);
-			PYTUPLE_SET_ULONG(args,1,i);
-			PyObject *entry = PyObject_CallObject((PyObject *) &libetrace_nfsdbEntryType, args);
-			Py_DECREF(args);
-			PyList_Append(execs,entry);
-			Py_DecRef(entry);
-		}
+	if (!self->filter_count) {
+		return 1;
 	}
 
-cleanup_and_exit:
-	if (cflts_size > 0) {
-		destroy_command_filters(filter_count,cflts,cflts_size);
-	}
-	if (fast_filter) {
-		destroy_command_filters(1,fflts,fflts_size);
+	return libetrace_nfsdb_filtered_commands_filter_once(self->nfsdb_object,(struct nfsdb_entry*)entry->entry,
+			self->cflts,self->cflts_size,self->filter_count);
+}
+
+PyObject* libetrace_nfsdb_commands_filter_call(PyObject *self, PyObject *args, PyObject* kwargs) {
+
+	PyObject* item;
+	if (!PyArg_ParseTuple(args,"O",&item)) {
+		return 0;
 	}
 
-	free(cflts);
-	free(cflts_size);
-	free(fast_filter);
-	return execs;
+	int match = libetrace_nfsdb_commands_filter_match((libetrace_nfsdb_commands_filter_object*)self,item);
+	if (match<0) {
+		return 0;
+	}
+	return PyBool_FromLong(match);
 }
 
-PyObject* libetrace_nfsdb_filtered_execs_iter(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs) {
+PyObject* libetrace_nfsdb_commands_filter_filter(PyObject *self, PyObject *args) {
 
-	Py_ssize_t patch_size = 1;
-	if (PyTuple_Size(args)>1) {
-		patch_size = PyLong_AsLong(PyTuple_GetItem(args,1));
+	PyObject* items;
+	if (!PyArg_ParseTuple(args,"O",&items)) {
+		return 0;
 	}
-	else {
-		if (KWARGS_HAVE(kwargs,"patch_size")) {
-			patch_size = PyLong_AsLong(KWARGS_GET(kwargs,"patch_size"));
-		}
+
+	PyObject* iter = PyObject_GetIter(items);
+	if (!iter) {
+		return 0;
 	}
 
-	PyObject* iter_args = PyTuple_New(4);
-	PYTUPLE_SET_ULONG(iter_args,0,(uintptr_t)self);
-	PyTuple_SetItem(iter_args,1,args);
-	Py_XINCREF(args);
-	PYTUPLE_SET_ULONG(iter_args,2,patch_size); /* step */
-	PyTuple_SetItem(iter_args,3,kwargs);
-	Py_XINCREF(kwargs);
+	PyObject* matched = PyList_New(0);
+	PyObject* item;
+	while ((item = PyIter_Next(iter))) {
+		int match = libetrace_nfsdb_commands_filter_match((libetrace_nfsdb_commands_filter_object*)self,item);
+		if (match>0) {
+			PyList_Append(matched,item);
+		}
+		Py_DecRef(item);
+		if (match<0) {
+			break;
+		}
+	}
+	Py_DecRef(iter);
 
-	PyObject *iter = PyObject_CallObject((PyObject *) &libetrace_nfsdbFilteredCommandsIterType, iter_args);
-	Py_DecRef(iter_args);
-	return iter;
+	if (PyErr_Occurred()) {
+		Py_DecRef(matched);
+		return 0;
+	}
+	return matched;
 }
 
 PyObject* libetrace_nfsdb_pcp_list(libetrace_nfsdb_object *self, PyObject *args) {
@@ -3454,11 +3660,11 @@ PyObject* libetrace_nfsdb_pid_list(libetrace_nfsdb_object *self, PyObject *args)
 
 	PyObject* pids = PyList_New(0);
 
-	struct rb_node * p = rb_first(&self->nfsdb->procmap);
+	struct nfsdb_entryMap_node* p = nfsdb_entryMap_first(&self->nfsdb->procmap);
 	while(p) {
 		struct nfsdb_entryMap_node* data = (struct nfsdb_entryMap_node*)p;
 		PYLIST_ADD_ULONG(pids,data->key);
-		p = rb_next(p);
+		p = nfsdb_entryMap_next(&self->nfsdb->procmap,p);
 	}
 
 	return pids;
@@ -3468,11 +3674,11 @@ PyObject* libetrace_nfsdb_bpath_list(libetrace_nfsdb_object *self, PyObject *arg
 
 	PyObject* bpaths = PyList_New(0);
 
-	struct rb_node * p = rb_first(&self->nfsdb->bmap);
+	struct nfsdb_entryMap_node* p = nfsdb_entryMap_first(&self->nfsdb->bmap);
 	while(p) {
 		struct nfsdb_entryMap_node* data = (struct nfsdb_entryMap_node*)p;
 		PYLIST_ADD_STRING(bpaths,self->nfsdb->string_table[data->key]);
-		p = rb_next(p);
+		p = nfsdb_entryMap_next(&self->nfsdb->bmap,p);
 	}
 
 	return bpaths;
@@ -3482,14 +3688,14 @@ PyObject* libetrace_nfsdb_linked_module_paths(libetrace_nfsdb_object *self, PyOb
 
 	PyObject* linked_modules = PyList_New(0);
 
-	struct rb_node * p = rb_first(&self->nfsdb->linkedmap);
+	struct nfsdb_entryMap_node* p = nfsdb_entryMap_first(&self->nfsdb->linkedmap);
 	while(p) {
 		struct nfsdb_entryMap_node* data = (struct nfsdb_entryMap_node*)p;
 		PyObject* lm = PyTuple_New(2);
 		PYTUPLE_SET_STR(lm,0,self->nfsdb->string_table[data->key]);
 		PYTUPLE_SET_LONG(lm,1,data->entry_list[0]->linked_type);
 		PyList_Append(linked_modules,lm);
-		p = rb_next(p);
+		p = nfsdb_entryMap_next(&self->nfsdb->linkedmap,p);
 	}
 
 	return linked_modules;
@@ -3499,7 +3705,7 @@ PyObject* libetrace_nfsdb_linked_modules(libetrace_nfsdb_object *self, PyObject
 
 	PyObject* linked_modules = PyList_New(0);
 
-	struct rb_node * p = rb_first(&self->nfsdb->linkedmap);
+	struct nfsdb_entryMap_node* p = nfsdb_entryMap_first(&self->nfsdb->linkedmap);
 	while(p) {
 		struct nfsdb_entryMap_node* data = (struct nfsdb_entryMap_node*)p;
 		const struct nfsdb_entry* entry = data->entry_list[0];
@@ -3511,7 +3717,7 @@ PyObject* libetrace_nfsdb_linked_modules(libetrace_nfsdb_object *self, PyObject
 			PYTUPLE_SET_LONG(lm,1,data->entry_list[0]->linked_type);
 			PyList_Append(linked_modules,lm);
 		}
-		p = rb_next(p);
+		p = nfsdb_entryMap_next(&self->nfsdb->linkedmap,p);
 	}
 
 	return linked_modules;
@@ -3525,7 +3731,7 @@ PyObject* libetrace_nfsdb_path_exists(libetrace_nfsdb_object *self, PyObject *ar
 
 	if (PyUnicode_Check(path)) {
 		const char* fpath = PyString_get_c_str(path);
-		struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb->revstringmap, fpath);
+		struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb->revstringmap, fpath);
 		PYASSTR_DECREF(fpath);
 		if (!srefnode) {
 			Py_RETURN_FALSE;
@@ -3570,7 +3776,7 @@ PyObject* libetrace_nfsdb_path_regular(libetrace_nfsdb_object *self, PyObject *a
 
 	if (PyUnicode_Check(path)) {
 		const char* fpath = PyString_get_c_str(path);
-		struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb->revstringmap, fpath);
+		struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb->revstringmap, fpath);
 		PYASSTR_DECREF(fpath);
 		if (!srefnode) {
 			Py_RETURN_FALSE;
@@ -3613,7 +3819,7 @@ PyObject* libetrace_nfsdb_path_symlinked(libetrace_nfsdb_object *self, PyObject
 
 	if (PyUnicode_Check(path)) {
 		const char* fpath = PyString_get_c_str(path);
-		struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb->revstringmap, fpath);
+		struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb->revstringmap, fpath);
 		PYASSTR_DECREF(fpath);
 		if (!srefnode) {
 			Py_RETURN_FALSE;
@@ -3666,7 +3872,7 @@ PyObject* libetrace_nfsdb_symlink_paths(libetrace_nfsdb_object *self, PyObject *
 
 	if (PyUnicode_Check(path)) {
 		const char* fpath = PyString_get_c_str(path);
-		struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb->revstringmap, fpath);
+		struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb->revstringmap, fpath);
 		PYASSTR_DECREF(fpath);
 		if (!srefnode) {
 			Py_RETURN_FALSE;
@@ -3726,7 +3932,7 @@ PyObject* libetrace_nfsdb_path_read(libetrace_nfsdb_object *self, PyObject *args
 
 	if (PyUnicode_Check(path)) {
 		const char* fpath = PyString_get_c_str(path);
-		struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb->revstringmap, fpath);
+		struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb->revstringmap, fpath);
 		PYASSTR_DECREF(fpath);
 		if (!srefnode) {
 			Py_RETURN_FALSE;
@@ -3752,7 +3958,7 @@ PyObject* libetrace_nfsdb_path_write(libetrace_nfsdb_object *self, PyObject *arg
 
 	if (PyUnicode_Check(path)) {
 		const char* fpath = PyString_get_c_str(path);
-		struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb->revstringmap, fpath);
+		struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb->revstringmap, fpath);
 		PYASSTR_DECREF(fpath);
 		if (!srefnode) {
 			Py_RETURN_FALSE;
@@ -3794,6 +4000,18 @@ PyObject* libetrace_nfsdb_get_dbversion(PyObject* self, void* closure) {
 	return PyUnicode_FromString(__self->nfsdb->dbversion);
 }
 
+PyObject* libetrace_nfsdb_get_mapped(PyObject* self, void* closure) {
+
+	libetrace_nfsdb_object* __self = (libetrace_nfsdb_object*)self;
+	return PyBool_FromLong(__self->mapped!=0);
+}
+
+PyObject* libetrace_nfsdb_get_deps_mapped(PyObject* self, void* closure) {
+
+	libetrace_nfsdb_object* __self = (libetrace_nfsdb_object*)self;
+	return PyBool_FromLong(__self->mapped_deps!=0);
+}
+
 PyObject* libetrace_nfsdb_load(libetrace_nfsdb_object* self, PyObject* args, PyObject* kwargs ) {
 
     const char* cache_filename = ".nfsdb.img";
@@ -3804,9 +4022,13 @@ PyObject* libetrace_nfsdb_load(libetrace_nfsdb_object* self, PyObject* args, PyO
 
     PyObject* py_debug = PyUnicode_FromString("debug");
     PyObject* py_quiet = PyUnicode_FromString("quiet");
+    PyObject* py_no_map_memory = PyUnicode_FromString("no_map_memory");
+    PyObject* py_prelink = PyUnicode_FromString("prelink");
 
     int debug = self->debug;
     int quiet = 0;
+    int no_map_memory = 0;
+    int prelink = 0;
     bool err = true;
 
     if (kwargs) {
@@ -3816,6 +4038,12 @@ PyObject* libetrace_nfsdb_load(libetrace_nfsdb_object* self, PyObject* args, PyO
     	if (PyDict_Contains(kwargs,py_quiet)) {
 			quiet = PyLong_AsLong(PyDict_GetItem(kwargs,py_quiet));
 		}
+    	if (PyDict_Contains(kwargs,py_no_map_memory)) {
+			no_map_memory = PyObject_IsTrue(PyDict_GetItem(kwargs,py_no_map_memory));
+		}
+		if (PyDict_Contains(kwargs,py_prelink)) {
+			prelink = PyObject_IsTrue(PyDict_GetItem(kwargs,py_prelink));
+		}
     }
 
     DBG( debug, "--- libetrace_nfsdb_load(\"%s\")\n",cache_filename);
@@ -3825,58 +4053,91 @@ PyObject* libetrace_nfsdb_load(libetrace_nfsdb_object* self, PyObject* args, PyO
     	goto done;
 	}
 
-	FILE* in = fopen(cache_filename, "r+b");
-	if (!in) {
-		in = fopen(cache_filename, "rb");
-		if(!in) {
-			PyErr_Format(libetrace_nfsdbError, "Cannot open cache file - (%d) %s", errno, strerror(errno));
-			goto done;
-		}
+	/* Use the prelinked image in place when there is an up-to-date one for this cache file */
+	if (!no_map_memory) {
+		self->mapped = prelink_map(cache_filename);
 	}
 
-	int debug_level = 0;
-	if(debug)
-		debug_level = 2;
-	else if (!quiet)
-		debug_level = 1;
-
-	self->unflatten = unflatten_init(debug_level);
-	if(self->unflatten == NULL) {
-		PyErr_SetString(libetrace_nfsdbError, "Failed to intialize unflatten library");
-		goto done;
+	if (self->mapped) {
+		DBG( debug, "--- mapped prelinked image at %p\n",(void*)self->mapped->base);
+		self->nfsdb = (const struct nfsdb*) self->mapped->root;
 	}
+	else {
+		FILE* in = fopen(cache_filename, "r+b");
+		if (!in) {
+			in = fopen(cache_filename, "rb");
+			if(!in) {
+				PyErr_Format(libetrace_nfsdbError, "Cannot open cache file - (%d) %s", errno, strerror(errno));
+				goto done;
+			}
+		}
 
-	UnflattenStatus status = unflatten_load_continuous(self->unflatten, in, NULL);
-	if (status) {
-		PyErr_Format(libetrace_nfsdbError, "Failed to read cache file: %s", unflatten_explain_status(status));
-		unflatten_deinit(self->unflatten);
-		fclose(in);
-		goto done;
-	}
+		int debug_level = 0;
+		if(debug)
+			debug_level = 2;
+		else if (!quiet)
+			debug_level = 1;
+
+		self->unflatten = unflatten_init(debug_level);
+		if(self->unflatten == NULL) {
+			PyErr_SetString(libetrace_nfsdbError, "Failed to intialize unflatten library");
+			fclose(in);
+			goto done;
+		}
+
+		UnflattenStatus status = unflatten_load_continuous(self->unflatten, in, NULL);
+		if (status) {
+			PyErr_Format(libetrace_nfsdbError, "Failed to read cache file: %s", unflatten_explain_status(status));
+			unflatten_deinit(self->unflatten);
+			fclose(in);
+			goto done;
+		}
 
-	fclose(in);
+		fclose(in);
 
-    self->nfsdb = (const struct nfsdb*) unflatten_root_pointer_next(self->unflatten);
+		self->nfsdb = (const struct nfsdb*) unflatten_root_pointer_next(self->unflatten);
+	}
 
 	/* Check whether it's correct file and in supported version */
 	if(self->nfsdb->db_magic != NFSDB_MAGIC_NUMBER) {
 		PyErr_Format(libetrace_nfsdbError, "Failed to parse cache file - invalid magic %p", self->nfsdb->db_magic);
-		unflatten_deinit(self->unflatten);
-		goto done;
+		goto release;
 	}
 	if(self->nfsdb->db_version != LIBETRACE_VERSION) {
 		PyErr_Format(libetrace_nfsdbError, "Failed to parse cache file - unsupported image version %p (required: %p)",
 						self->nfsdb->db_version, LIBETRACE_VERSION);
-		unflatten_deinit(self->unflatten);
-		goto done;
+		goto release;
+	}
+
+	/* Save the prelinked image for subsequent loads when requested and switch to it right away (failures are not fatal) */
+	if (!self->mapped && !no_map_memory && prelink && (nfsdb_prelink(cache_filename,self->nfsdb)==0)) {
+		const struct prelink_header* mapped = prelink_map(cache_filename);
+		if (mapped) {
+			DBG( debug, "--- saved prelinked image at %p\n",(void*)mapped->base);
+			unflatten_deinit(self->unflatten);
+			self->unflatten = NULL;
+			self->mapped = mapped;
+			self->nfsdb = (const struct nfsdb*) mapped->root;
+		}
 	}
 
 	self->init_done = 1;
 	err = false;
+	goto done;
+
+release:
+	if (self->mapped)
+		prelink_unmap(self->mapped);
+	else
+		unflatten_deinit(self->unflatten);
+	self->mapped = NULL;
+	self->unflatten = NULL;
 
 done:
 	Py_DecRef(py_debug);
 	Py_DecRef(py_quiet);
+	Py_DecRef(py_no_map_memory);
+	Py_DecRef(py_prelink);
 	PYASSTR_DECREF(cache_filename);
 	if (err)
 		return NULL;	/* Indicate that an error has occurred */
@@ -3893,9 +4154,13 @@ PyObject* libetrace_nfsdb_load_deps(libetrace_nfsdb_object* self, PyObject* args
 
 	PyObject* py_debug = PyUnicode_FromString("debug");
 	PyObject* py_quiet = PyUnicode_FromString("quiet");
+	PyObject* py_no_map_memory = PyUnicode_FromString("no_map_memory");
+	PyObject* py_prelink = PyUnicode_FromString("prelink");
 
 	int debug = self->debug;
 	int quiet = 0;
+	int no_map_memory = 0;
+	int prelink = 0;
 	bool err = true;
 
 	if (kwargs) {
@@ -3905,6 +4170,12 @@ PyObject* libetrace_nfsdb_load_deps(libetrace_nfsdb_object* self, PyObject* args
 		if (PyDict_Contains(kwargs,py_quiet)) {
 			quiet = PyLong_AsLong(PyDict_GetItem(kwargs,py_quiet));
 		}
+		if (PyDict_Contains(kwargs,py_no_map_memory)) {
+			no_map_memory = PyObject_IsTrue(PyDict_GetItem(kwargs,py_no_map_memory));
+		}
+		if (PyDict_Contains(kwargs,py_prelink)) {
+			prelink = PyObject_IsTrue(PyDict_GetItem(kwargs,py_prelink));
+		}
 	}
 
 	DBG( debug, "--- libetrace_nfsdb_load_deps(\"%s\")\n",cache_filename);
@@ -3914,57 +4185,89 @@ PyObject* libetrace_nfsdb_load_deps(libetrace_nfsdb_object* self, PyObject* args
 		goto done;
 	}
 
-	FILE* in = fopen(cache_filename, "r+b");
-	if (!in) {
-		in = fopen(cache_filename, "rb");
-		if(!in) {
-			PyErr_Format(libetrace_nfsdbError, "Cannot open cache file - (%d) %s", errno, strerror(errno));
-			goto done;
-		}
+	if (!no_map_memory) {
+		self->mapped_deps = prelink_map(cache_filename);
 	}
 
-	int debug_level = 0;
-	if(debug)
-		debug_level = 2;
-	else if (!quiet)
-		debug_level = 1;
-
-	self->unflatten_deps = unflatten_init(debug_level);
-	if(self->unflatten_deps == NULL) {
-		PyErr_SetString(libetrace_nfsdbError, "Failed to intialize unflatten library");
-		goto done;
+	if (self->mapped_deps) {
+		DBG( debug, "--- mapped prelinked image at %p\n",(void*)self->mapped_deps->base);
+		self->nfsdb_deps = (const struct nfsdb_deps*) self->mapped_deps->root;
 	}
+	else {
+		FILE* in = fopen(cache_filename, "r+b");
+		if (!in) {
+			in = fopen(cache_filename, "rb");
+			if(!in) {
+				PyErr_Format(libetrace_nfsdbError, "Cannot open cache file - (%d) %s", errno, strerror(errno));
+				goto done;
+			}
+		}
 
-	UnflattenStatus status = unflatten_load_continuous(self->unflatten_deps, in, NULL);
-	if (status) {
-		PyErr_Format(libetrace_nfsdbError, "Failed to read cache file: %s", unflatten_explain_status(status));
-		unflatten_deinit(self->unflatten_deps);
-		fclose(in);
-		goto done;
-	}
+		int debug_level = 0;
+		if(debug)
+			debug_level = 2;
+		else if (!quiet)
+			debug_level = 1;
+
+		self->unflatten_deps = unflatten_init(debug_level);
+		if(self->unflatten_deps == NULL) {
+			PyErr_SetString(libetrace_nfsdbError, "Failed to intialize unflatten library");
+			fclose(in);
+			goto done;
+		}
 
-	fclose(in);
+		UnflattenStatus status = unflatten_load_continuous(self->unflatten_deps, in, NULL);
+		if (status) {
+			PyErr_Format(libetrace_nfsdbError, "Failed to read cache file: %s", unflatten_explain_status(status));
+			unflatten_deinit(self->unflatten_deps);
+			self->unflatten_deps = NULL;
+			fclose(in);
+			goto done;
+		}
+
+		fclose(in);
 
-	self->nfsdb_deps = (const struct nfsdb_deps*) unflatten_root_pointer_next(self->unflatten_deps);
+		self->nfsdb_deps = (const struct nfsdb_deps*) unflatten_root_pointer_next(self->unflatten_deps);
+	}
 
 	/* Check whether it's correct file and in supported version */
 	if(self->nfsdb_deps->db_magic != NFSDB_DEPS_MAGIC_NUMBER) {
 		PyErr_Format(libetrace_nfsdbError, "Failed to parse cache file - invalid magic %p", self->nfsdb_deps->db_magic);
-		unflatten_deinit(self->unflatten);
-		goto done;
+		goto release;
 	}
 	if(self->nfsdb_deps->db_version != LIBETRACE_VERSION) {
 		PyErr_Format(libetrace_nfsdbError, "Failed to parse cache file - unsupported image version %p (required: %p)",
 						self->nfsdb_deps->db_version, LIBETRACE_VERSION);
-		unflatten_deinit(self->unflatten);
-		goto done;
+		goto release;
+	}
+
+	if (!self->mapped_deps && !no_map_memory && prelink && (nfsdb_deps_prelink(cache_filename,self->nfsdb_deps)==0)) {
+		const struct prelink_header* mapped = prelink_map(cache_filename);
+		if (mapped) {
+			DBG( debug, "--- saved prelinked image at %p\n",(void*)mapped->base);
+			unflatten_deinit(self->unflatten_deps);
+			self->unflatten_deps = NULL;
+			self->mapped_deps = mapped;
+			self->nfsdb_deps = (const struct nfsdb_deps*) mapped->root;
+		}
 	}
 
 	err = false;
+	goto done;
+
+release:
+	if (self->mapped_deps)
+		prelink_unmap(self->mapped_deps);
+	else
+		unflatten_deinit(self->unflatten_deps);
+	self->mapped_deps = NULL;
+	self->unflatten_deps = NULL;
 
 done:
 	Py_DecRef(py_debug);
 	Py_DecRef(py_quiet);
+	Py_DecRef(py_no_map_memory);
+	Py_DecRef(py_prelink);
 	PYASSTR_DECREF(cache_filename);
 	if (err) {
 		self->nfsdb_deps = NULL;
@@ -4040,7 +4343,7 @@ PyObject* libetrace_nfsdb_module_dependencies_count(libetrace_nfsdb_object *self
 	for (Py_ssize_t u=0; u<PyList_Size(path_args); ++u) {
 		PyObject* parg = PyList_GetItem(path_args,u);
 		const char* mpath = PyString_get_c_str(parg);
-		struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb->revstringmap, mpath);
+		struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb->revstringmap, mpath);
 		PYASSTR_DECREF(mpath);
 		if (!srefnode) {
 			continue;
@@ -4121,7 +4424,7 @@ PyObject* libetrace_nfsdb_module_dependencies(libetrace_nfsdb_object *self, PyOb
 	for (Py_ssize_t u=0; u<PyList_Size(path_args); ++u) {
 		PyObject* parg = PyList_GetItem(path_args,u);
 		const char* mpath = PyString_get_c_str(parg);
-		struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb->revstringmap, mpath);
+		struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb->revstringmap, mpath);
 		PYASSTR_DECREF(mpath);
 		if (!srefnode) {
 			continue;
@@ -4208,7 +4511,7 @@ PyObject* libetrace_nfsdb_reverse_module_dependencies(libetrace_nfsdb_object *se
 	for (Py_ssize_t u=0; u<PyList_Size(path_args); ++u) {
 		PyObject* parg = PyList_GetItem(path_args,u);
 		const char* mpath = PyString_get_c_str(parg);
-		struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb->revstringmap, mpath);
+		struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb->revstringmap, mpath);
 		PYASSTR_DECREF(mpath);
 		if (!srefnode) {
 			continue;
@@ -4233,7 +4536,7 @@ PyObject* libetrace_nfsdb_filemap_has_path(libetrace_nfsdb_object *self, PyObjec
 
 	PyObject* path = PyTuple_GetItem(args,0);
 	const char* fpath = PyString_get_c_str(path);
-	struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb->revstringmap, fpath);
+	struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb->revstringmap, fpath);
 	if (!srefnode) {
 		Py_RETURN_FALSE;
 	}
@@ -5131,6 +5434,110 @@ PyObject* libetrace_nfsdb_entry_richcompare(PyObject *self, PyObject *other, int
 	Py_RETURN_RICHCOMPARE_internal(__self->nfsdb_index, __other->nfsdb_index , op);
 }
 
+struct sorted_window_items {
+	struct sorted_window_item* items;
+	size_t count;
+	size_t alloc;
+};
+
+static inline void sorted_window_items_append(struct sorted_window_items* w, unsigned long nfsdb_index, unsigned long open_index) {
+
+	if (w->count>=w->alloc) {
+		w->alloc = w->alloc?2*w->alloc:1024;
+		w->items = realloc(w->items,w->alloc*sizeof(struct sorted_window_item));
+	}
+	w->items[w->count].nfsdb_index = nfsdb_index;
+	w->items[w->count].open_index = open_index;
+	w->count++;
+}
+
+/*
+ * Common part of the iterators 'sorted_window(key, start=0, stop=None, reverse=False)' method
+ * Sorts the collected items (only as far as the 'stop' position) and creates the objects for the [start,stop) window
+ */
+static PyObject* libetrace_nfsdb_sorted_window(libetrace_nfsdb_object* nfsdb_object, struct sorted_window_items* w,
+		PyObject *args, PyObject* kwargs, int opens) {
+
+	PyObject* py_key = (PyTuple_Size(args)>0)?PyTuple_GetItem(args,0):(KWARGS_HAVE(kwargs,"key")?KWARGS_GET(kwargs,"key"):0);
+	PyObject* py_start = (PyTuple_Size(args)>1)?PyTuple_GetItem(args,1):(KWARGS_HAVE(kwargs,"start")?KWARGS_GET(kwargs,"start"):0);
+	PyObject* py_stop = (PyTuple_Size(args)>2)?PyTuple_GetItem(args,2):(KWARGS_HAVE(kwargs,"stop")?KWARGS_GET(kwargs,"stop"):0);
+	int reverse = KWARGS_HAVE(kwargs,"reverse")?PyObject_IsTrue(KWARGS_GET(kwargs,"reverse")):0;
+
+	if (!py_key || !PyUnicode_Check(py_key)) {
+		free(w->items);
+		ASSERT_WITH_NFSDB_ERROR(0,"Invalid sorting key: expected (str)");
+	}
+	const char* key_name = PyString_get_c_str(py_key);
+	int key = sorted_window_key_parse(key_name,opens);
+	PYASSTR_DECREF(key_name);
+	if (key<0) {
+		free(w->items);
+		ASSERT_WITH_NFSDB_ERROR(0,"Invalid sorting key for this iterator");
+	}
+	long start = (py_start && py_start!=Py_None)?PyLong_AsLong(py_start):0;
+	long stop = (py_stop && py_stop!=Py_None)?PyLong_AsLong(py_stop):(long)w->count;
+	if ((start<0) || (stop<0)) {
+		free(w->items);
+		ASSERT_WITH_NFSDB_ERROR(0,"Negative window bounds are not supported");
+	}
+	if ((size_t)stop>w->count) stop = w->count;
+
+	PyObject* items = PyList_New(0);
+	if (start<stop) {
+		Py_BEGIN_ALLOW_THREADS
+		sorted_window_select(nfsdb_object->nfsdb,w->items,w->count,key,stop,reverse);
+		Py_END_ALLOW_THREADS
+	}
+	for (long u=start; u<stop; ++u) {
+		const struct nfsdb_entry* entry = &nfsdb_object->nfsdb->nfsdb_entry[w->items[u].nfsdb_index];
+		PyObject* item;
+		if (opens) {
+			item = (PyObject*)libetrace_nfsdb_create_openfile_entry(nfsdb_object,entry,w->items[u].open_index,entry->nfsdb_index);
+		}
+		else {
+			PyObject* args = PyTuple_New(2);
+			PYTUPLE_SET_ULONG(args,0,(uintptr_t)nfsdb_object);
+			PYTUPLE_SET_ULONG(args,1,entry->nfsdb_index);
+			item = PyObject_CallObject((PyObject *) &libetrace_nfsdbEntryType, args);
+			Py_DecRef(args);
+		}
+		PyList_Append(items,item);
+		Py_DecRef(item);
+	}
+	free(w->items);
+	return items;
+}
+
+/*
+ * Common part of the iterators 'count(distinct=None)' method
+ * Returns the number of the collected items or the number of their distinct values of a given sorting key
+ */
+static PyObject* libetrace_nfsdb_count(libetrace_nfsdb_object* nfsdb_object, struct sorted_window_items* w,
+		PyObject *args, PyObject* kwargs, int opens) {
+
+	PyObject* py_distinct = (PyTuple_Size(args)>0)?PyTuple_GetItem(args,0):(KWARGS_HAVE(kwargs,"distinct")?KWARGS_GET(kwargs,"distinct"):0);
+
+	size_t count = w->count;
+	if (py_distinct && py_distinct!=Py_None) {
+		if (!PyUnicode_Check(py_distinct)) {
+			free(w->items);
+			ASSERT_WITH_NFSDB_ERROR(0,"Invalid distinct key: expected (str)");
+		}
+		const char* key_name = PyString_get_c_str(py_distinct);
+		int key = sorted_window_key_parse(key_name,opens);
+		PYASSTR_DECREF(key_name);
+		if (key<0) {
+			free(w->items);
+			ASSERT_WITH_NFSDB_ERROR(0,"Invalid distinct key for this iterator");
+		}
+		Py_BEGIN_ALLOW_THREADS
+		count = sorted_window_count_distinct(nfsdb_object->nfsdb,w->items,w->count,key);
+		Py_END_ALLOW_THREADS
+	}
+	free(w->items);
+	return PyLong_FromSize_t(count);
+}
+
 void libetrace_nfsdb_iter_dealloc(libetrace_nfsdb_iter_object* self) {
 
     PyTypeObject *tp = Py_TYPE(self);
@@ -5177,6 +5584,31 @@ PyObject* libetrace_nfsdb_iter_next(PyObject *self) {
 	return entry;
 }
 
+static void libetrace_nfsdb_iter_collect(libetrace_nfsdb_iter_object* __self, struct sorted_window_items* w) {
+
+	for (unsigned long i=__self->start; i<__self->end; i+=__self->step) {
+		sorted_window_items_append(w,i,0);
+	}
+}
+
+PyObject* libetrace_nfsdb_iter_sorted_window(PyObject *self, PyObject *args, PyObject* kwargs) {
+
+	libetrace_nfsdb_iter_object* __self = (libetrace_nfsdb_iter_object*)self;
+
+	struct sorted_window_items w = {0};
+	libetrace_nfsdb_iter_collect(__self,&w);
+	return libetrace_nfsdb_sorted_window(__self->nfsdb_object,&w,args,kwargs,0);
+}
+
+PyObject* libetrace_nfsdb_iter_count(PyObject *self, PyObject *args, PyObject* kwargs) {
+
+	libetrace_nfsdb_iter_object* __self = (libetrace_nfsdb_iter_object*)self;
+
+	struct sorted_window_items w = {0};
+	libetrace_nfsdb_iter_collect(__self,&w);
+	return libetrace_nfsdb_count(__self->nfsdb_object,&w,args,kwargs,0);
+}
+
 void libetrace_nfsdb_opens_iter_dealloc(libetrace_nfsdb_opens_iter_object* self) {
 
     PyTypeObject *tp = Py_TYPE(self);
@@ -5249,6 +5681,36 @@ PyObject* libetrace_nfsdb_opens_iter_next(PyObject *self) {
 	return (PyObject*)openfile;
 }
 
+static void libetrace_nfsdb_opens_iter_collect(libetrace_nfsdb_opens_iter_object* __self, struct sorted_window_items* w) {
+
+	unsigned long open_index = __self->open_index;
+	for (unsigned long i=__self->start; i<__self->end; i+=__self->step) {
+		const struct nfsdb_entry* entry = &__self->nfsdb_object->nfsdb->nfsdb_entry[i];
+		for (; open_index<entry->open_files_count; ++open_index) {
+			sorted_window_items_append(w,i,open_index);
+		}
+		open_index = 0;
+	}
+}
+
+PyObject* libetrace_nfsdb_opens_iter_sorted_window(PyObject *self, PyObject *args, PyObject* kwargs) {
+
+	libetrace_nfsdb_opens_iter_object* __self = (libetrace_nfsdb_opens_iter_object*)self;
+
+	struct sorted_window_items w = {0};
+	libetrace_nfsdb_opens_iter_collect(__self,&w);
+	return libetrace_nfsdb_sorted_window(__self->nfsdb_object,&w,args,kwargs,1);
+}
+
+PyObject* libetrace_nfsdb_opens_iter_count(PyObject *self, PyObject *args, PyObject* kwargs) {
+
+	libetrace_nfsdb_opens_iter_object* __self = (libetrace_nfsdb_opens_iter_object*)self;
+
+	struct sorted_window_items w = {0};
+	libetrace_nfsdb_opens_iter_collect(__self,&w);
+	return libetrace_nfsdb_count(__self->nfsdb_object,&w,args,kwargs,1);
+}
+
 void libetrace_nfsdb_filtered_opens_paths_iter_dealloc(libetrace_nfsdb_filtered_opens_paths_iter_object* self) {
 
 	if (self->cflts_size > 0) {
@@ -5318,7 +5780,7 @@ PyObject* libetrace_nfsdb_filtered_opens_paths_iter_new(PyTypeObject *subtype, P
 
 
 		/* Set the iterator to the first filtered opens path (if possible) */
-		self->filemap_node = rb_first(&self->nfsdb_object->nfsdb->filemap);
+		self->filemap_node = fileMap_first(&self->nfsdb_object->nfsdb->filemap);
 		while(self->filemap_node) {
 			struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)self->filemap_node;
 			if ((data->access_type!=FILE_ACCESS_TYPE_EXEC) && ((self->fast_filter ? libetrace_nfsdb_filtered_opens_paths_filter_once(self->nfsdb_object,data,self->fflts,self->fflts_size,1) : true) &&
@@ -5326,7 +5788,7 @@ PyObject* libetrace_nfsdb_filtered_opens_paths_iter_new(PyTypeObject *subtype, P
 				/* filter returned true */
 				break;
 			}
-			self->filemap_node = rb_next(self->filemap_node);
+			self->filemap_node = fileMap_next(&self->nfsdb_object->nfsdb->filemap,self->filemap_node);
 		}
 	}
 
@@ -5338,7 +5800,7 @@ Py_ssize_t libetrace_nfsdb_filtered_opens_paths_iter_sq_length(PyObject* self) {
 	libetrace_nfsdb_filtered_opens_paths_iter_object* __self = (libetrace_nfsdb_filtered_opens_paths_iter_object*)self;
 
 	unsigned long entry_count = 0;
-	struct rb_node * p = rb_first(&__self->nfsdb_object->nfsdb->filemap);
+	struct nfsdb_fileMap_node* p = fileMap_first(&__self->nfsdb_object->nfsdb->filemap);
 	while(p) {
 		struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)p;
 		if ((data->access_type!=FILE_ACCESS_TYPE_EXEC) && ((__self->fast_filter ? libetrace_nfsdb_filtered_opens_paths_filter_once(__self->nfsdb_object,data,__self->fflts,__self->fflts_size,1) : true) &&
@@ -5346,7 +5808,7 @@ Py_ssize_t libetrace_nfsdb_filtered_opens_paths_iter_sq_length(PyObject* self) {
 			/* filter returned true */
 			entry_count++;
 		}
-		p = rb_next(p);
+		p = fileMap_next(&__self->nfsdb_object->nfsdb->filemap,p);
 	}
 
 	return entry_count;
@@ -5368,7 +5830,7 @@ PyObject* libetrace_nfsdb_filtered_opens_paths_iter_next(PyObject *self) {
 	PyObject* s = PyUnicode_FromString(__self->nfsdb_object->nfsdb->string_table[data->key]);
     PyList_Append(paths,s);
     Py_DecRef(s);
-    __self->filemap_node = rb_next(__self->filemap_node);
+    __self->filemap_node = fileMap_next(&__self->nfsdb_object->nfsdb->filemap,__self->filemap_node);
 
 	/* Find more entries to fill the 'patch_size' paths */
 	while(__self->filemap_node) {
@@ -5385,7 +5847,7 @@ PyObject* libetrace_nfsdb_filtered_opens_paths_iter_next(PyObject *self) {
 				break;
 			}
 		}
-		__self->filemap_node = rb_next(__self->filemap_node);
+		__self->filemap_node = fileMap_next(&__self->nfsdb_object->nfsdb->filemap,__self->filemap_node);
 	}
 
 	if (__self->patch_size>1) {
@@ -5475,7 +5937,7 @@ PyObject* libetrace_nfsdb_filtered_opens_iter_new(PyTypeObject *subtype, PyObjec
 		self->path_index = 0;
 		/* Set the iterator to the first filtered open(if possible) */
 		if (pure_paths_filter_only(self->cflts,self->cflts_size,self->filter_count,self->fast_filter) && (!force_standard_filters)) {
-			self->filemap_node = rb_first(&self->nfsdb_object->nfsdb->filemap);
+			self->filemap_node = fileMap_first(&self->nfsdb_object->nfsdb->filemap);
 			while(self->filemap_node) {
 				struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)self->filemap_node;
 				if ((data->access_type!=FILE_ACCESS_TYPE_EXEC) && ((self->fast_filter ? libetrace_nfsdb_filtered_opens_paths_filter_once(self->nfsdb_object,data,self->fflts,self->fflts_size,1) : true) &&
@@ -5483,11 +5945,11 @@ PyObject* libetrace_nfsdb_filtered_opens_iter_new(PyTypeObject *subtype, PyObjec
 					/* filter returned true */
 					break;
 				}
-				self->filemap_node = rb_next(self->filemap_node);
+				self->filemap_node = fileMap_next(&self->nfsdb_object->nfsdb->filemap,self->filemap_node);
 			}
 		}
 		else {
-			self->filemap_node = rb_first(&self->nfsdb_object->nfsdb->filemap);
+			self->filemap_node = fileMap_first(&self->nfsdb_object->nfsdb->filemap);
 			while(self->filemap_node) {
 				struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)self->filemap_node;
 				for (self->path_index=0; self->path_index<data->ga_entry_count; ++self->path_index) {
@@ -5497,7 +5959,7 @@ PyObject* libetrace_nfsdb_filtered_opens_iter_new(PyTypeObject *subtype, PyObjec
 						goto done;
 					}
 				}
-				self->filemap_node = rb_next(self->filemap_node);
+				self->filemap_node = fileMap_next(&self->nfsdb_object->nfsdb->filemap,self->filemap_node);
 			}
 		}
 	}
@@ -5510,7 +5972,7 @@ Py_ssize_t libetrace_nfsdb_filtered_opens_iter_sq_length(PyObject* self) {
 	libetrace_nfsdb_filtered_opens_iter_object* __self = (libetrace_nfsdb_filtered_opens_iter_object*)self;
 
 	unsigned long entry_count = 0;
-	struct rb_node * p = rb_first(&__self->nfsdb_object->nfsdb->filemap);
+	struct nfsdb_fileMap_node* p = fileMap_first(&__self->nfsdb_object->nfsdb->filemap);
 	if (pure_paths_filter_only(__self->cflts,__self->cflts_size,__self->filter_count,__self->fast_filter)) {
 		while(p) {
 			struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)p;
@@ -5519,7 +5981,7 @@ Py_ssize_t libetrace_nfsdb_filtered_opens_iter_sq_length(PyObject* self) {
 				/* filter returned true */
 				entry_count+=data->ga_entry_count;
 			}
-			p = rb_next(p);
+			p = fileMap_next(&__self->nfsdb_object->nfsdb->filemap,p);
 		}
 	}
 	else {
@@ -5532,7 +5994,7 @@ Py_ssize_t libetrace_nfsdb_filtered_opens_iter_sq_length(PyObject* self) {
 					entry_count++;
 				}
 			}
-			p = rb_next(p);
+			p = fileMap_next(&__self->nfsdb_object->nfsdb->filemap,p);
 		}
 	}
 
@@ -5575,7 +6037,7 @@ PyObject* libetrace_nfsdb_filtered_opens_iter_next(PyObject *self) {
 			}
 			if (__self->path_index>=data->ga_entry_count) {
 				__self->path_index=0;
-			    __self->filemap_node = rb_next(__self->filemap_node);
+			    __self->filemap_node = fileMap_next(&__self->nfsdb_object->nfsdb->filemap,__self->filemap_node);
 			    while(__self->filemap_node) {
 					struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)__self->filemap_node;
 					if ((data->access_type!=FILE_ACCESS_TYPE_EXEC) && ((__self->fast_filter ? libetrace_nfsdb_filtered_opens_paths_filter_once(__self->nfsdb_object,data,__self->fflts,__self->fflts_size,1) : true) &&
@@ -5583,7 +6045,7 @@ PyObject* libetrace_nfsdb_filtered_opens_iter_next(PyObject *self) {
 						/* filter returned true */
 						break;
 					}
-					__self->filemap_node = rb_next(__self->filemap_node);
+					__self->filemap_node = fileMap_next(&__self->nfsdb_object->nfsdb->filemap,__self->filemap_node);
 				}
 			}
 			if (patch_count>=__self->patch_size) {
@@ -5615,7 +6077,7 @@ main_loop:
 					}
 				}
 			}
-			__self->filemap_node = rb_next(__self->filemap_node);
+			__self->filemap_node = fileMap_next(&__self->nfsdb_object->nfsdb->filemap,__self->filemap_node);
 			while(__self->filemap_node) {
 				struct nfsdb_fileMap_node* data = (struct nfsdb_fileMap_node*)__self->filemap_node;
 				for (__self->path_index=0; __self->path_index<data->ga_entry_count; ++__self->path_index) {
@@ -5628,7 +6090,7 @@ main_loop:
 						goto main_loop;
 					}
 				}
-				__self->filemap_node = rb_next(__self->filemap_node);
+				__self->filemap_node = fileMap_next(&__self->nfsdb_object->nfsdb->filemap,__self->filemap_node);
 			}
 		}
 	}
@@ -5645,6 +6107,60 @@ done:
 	}
 }
 
+static void libetrace_nfsdb_filtered_opens_iter_collect(libetrace_nfsdb_filtered_opens_iter_object* __self, struct sorted_window_items* w) {
+
+	/* __self->filemap_node and __self->path_index are pointing to the next filtered open (if any) */
+	struct nfsdb_fileMap_node* node = __self->filemap_node;
+	unsigned long path_index = __self->path_index;
+	if (pure_paths_filter_only(__self->cflts,__self->cflts_size,__self->filter_count,__self->fast_filter)) {
+		while(node) {
+			for (; path_index<node->ga_entry_count; ++path_index) {
+				sorted_window_items_append(w,node->ga_entry_list[path_index]->nfsdb_index,node->ga_entry_index[path_index]);
+			}
+			path_index = 0;
+			node = fileMap_next(&__self->nfsdb_object->nfsdb->filemap,node);
+			while(node) {
+				if ((node->access_type!=FILE_ACCESS_TYPE_EXEC) && ((__self->fast_filter ? libetrace_nfsdb_filtered_opens_paths_filter_once(__self->nfsdb_object,node,__self->fflts,__self->fflts_size,1) : true) &&
+					((__self->cflts_size > 0) ? libetrace_nfsdb_filtered_opens_paths_filter_once(__self->nfsdb_object,node,__self->cflts,__self->cflts_size,__self->filter_count) : true))) {
+					/* filter returned true */
+					break;
+				}
+				node = fileMap_next(&__self->nfsdb_object->nfsdb->filemap,node);
+			}
+		}
+	}
+	else {
+		for (; node; node = fileMap_next(&__self->nfsdb_object->nfsdb->filemap,node)) {
+			for (; path_index<node->ga_entry_count; ++path_index) {
+				if ((__self->fast_filter ? libetrace_nfsdb_filtered_opens_filter_once(__self->nfsdb_object,node,path_index,__self->fflts,__self->fflts_size,1) : true) &&
+					((__self->cflts_size > 0) ? libetrace_nfsdb_filtered_opens_filter_once(__self->nfsdb_object,node,path_index,__self->cflts,__self->cflts_size,__self->filter_count) : true)) {
+					/* filter returned true */
+					sorted_window_items_append(w,node->ga_entry_list[path_index]->nfsdb_index,node->ga_entry_index[path_index]);
+				}
+			}
+			path_index = 0;
+		}
+	}
+}
+
+PyObject* libetrace_nfsdb_filtered_opens_iter_sorted_window(PyObject *self, PyObject *args, PyObject* kwargs) {
+
+	libetrace_nfsdb_filtered_opens_iter_object* __self = (libetrace_nfsdb_filtered_opens_iter_object*)self;
+
+	struct sorted_window_items w = {0};
+	libetrace_nfsdb_filtered_opens_iter_collect(__self,&w);
+	return libetrace_nfsdb_sorted_window(__self->nfsdb_object,&w,args,kwargs,1);
+}
+
+PyObject* libetrace_nfsdb_filtered_opens_iter_count(PyObject *self, PyObject *args, PyObject* kwargs) {
+
+	libetrace_nfsdb_filtered_opens_iter_object* __self = (libetrace_nfsdb_filtered_opens_iter_object*)self;
+
+	struct sorted_window_items w = {0};
+	libetrace_nfsdb_filtered_opens_iter_collect(__self,&w);
+	return libetrace_nfsdb_count(__self->nfsdb_object,&w,args,kwargs,1);
+}
+
 void libetrace_nfsdb_filtered_commands_iter_dealloc(libetrace_nfsdb_filtered_commands_iter_object* self) {
 
 	if (self->cflts_size > 0) {
@@ -5789,6 +6305,36 @@ PyObject* libetrace_nfsdb_filtered_commands_iter_next(PyObject *self) {
 	}
 }
 
+static void libetrace_nfsdb_filtered_commands_iter_collect(libetrace_nfsdb_filtered_commands_iter_object* __self, struct sorted_window_items* w) {
+
+	for (unsigned long i=__self->command_index; i<__self->nfsdb_object->nfsdb->nfsdb_count; ++i) {
+		struct nfsdb_entry* entry = &__self->nfsdb_object->nfsdb->nfsdb_entry[i];
+		if ((__self->fast_filter ? libetrace_nfsdb_filtered_commands_filter_once(__self->nfsdb_object,entry,__self->fflts,__self->fflts_size,1): true) &&
+			(__self->cflts_size > 0 ? libetrace_nfsdb_filtered_commands_filter_once(__self->nfsdb_object,entry,__self->cflts,__self->cflts_size,__self->filter_count): true)) {
+			/* filter returned true */
+			sorted_window_items_append(w,i,0);
+		}
+	}
+}
+
+PyObject* libetrace_nfsdb_filtered_commands_iter_sorted_window(PyObject *self, PyObject *args, PyObject* kwargs) {
+
+	libetrace_nfsdb_filtered_commands_iter_object* __self = (libetrace_nfsdb_filtered_commands_iter_object*)self;
+
+	struct sorted_window_items w = {0};
+	libetrace_nfsdb_filtered_commands_iter_collect(__self,&w);
+	return libetrace_nfsdb_sorted_window(__self->nfsdb_object,&w,args,kwargs,0);
+}
+
+PyObject* libetrace_nfsdb_filtered_commands_iter_count(PyObject *self, PyObject *args, PyObject* kwargs) {
+
+	libetrace_nfsdb_filtered_commands_iter_object* __self = (libetrace_nfsdb_filtered_commands_iter_object*)self;
+
+	struct sorted_window_items w = {0};
+	libetrace_nfsdb_filtered_commands_iter_collect(__self,&w);
+	return libetrace_nfsdb_count(__self->nfsdb_object,&w,args,kwargs,0);
+}
+
 void libetrace_nfsdb_entry_eid_dealloc(libetrace_nfsdb_entry_eid_object* self) {
 
 	PyTypeObject *tp = Py_TYPE(self);
@@ -5806,9 +6352,9 @@ PyObject* libetrace_nfsdb_entry_eid_new(PyTypeObject *subtype, PyObject *args, P
 
 	self = (libetrace_nfsdb_entry_eid_object*)subtype->tp_alloc(subtype, 0);
 	if (self != 0) {
-		self->pid = PyLong_AsLong(PyTuple_GetItem(args,0));
+		self->pid = PyLong_AsUnsignedLongMask(PyTuple_GetItem(args,0));
 		if (PyTuple_Size(args)>1) {
-			self->exeidx = PyLong_AsLong(PyTuple_GetItem(args,1));
+			self->exeidx = PyLong_AsUnsignedLongMask(PyTuple_GetItem(args,1));
 		}
 		else {
 			self->exeidx = ULONG_MAX;
@@ -6552,7 +7098,7 @@ static int libetrace_nfsdb_filemap_entry_retrieve(libetrace_nfsdb_filemap* self,
 	static char errmsg[ERRMSG_BUFFER_SIZE];
 
 	const char* fpath = PyString_get_c_str(path);
-	struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb_object->nfsdb->revstringmap, fpath);
+	struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb_object->nfsdb->revstringmap, fpath);
 	if (!srefnode) {
 		snprintf(errmsg,ERRMSG_BUFFER_SIZE,"Invalid path not present in the database [%s]",fpath);
 		PyErr_SetString(libetrace_nfsdbError, errmsg);
@@ -6581,7 +7127,7 @@ static int libetrace_nfsdb_filemap_entry_retrieve_with_filter(libetrace_nfsdb_fi
 	static char errmsg[ERRMSG_BUFFER_SIZE];
 
 	const char* fpath = PyString_get_c_str(path);
-	struct stringRefMap_node* srefnode = stringRefMap_search(&self->nfsdb_object->nfsdb->revstringmap, fpath);
+	struct stringHashMap_node* srefnode = stringHashMap_search(&self->nfsdb_object->nfsdb->revstringmap, fpath);
 	if (!srefnode) {
 		snprintf(errmsg,ERRMSG_BUFFER_SIZE,"Invalid path not present in the database [%s]",fpath);
 		PyErr_SetString(libetrace_nfsdbError, errmsg);
@@ -7369,6 +7915,14 @@ PyInit_libetrace(void)
 		return 0;
 	Py_XINCREF(&libetrace_nfsdbFilteredCommandsIterType);
 
+	if (PyType_Ready(&libetrace_nfsdbOpensFilterType) < 0)
+		return 0;
+	Py_XINCREF(&libetrace_nfsdbOpensFilterType);
+
+	if (PyType_Ready(&libetrace_nfsdbCommandsFilterType) < 0)
+		return 0;
+	Py_XINCREF(&libetrace_nfsdbCommandsFilterType);
+
     if (PyType_Ready(&libetrace_nfsdbEntryType) < 0)
 		return 0;
 	Py_XINCREF(&libetrace_nfsdbEntryType);
@@ -7428,6 +7982,16 @@ PyInit_libetrace(void)
 		return 0;
 	}
 
+	if (PyModule_AddObject(m, "nfsdbOpensFilter", (PyObject *)&libetrace_nfsdbOpensFilterType)<0) {
+		Py_DECREF(m);
+		return 0;
+	}
+
+	if (PyModule_AddObject(m, "nfsdbCommandsFilter", (PyObject *)&libetrace_nfsdbCommandsFilterType)<0) {
+		Py_DECREF(m);
+		return 0;
+	}
+
 	if (PyModule_AddObject(m, "nfsdbEntryCid", (PyObject *)&libetrace_nfsdbEntryCidType)<0) {
 		Py_DECREF(m);
 		return 0;
@@ -40,6 +40,7 @@ static const char* PyString_get_c_str(PyObject* s) {
 #include "utils.h"
 #include "nfsdb.h"
 #include "ftdb_entry.h"
+#include <prelink.h>
 
 #include <unflatten.hpp>
 
@@ -169,9 +170,46 @@ PyObject * libetrace_pytools_is_ELF_or_LLVM_BC_file(PyObject *self, PyObject *ar
 PyObject * libetrace_precompute_command_patterns(PyObject *self, PyObject *args, PyObject* kwargs);
 PyObject * libetrace_parse_compiler_triple_hash(PyObject *self, PyObject *args);
 PyObject * libetrace_create_nfsdb(PyObject *self, PyObject *args, PyObject* kwargs);
+PyObject * libetrace_create_nfsdb_from_json(PyObject *self, PyObject *args, PyObject* kwargs);
 
+const char* joinpath(const char* cwd, const char* path);
 unsigned long nfsdb_has_unique_keys(const struct nfsdb* nfsdb);
-int nfsdb_maps(struct nfsdb* nfsdb, int show_stats);
+int nfsdb_maps(struct nfsdb* nfsdb, int show_stats, size_t jobs);
+struct command_patterns;
+struct command_patterns* command_patterns_compile(const char** patterns, size_t count);
+void command_patterns_destroy(struct command_patterns* cp);
+void command_patterns_match_strings(const struct command_patterns* cp, const char** commands, size_t count,
+		unsigned char* bitmaps, size_t jobs);
+void command_patterns_match_nfsdb(const struct command_patterns* cp, const struct nfsdb* nfsdb,
+		unsigned long begin, unsigned long end, unsigned char* bitmaps, size_t jobs);
+enum {
+	SORTED_WINDOW_KEY_PATH,
+	SORTED_WINDOW_KEY_ORIGINAL_PATH,
+	SORTED_WINDOW_KEY_MODE,
+	SORTED_WINDOW_KEY_BIN,
+	SORTED_WINDOW_KEY_CWD,
+	SORTED_WINDOW_KEY_CMD,
+	SORTED_WINDOW_KEY_ARGV,
+	SORTED_WINDOW_KEY_PID,
+	SORTED_WINDOW_KEY_EXEC,
+};
+struct sorted_window_item {
+	unsigned long nfsdb_index;
+	unsigned long open_index;
+	unsigned long seq;
+};
+int sorted_window_key_parse(const char* name, int opens);
+void sorted_window_select(const struct nfsdb* nfsdb, struct sorted_window_item* items, size_t count,
+		int key, size_t stop, int reverse);
+size_t sorted_window_count_distinct(const struct nfsdb* nfsdb, struct sorted_window_item* items, size_t count, int key);
+void nfsdb_image_prepare(struct nfsdb* nfsdb, int show_stats, size_t jobs);
+int nfsdb_image_write(struct nfsdb* nfsdb, const char* dbfn, int verbose_mode, int debug_mode);
+int nfsdb_prelink(const char* image_path, const struct nfsdb* nfsdb);
+int nfsdb_deps_prelink(const char* image_path, const struct nfsdb_deps* nfsdb_deps);
+void nfsdb_deps_insert_module(const struct nfsdb* nfsdb, struct rb_root* map, struct rb_root* revmap,
+		unsigned long mhandle, unsigned long* values, unsigned long count);
+int nfsdb_deps_image_write(struct nfsdb_deps* nfsdb_deps, const char* dbfn, int verbose_mode, int debug_mode);
+void destroy_nfsdb_deps(struct nfsdb_deps* nfsdb_deps);
 int libetrace_nfsdb_entry_is_linking_internal(const struct nfsdb_entry * entry);
 int libetrace_nfsdb_entry_has_compilations_internal(const struct nfsdb_entry * entry);
 
@@ -196,6 +234,7 @@ static PyMethodDef libetrace_methods[] = {
 	{"precompute_command_patterns", (PyCFunction)libetrace_precompute_command_patterns, METH_VARARGS|METH_KEYWORDS,"Precompute command patterns for file dependency processing"},
 	{"parse_compiler_triple_hash", (PyCFunction)libetrace_parse_compiler_triple_hash, METH_VARARGS,"Parse compiler -### output for clang"},
 	{"create_nfsdb", (PyCFunction)libetrace_create_nfsdb, METH_VARARGS | METH_KEYWORDS,""},
+	{"create_nfsdb_from_json", (PyCFunction)libetrace_create_nfsdb_from_json, METH_VARARGS | METH_KEYWORDS,"Create the database image directly from the .nfsdb.json file"},
 	{"parse_nfsdb", (PyCFunction)libetrace_parse_nfsdb, METH_VARARGS,""},
     {NULL, NULL, 0, NULL}        /* Sentinel */
 };
@@ -220,6 +259,8 @@ typedef struct {
 
 	CUnflatten unflatten;
 	CUnflatten unflatten_deps;
+	const struct prelink_header* mapped;
+	const struct prelink_header* mapped_deps;
 
 	const struct nfsdb* nfsdb;
 	const struct nfsdb_deps* nfsdb_deps;
@@ -249,6 +290,8 @@ PyObject* libetrace_nfsdb_filtered_opens(libetrace_nfsdb_object *self, PyObject
 PyObject* libetrace_nfsdb_filtered_opens_iter(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs);
 PyObject* libetrace_nfsdb_filtered_execs(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs);
 PyObject* libetrace_nfsdb_filtered_execs_iter(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs);
+PyObject* libetrace_nfsdb_opens_filter(libetrace_nfsdb_object *self, PyObject *args);
+PyObject* libetrace_nfsdb_commands_filter(libetrace_nfsdb_object *self, PyObject *args);
 PyObject* libetrace_nfsdb_pcp_list(libetrace_nfsdb_object *self, PyObject *args);
 PyObject* libetrace_nfsdb_pid_list(libetrace_nfsdb_object *self, PyObject *args);
 PyObject* libetrace_nfsdb_bpath_list(libetrace_nfsdb_object *self, PyObject *args);
@@ -261,10 +304,13 @@ PyObject* libetrace_nfsdb_path_regular(libetrace_nfsdb_object *self, PyObject *a
 PyObject* libetrace_nfsdb_path_symlinked(libetrace_nfsdb_object *self, PyObject *args);
 PyObject* libetrace_nfsdb_symlink_paths(libetrace_nfsdb_object *self, PyObject *args);
 PyObject* libetrace_nfsdb_create_deps_cache(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs);
+PyObject* libetrace_nfsdb_create_deps_image(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs);
 PyObject* libetrace_nfsdb_precompute_command_patterns(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs);
 PyObject* libetrace_nfsdb_get_filemap(PyObject* self, void* closure);
 PyObject* libetrace_nfsdb_get_source_root(PyObject* self, void* closure);
 PyObject* libetrace_nfsdb_get_dbversion(PyObject* self, void* closure);
+PyObject* libetrace_nfsdb_get_mapped(PyObject* self, void* closure);
+PyObject* libetrace_nfsdb_get_deps_mapped(PyObject* self, void* closure);
 PyObject* libetrace_nfsdb_module_dependencies(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs);
 PyObject* libetrace_nfsdb_module_dependencies_count(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs);
 PyObject* libetrace_nfsdb_reverse_module_dependencies(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs);
@@ -277,6 +323,7 @@ int libetrace_nfsdb_entry_has_shared_argv(const struct nfsdb_entry * entry);
 extern "C" {
 #endif
 PyObject* libetrace_nfsdb_file_dependencies(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs);
+PyObject* libetrace_nfsdb_post_process_scan(libetrace_nfsdb_object *self, PyObject *args, PyObject* kwargs);
 int parser_main(int argc, char** argv);
 #ifdef __cplusplus
 }
@@ -296,6 +343,8 @@ static PyMethodDef libetrace_nfsdb_methods[] = {
 	{"filtered_opens_iter",(PyCFunction)libetrace_nfsdb_filtered_opens_iter,METH_VARARGS|METH_KEYWORDS,"Returns the iterator to the unique opened files across entire database filtered by a given set of filters"},
 	{"filtered_execs",(PyCFunction)libetrace_nfsdb_filtered_execs,METH_VARARGS|METH_KEYWORDS,"Returns the list of all executions across entire database filtered by a given set of filters"},
 	{"filtered_execs_iter",(PyCFunction)libetrace_nfsdb_filtered_execs_iter,METH_VARARGS|METH_KEYWORDS,"Returns the iterator to the all executions across entire database filtered by a given set of filters"},
+	{"opens_filter",(PyCFunction)libetrace_nfsdb_opens_filter,METH_VARARGS,"Returns the compiled filter of opened files (callable on a single opened file) for a given set of filters"},
+	{"commands_filter",(PyCFunction)libetrace_nfsdb_commands_filter,METH_VARARGS,"Returns the compiled filter of executions (callable on a single execution) for a given set of filters"},
 	{"pcp_list",(PyCFunction)libetrace_nfsdb_pcp_list,METH_VARARGS,"Returns the list of command patterns to be precomputed"},
 	{"pids",(PyCFunction)libetrace_nfsdb_pid_list,METH_VARARGS,"Returns the list of all unique pids in the database"},
 	{"linked_modules",(PyCFunction)libetrace_nfsdb_linked_modules,METH_VARARGS,"Returns the list of all linked modules present in the database"},
@@ -311,7 +360,9 @@ static PyMethodDef libetrace_nfsdb_methods[] = {
 	{"path_symlinked",(PyCFunction)libetrace_nfsdb_path_symlinked,METH_VARARGS,"Returns True if a given path was reached through a symbolic link (doesn't apply to executed binary paths)"},
 	{"symlink_paths",(PyCFunction)libetrace_nfsdb_symlink_paths,METH_VARARGS,"Returns list of original symlink paths for a given resolved path (doesn't apply to executed binary paths)"},
 	{"create_deps_cache", (PyCFunction)libetrace_nfsdb_create_deps_cache, METH_VARARGS | METH_KEYWORDS,""},
+	{"create_deps_image",(PyCFunction)libetrace_nfsdb_create_deps_image,METH_VARARGS|METH_KEYWORDS,"Computes direct and full dependencies of given modules in parallel and writes the dependency image"},
 	{"precompute_command_patterns",(PyCFunction)libetrace_nfsdb_precompute_command_patterns, METH_VARARGS|METH_KEYWORDS,"Precompute command patterns for file dependency processing"},
+	{"post_process_scan",(PyCFunction)libetrace_nfsdb_post_process_scan,METH_VARARGS|METH_KEYWORDS,"Extracts linked module and compilation candidates for the database post processing"},
 	{"filemap_has_path",(PyCFunction)libetrace_nfsdb_filemap_has_path,METH_VARARGS,"Returns True if a given opened path exists in the database"}, /* TODO: write 'in' operator */
 	{NULL, NULL, 0, NULL}        /* Sentinel */
 };
@@ -320,6 +371,8 @@ static PyGetSetDef libetrace_nfsdb_getset[] = {
 	{"filemap",libetrace_nfsdb_get_filemap,0,"nfsdb filemap object (maps a path to the corresponding openfile entry (or the nfsdb entry where the file was opened)",0},
 	{"source_root",libetrace_nfsdb_get_source_root,0,"nfsdb database source root",0},
 	{"dbversion",libetrace_nfsdb_get_dbversion,0,"nfsdb database version string",0},
+	{"mapped",libetrace_nfsdb_get_mapped,0,"True when the database image is mapped from its prelinked copy (False when it was unflattened)",0},
+	{"deps_mapped",libetrace_nfsdb_get_deps_mapped,0,"True when the dependency image is mapped from its prelinked copy (False when it was unflattened)",0},
 	{"thread_count", libetrace_nfsdb_thread_count, 0, "Returns the total number of threads in the database", 0},
 	{"threads", libetrace_nfsdb_threads, 0, "Set with all threads used in the database"},
 	{0,0,0,0,0},
@@ -527,6 +580,14 @@ void libetrace_nfsdb_iter_dealloc(libetrace_nfsdb_iter_object* self);
 PyObject* libetrace_nfsdb_iter_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds);
 Py_ssize_t libetrace_nfsdb_iter_sq_length(PyObject* self);
 PyObject* libetrace_nfsdb_iter_next(PyObject *self);
+PyObject* libetrace_nfsdb_iter_sorted_window(PyObject *self, PyObject *args, PyObject* kwargs);
+PyObject* libetrace_nfsdb_iter_count(PyObject *self, PyObject *args, PyObject* kwargs);
+
+static PyMethodDef libetrace_nfsdbIter_methods[] = {
+	{"sorted_window",(PyCFunction)libetrace_nfsdb_iter_sorted_window,METH_VARARGS|METH_KEYWORDS,"Returns the items in the [start,stop) window of the remaining items sorted by a given key"},
+	{"count",(PyCFunction)libetrace_nfsdb_iter_count,METH_VARARGS|METH_KEYWORDS,"Returns the number of the remaining items (or their distinct values of a given sorting key) without creating the items"},
+	{NULL,NULL,0,NULL} /* Sentinel */
+};
 
 static PySequenceMethods libetrace_nfsdbIter_sequence_methods = {
 		.sq_length = libetrace_nfsdb_iter_sq_length,
@@ -541,6 +602,7 @@ static PyTypeObject libetrace_nfsdbIterType = {
 	.tp_doc = "libetrace nfsdb iterator",
 	.tp_iter = PyObject_SelfIter,
 	.tp_iternext = libetrace_nfsdb_iter_next,
+	.tp_methods = libetrace_nfsdbIter_methods,
 	.tp_new = libetrace_nfsdb_iter_new,
 };
 
@@ -557,6 +619,14 @@ void libetrace_nfsdb_opens_iter_dealloc(libetrace_nfsdb_opens_iter_object* self)
 PyObject* libetrace_nfsdb_opens_iter_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds);
 Py_ssize_t libetrace_nfsdb_opens_iter_sq_length(PyObject* self);
 PyObject* libetrace_nfsdb_opens_iter_next(PyObject *self);
+PyObject* libetrace_nfsdb_opens_iter_sorted_window(PyObject *self, PyObject *args, PyObject* kwargs);
+PyObject* libetrace_nfsdb_opens_iter_count(PyObject *self, PyObject *args, PyObject* kwargs);
+
+static PyMethodDef libetrace_nfsdbOpensIter_methods[] = {
+	{"sorted_window",(PyCFunction)libetrace_nfsdb_opens_iter_sorted_window,METH_VARARGS|METH_KEYWORDS,"Returns the items in the [start,stop) window of the remaining items sorted by a given key"},
+	{"count",(PyCFunction)libetrace_nfsdb_opens_iter_count,METH_VARARGS|METH_KEYWORDS,"Returns the number of the remaining items (or their distinct values of a given sorting key) without creating the items"},
+	{NULL,NULL,0,NULL} /* Sentinel */
+};
 
 static PySequenceMethods libetrace_nfsdbOpensIter_sequence_methods = {
 		.sq_length = libetrace_nfsdb_opens_iter_sq_length,
@@ -571,6 +641,7 @@ static PyTypeObject libetrace_nfsdbOpensIterType = {
 	.tp_doc = "libetrace nfsdb openfile iterator",
 	.tp_iter = PyObject_SelfIter,
 	.tp_iternext = libetrace_nfsdb_opens_iter_next,
+	.tp_methods = libetrace_nfsdbOpensIter_methods,
 	.tp_new = libetrace_nfsdb_opens_iter_new,
 };
 
@@ -584,7 +655,7 @@ typedef struct {
 	size_t fflts_size[1];
     struct file_filter* fast_filter;
 	Py_ssize_t filter_count;
-    struct rb_node* filemap_node;
+    struct nfsdb_fileMap_node* filemap_node;
 } libetrace_nfsdb_filtered_opens_paths_iter_object;
 
 void libetrace_nfsdb_filtered_opens_paths_iter_dealloc(libetrace_nfsdb_filtered_opens_paths_iter_object* self);
@@ -619,13 +690,21 @@ typedef struct {
 	size_t fflts_size[1];
     struct file_filter* fast_filter;
 	Py_ssize_t filter_count;
-    struct rb_node* filemap_node;
+    struct nfsdb_fileMap_node* filemap_node;
 } libetrace_nfsdb_filtered_opens_iter_object;
 
 void libetrace_nfsdb_filtered_opens_iter_dealloc(libetrace_nfsdb_filtered_opens_iter_object* self);
 PyObject* libetrace_nfsdb_filtered_opens_iter_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds);
 Py_ssize_t libetrace_nfsdb_filtered_opens_iter_sq_length(PyObject* self);
 PyObject* libetrace_nfsdb_filtered_opens_iter_next(PyObject *self);
+PyObject* libetrace_nfsdb_filtered_opens_iter_sorted_window(PyObject *self, PyObject *args, PyObject* kwargs);
+PyObject* libetrace_nfsdb_filtered_opens_iter_count(PyObject *self, PyObject *args, PyObject* kwargs);
+
+static PyMethodDef libetrace_nfsdbFilteredOpensIter_methods[] = {
+	{"sorted_window",(PyCFunction)libetrace_nfsdb_filtered_opens_iter_sorted_window,METH_VARARGS|METH_KEYWORDS,"Returns the items in the [start,stop) window of the remaining items sorted by a given key"},
+	{"count",(PyCFunction)libetrace_nfsdb_filtered_opens_iter_count,METH_VARARGS|METH_KEYWORDS,"Returns the number of the remaining items (or their distinct values of a given sorting key) without creating the items"},
+	{NULL,NULL,0,NULL} /* Sentinel */
+};
 
 static PySequenceMethods libetrace_nfsdbFilteredOpensIter_sequence_methods = {
 	.sq_length = libetrace_nfsdb_filtered_opens_iter_sq_length,
@@ -640,6 +719,7 @@ static PyTypeObject libetrace_nfsdbFilteredOpensIterType = {
 	.tp_doc = "libetrace nfsdb filtered opens iterator",
 	.tp_iter = PyObject_SelfIter,
 	.tp_iternext = libetrace_nfsdb_filtered_opens_iter_next,
+	.tp_methods = libetrace_nfsdbFilteredOpensIter_methods,
 	.tp_new = libetrace_nfsdb_filtered_opens_iter_new,
 };
 
@@ -660,6 +740,14 @@ void libetrace_nfsdb_filtered_commands_iter_dealloc(libetrace_nfsdb_filtered_com
 PyObject* libetrace_nfsdb_filtered_commands_iter_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds);
 Py_ssize_t libetrace_nfsdb_filtered_commands_iter_sq_length(PyObject* self);
 PyObject* libetrace_nfsdb_filtered_commands_iter_next(PyObject *self);
+PyObject* libetrace_nfsdb_filtered_commands_iter_sorted_window(PyObject *self, PyObject *args, PyObject* kwargs);
+PyObject* libetrace_nfsdb_filtered_commands_iter_count(PyObject *self, PyObject *args, PyObject* kwargs);
+
+static PyMethodDef libetrace_nfsdbFilteredCommandsIter_methods[] = {
+	{"sorted_window",(PyCFunction)libetrace_nfsdb_filtered_commands_iter_sorted_window,METH_VARARGS|METH_KEYWORDS,"Returns the items in the [start,stop) window of the remaining items sorted by a given key"},
+	{"count",(PyCFunction)libetrace_nfsdb_filtered_commands_iter_count,METH_VARARGS|METH_KEYWORDS,"Returns the number of the remaining items (or their distinct values of a given sorting key) without creating the items"},
+	{NULL,NULL,0,NULL} /* Sentinel */
+};
 
 static PySequenceMethods libetrace_nfsdbFilteredCommandsIter_sequence_methods = {
 	.sq_length = libetrace_nfsdb_filtered_commands_iter_sq_length,
@@ -674,9 +762,68 @@ static PyTypeObject libetrace_nfsdbFilteredCommandsIterType = {
 	.tp_doc = "libetrace nfsdb filtered commands iterator",
 	.tp_iter = PyObject_SelfIter,
 	.tp_iternext = libetrace_nfsdb_filtered_commands_iter_next,
+	.tp_methods = libetrace_nfsdbFilteredCommandsIter_methods,
 	.tp_new = libetrace_nfsdb_filtered_commands_iter_new,
 };
 
+typedef struct {
+    PyObject_HEAD
+    libetrace_nfsdb_object* nfsdb_object;
+    struct file_filter** cflts;
+    size_t* cflts_size;
+	Py_ssize_t filter_count;
+} libetrace_nfsdb_opens_filter_object;
+
+void libetrace_nfsdb_opens_filter_dealloc(libetrace_nfsdb_opens_filter_object* self);
+PyObject* libetrace_nfsdb_opens_filter_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds);
+PyObject* libetrace_nfsdb_opens_filter_call(PyObject *self, PyObject *args, PyObject* kwargs);
+PyObject* libetrace_nfsdb_opens_filter_filter(PyObject *self, PyObject *args);
+
+static PyMethodDef libetrace_nfsdbOpensFilter_methods[] = {
+	{"filter",(PyCFunction)libetrace_nfsdb_opens_filter_filter,METH_VARARGS,"Returns the list of the opened files from a given iterable that match the filter"},
+	{NULL,NULL,0,NULL} /* Sentinel */
+};
+
+static PyTypeObject libetrace_nfsdbOpensFilterType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "libetrace.nfsdbOpensFilter",
+	.tp_basicsize = sizeof(libetrace_nfsdb_opens_filter_object),
+	.tp_dealloc = (destructor)libetrace_nfsdb_opens_filter_dealloc,
+	.tp_call = libetrace_nfsdb_opens_filter_call,
+	.tp_doc = "libetrace nfsdb compiled opened files filter",
+	.tp_methods = libetrace_nfsdbOpensFilter_methods,
+	.tp_new = libetrace_nfsdb_opens_filter_new,
+};
+
+typedef struct {
+    PyObject_HEAD
+    libetrace_nfsdb_object* nfsdb_object;
+    struct command_filter** cflts;
+    size_t* cflts_size;
+	Py_ssize_t filter_count;
+} libetrace_nfsdb_commands_filter_object;
+
+void libetrace_nfsdb_commands_filter_dealloc(libetrace_nfsdb_commands_filter_object* self);
+PyObject* libetrace_nfsdb_commands_filter_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds);
+PyObject* libetrace_nfsdb_commands_filter_call(PyObject *self, PyObject *args, PyObject* kwargs);
+PyObject* libetrace_nfsdb_commands_filter_filter(PyObject *self, PyObject *args);
+
+static PyMethodDef libetrace_nfsdbCommandsFilter_methods[] = {
+	{"filter",(PyCFunction)libetrace_nfsdb_commands_filter_filter,METH_VARARGS,"Returns the list of the executions from a given iterable that match the filter"},
+	{NULL,NULL,0,NULL} /* Sentinel */
+};
+
+static PyTypeObject libetrace_nfsdbCommandsFilterType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "libetrace.nfsdbCommandsFilter",
+	.tp_basicsize = sizeof(libetrace_nfsdb_commands_filter_object),
+	.tp_dealloc = (destructor)libetrace_nfsdb_commands_filter_dealloc,
+	.tp_call = libetrace_nfsdb_commands_filter_call,
+	.tp_doc = "libetrace nfsdb compiled executions filter",
+	.tp_methods = libetrace_nfsdbCommandsFilter_methods,
+	.tp_new = libetrace_nfsdb_commands_filter_new,
+};
+
 typedef struct {
     PyObject_HEAD
 	unsigned long pid;
@@ -0,0 +1,130 @@
+/*
+ * Flatten recipes of the nfsdb and nfsdb_deps images.
+ * Also expanded with the prelink definitions of the recipe macros (see prelink.h)
+ */
+
+FUNCTION_DEFINE_FLATTEN_STRUCT(eid);
+FUNCTION_DEFINE_FLATTEN_STRUCT(cid);
+FUNCTION_DEFINE_FLATTEN_STRUCT(pp_def);
+FUNCTION_DEFINE_FLATTEN_STRUCT(cputime);
+FUNCTION_DEFINE_FLATTEN_STRUCT(nfsdb_entry_file_index);
+
+FUNCTION_DECLARE_FLATTEN_STRUCT(nfsdb_entry);
+
+FUNCTION_DEFINE_FLATTEN_STRUCT(openfile,
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,original_path,1);
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entry,opaque_entry,1);
+);
+
+FUNCTION_DEFINE_FLATTEN_STRUCT(compilation_info,
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,compiled_list,ATTR(compiled_count));
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entry_file_index,compiled_index,ATTR(compiled_count));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,include_paths,ATTR(include_paths_count));
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(pp_def,pp_defs,ATTR(pp_defs_count));
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(pp_def,pp_udefs,ATTR(pp_udefs_count));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,header_list,ATTR(header_list_count));
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entry_file_index,header_index,ATTR(header_list_count));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,object_list,ATTR(object_list_count));
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entry_file_index,object_index,ATTR(object_list_count));
+);
+
+FUNCTION_DEFINE_FLATTEN_STRUCT(nfsdb_entry,
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(cid,child_ids,ATTR(child_ids_count));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,argv,ATTR(argv_count));
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(openfile,open_files,ATTR(open_files_count));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned char,pcp,ATTR(pcp_count));
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(eid,pipe_eids,ATTR(pipe_eids_count));
+	AGGREGATE_FLATTEN_STRUCT(compilation_info,compilation_info);
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,linked_file,1);
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(cputime,cpu,ATTR(cpu_count));
+);
+
+FUNCTION_DECLARE_FLATTEN_STRUCT(nfsdb_entryMap_node);
+
+FUNCTION_DEFINE_FLATTEN_STRUCT(nfsdb_entryMap_node,
+	AGGREGATE_FLATTEN_TYPE_ARRAY(struct nfsdb_entry*,entry_list,ATTR(entry_count));
+	FOREACH_POINTER(struct nfsdb_entry*,entry,ATTR(entry_list),ATTR(entry_count),
+		FLATTEN_STRUCT(nfsdb_entry,entry);
+	);
+);
+
+FUNCTION_DECLARE_FLATTEN_STRUCT(ulongMap_node);
+
+
+FUNCTION_DEFINE_FLATTEN_STRUCT(ulongMap_node,
+	STRUCT_ALIGN(4);
+	AGGREGATE_FLATTEN_STRUCT_EMBEDDED_POINTER(ulongMap_node,node.__rb_parent_color,
+			ptr_clear_2lsb_bits,flatten_ptr_restore_2lsb_bits);
+	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,node.rb_right);
+	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,node.rb_left);
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,value_list,ATTR(value_count));
+);
+
+FUNCTION_DECLARE_FLATTEN_STRUCT(stringHashMap_node);
+
+FUNCTION_DEFINE_FLATTEN_STRUCT(stringHashMap_node,
+	AGGREGATE_FLATTEN_STRING(key);
+);
+
+FUNCTION_DECLARE_FLATTEN_STRUCT(nfsdb_fileMap_node);
+
+
+FUNCTION_DEFINE_FLATTEN_STRUCT(nfsdb_fileMap_node,
+	AGGREGATE_FLATTEN_TYPE_ARRAY(struct nfsdb_entry*,rd_entry_list,ATTR(rd_entry_count));
+	FOREACH_POINTER(struct nfsdb_entry*,entry,ATTR(rd_entry_list),ATTR(rd_entry_count),
+		FLATTEN_STRUCT(nfsdb_entry,entry);
+	);
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,rd_entry_index,ATTR(rd_entry_count));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(struct nfsdb_entry*,wr_entry_list,ATTR(wr_entry_count));
+	FOREACH_POINTER(struct nfsdb_entry*,entry,ATTR(wr_entry_list),ATTR(wr_entry_count),
+		FLATTEN_STRUCT(nfsdb_entry,entry);
+	);
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,wr_entry_index,ATTR(wr_entry_count));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(struct nfsdb_entry*,rw_entry_list,ATTR(rw_entry_count));
+	FOREACH_POINTER(struct nfsdb_entry*,entry,ATTR(rw_entry_list),ATTR(rw_entry_count),
+		FLATTEN_STRUCT(nfsdb_entry,entry);
+	);
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,rw_entry_index,ATTR(rw_entry_count));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(struct nfsdb_entry*,ga_entry_list,ATTR(ga_entry_count));
+	FOREACH_POINTER(struct nfsdb_entry*,entry,ATTR(ga_entry_list),ATTR(ga_entry_count),
+		FLATTEN_STRUCT(nfsdb_entry,entry);
+	);
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,ga_entry_index,ATTR(ga_entry_count));
+);
+
+FUNCTION_DEFINE_FLATTEN_STRUCT(nfsdb,
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entry,nfsdb_entry,ATTR(nfsdb_count));
+	AGGREGATE_FLATTEN_STRING(source_root);
+	AGGREGATE_FLATTEN_STRING(dbversion);
+	AGGREGATE_FLATTEN_TYPE_ARRAY(const char*,string_table,ATTR(string_count));
+	FOREACH_POINTER(const char*,s,ATTR(string_table),ATTR(string_count),
+		FLATTEN_STRING(s);
+	);
+	AGGREGATE_FLATTEN_TYPE_ARRAY(uint32_t,string_size_table,ATTR(string_count));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(const char*,pcp_pattern_list,ATTR(pcp_pattern_list_size));
+	FOREACH_POINTER(const char*,s,ATTR(pcp_pattern_list),ATTR(pcp_pattern_list_size),
+		FLATTEN_STRING(s);
+	);
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,procmap.keys,ATTR(procmap.count));
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entryMap_node,procmap.nodes,ATTR(procmap.count));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,bmap.keys,ATTR(bmap.count));
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entryMap_node,bmap.nodes,ATTR(bmap.count));
+	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,forkmap.rb_node);
+	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,revforkmap.rb_node);
+	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,pipemap.rb_node);
+	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,wrmap.rb_node);
+	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,rdmap.rb_node);
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(stringHashMap_node,revstringmap.nodes,ATTR(revstringmap.size));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,filemap.keys,ATTR(filemap.count));
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_fileMap_node,filemap.nodes,ATTR(filemap.count));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,linkedmap.keys,ATTR(linkedmap.count));
+	AGGREGATE_FLATTEN_STRUCT_ARRAY(nfsdb_entryMap_node,linkedmap.nodes,ATTR(linkedmap.count));
+	AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,threads,ATTR(threads_count));
+);
+
+FUNCTION_DEFINE_FLATTEN_STRUCT(nfsdb_deps,
+	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,depmap.rb_node);
+	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,ddepmap.rb_node);
+	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,revdepmap.rb_node);
+	AGGREGATE_FLATTEN_STRUCT(ulongMap_node,revddepmap.rb_node);
+);
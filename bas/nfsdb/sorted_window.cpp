@@ -0,0 +1,135 @@
+extern "C" {
+#include "pyetrace.h"
+}
+#include <algorithm>
+#include <string.h>
+
+/*
+ * Sorted windows of the opens and execs iterators.
+ *
+ * The iterators collect the handles of all their remaining items and only the first 'stop' handles are put
+ * in order with a partial sort (O(n log k)), so Python objects are created for the requested window alone.
+ * Items with equal keys keep the iteration order (in both directions) just like the Python sorted() does.
+ * The same keys are used to count the distinct values of the items for the count-only queries.
+ */
+
+struct sorted_window_key_name {
+	const char* name;
+	int key;
+	int opens;
+};
+
+static const struct sorted_window_key_name sorted_window_keys[] = {
+	{"path",SORTED_WINDOW_KEY_PATH,1},
+	{"original_path",SORTED_WINDOW_KEY_ORIGINAL_PATH,1},
+	{"mode",SORTED_WINDOW_KEY_MODE,1},
+	{"bin",SORTED_WINDOW_KEY_BIN,0},
+	{"cwd",SORTED_WINDOW_KEY_CWD,0},
+	{"cmd",SORTED_WINDOW_KEY_CMD,0},
+	{"argv",SORTED_WINDOW_KEY_ARGV,0},
+	{"pid",SORTED_WINDOW_KEY_PID,0},
+	{"exec",SORTED_WINDOW_KEY_EXEC,1},
+};
+
+int sorted_window_key_parse(const char* name, int opens) {
+
+	for (auto& k : sorted_window_keys) {
+		if ((k.opens==opens) && !strcmp(k.name,name)) {
+			return k.key;
+		}
+	}
+	return -1;
+}
+
+static inline int ulong_cmp(unsigned long a, unsigned long b) {
+	return (a>b)-(a<b);
+}
+
+/* Compares the argument lists as strings joined with spaces */
+static int cmd_cmp(const struct nfsdb* nfsdb, const struct nfsdb_entry* a, const struct nfsdb_entry* b) {
+
+	unsigned long ia = 0, ib = 0;
+	const char* pa = a->argv_count?nfsdb->string_table[a->argv[0]]:"";
+	const char* pb = b->argv_count?nfsdb->string_table[b->argv[0]]:"";
+	for (;;) {
+		/* The end of an argument reads as the separating space unless it is the last one */
+		int ca = *pa?(unsigned char)*pa:((ia+1<a->argv_count)?' ':-1);
+		int cb = *pb?(unsigned char)*pb:((ib+1<b->argv_count)?' ':-1);
+		if (ca!=cb) return (ca>cb)-(ca<cb);
+		if (ca<0) return 0;
+		if (*pa) ++pa;
+		else pa = nfsdb->string_table[a->argv[++ia]];
+		if (*pb) ++pb;
+		else pb = nfsdb->string_table[b->argv[++ib]];
+	}
+}
+
+static int argv_cmp(const struct nfsdb* nfsdb, const struct nfsdb_entry* a, const struct nfsdb_entry* b) {
+
+	for (unsigned long u=0; (u<a->argv_count) && (u<b->argv_count); ++u) {
+		int r = strcmp(nfsdb->string_table[a->argv[u]],nfsdb->string_table[b->argv[u]]);
+		if (r) return r;
+	}
+	return ulong_cmp(a->argv_count,b->argv_count);
+}
+
+static int key_cmp(const struct nfsdb* nfsdb, int key, const struct sorted_window_item& a, const struct sorted_window_item& b) {
+
+	const struct nfsdb_entry* ea = &nfsdb->nfsdb_entry[a.nfsdb_index];
+	const struct nfsdb_entry* eb = &nfsdb->nfsdb_entry[b.nfsdb_index];
+	switch (key) {
+		case SORTED_WINDOW_KEY_PATH:
+			return strcmp(nfsdb->string_table[ea->open_files[a.open_index].path],
+					nfsdb->string_table[eb->open_files[b.open_index].path]);
+		case SORTED_WINDOW_KEY_ORIGINAL_PATH:
+		{
+			const struct openfile* oa = &ea->open_files[a.open_index];
+			const struct openfile* ob = &eb->open_files[b.open_index];
+			return strcmp(nfsdb->string_table[oa->original_path?*oa->original_path:oa->path],
+					nfsdb->string_table[ob->original_path?*ob->original_path:ob->path]);
+		}
+		case SORTED_WINDOW_KEY_MODE:
+			return ulong_cmp(ea->open_files[a.open_index].mode,eb->open_files[b.open_index].mode);
+		case SORTED_WINDOW_KEY_BIN:
+			return strcmp(nfsdb->string_table[ea->bpath],nfsdb->string_table[eb->bpath]);
+		case SORTED_WINDOW_KEY_CWD:
+			return strcmp(nfsdb->string_table[ea->cwd],nfsdb->string_table[eb->cwd]);
+		case SORTED_WINDOW_KEY_CMD:
+			return cmd_cmp(nfsdb,ea,eb);
+		case SORTED_WINDOW_KEY_ARGV:
+			return argv_cmp(nfsdb,ea,eb);
+		case SORTED_WINDOW_KEY_PID:
+			return ulong_cmp(ea->eid.pid,eb->eid.pid);
+		case SORTED_WINDOW_KEY_EXEC:
+			/* Opens of the same execution */
+			return ulong_cmp(a.nfsdb_index,b.nfsdb_index);
+	}
+	return 0;
+}
+
+void sorted_window_select(const struct nfsdb* nfsdb, struct sorted_window_item* items, size_t count,
+		int key, size_t stop, int reverse) {
+
+	for (size_t u=0; u<count; ++u) {
+		items[u].seq = u;
+	}
+	stop = std::min(stop,count);
+	std::partial_sort(items,items+stop,items+count,[&](const struct sorted_window_item& a, const struct sorted_window_item& b) {
+		/* strcmp() on UTF-8 strings gives the code point order of Python strings */
+		int r = key_cmp(nfsdb,key,a,b);
+		if (r) return reverse?(r>0):(r<0);
+		return a.seq<b.seq;
+	});
+}
+
+size_t sorted_window_count_distinct(const struct nfsdb* nfsdb, struct sorted_window_item* items, size_t count, int key) {
+
+	std::sort(items,items+count,[&](const struct sorted_window_item& a, const struct sorted_window_item& b) {
+		return key_cmp(nfsdb,key,a,b)<0;
+	});
+	size_t distinct = count?1:0;
+	for (size_t u=1; u<count; ++u) {
+		if (key_cmp(nfsdb,key,items[u-1],items[u])) distinct++;
+	}
+	return distinct;
+}
@@ -8,19 +8,31 @@
 #include <cstdlib>
 #include <cstring>
 #include <cerrno>
+#include <deque>
 #include <exception>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <fcntl.h>
+#include <getopt.h>
 #include <poll.h>
 #include <signal.h>
+#include <spawn.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+extern char** environ;
+
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 29)
+#define HAVE_SPAWN_ADDCHDIR
+#endif
+#endif
+
 
 #define __PACKED    __attribute__((packed))
 
@@ -46,6 +58,23 @@ struct resp_packet {
     char data[0];
 } __PACKED;
 
+/* Batch mode: every batch starts with the number of requests and each
+ *  request is preceded by its flags. Responses are sent in request order
+ */
+struct batch_packet {
+    unsigned int count;
+} __PACKED;
+struct batch_entry {
+    unsigned int flags;
+} __PACKED;
+
+// Result may be reused for identical requests (same cwd, input and arguments)
+#define BATCH_FLAG_CACHE    0x1
+
+// Values of resp_packet.internal_error
+#define INTERNAL_ERROR_FATAL    1
+#define INTERNAL_ERROR_REQUEST  2
+
 
 /* Helper exception class to handle both error message and
  *  errno message in one go
@@ -70,6 +99,27 @@ public:
 };
 
 
+/* Single request of a batch together with its result
+ */
+struct BatchRequest {
+    unsigned int flags;
+    std::vector<char> cwd, input;
+    std::vector<std::vector<char>> cmd;
+
+    std::vector<char> outputOut, outputErr;
+    int retCode;
+    unsigned short internalError;
+};
+
+/* Subprocess of a batch request that is still running
+ */
+struct RunningProcess {
+    pid_t pid;
+    int fdIn, fdOut, fdErr;
+    size_t inputOffset;
+    BatchRequest* request;
+};
+
 /* Main executor class responsible for handling pipes
  *  communication and process creation
  */
@@ -78,19 +128,34 @@ class ExecutionWorker {
     std::vector<char> cwd, outputOut, outputErr, input;
     std::vector<std::vector<char>> cmd;
 
+    // Batch mode state
+    unsigned int maxJobs;
+    size_t cacheLimit, cacheSize;
+    std::unordered_map<std::string, BatchRequest> cache;
+    std::deque<std::string> cacheOrder;
+
     void full_read(int fd, void* buffer, size_t len);
     void full_write(int fd, void* buffer, size_t len);
 
+    void readRequest(std::vector<char>& cwd, std::vector<char>& input, std::vector<std::vector<char>>& cmd);
     void recv(void);
     void send(bool sentError = false);
 
     void execute(void);
 
+    std::string requestKey(const BatchRequest& request);
+    void cacheResult(const std::string& key, const BatchRequest& request);
+    bool spawn(BatchRequest& request, RunningProcess& process);
+    void finish(RunningProcess& process);
+    void executeBatch(std::vector<BatchRequest*>& requests);
+
 public:
-    ExecutionWorker(int _readFD, int _writeFD) 
-        : readFD(_readFD), writeFD(_writeFD), retCode(-1) {};
+    ExecutionWorker(int _readFD, int _writeFD, unsigned int _maxJobs = 1, size_t _cacheLimit = 0)
+        : readFD(_readFD), writeFD(_writeFD), retCode(-1),
+          maxJobs(_maxJobs ? _maxJobs : 1), cacheLimit(_cacheLimit), cacheSize(0) {};
 
     void processSingleRequest(void);
+    void processBatchRequest(void);
     void sendError(const char* errorStr);
 };
 
@@ -120,7 +185,7 @@ void ExecutionWorker::full_write(int fd, void* buffer, size_t len) {
 }
 
 
-void ExecutionWorker::recv(void) {
+void ExecutionWorker::readRequest(std::vector<char>& cwd, std::vector<char>& input, std::vector<std::vector<char>>& cmd) {
     struct req_packet packet;
 
     full_read(readFD, &packet, sizeof(packet));
@@ -152,6 +217,10 @@ void ExecutionWorker::recv(void) {
     }
 }
 
+void ExecutionWorker::recv(void) {
+    readRequest(cwd, input, cmd);
+}
+
 void ExecutionWorker::send(bool sentError) {
     struct resp_packet packet;
 
@@ -339,23 +408,348 @@ void ExecutionWorker::sendError(const char* errorStr) {
 }
 
 
+/* Batch mode
+ *  Requests of a batch are executed with at most maxJobs subprocesses running at once. The worker
+ *  stays single threaded - all pipes of the running subprocesses are served from one poll loop.
+ *  Results of cacheable requests are kept (up to cacheLimit bytes, oldest dropped first) and
+ *  reused for identical requests within the batch and in the following batches.
+ */
+std::string ExecutionWorker::requestKey(const BatchRequest& request) {
+    std::string key;
+    auto append = [&key](const char* data, size_t size) {
+        key.append((const char*)&size, sizeof(size));
+        key.append(data, size);
+    };
+
+    append(request.cwd.data(), strlen(request.cwd.data()));
+    append(request.input.data(), request.input.size());
+    for(auto& arg : request.cmd)
+        append(arg.data(), arg.size() - 1);
+    return key;
+}
+
+void ExecutionWorker::cacheResult(const std::string& key, const BatchRequest& request) {
+    size_t size = key.size() + request.outputOut.size() + request.outputErr.size();
+    if(size > cacheLimit || cache.count(key))
+        return;
+
+    while(cacheSize + size > cacheLimit) {
+        auto it = cache.find(cacheOrder.front());
+        cacheSize -= it->first.size() + it->second.outputOut.size() + it->second.outputErr.size();
+        cache.erase(it);
+        cacheOrder.pop_front();
+    }
+
+    BatchRequest& entry = cache[key];
+    entry.outputOut = request.outputOut;
+    entry.outputErr = request.outputErr;
+    entry.retCode = request.retCode;
+    entry.internalError = 0;
+    cacheOrder.push_back(key);
+    cacheSize += size;
+}
+
+bool ExecutionWorker::spawn(BatchRequest& request, RunningProcess& process) {
+    int fdOut[2], fdErr[2], fdRead[2];
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    const char* failure = nullptr;
+    int ret = 0;
+
+    request.outputOut.clear();
+    request.outputErr.clear();
+    request.retCode = -1;
+    request.internalError = 0;
+
+    // Pipe ends are not inherited by the other subprocesses of the batch
+    if(pipe2(fdOut, O_CLOEXEC) < 0)
+        throw ExecutionWorkerException("cannot create output pipe to subprocess", true);
+    if(pipe2(fdErr, O_CLOEXEC) < 0)
+        throw ExecutionWorkerException("cannot create error pipe to subprocess", true);
+    if(pipe2(fdRead, O_CLOEXEC) < 0)
+        throw ExecutionWorkerException("cannot create input pipe to subprocess", true);
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fdRead[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fdOut[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, fdErr[1], STDERR_FILENO);
+
+    // The worker ignores SIGPIPE in batch mode; the subprocesses get the default disposition back
+    sigset_t defaultSignals;
+    sigemptyset(&defaultSignals);
+    sigaddset(&defaultSignals, SIGPIPE);
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigdefault(&attr, &defaultSignals);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+    bool changeDir = request.cwd.size() > 0 && request.cwd[0] != '\0';
+#ifdef HAVE_SPAWN_ADDCHDIR
+    if(changeDir)
+        posix_spawn_file_actions_addchdir_np(&actions, request.cwd.data());
+#else
+    // No other thread can observe the temporary working directory of the worker
+    int oldCwd = -1;
+    if(changeDir) {
+        oldCwd = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if(oldCwd < 0)
+            throw ExecutionWorkerException("cannot open current directory", true);
+        if(chdir(request.cwd.data())) {
+            ret = errno;
+            failure = "cannot change children directory";
+        }
+    }
+#endif
+
+    std::vector<char*> argv;
+    for(size_t i = 0; i < request.cmd.size(); i++)
+        argv.push_back(request.cmd[i].data());
+    argv.push_back(nullptr);
+
+    if(!failure) {
+        ret = posix_spawn(&process.pid, argv[0], &actions, &attr, argv.data(), environ);
+        if(ret)
+            failure = "failed to spawn target subprocess";
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+#ifndef HAVE_SPAWN_ADDCHDIR
+    if(oldCwd >= 0) {
+        if(fchdir(oldCwd))
+            throw ExecutionWorkerException("cannot restore current directory", true);
+        close(oldCwd);
+    }
+#endif
+
+    close(fdRead[0]);
+    close(fdOut[1]);
+    close(fdErr[1]);
+
+    if(failure) {
+        close(fdRead[1]);
+        close(fdOut[0]);
+        close(fdErr[0]);
+
+        errno = ret;
+        ExecutionWorkerException ex(failure, true);
+        size_t len = strlen(ex.what());
+        request.outputErr.assign(ex.what(), ex.what() + len + 1);
+        request.internalError = INTERNAL_ERROR_REQUEST;
+        return false;
+    }
+
+    process.fdIn = fdRead[1];
+    process.fdOut = fdOut[0];
+    process.fdErr = fdErr[0];
+    process.inputOffset = 0;
+    process.request = &request;
+    fcntl(process.fdIn, F_SETFL, O_NONBLOCK);
+    if(request.input.empty()) {
+        close(process.fdIn);
+        process.fdIn = -1;
+    }
+    return true;
+}
+
+void ExecutionWorker::finish(RunningProcess& process) {
+    int status = 0;
+
+    if(process.fdIn >= 0)
+        close(process.fdIn);
+    if(waitpid(process.pid, &status, 0) != process.pid)
+        throw ExecutionWorkerException("cannot wait for subprocess", true);
+
+    if(WIFEXITED(status))
+        process.request->retCode = WEXITSTATUS(status);
+    else
+        process.request->retCode = -1;
+}
+
+void ExecutionWorker::executeBatch(std::vector<BatchRequest*>& requests) {
+    std::vector<RunningProcess> running;
+    std::vector<struct pollfd> pfds;
+    size_t next = 0;
+    char slice[4096];
+
+    while(next < requests.size() || !running.empty()) {
+        while(running.size() < maxJobs && next < requests.size()) {
+            RunningProcess process;
+            if(spawn(*requests[next++], process))
+                running.push_back(process);
+        }
+        if(running.empty())
+            continue;
+
+        pfds.clear();
+        for(auto& process : running) {
+            struct pollfd pfd[3];
+            memset(pfd, 0, sizeof(pfd));
+            pfd[0].fd = process.fdOut;
+            pfd[1].fd = process.fdErr;
+            pfd[2].fd = process.fdIn;
+            pfd[0].events = pfd[1].events = POLLIN;
+            pfd[2].events = POLLOUT;
+            pfds.insert(pfds.end(), pfd, pfd + 3);
+        }
+
+        if(poll(pfds.data(), pfds.size(), -1) < 0) {
+            if(errno == EINTR)
+                continue;
+            throw ExecutionWorkerException("cannot poll pipe events", true);
+        }
+
+        for(size_t i = 0; i < running.size(); i++) {
+            RunningProcess& process = running[i];
+            struct pollfd* pfd = &pfds[i * 3];
+
+            if(process.fdIn >= 0 && pfd[2].revents) {
+                ssize_t ret = write(process.fdIn, process.request->input.data() + process.inputOffset,
+                                    process.request->input.size() - process.inputOffset);
+                if(ret > 0)
+                    process.inputOffset += ret;
+                // Subprocess may exit without reading its whole input
+                if((ret < 0 && errno != EAGAIN) || process.inputOffset == process.request->input.size()) {
+                    close(process.fdIn);
+                    process.fdIn = -1;
+                }
+            }
+
+            int* fds[2] = {&process.fdOut, &process.fdErr};
+            std::vector<char>* outputs[2] = {&process.request->outputOut, &process.request->outputErr};
+            for(int k = 0; k < 2; k++) {
+                if(*fds[k] < 0 || !pfd[k].revents)
+                    continue;
+                ssize_t ret = read(*fds[k], slice, sizeof(slice));
+                if(ret < 0 && errno != EAGAIN && errno != EINTR)
+                    throw ExecutionWorkerException("cannot read from children output pipe", true);
+                if(ret > 0) {
+                    outputs[k]->insert(outputs[k]->end(), slice, slice + ret);
+                } else if(ret == 0) {
+                    close(*fds[k]);
+                    *fds[k] = -1;
+                }
+            }
+        }
+
+        for(size_t i = 0; i < running.size();) {
+            if(running[i].fdOut < 0 && running[i].fdErr < 0) {
+                finish(running[i]);
+                running[i] = running.back();
+                running.pop_back();
+            } else
+                i++;
+        }
+    }
+}
+
+void ExecutionWorker::processBatchRequest(void) {
+    struct batch_packet packet;
+
+    full_read(readFD, &packet, sizeof(packet));
+    std::vector<BatchRequest> requests(packet.count);
+    for(auto& request : requests) {
+        struct batch_entry entry;
+        full_read(readFD, &entry, sizeof(entry));
+        request.flags = entry.flags;
+        readRequest(request.cwd, request.input, request.cmd);
+        if(request.cmd.empty())
+            throw ExecutionWorkerException("empty command in batch request");
+    }
+
+    // Cached results are used directly and identical requests of the batch are executed once
+    std::vector<BatchRequest*> todo;
+    std::vector<std::pair<size_t, size_t>> duplicates;
+    std::unordered_map<std::string, size_t> pending;
+    std::vector<std::string> keys(requests.size());
+    for(size_t i = 0; i < requests.size(); i++) {
+        BatchRequest& request = requests[i];
+        if(cacheLimit && (request.flags & BATCH_FLAG_CACHE)) {
+            keys[i] = requestKey(request);
+            auto cached = cache.find(keys[i]);
+            if(cached != cache.end()) {
+                request.outputOut = cached->second.outputOut;
+                request.outputErr = cached->second.outputErr;
+                request.retCode = cached->second.retCode;
+                request.internalError = 0;
+                continue;
+            }
+            auto first = pending.find(keys[i]);
+            if(first != pending.end()) {
+                duplicates.emplace_back(i, first->second);
+                continue;
+            }
+            pending[keys[i]] = i;
+        }
+        todo.push_back(&request);
+    }
+
+    executeBatch(todo);
+
+    for(auto& dup : duplicates) {
+        requests[dup.first].outputOut = requests[dup.second].outputOut;
+        requests[dup.first].outputErr = requests[dup.second].outputErr;
+        requests[dup.first].retCode = requests[dup.second].retCode;
+        requests[dup.first].internalError = requests[dup.second].internalError;
+    }
+    for(auto& it : pending) {
+        if(!requests[it.second].internalError)
+            cacheResult(it.first, requests[it.second]);
+    }
+
+    for(auto& request : requests) {
+        struct resp_packet resp;
+        resp.stdout_size = request.outputOut.size();
+        resp.stderr_size = request.outputErr.size();
+        resp.return_code = request.retCode;
+        resp.internal_error = request.internalError;
+        full_write(writeFD, &resp, sizeof(resp));
+        full_write(writeFD, request.outputOut.data(), request.outputOut.size());
+        full_write(writeFD, request.outputErr.data(), request.outputErr.size());
+    }
+}
+
 /* 
  * Application entry-point
  */
 int main(int argc, char** argv) {
-    // TODO: Switch to getopt
-    if(argc < 3) {
-        fprintf(stderr, "Usage: %s <read_fd> <write_fd>\n", argv[0]);
+    unsigned int maxJobs = 0;
+    size_t cacheLimit = 64;
+    int opt;
+
+    while((opt = getopt(argc, argv, "b:c:")) != -1) {
+        switch(opt) {
+        case 'b':
+            maxJobs = atoi(optarg);
+            break;
+        case 'c':
+            cacheLimit = strtoul(optarg, nullptr, 10);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-b <jobs> [-c <cache_MB>]] <read_fd> <write_fd>\n", argv[0]);
+            return 1;
+        }
+    }
+    if(argc - optind < 2) {
+        fprintf(stderr, "Usage: %s [-b <jobs> [-c <cache_MB>]] <read_fd> <write_fd>\n", argv[0]);
         return 1;
     }
-    int read_fd = atoi(argv[1]);
-    int write_fd = atoi(argv[2]);
-
+    int read_fd = atoi(argv[optind]);
+    int write_fd = atoi(argv[optind + 1]);
+
+    if(maxJobs) {
+        // Subprocesses closing their input early must not terminate the worker
+        signal(SIGPIPE, SIG_IGN);
+        fcntl(read_fd, F_SETFD, FD_CLOEXEC);
+        fcntl(write_fd, F_SETFD, FD_CLOEXEC);
+    }
 
-    ExecutionWorker worker(read_fd, write_fd);
+    ExecutionWorker worker(read_fd, write_fd, maxJobs, cacheLimit << 20);
     while(1) {
         try {
-            worker.processSingleRequest();
+            if(maxJobs)
+                worker.processBatchRequest();
+            else
+                worker.processSingleRequest();
         } catch(ExecutionWorkerException& ex) {
             // Send error message to host
             worker.sendError(ex.what());
@@ -552,15 +552,14 @@ def search_files(
     """Find processes that opened a given file"""
     execs = []
     cas_db = dbs.get_nfsdb(db)
-    command_filter = CommandFilter(cmd_filter, None, cas_db.config, cas_db.source_root) if cmd_filter is not None else None
+    command_filter = CommandFilter(cmd_filter, None, cas_db.config, cas_db.source_root, nfsdb=cas_db.db) if cmd_filter is not None else None
 
     if filename:
         filepaths = get_opened_files(db, filename)
         if command_filter:
-            execs = [open.parent
-                     for openedFile in filepaths
-                     for open in cas_db.get_opens_of_path(openedFile)
-                     if command_filter.resolve_filters(open.parent)]
+            execs = command_filter.filter(open.parent
+                                          for openedFile in filepaths
+                                          for open in cas_db.get_opens_of_path(openedFile))
         else:
             execs = [open.parent
                      for openedFile in filepaths
@@ -901,6 +900,8 @@ def parse_server_args(argv = None):
     arg_parser.add_argument("--ctx", type=str, default=os.environ.get("CAS_CTX", "/"), help="Web context")
     arg_parser.add_argument("--workers", type=int, default=os.environ.get("WEB_CONCURRENCY", os.cpu_count() or 1), help="Number of worker processes to run")
     arg_parser.add_argument("--mcp", action="store_true", help="Enable CAS MCP server under `/mcp` and `/sse` endpoints")
+    arg_parser.add_argument("--preload", action="store_true", default=os.environ.get("CAS_PRELOAD", "").lower() in ("1", "true", "yes"), help="Write prelinked images of all databases before starting the worker processes (workers share the mapped images)")
+    arg_parser.add_argument("--prelink-dir", type=str, default=os.environ.get("CAS_PRELINK_DIR", None), help="Directory for prelinked images shared by the workers (e.g. /dev/shm) when database directories are read-only")
     args, unknown = arg_parser.parse_known_args(argv)
     return args, unknown
 def run(args=None):
@@ -913,10 +914,16 @@ def run(args=None):
         return original_uvicorn_is_alive(self, timeout)
     uvicorn.supervisors.multiprocess.Process.is_alive = patched_is_alive # type: ignore
     
+    # Exported so that the spawned worker processes look up the prelinked images in the same directory
+    if args.prelink_dir:
+        os.environ["CAS_PRELINK_DIR"] = args.prelink_dir
+
     try:
         app = get_app(args)
         if args.debug:
             print(app.routes)
+        if args.preload:
+            dbs.prelink_dbs()
         uvicorn.run("cas_server:get_app", factory=True, host=args.host, port=args.port, log_level="debug" if args.debug else None, workers=args.workers, forwarded_allow_ips="*")
         print("Started CAS Server")
     except KeyboardInterrupt:
@@ -15,6 +15,7 @@ int DEBUG_NOTICE;
 constexpr bool DISABLED = false;
 
 thread_local size_t exprOrd;
+thread_local bool DbJSONClassVisitor::ObjectID::shifted = false;
 
 typedef std::string name_t;
 	typedef int to_index;
@@ -1006,7 +1007,7 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
   }
 
   void DbJSONClassConsumer::printGlobalEntry(DbJSONClassVisitor::VarData &var_data, int Indentation){
-	  llvm::raw_string_ostream GOut(*var_data.output);
+	  llvm::raw_string_ostream GOut(var_data.output->text);
 	  std::string Indent(Indentation,'\t');
 	  const VarDecl *D = var_data.Node;
 	  QualType ST = D->getTypeSourceInfo() ? D->getTypeSourceInfo()->getType() : D->getType();
@@ -1544,14 +1545,13 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 
   void DbJSONClassConsumer::getFuncDeclHash(DbJSONClassVisitor::FuncDeclData *func_data){
 	const FunctionDecl *D = func_data->this_func;
-	SHA_CTX cd;
-	SHA_init(&cd);
+	DeclHash cd(opts.fasthash);
 	
 	getFuncTemplatePars(func_data);
-	SHA_update(&cd, func_data->templatePars.data(), func_data->templatePars.size());
+	cd.update(func_data->templatePars);
 
 	getFuncDeclSignature(D,func_data->signature);
-	SHA_update(&cd, func_data->signature.data(), func_data->signature.size());
+	cd.update(func_data->signature);
 
 	if (D->isCXXClassMember()) {
 		const CXXMethodDecl* MD = static_cast<const CXXMethodDecl*>(D);
@@ -1562,7 +1562,7 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 		if(!RT_data.hash.size()){
 			buildTypeString(RT,RT_data.hash);
 		}
-		SHA_update(&cd, RT_data.hash.data(), RT_data.hash.size());
+		cd.update(RT_data.hash);
 	}
 
 	if (isa<CXXMethodDecl>(D)) {
@@ -1570,30 +1570,28 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 		func_data->nms = Visitor.parentFunctionOrMethodString(RD);
 	}
 	if (func_data->nms.empty()) func_data->nms = getFullFunctionNamespace(D);
-	SHA_update(&cd, func_data->nms.data(), func_data->nms.size());
+	cd.update(func_data->nms);
 
-	SHA_final(&cd);
-	func_data->declhash = base64_encode(reinterpret_cast<const unsigned char*>(cd.buf.b),64);
+	func_data->declhash = cd.digest();
   }
 
   void DbJSONClassConsumer::getFuncHash(DbJSONClassVisitor::FuncData *func_data){
 	const FunctionDecl *D = func_data->this_func;
 	getFuncDeclHash(func_data);
-	SHA_CTX c;
-	SHA_init(&c);
+	DeclHash c(opts.fasthash);
 
 	// FIX: added for some edge cases, think of a better solution
-	SHA_update(&c, func_data->signature.data(), func_data->signature.size());
-	SHA_update(&c, func_data->templatePars.data(), func_data->templatePars.size());
+	c.update(func_data->signature);
+	c.update(func_data->templatePars);
 
 	llvm::raw_string_ostream bstream(func_data->body);
 	D->print(bstream);
 	bstream.flush();
-	SHA_update(&c, func_data->body.data(), func_data->body.size());
+	c.update(func_data->body);
 
 	SourceManager& SM = Context.getSourceManager();
 	std::string exp_loc = getAbsoluteLocation(SM.getExpansionLoc(D->getLocation()));
-	SHA_update(&c,exp_loc.data(),exp_loc.size());
+	c.update(exp_loc);
 
 	//Adding static variable references to hash
 	std::set<std::string> ordered;
@@ -1604,7 +1602,7 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 		}
 	}
 	for(auto &vhash : ordered){
-		SHA_update(&c,vhash.data(),vhash.size());
+		c.update(vhash);
 	}
 
 	if (D->isCXXClassMember()) {
@@ -1616,13 +1614,12 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 		if(!RT_data.hash.size()){
 			buildTypeString(RT,RT_data.hash);
 		}
-		SHA_update(&c, RT_data.hash.data(), RT_data.hash.size());
+		c.update(RT_data.hash);
 	}
 
-	SHA_update(&c, func_data->nms.data(), func_data->nms.size());
+	c.update(func_data->nms);
 
-	SHA_final(&c);
-	func_data->hash = base64_encode(reinterpret_cast<const unsigned char*>(c.buf.b), 64);
+	func_data->hash = c.digest();
   }
 
   static bool isFunctionDefinitionDiscarded(const FunctionDecl *FD) {
@@ -1671,7 +1668,7 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
   }
 
   void DbJSONClassConsumer::printFuncEntry(DbJSONClassVisitor::FuncData &func_data, int Indentation) {
-	  llvm::raw_string_ostream FOut(*func_data.output);
+	  llvm::raw_string_ostream FOut(func_data.output->text);
 	  SourceManager& SM = Context.getSourceManager();
 	  std::string Indent(Indentation,'\t');
 		  const FunctionDecl* D = func_data.this_func;
@@ -1717,10 +1714,8 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 				exp_os<<Indent<<"\t\t\t}";
 			}
 		  }
-          SHA_CTX csc;
-          SHA_init(&csc);
-          SHA_update(&csc, fcsbody.data(), fcsbody.size());
-		  SHA_final(&csc);
+          DeclHash csc(opts.fasthash);
+          csc.update(fcsbody);
 		  
 		  std::stringstream argss;
 		  argss << "[";
@@ -2298,9 +2293,17 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 		  if (isCXXTU(Context)) {
 			  FOut << Indent << "\t\t\"namespace\": \"" << func_data.nms << "\",\n";
 		  }
-		  FOut << Indent << "\t\t\"id\": " << func_data.id << ",\n";
+		  FOut << Indent << "\t\t\"id\": ";
+		  size_t id_begin = FOut.tell();
+		  FOut << func_data.id;
+		  func_data.output->setField(multi::entry_output::ID,id_begin,FOut.tell());
+		  FOut << ",\n";
 		  FOut << Indent << "\t\t\"fid\": " << file_id << ",\n";
-		  FOut << Indent << "\t\t\"fids\": [ " << file_id << " ],\n";
+		  FOut << Indent << "\t\t\"fids\": ";
+		  size_t fids_begin = FOut.tell();
+		  FOut << "[ " << file_id << " ]";
+		  func_data.output->setField(multi::entry_output::FIDS,fids_begin,FOut.tell());
+		  FOut << ",\n";
 		  FOut << Indent << "\t\t\"nargs\": " << D->getNumParams() << ",\n";
 		  FOut << Indent << "\t\t\"variadic\": " << (D->isVariadic()?("true"):("false")) << ",\n";
 		  FOut << Indent << "\t\t\"firstNonDeclStmt\": \"" << func_data.firstNonDeclStmtLoc << "\",\n";
@@ -2326,9 +2329,9 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 			  FOut << Indent << "\t\t\"classid\": " << RT_data.id << ",\n";
 		  }
 		  FOut << Indent << "\t\t\"attributes\": " << attributes.str() << ",\n"; 
-		  func_data.cshash = base64_encode(reinterpret_cast<const unsigned char*>(csc.buf.b), 64);
-		  FOut << Indent << "\t\t\"hash\": \"" << func_data.hash << "\",\n";
-		  FOut << Indent << "\t\t\"cshash\": \"" << func_data.cshash << "\",\n";
+		  func_data.cshash = csc.digest();
+		  FOut << Indent << "\t\t\"hash\": \"" << DeclHash::encode(func_data.hash) << "\",\n";
+		  FOut << Indent << "\t\t\"cshash\": \"" << DeclHash::encode(func_data.cshash) << "\",\n";
 		  if (opts.addbody) {
 			  if (hasTemplatePars) FOut << Indent << "\t\t\"template_parameters\": \"" << json::json_escape(func_data.templatePars) << "\",\n";
 			  FOut << Indent << "\t\t\"body\": \"" << json::json_escape(func_data.body) << "\",\n";
@@ -2341,7 +2344,7 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 			  FOut << Indent << "\t\t\"declbody\": \"" << json::json_escape(declbody) << "\",\n";
 		  }
 		  FOut << Indent << "\t\t\"signature\": \"" << json::json_escape(func_data.signature) << "\",\n";
-		  FOut << Indent << "\t\t\"declhash\": \"" << func_data.declhash << "\",\n";
+		  FOut << Indent << "\t\t\"declhash\": \"" << DeclHash::encode(func_data.declhash) << "\",\n";
 		  FOut << Indent << "\t\t\"location\": \"" << getAbsoluteLocation(D->getLocation()) << "\",\n";
 		  std::string sloc = getAbsoluteLocation(D->getSourceRange().getBegin());
 		  std::string eloc = getAbsoluteLocation(D->getSourceRange().getEnd());
@@ -2751,7 +2754,7 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
   }
 
   void DbJSONClassConsumer::printFuncDeclEntry(DbJSONClassVisitor::FuncDeclData &func_data, int Indentation) {
-		  llvm::raw_string_ostream FDOut(*func_data.output);
+		  llvm::raw_string_ostream FDOut(func_data.output->text);
   		  std::string Indent(Indentation,'\t');
   		  const FunctionDecl* D = func_data.this_func;
 
@@ -2815,7 +2818,7 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
   			  FDOut << Indent << "\t\t\"decl\": \"" << json::json_escape(fdeclbody) << "\",\n";
   		  }
 		  FDOut << Indent << "\t\t\"signature\": \"" << json::json_escape(func_data.signature) << "\",\n";
-  		  FDOut << Indent << "\t\t\"declhash\": \"" << func_data.declhash << "\",\n";
+  		  FDOut << Indent << "\t\t\"declhash\": \"" << DeclHash::encode(func_data.declhash) << "\",\n";
   		  FDOut << Indent << "\t\t\"location\": \"" << getAbsoluteLocation(D->getLocation()) << "\",\n";
   		  FDOut << Indent << "\t\t\"refcount\": " << 1 << ",\n";
   		  FDOut << Indent << "\t\t\"types\": " << argss.str() << "\n";
@@ -3237,7 +3240,7 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 
   void DbJSONClassConsumer::printTypeEntry(DbJSONClassVisitor::TypeData &type_data,int Indentation) {
     std::string Indent(Indentation,'\t');
-	  llvm::raw_string_ostream TOut(*type_data.output);
+	  llvm::raw_string_ostream TOut(type_data.output->text);
 	  QualType T = type_data.T;
 	  DbJSONClassVisitor::recordInfo_t *RInfo = type_data.RInfo;
 	  TOut << Indent << "\t{\n";
@@ -4056,13 +4059,17 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
           multi::handleRefs(type_data.usedrefs,rIds,rDef);
 				  if(DISABLED && opts.adddefs && opts.csd && !rDef.empty()){
 					  TOut<< Indent << "\t\t\"defhead\": \"" << json::json_escape(head) << "\",\n";
-					  TOut << Indent << "\t\t\"useddef\": [";
+					  TOut << Indent << "\t\t\"useddef\": ";
+					  size_t useddef_begin = TOut.tell();
+					  TOut << "[";
             // will be updated in postprocessing
 					  // for(auto i = rDef.begin();i!=rDef.end();i++){
 						//   if(i != rDef.begin()) TOut<<",";
 						//   TOut<<"\""<<json::json_escape(*i)<<"\"";
 					  // }
-					  TOut<<"],\n";
+					  TOut<<"]";
+					  type_data.output->setField(multi::entry_output::USEDDEF,useddef_begin,TOut.tell());
+					  TOut<<",\n";
 				  }
 			  }
 			  if(Visitor.isTypedefRecord(rD)){
@@ -4150,12 +4157,16 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 					  }
 				  }
 				  TOut << " ],\n";
-				  TOut << Indent << "\t\t\"usedrefs\": [ ";
+				  TOut << Indent << "\t\t\"usedrefs\": ";
+				  size_t usedrefs_begin = TOut.tell();
+				  TOut << "[ ";
 				  for(auto i=rIds.begin(); i!=rIds.end(); i++){
 					  if(i != rIds.begin()) TOut<<",";
 					  TOut<<*i;
 				  }
-				  TOut << " ],\n";
+				  TOut << " ]";
+				  type_data.output->setField(multi::entry_output::USEDREFS,usedrefs_begin,TOut.tell());
+				  TOut << ",\n";
 				  TOut << Indent << "\t\t\"globalrefs\": [ ";
 				  if (Visitor.gtp_refVars.find(rD)!=Visitor.gtp_refVars.end()) {
 					  for (auto u = Visitor.gtp_refVars[rD].begin(); u!=Visitor.gtp_refVars[rD].end();) {
@@ -4584,6 +4595,14 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
   void DbJSONClassConsumer::processFops(){
 	for(auto i = Visitor.getFopsMap().begin(); i!=Visitor.getFopsMap().end();i++){
     auto &fops_data = i->second;
+      computeFopsIds(fops_data);
+      multi::registerFops(fops_data);
+    }
+  }
+
+  // Ids of the objects and the registry key of fops
+  void DbJSONClassConsumer::computeFopsIds(DbJSONClassVisitor::FopsData &fops_data){
+      fops_data.hash.clear();
       llvm::raw_string_ostream hs(fops_data.hash);
       switch(fops_data.obj.kind){
         case DbJSONClassVisitor::FopsObject::FopsKind::FObjGlobal:{
@@ -4613,8 +4632,6 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
         }
       }
 	  hs.flush();
-      multi::registerFops(fops_data);
-    }
   }
 
 
@@ -4628,7 +4645,7 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 
   void DbJSONClassConsumer::printFopsEntry(const DbJSONClassVisitor::FopsData &fops_data, int Indentation){
     std::string Indent(Indentation,'\t');
-    llvm::raw_string_ostream Out(*fops_data.output);
+    llvm::raw_string_ostream Out(fops_data.output->text);
     Out << Indent << "\t{\n";
     Out << Indent << "\t\t\"kind\": \""<<fops_data.obj.FopsKindName()<<"\",\n";
     Out << Indent << "\t\t\"type\": "<<fops_data.type_id<<",\n";
@@ -4689,11 +4706,31 @@ std::string DbJSONClassVisitor::getAbsoluteLocation(SourceLocation Loc){
 	  processFops();
 
     // process data to string
+    size_t printOrd = exprOrd;
     printGlobalArray(1);
     printTypeArray(1);
     printFuncArray(1);
     printFuncDeclArray(1);
     printFopsArray(1);
+    if(multi::recordingTU()){
+      // render everything once more with shifted ids to find the ids in the text kept by the TU cache
+      multi::beginRelocation();
+      size_t fid = file_id;
+      file_id += DbJSONClassVisitor::ObjectID::shift(DbJSONClassVisitor::ObjectID::SPACE_FID);
+      exprOrd = printOrd;
+      Visitor.etp_refVars.clear();
+      for(auto i = Visitor.getFopsMap().begin(); i!=Visitor.getFopsMap().end();i++){
+        computeFopsIds(i->second);
+      }
+      printGlobalArray(1);
+      printTypeArray(1);
+      printFuncArray(1);
+      printFuncDeclArray(1);
+      printFopsArray(1);
+      file_id = fid;
+      multi::endRelocation();
+    }
+    multi::finishTU();
 
 	  // printDatabase();
 	setCTAList(nullptr);
@@ -4705,6 +4742,7 @@ void DbJSONClassConsumer::printDatabase(){
 	llvm::outs() << "\t\"sourcen\": " << 1 << ",\n";
 	llvm::outs() << "\t\"sources\": [\n\t\t{ \"" << multi::files.at(file_id) << "\" : " << 0 << " }\n\t],\n";
 	llvm::outs() << "\t\"directory\": \"" << multi::directory << "\",\n";
+	llvm::outs() << "\t\"hash_scheme\": \"" << DeclHash::schemeName(opts.fasthash) << "\",\n";
 	llvm::outs() << "\t\"typen\": " << Visitor.getTypeNum() << ",\n";
 	llvm::outs() << "\t\"funcn\": " << Visitor.getFuncNum() << ",\n";
 	llvm::outs() << "\t\"funcdecln\": " << Visitor.getFuncDeclNum() << ",\n";
@@ -4795,12 +4833,19 @@ void DbJSONClassConsumer::printDatabase(){
 
 
 #include <mutex>
+#include <atomic>
+#include <unistd.h>
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/ADT/StringExtras.h"
+#include <array>
+#include <chrono>
 namespace multi{
   namespace{
     struct db_status{
       size_t id;
       int kind; //enum {decl,weak,def}
-      std::shared_ptr<std::string>out;
+      std::shared_ptr<entry_output>out;
     };
 
     struct usedrefs{
@@ -4812,299 +4857,1038 @@ namespace multi{
       std::vector<ref>refs;
     };
 
-    std::mutex VarLock;
-    size_t VarId = 0;
-    std::unordered_map<std::string,db_status>VarMap;
+    // Registries are split into shards selected by the hash of the entry key
+    // so that threads registering different entries rarely touch the same lock
+    constexpr unsigned MaxShards = 256;
+    unsigned ShardCount = 64;
+
+    struct lock_stats{
+      std::atomic<uint64_t> acquired{0};
+      std::atomic<uint64_t> contended{0};
+      std::atomic<uint64_t> wait_ns{0};
+    };
+    bool TrackLockWait = false;
+
+    std::unique_lock<std::mutex> acquire(std::mutex &m, lock_stats &stats){
+      if(!TrackLockWait) return std::unique_lock<std::mutex>(m);
+      std::unique_lock<std::mutex> lock(m,std::try_to_lock);
+      stats.acquired++;
+      if(!lock.owns_lock()){
+        auto start = std::chrono::steady_clock::now();
+        lock.lock();
+        auto wait = std::chrono::steady_clock::now() - start;
+        stats.contended++;
+        stats.wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count();
+      }
+      return lock;
+    }
+
+    unsigned shardOf(const std::string &key){
+      return std::hash<std::string>()(key) % ShardCount;
+    }
+
+    struct shard{
+      std::mutex m;
+      std::unordered_map<std::string,db_status>map;
+    };
+
+    struct type_shard : shard{
+      std::unordered_map<size_t,usedrefs> refs;
+    };
+
+    struct func_shard : shard{
+      // weak is keyed by declhash, known by definition hash, fixid and fids by ids of entries in this shard
+      std::unordered_map<std::string,std::string>weak;
+      std::unordered_set<std::string> known;
+      std::unordered_set<size_t> fixid;
+      std::unordered_map<size_t,std::set<int>>fids;
+    };
+
+    lock_stats VarLockStats;
+    std::atomic<size_t> VarId{0};
+    std::array<shard,MaxShards> VarShards;
     std::vector<db_status*>Vars;
 
-    std::mutex TypeLock;
-    size_t TypeId = 0;
-    std::unordered_map<std::string,db_status>TypeMap;
+    lock_stats TypeLockStats;
+    std::atomic<size_t> TypeId{0};
+    std::array<type_shard,MaxShards> TypeShards;
     std::vector<db_status*>Types;
-    std::unordered_map<size_t,usedrefs> TypeUsedRefs;
-
-    std::mutex FuncLock;
-    size_t FuncId = 0;
-    size_t FuncDeclCnt = 0;
-    std::unordered_map<std::string,db_status>FuncMap;
-    std::unordered_map<std::string,std::string>WeakMap;
-    std::unordered_set<std::string> KnownFuncs;
-    std::unordered_set<size_t> FixIdFuncs;
+
+    lock_stats FuncLockStats;
+    std::atomic<size_t> FuncId{0};
+    std::atomic<size_t> FuncDeclCnt{0};
+    std::array<func_shard,MaxShards> FuncShards;
     std::vector<db_status*>Funcs;
     std::vector<db_status*>FDecls;
-    std::unordered_map<size_t,std::set<int>>FuncFids;
 
-	std::mutex FopsLock;
-	std::unordered_map<std::string,db_status>FopsMap;
-  }
+    lock_stats FopsLockStats;
+    std::atomic<size_t> FopsCnt{0};
+    std::array<shard,MaxShards> FopsShards;
 
-  std::string directory;
-  std::vector<std::string> files;
+    // Entries produced by the current TU, spilled to the thread's spill file once the TU is done
+    thread_local std::vector<std::shared_ptr<entry_output>> Pending;
+    thread_local int SpillFd = -1;
+    thread_local uint64_t SpillSize = 0;
+    std::string SpillDir;
 
-  void registerVar(DbJSONClassVisitor::VarData &var_data){
-    const VarDecl *D = var_data.Node;
-    std::lock_guard<std::mutex> lock(VarLock);
-    auto rv = VarMap.insert({var_data.hash,{}});
-    db_status &entry = rv.first->second;
-    if(rv.second){
-      // new entry
-      entry.id = VarId++;
-      entry.out = std::make_shared<std::string>();
-      var_data.id.setIDProper(entry.id);
-      var_data.output = entry.out;
-      entry.kind = D->hasDefinition();
+    std::shared_ptr<entry_output> newOutput(){
+      auto out = std::make_shared<entry_output>();
+      Pending.push_back(out);
+      return out;
     }
-    else{
-      var_data.id.setIDProper(entry.id);
-      var_data.output = nullptr;
-      // update entry
-      if(entry.kind < D->hasDefinition()){
-        entry.out = std::make_shared<std::string>();
-        var_data.output = entry.out;
+
+    bool openSpillFile(){
+      llvm::SmallString<128> path;
+      std::error_code EC;
+      if(SpillDir.empty())
+        EC = llvm::sys::fs::createTemporaryFile("clang-proc","spill",SpillFd,path);
+      else
+        EC = llvm::sys::fs::createUniqueFile(SpillDir+"/clang-proc-%%%%%%%%.spill",SpillFd,path);
+      if(EC){
+        llvm::errs()<<"Failed to create spill file: "<<EC.message()<<'\n';
+        SpillFd = -1;
+        return false;
       }
+      // the file lives as long as the descriptor
+      llvm::sys::fs::remove(path);
+      return true;
     }
-  }
 
-  void registerType(DbJSONClassVisitor::TypeData &type_data){
-    std::lock_guard<std::mutex> lock(TypeLock);
-    auto rv = TypeMap.insert({type_data.hash,{}});
-    db_status &entry = rv.first->second;
-    if(rv.second){
-      // new entry
-      entry.id = TypeId++;
-      entry.out = std::make_shared<std::string>();
-      type_data.id.setIDProper(entry.id);
-      type_data.output = entry.out;
-    }
-    else{
-      type_data.id.setIDProper(entry.id);
-      type_data.output = nullptr;
+    bool writeSpill(const std::string &data){
+      const char *p = data.data();
+      size_t left = data.size();
+      while(left){
+        ssize_t n = write(SpillFd,p,left);
+        if(n<0){
+          if(errno == EINTR) continue;
+          return false;
+        }
+        p+=n;
+        left-=n;
+      }
+      return true;
     }
-    if(type_data.T->getTypeClass() == Type::Record){
-      entry.out = std::make_shared<std::string>();
-      type_data.output = entry.out;
-      type_data.usedrefs = &TypeUsedRefs[entry.id];
+
+    void readSpill(const entry_output &out, std::string &buf){
+      buf.resize(out.length);
+      size_t done = 0;
+      while(done<out.length){
+        ssize_t n = pread(out.spill_fd,&buf[done],out.length-done,out.spill_off+done);
+        if(n<0 && errno == EINTR) continue;
+        if(n<=0){
+          llvm::errs()<<"Failed to read spill file\n";
+          assert(0);
+          break;
+        }
+        done+=n;
+      }
     }
-  }
 
-  void registerFuncDecl(DbJSONClassVisitor::FuncDeclData &func_data){
-    std::lock_guard<std::mutex> lock(FuncLock);
-    auto rv = FuncMap.insert({func_data.declhash,{}});
-    db_status &entry = rv.first->second;
-    if(rv.second){
-      //new entry
-      entry.kind = 0; //decl
-      entry.id = FuncId++;
-      entry.out = std::make_shared<std::string>();
-      func_data.id.setIDProper(entry.id);
-      func_data.output = entry.out;
-      FuncDeclCnt++;
+    // Writes entry text with the final values of tracked fields substituted
+    void writeEntry(llvm::raw_ostream &db_file, const entry_output &out, std::string &buf){
+      const std::string *text = &out.text;
+      if(out.spill_fd>=0){
+        readSpill(out,buf);
+        text = &buf;
+      }
+      std::vector<const entry_output::span*> spans;
+      for(auto &f : out.fields){
+        if(f.begin != std::string::npos && !f.repl.empty()) spans.push_back(&f);
+      }
+      std::sort(spans.begin(),spans.end(),[](const entry_output::span *a,const entry_output::span *b){return a->begin < b->begin;});
+      size_t pos = 0;
+      for(auto f : spans){
+        db_file.write(text->data()+pos,f->begin-pos);
+        db_file<<f->repl;
+        pos = f->end;
+      }
+      db_file.write(text->data()+pos,text->size()-pos);
     }
-    else{
-      func_data.id.setIDProper(entry.id);
-      func_data.output = nullptr;
+
+    // Locks a set of function shards in index order so that updates spanning several shards cannot deadlock
+    std::vector<std::unique_lock<std::mutex>> lockFuncShards(std::vector<unsigned> shards){
+      std::sort(shards.begin(),shards.end());
+      shards.erase(std::unique(shards.begin(),shards.end()),shards.end());
+      std::vector<std::unique_lock<std::mutex>> locks;
+      for(auto i : shards){
+        locks.push_back(acquire(FuncShards[i].m,FuncLockStats));
+      }
+      return locks;
     }
-  }
 
-  void registerFuncInternal(DbJSONClassVisitor::FuncData &func_data){
-    std::lock_guard<std::mutex> lock(FuncLock);
-    auto rv = FuncMap.insert({func_data.hash,{}});
-    db_status &entry = rv.first->second;
-    if(rv.second){
-      // new entry
-      entry.kind = 2; //def
-      entry.id = FuncId++;
-      entry.out = std::make_shared<std::string>();
-      func_data.id.setIDProper(entry.id);
-      func_data.output = entry.out;
+    // Result of a registration: the global id of the entry and the output that receives its text
+    // (null when the entry was already produced by another TU)
+    struct registration{
+      size_t id = 0;
+      std::shared_ptr<entry_output> out;
+      void *usedrefs = nullptr;
+    };
+
+    registration addVar(const std::string &hash, int kind){
+      registration r;
+      shard &s = VarShards[shardOf(hash)];
+      auto lock = acquire(s.m,VarLockStats);
+      auto rv = s.map.insert({hash,{}});
+      db_status &entry = rv.first->second;
+      if(rv.second){
+        // new entry
+        entry.id = VarId++;
+        entry.out = newOutput();
+        r.out = entry.out;
+        entry.kind = kind;
+      }
+      else if(entry.kind < kind){
+        // update entry
+        entry.out = newOutput();
+        r.out = entry.out;
+      }
+      r.id = entry.id;
+      return r;
     }
-    else{
-      func_data.id.setIDProper(entry.id);
-      func_data.output = nullptr;
+
+    registration addType(const std::string &hash, bool record){
+      registration r;
+      type_shard &s = TypeShards[shardOf(hash)];
+      auto lock = acquire(s.m,TypeLockStats);
+      auto rv = s.map.insert({hash,{}});
+      db_status &entry = rv.first->second;
+      if(rv.second){
+        // new entry
+        entry.id = TypeId++;
+        entry.out = newOutput();
+        r.out = entry.out;
+      }
+      if(record){
+        entry.out = newOutput();
+        r.out = entry.out;
+        r.usedrefs = &s.refs[entry.id];
+      }
+      r.id = entry.id;
+      return r;
     }
-    //fids
-    FuncFids[entry.id].insert(func_data.fid);
-  }
 
-  void registerFunc(DbJSONClassVisitor::FuncData &func_data){
-    std::lock_guard<std::mutex> lock(FuncLock);
-    if(!KnownFuncs.insert(func_data.hash).second){
-      // skip known function
-      func_data.id.setIDProper(FuncMap.at(func_data.declhash).id);
-      func_data.output = nullptr;
-      FuncFids[FuncMap.at(func_data.declhash).id].insert(func_data.fid);
-      return;
+    registration addFuncDecl(const std::string &declhash){
+      registration r;
+      func_shard &s = FuncShards[shardOf(declhash)];
+      auto lock = acquire(s.m,FuncLockStats);
+      auto rv = s.map.insert({declhash,{}});
+      db_status &entry = rv.first->second;
+      if(rv.second){
+        //new entry
+        entry.kind = 0; //decl
+        entry.id = FuncId++;
+        entry.out = newOutput();
+        r.out = entry.out;
+        FuncDeclCnt++;
+      }
+      r.id = entry.id;
+      return r;
     }
-    int kind = func_data.this_func->isWeak() ? 1 : 2; // weak : def 
-    auto rv = FuncMap.insert({func_data.declhash,{}});
-    db_status &entry = rv.first->second;
-    if(rv.second){
-      // new entry
-      entry.kind = kind;
-      entry.id = FuncId++;
-      entry.out = std::make_shared<std::string>();
-      func_data.id.setIDProper(entry.id);
-      func_data.output = entry.out;
-      // track weak definition
-      if(kind == 1) WeakMap[func_data.declhash] = func_data.hash;
+
+    registration addFuncInternal(const std::string &hash, int fid){
+      registration r;
+      func_shard &s = FuncShards[shardOf(hash)];
+      auto lock = acquire(s.m,FuncLockStats);
+      auto rv = s.map.insert({hash,{}});
+      db_status &entry = rv.first->second;
+      if(rv.second){
+        // new entry
+        entry.kind = 2; //def
+        entry.id = FuncId++;
+        entry.out = newOutput();
+        r.out = entry.out;
+      }
+      r.id = entry.id;
+      //fids
+      s.fids[entry.id].insert(fid);
+      return r;
     }
-    else{
-      func_data.id.setIDProper(entry.id);
-      if(entry.kind < kind){
-        // update entry
-        if(entry.kind == 0) FuncDeclCnt--;
-        if(entry.kind == 1){
-          // demote weak definition
-          auto weak_rv = FuncMap.insert({WeakMap.at(func_data.declhash),{}});
-          assert(weak_rv.second && "Entry already in map");
-          db_status &weak_entry = weak_rv.first->second;
-          weak_entry.kind = 1;
-          weak_entry.id = FuncId++;
-          weak_entry.out = entry.out;
-          FixIdFuncs.insert(weak_entry.id);
+
+    registration addFunc(const std::string &declhash, const std::string &hash, int kind, int fid){
+      // the declaration entry lives in the shard of declhash while known and weak definitions live in the shard of hash
+      registration r;
+      func_shard &ds = FuncShards[shardOf(declhash)];
+      func_shard &hs = FuncShards[shardOf(hash)];
+      std::vector<unsigned> need = {shardOf(declhash),shardOf(hash)};
+      std::vector<std::unique_lock<std::mutex>> locks;
+      while(true){
+        locks = lockFuncShards(need);
+        // demoting a weak definition also touches the shard of its hash
+        auto decl = ds.map.find(declhash);
+        if(kind == 2 && decl != ds.map.end() && decl->second.kind == 1 && !hs.known.count(hash)){
+          unsigned wshard = shardOf(ds.weak.at(declhash));
+          if(std::find(need.begin(),need.end(),wshard) == need.end()){
+            locks.clear();
+            need.push_back(wshard);
+            continue;
+          }
         }
+        break;
+      }
+
+      if(!hs.known.insert(hash).second){
+        // skip known function
+        r.id = ds.map.at(declhash).id;
+        ds.fids[r.id].insert(fid);
+        return r;
+      }
+      auto rv = ds.map.insert({declhash,{}});
+      db_status &entry = rv.first->second;
+      if(rv.second){
+        // new entry
         entry.kind = kind;
-        entry.out = std::make_shared<std::string>();
-        func_data.output = entry.out;
+        entry.id = FuncId++;
+        entry.out = newOutput();
+        r.out = entry.out;
         // track weak definition
-        if(kind == 1) WeakMap[func_data.declhash] = func_data.hash;
+        if(kind == 1) ds.weak[declhash] = hash;
       }
       else{
-        // add weak definition (including strong definition conflicts for now)
-        auto weak_rv = FuncMap.insert({func_data.hash,{}});
-        assert(weak_rv.second && "Entry already in map");
-        db_status &weak_entry = weak_rv.first->second;
-        weak_entry.kind = kind;
-        weak_entry.id = FuncId++;
-        weak_entry.out = std::make_shared<std::string>();
-        func_data.output = weak_entry.out;
-        FixIdFuncs.insert(weak_entry.id);
+        if(entry.kind < kind){
+          // update entry
+          if(entry.kind == 0) FuncDeclCnt--;
+          if(entry.kind == 1){
+            // demote weak definition
+            const std::string &weak_hash = ds.weak.at(declhash);
+            func_shard &ws = FuncShards[shardOf(weak_hash)];
+            auto weak_rv = ws.map.insert({weak_hash,{}});
+            assert(weak_rv.second && "Entry already in map");
+            db_status &weak_entry = weak_rv.first->second;
+            weak_entry.kind = 1;
+            weak_entry.id = FuncId++;
+            weak_entry.out = entry.out;
+            ws.fixid.insert(weak_entry.id);
+          }
+          entry.kind = kind;
+          entry.out = newOutput();
+          r.out = entry.out;
+          // track weak definition
+          if(kind == 1) ds.weak[declhash] = hash;
+        }
+        else{
+          // add weak definition (including strong definition conflicts for now)
+          auto weak_rv = hs.map.insert({hash,{}});
+          assert(weak_rv.second && "Entry already in map");
+          db_status &weak_entry = weak_rv.first->second;
+          weak_entry.kind = kind;
+          weak_entry.id = FuncId++;
+          weak_entry.out = newOutput();
+          r.out = weak_entry.out;
+          hs.fixid.insert(weak_entry.id);
+        }
       }
+      r.id = entry.id;
+      // fids
+      ds.fids[entry.id].insert(fid);
+      return r;
     }
-    // fids
-    FuncFids[entry.id].insert(func_data.fid);
-  }
 
-  void registerFops(DbJSONClassVisitor::FopsData &fops_data){
-    std::lock_guard<std::mutex> lock(FopsLock);
-    auto rv = FopsMap.insert({fops_data.hash,{}});
-    db_status &entry = rv.first->second;
-    if(rv.second){
+    std::shared_ptr<entry_output> addFops(const std::string &hash){
+      shard &s = FopsShards[shardOf(hash)];
+      auto lock = acquire(s.m,FopsLockStats);
+      auto rv = s.map.insert({hash,{}});
+      db_status &entry = rv.first->second;
+      if(!rv.second) return nullptr;
       // new entry
-      entry.out = std::make_shared<std::string>();
-      fops_data.output = entry.out;
+      entry.out = newOutput();
+      FopsCnt++;
+      return entry.out;
+    }
+
+    void addRefs(void *rv, const std::vector<int> &rIds, const std::vector<std::string> &rDef){
+      auto R = (usedrefs*)rv;
+      std::lock_guard<std::mutex> lock(R->m);
+      R->refs.resize(rIds.size());
+      for(size_t i = 0;i<rIds.size();i++){
+        auto &ref = R->refs[i];
+        if(rIds[i]>=0){
+          ref.id = rIds[i];
+          ref.def = rDef[i];
+        }
+        if(ref.def.empty()){
+          ref.def = rDef[i];
+        }
+      }
+    }
+
+    // Persistent TU cache. The cache entry of a TU holds the registrations it made and the text of the
+    // entries it rendered, including the entries other TUs produced first (these are rendered to private
+    // outputs). Ids handed out by the registries are cut out of the text and replaced by references to
+    // the registrations that returned them (TU local ids); the ids are found by rendering the TU a second
+    // time with shifted ids (see ObjectID). A replayed entry makes the same registrations again and
+    // substitutes the ids returned this time, so it does not depend on the other TUs or on the order of
+    // processing. The entry is dropped as soon as any file read by the TU changes its content.
+    enum tu_record_kind {TU_VAR,TU_TYPE,TU_FUNCDECL,TU_FUNCINTERNAL,TU_FUNC,TU_FOPS,TU_REFS};
+    const std::string TUCacheMagic = "clang-proc tu cache 2\n";
+    // slot of the file id of the TU
+    const uint64_t TUFidSlot = ~(uint64_t)0;
+    std::string TUCacheDir;
+    std::string TUCacheOptions;
+
+    // Text with the ids cut out; every id is given by the index of the registration (slot) that returned it
+    struct tu_text{
+      std::string text;
+      std::vector<std::pair<uint64_t,uint64_t>> ids; // offset in text, slot
+    };
+
+    // Position in the text given by the offset in the text without ids and the number of ids before it
+    struct tu_pos{
+      uint64_t offset = ~(uint64_t)0;
+      uint64_t ids = 0;
+    };
+
+    struct tu_record{
+      tu_record_kind kind;
+      tu_text key;          // registry key (declhash of functions, fops keys embed ids)
+      std::string hash;     // definition hash of functions
+      uint64_t value = 0;   // entry kind, record flag of types or the type registration of refs
+      tu_text text;
+      tu_pos fields[entry_output::FIELD_NUM][2];
+      std::vector<tu_text> refs;  // ids and definitions of refs
+      // state of a recorded TU
+      size_t id = 0;
+      std::shared_ptr<entry_output> out;
+      const std::string *shifted_key = nullptr;
+      std::string first;                   // first rendering of the entry
+      std::vector<std::string> first_refs; // refs given in the first rendering
+      bool relocated = false;
+    };
+
+    thread_local bool TURecording = false;
+    thread_local bool TUValid = false;
+    thread_local std::string TUKey;
+    thread_local size_t TUFid = 0;
+    thread_local std::vector<tu_record> TURecords;
+    // registrations by id space and id
+    thread_local std::map<std::pair<unsigned,size_t>,size_t> TUSlots;
+    // type registrations by their used references
+    thread_local std::unordered_map<void*,size_t> TURefsRecords;
+    // first record of the current AST and the next refs record of the second rendering
+    thread_local size_t TURelocStart = 0;
+    thread_local size_t TURefsNext = 0;
+    thread_local bool TURelocating = false;
+
+    void putU64(std::string &s, uint64_t v){
+      s.append(reinterpret_cast<const char*>(&v),sizeof(v));
+    }
+
+    void putStr(std::string &s, const std::string &v){
+      putU64(s,v.size());
+      s.append(v);
+    }
+
+    void putText(std::string &s, const tu_text &t){
+      putStr(s,t.text);
+      putU64(s,t.ids.size());
+      for(auto &id : t.ids){
+        putU64(s,id.first);
+        putU64(s,id.second);
+      }
+    }
+
+    struct tu_reader{
+      const char *p;
+      const char *end;
+      bool ok = true;
+
+      uint64_t u64(){
+        uint64_t v = 0;
+        if(!ok || end-p<(ptrdiff_t)sizeof(v)){
+          ok = false;
+          return 0;
+        }
+        memcpy(&v,p,sizeof(v));
+        p+=sizeof(v);
+        return v;
+      }
+
+      std::string str(){
+        uint64_t n = u64();
+        if(!ok || (uint64_t)(end-p)<n){
+          ok = false;
+          return std::string();
+        }
+        std::string v(p,n);
+        p+=n;
+        return v;
+      }
+
+      tu_text text(){
+        tu_text t;
+        t.text = str();
+        uint64_t n = u64();
+        for(uint64_t i = 0; i<n && ok; i++){
+          uint64_t offset = u64();
+          uint64_t slot = u64();
+          if(offset>t.text.size() || (i && offset<t.ids.back().first)) ok = false;
+          t.ids.push_back({offset,slot});
+        }
+        return t;
+      }
+    };
+
+    std::string contentDigest(llvm::StringRef data){
+      DeclHash h(true);
+      h.update(data.data(),data.size());
+      return h.digest();
+    }
+
+    bool fileDigest(const std::string &path, std::string &digest){
+      auto buf = llvm::MemoryBuffer::getFile(path);
+      if(!buf) return false;
+      digest = contentDigest((*buf)->getBuffer());
+      return true;
+    }
+
+    // Cuts the ids out of the first rendering using the second one (rendered with shifted ids); every other
+    // difference fails. The spans of the ids in the first rendering are returned in spans.
+    bool relocateText(const std::string &a, const std::string &b, tu_text &t,
+        std::vector<std::pair<size_t,size_t>> *spans = nullptr){
+      using ObjectID = DbJSONClassVisitor::ObjectID;
+      t.text.clear();
+      t.ids.clear();
+      size_t i = 0, j = 0;
+      while(i<a.size() && j<b.size()){
+        if(!isdigit(a[i]) || !isdigit(b[j])){
+          if(a[i] != b[j]) return false;
+          t.text.push_back(a[i]);
+          i++;
+          j++;
+          continue;
+        }
+        size_t ie = i, je = j;
+        while(ie<a.size() && isdigit(a[ie])) ie++;
+        while(je<b.size() && isdigit(b[je])) je++;
+        if(a.compare(i,ie-i,b,j,je-j) == 0){
+          t.text.append(a,i,ie-i);
+        }
+        else{
+          if(ie-i>18 || je-j>18) return false;
+          uint64_t va = std::stoull(a.substr(i,ie-i));
+          uint64_t vb = std::stoull(b.substr(j,je-j));
+          if(va>=ObjectID::ShiftUnit || vb<va || (vb-va)%ObjectID::ShiftUnit) return false;
+          uint64_t space = (vb-va)/ObjectID::ShiftUnit-1;
+          uint64_t slot;
+          if(space == ObjectID::SPACE_FID){
+            if(va != TUFid) return false;
+            slot = TUFidSlot;
+          }
+          else{
+            auto s = TUSlots.find({space,va});
+            if(s == TUSlots.end()) return false;
+            slot = s->second;
+          }
+          t.ids.push_back({t.text.size(),slot});
+          if(spans) spans->push_back({i,ie});
+        }
+        i = ie;
+        j = je;
+      }
+      return i == a.size() && j == b.size();
+    }
+
+    // Position in the text without ids of a position in the first rendering (not inside of an id)
+    bool relocatePos(size_t pos, const std::vector<std::pair<size_t,size_t>> &spans, tu_pos &p){
+      if(pos == std::string::npos) return true;
+      size_t cut = 0;
+      p.ids = 0;
+      for(auto &span : spans){
+        if(span.second<=pos){
+          cut+=span.second-span.first;
+          p.ids++;
+        }
+        else if(span.first<pos) return false;
+      }
+      p.offset = pos-cut;
+      return true;
+    }
+
+    // Text with the ids returned by the registrations of a replayed TU; lengths receives the length of each id
+    std::string renderText(const tu_text &t, const std::vector<size_t> &ids, std::vector<size_t> *lengths = nullptr){
+      std::string s;
+      size_t pos = 0;
+      for(auto &id : t.ids){
+        s.append(t.text,pos,id.first-pos);
+        std::string v = std::to_string(id.second == TUFidSlot ? TUFid : ids[id.second]);
+        if(lengths) lengths->push_back(v.size());
+        s.append(v);
+        pos = id.first;
+      }
+      s.append(t.text,pos,std::string::npos);
+      return s;
+    }
+
+    size_t renderPos(const tu_pos &p, const std::vector<size_t> &lengths){
+      if(p.offset == ~(uint64_t)0) return std::string::npos;
+      size_t pos = p.offset;
+      for(uint64_t i = 0; i<p.ids; i++) pos+=lengths[i];
+      return pos;
+    }
+
+    // Adds a registration to the recorded TU and returns the output the entry is rendered to
+    std::shared_ptr<entry_output> recordTU(tu_record_kind kind, const std::string &key, const std::string &hash,
+        uint64_t value, const registration &r, int space){
+      if(!TURecording) return r.out;
+      if(space>=0){
+        // shifted ids must stay apart and fit in an int
+        if(r.id>=DbJSONClassVisitor::ObjectID::ShiftUnit) TUValid = false;
+        TUSlots.insert({{space,r.id},TURecords.size()});
+      }
+      TURecords.emplace_back();
+      tu_record &rec = TURecords.back();
+      rec.kind = kind;
+      rec.key.text = key;
+      rec.hash = hash;
+      rec.value = value;
+      rec.id = r.id;
+      rec.out = r.out ? r.out : std::make_shared<entry_output>();
+      return rec.out;
+    }
+
+    bool storeTU(const std::vector<std::string> &deps){
+      std::string data = TUCacheMagic;
+      putU64(data,deps.size());
+      for(auto &dep : deps){
+        std::string digest;
+        if(!fileDigest(dep,digest)) return false;
+        putStr(data,dep);
+        putStr(data,digest);
+      }
+      putU64(data,TURecords.size());
+      for(auto &rec : TURecords){
+        if(!rec.relocated) return false;
+        data.push_back(rec.kind);
+        putText(data,rec.key);
+        putStr(data,rec.hash);
+        putU64(data,rec.value);
+        if(rec.kind == TU_REFS){
+          putU64(data,rec.refs.size());
+          for(auto &ref : rec.refs) putText(data,ref);
+          continue;
+        }
+        putText(data,rec.text);
+        for(auto &f : rec.fields){
+          for(auto &p : f){
+            putU64(data,p.offset);
+            putU64(data,p.ids);
+          }
+        }
+      }
+
+      // write under a temporary name so that readers never see a partial entry
+      int fd;
+      llvm::SmallString<128> tmp;
+      if(llvm::sys::fs::createUniqueFile(TUCacheDir+"/"+TUKey+"-%%%%%%.tmp",fd,tmp)){
+        llvm::errs()<<"Failed to create TU cache entry\n";
+        return false;
+      }
+      {
+        llvm::raw_fd_ostream os(fd,true);
+        os<<data;
+        os.close();
+        if(os.has_error()){
+          os.clear_error();
+          llvm::errs()<<"Failed to write TU cache entry\n";
+          llvm::sys::fs::remove(tmp);
+          return false;
+        }
+      }
+      if(llvm::sys::fs::rename(tmp,TUCacheDir+"/"+TUKey+".tu")){
+        llvm::errs()<<"Failed to write TU cache entry\n";
+        llvm::sys::fs::remove(tmp);
+        return false;
+      }
+      return true;
     }
-    else{
-      fops_data.output = nullptr;
+
+    // Reads a cache entry; every id reference is checked so that the registrations can be applied safely
+    bool loadTU(tu_reader &r, std::vector<tu_record> &records){
+      auto valid = [&records](const tu_text &t, size_t limit){
+        for(auto &id : t.ids){
+          if(id.second == TUFidSlot) continue;
+          if(id.second>=limit || records[id.second].kind>=TU_FOPS) return false;
+        }
+        return true;
+      };
+      uint64_t nrecords = r.u64();
+      for(uint64_t i = 0; i<nrecords && r.ok; i++){
+        if(r.p>=r.end) return false;
+        records.emplace_back();
+        tu_record &rec = records.back();
+        uint64_t kind = (unsigned char)*r.p++;
+        if(kind>TU_REFS) return false;
+        rec.kind = (tu_record_kind)kind;
+        rec.key = r.text();
+        rec.hash = r.str();
+        rec.value = r.u64();
+        // only fops keys refer to (earlier) registrations
+        if(!r.ok || (rec.kind != TU_FOPS && rec.key.ids.size()) || !valid(rec.key,i)) return false;
+        if(rec.kind == TU_REFS){
+          uint64_t n = r.u64();
+          for(uint64_t k = 0; k<n && r.ok; k++){
+            rec.refs.push_back(r.text());
+          }
+          if(rec.refs.size()%2 || rec.value>=i || records[rec.value].kind != TU_TYPE || !records[rec.value].value) return false;
+          continue;
+        }
+        rec.text = r.text();
+        for(auto &f : rec.fields){
+          for(auto &p : f){
+            p.offset = r.u64();
+            p.ids = r.u64();
+            if(p.offset != ~(uint64_t)0 && (p.offset>rec.text.text.size() || p.ids>rec.text.ids.size())) return false;
+          }
+        }
+      }
+      if(!r.ok || r.p != r.end) return false;
+      for(auto &rec : records){
+        if(!valid(rec.text,records.size())) return false;
+        for(auto &ref : rec.refs){
+          if(!valid(ref,records.size())) return false;
+        }
+      }
+      return true;
     }
+  }
 
+  std::string directory;
+  std::vector<std::string> files;
+
+  void setShardCount(unsigned count){
+    if(count<1) count = 1;
+    if(count>MaxShards) count = MaxShards;
+    ShardCount = count;
   }
 
-  void handleRefs(void *rv, std::vector<int> rIds,std::vector<std::string> rDef){
-    auto R = (usedrefs*)rv;
-    std::lock_guard<std::mutex> lock(R->m);
-    R->refs.resize(rIds.size());
-    for(size_t i = 0;i<rIds.size();i++){
-      auto &ref = R->refs[i];
-      if(rIds[i]>=0){
-        ref.id = rIds[i];
-        ref.def = rDef[i];
+  void enableLockStats(){
+    TrackLockWait = true;
+  }
+
+  void setSpillDirectory(std::string dir){
+    llvm::SmallString<128> path(dir);
+    llvm::sys::fs::make_absolute(path);
+    SpillDir = path.str().str();
+  }
+
+  void setTUCacheDirectory(std::string dir, std::string options){
+    llvm::SmallString<128> path(dir);
+    llvm::sys::fs::make_absolute(path);
+    if(auto EC = llvm::sys::fs::create_directories(path)){
+      llvm::errs()<<"Failed to create TU cache directory: "<<EC.message()<<'\n';
+      return;
+    }
+    TUCacheDir = path.str().str();
+    TUCacheOptions = options;
+  }
+
+  bool replayTU(size_t fid, const std::vector<std::string> &args){
+    if(TUCacheDir.empty()) return false;
+    // the entry only depends on the options and the compile commands of the TU
+    std::string key;
+    putStr(key,TUCacheOptions);
+    for(auto &arg : args) putStr(key,arg);
+    TUKey = llvm::toHex(contentDigest(key),true);
+    TUFid = fid;
+    // record the TU unless the cached entry is valid
+    TURecording = true;
+    TUValid = fid<DbJSONClassVisitor::ObjectID::ShiftUnit;
+
+    auto buf = llvm::MemoryBuffer::getFile(TUCacheDir+"/"+TUKey+".tu");
+    if(!buf) return false;
+    tu_reader r{(*buf)->getBufferStart(),(*buf)->getBufferEnd()};
+    if(!(*buf)->getBuffer().startswith(TUCacheMagic)) return false;
+    r.p+=TUCacheMagic.size();
+    uint64_t ndeps = r.u64();
+    for(uint64_t i = 0; i<ndeps && r.ok; i++){
+      std::string dep = r.str();
+      std::string digest = r.str();
+      std::string current;
+      if(!r.ok || !fileDigest(dep,current) || current != digest) return false;
+    }
+    std::vector<tu_record> records;
+    if(!r.ok || !loadTU(r,records)) return false;
+
+    TURecording = false;
+    std::vector<size_t> ids(records.size());
+    std::vector<registration> regs(records.size());
+    for(size_t i = 0; i<records.size(); i++){
+      auto &rec = records[i];
+      switch(rec.kind){
+        case TU_VAR: regs[i] = addVar(rec.key.text,rec.value); break;
+        case TU_TYPE: regs[i] = addType(rec.key.text,rec.value); break;
+        case TU_FUNCDECL: regs[i] = addFuncDecl(rec.key.text); break;
+        case TU_FUNCINTERNAL: regs[i] = addFuncInternal(rec.key.text,fid); break;
+        case TU_FUNC: regs[i] = addFunc(rec.key.text,rec.hash,rec.value,fid); break;
+        case TU_FOPS: regs[i].out = addFops(renderText(rec.key,ids)); break;
+        case TU_REFS: break;
+      }
+      ids[i] = regs[i].id;
+    }
+    for(size_t i = 0; i<records.size(); i++){
+      auto &rec = records[i];
+      if(rec.kind == TU_REFS){
+        std::vector<int> rIds;
+        std::vector<std::string> rDef;
+        size_t n = rec.refs.size()/2;
+        for(size_t k = 0; k<n; k++){
+          rIds.push_back(std::stoi(renderText(rec.refs[k],ids)));
+          rDef.push_back(renderText(rec.refs[n+k],ids));
+        }
+        addRefs(regs[rec.value].usedrefs,rIds,rDef);
+        continue;
+      }
+      auto &out = regs[i].out;
+      if(!out) continue;
+      std::vector<size_t> lengths;
+      out->text = renderText(rec.text,ids,&lengths);
+      for(unsigned f = 0; f<entry_output::FIELD_NUM; f++){
+        out->fields[f].begin = renderPos(rec.fields[f][0],lengths);
+        out->fields[f].end = renderPos(rec.fields[f][1],lengths);
+      }
+    }
+    finishTU();
+    return true;
+  }
+
+  void endTU(const std::vector<std::string> &deps, bool ok){
+    if(!TURecording) return;
+    TURecording = false;
+    if(ok && TUValid) storeTU(deps);
+    TURecords.clear();
+    TUSlots.clear();
+    TURefsRecords.clear();
+    TURelocStart = 0;
+  }
+
+  bool recordingTU(){
+    return TURecording;
+  }
+
+  // Keeps the first rendering of the entries aside and shifts the ids for the second one
+  void beginRelocation(){
+    for(size_t i = TURelocStart; i<TURecords.size(); i++){
+      auto &rec = TURecords[i];
+      if(!rec.out) continue;
+      rec.first.swap(rec.out->text);
+      for(unsigned f = 0; f<entry_output::FIELD_NUM; f++){
+        rec.fields[f][0].offset = rec.out->fields[f].begin;
+        rec.fields[f][1].offset = rec.out->fields[f].end;
+        rec.out->fields[f] = entry_output::span();
       }
-      if(ref.def.empty()){
-        ref.def = rDef[i];
+    }
+    TURefsNext = TURelocStart;
+    TURelocating = true;
+    DbJSONClassVisitor::ObjectID::shifted = true;
+  }
+
+  // Cuts the ids out of the entries rendered by the current AST and restores the first rendering
+  void endRelocation(){
+    DbJSONClassVisitor::ObjectID::shifted = false;
+    TURelocating = false;
+    for(size_t i = TURelocStart; i<TURecords.size(); i++){
+      auto &rec = TURecords[i];
+      if(rec.kind == TU_REFS){
+        if(!rec.relocated) TUValid = false;
+        continue;
+      }
+      if(rec.kind == TU_FOPS){
+        tu_text key;
+        if(!rec.shifted_key || !relocateText(rec.key.text,*rec.shifted_key,key)) TUValid = false;
+        rec.key = key;
+        rec.shifted_key = nullptr;
       }
+      std::vector<std::pair<size_t,size_t>> spans;
+      rec.relocated = relocateText(rec.first,rec.out->text,rec.text,&spans);
+      for(unsigned f = 0; f<entry_output::FIELD_NUM; f++){
+        size_t begin = rec.fields[f][0].offset;
+        size_t end = rec.fields[f][1].offset;
+        if(!relocatePos(begin,spans,rec.fields[f][0]) || !relocatePos(end,spans,rec.fields[f][1])) rec.relocated = false;
+        rec.out->fields[f].begin = begin;
+        rec.out->fields[f].end = end;
+      }
+      if(!rec.relocated) TUValid = false;
+      rec.out->text.swap(rec.first);
+      rec.out.reset();
+      std::string().swap(rec.first);
     }
+    TURelocStart = TURecords.size();
   }
 
-  void updateEntry(std::string name, char delim, std::string &data, std::string &repl){
-    auto begin = data.find("\"" + name+ "\":");
-    if(begin == std::string::npos){
-      llvm::errs()<<data<<'\n';
-      llvm::errs()<<repl<<'\n';
-      assert(0);
+  void finishTU(){
+    if(SpillFd<0 && !openSpillFile()){
+      // keep entries in memory
+      for(auto &out : Pending) out->length = out->text.size();
+      Pending.clear();
+      return;
     }
-    auto end = data.find(delim,begin);
-    data.replace(begin,end-begin+1,repl);
+    for(auto &out : Pending){
+      out->length = out->text.size();
+      if(!writeSpill(out->text)){
+        llvm::errs()<<"Failed to write spill file\n";
+        continue;
+      }
+      out->spill_fd = SpillFd;
+      out->spill_off = SpillSize;
+      SpillSize+=out->length;
+      std::string().swap(out->text);
+    }
+    Pending.clear();
+  }
+
+  void registerVar(DbJSONClassVisitor::VarData &var_data){
+    int kind = var_data.Node->hasDefinition();
+    registration r = addVar(var_data.hash,kind);
+    var_data.id.setIDProper(r.id,DbJSONClassVisitor::ObjectID::SPACE_VAR);
+    var_data.output = recordTU(TU_VAR,var_data.hash,std::string(),kind,r,DbJSONClassVisitor::ObjectID::SPACE_VAR);
+  }
+
+  void registerType(DbJSONClassVisitor::TypeData &type_data){
+    bool record = type_data.T->getTypeClass() == Type::Record;
+    registration r = addType(type_data.hash,record);
+    type_data.id.setIDProper(r.id,DbJSONClassVisitor::ObjectID::SPACE_TYPE);
+    type_data.output = recordTU(TU_TYPE,type_data.hash,std::string(),record,r,DbJSONClassVisitor::ObjectID::SPACE_TYPE);
+    if(record){
+      type_data.usedrefs = r.usedrefs;
+      if(TURecording) TURefsRecords.insert({r.usedrefs,TURecords.size()-1});
+    }
+  }
+
+  void registerFuncDecl(DbJSONClassVisitor::FuncDeclData &func_data){
+    registration r = addFuncDecl(func_data.declhash);
+    func_data.id.setIDProper(r.id,DbJSONClassVisitor::ObjectID::SPACE_FUNC);
+    func_data.output = recordTU(TU_FUNCDECL,func_data.declhash,std::string(),0,r,DbJSONClassVisitor::ObjectID::SPACE_FUNC);
+  }
+
+  void registerFuncInternal(DbJSONClassVisitor::FuncData &func_data){
+    registration r = addFuncInternal(func_data.hash,func_data.fid);
+    func_data.id.setIDProper(r.id,DbJSONClassVisitor::ObjectID::SPACE_FUNC);
+    func_data.output = recordTU(TU_FUNCINTERNAL,func_data.hash,std::string(),0,r,DbJSONClassVisitor::ObjectID::SPACE_FUNC);
   }
 
-  void updateId(std::string& out, std::string& id){
-    auto begin = out.find("\"id\":");
-    auto end = out.find(',',begin);
-    out.replace(begin,end-begin+1,id);
+  void registerFunc(DbJSONClassVisitor::FuncData &func_data){
+    int kind = func_data.this_func->isWeak() ? 1 : 2; // weak : def 
+    registration r = addFunc(func_data.declhash,func_data.hash,kind,func_data.fid);
+    func_data.id.setIDProper(r.id,DbJSONClassVisitor::ObjectID::SPACE_FUNC);
+    func_data.output = recordTU(TU_FUNC,func_data.declhash,func_data.hash,kind,r,DbJSONClassVisitor::ObjectID::SPACE_FUNC);
   }
 
-  void updateFids(std::string& out, std::string& fids){
-    auto begin = out.find("\"fids\":");
-    auto end = out.find(']',begin);
-    out.replace(begin,end-begin+1,fids);
+  void registerFops(DbJSONClassVisitor::FopsData &fops_data){
+    registration r;
+    r.out = addFops(fops_data.hash);
+    fops_data.output = recordTU(TU_FOPS,fops_data.hash,std::string(),0,r,-1);
+    // the key embeds ids, it is relocated with the key computed for the second rendering
+    if(TURecording) TURecords.back().shifted_key = &fops_data.hash;
   }
 
-  void updateRefs(std::string &out, std::string &refs){
-    auto begin = out.find("\"usedrefs\":");
-    auto end = out.find(']',begin);
-    out.replace(begin,end-begin+1,refs);
+  void handleRefs(void *rv, std::vector<int> rIds,std::vector<std::string> rDef){
+    if(TURelocating){
+      // second rendering of the recorded refs
+      auto t = TURefsRecords.find(rv);
+      while(TURefsNext<TURecords.size() && TURecords[TURefsNext].kind != TU_REFS) TURefsNext++;
+      if(t == TURefsRecords.end() || TURefsNext == TURecords.size()){
+        TUValid = false;
+        return;
+      }
+      auto &rec = TURecords[TURefsNext++];
+      std::vector<std::string> second;
+      for(auto id : rIds) second.push_back(std::to_string(id));
+      second.insert(second.end(),rDef.begin(),rDef.end());
+      rec.relocated = rec.value == t->second && rec.first_refs.size() == second.size() && rIds.size() == rDef.size();
+      rec.refs.resize(second.size());
+      for(size_t i = 0; i<second.size() && rec.relocated; i++){
+        rec.relocated = relocateText(rec.first_refs[i],second[i],rec.refs[i]);
+      }
+      rec.first_refs.clear();
+      return;
+    }
+    if(TURecording){
+      auto t = TURefsRecords.find(rv);
+      if(t == TURefsRecords.end()) TUValid = false;
+      else{
+        TURecords.emplace_back();
+        tu_record &rec = TURecords.back();
+        rec.kind = TU_REFS;
+        rec.value = t->second;
+        for(auto id : rIds) rec.first_refs.push_back(std::to_string(id));
+        rec.first_refs.insert(rec.first_refs.end(),rDef.begin(),rDef.end());
+      }
+    }
+    addRefs(rv,rIds,rDef);
   }
 
   void processDatabase(){
     Vars.resize(VarId);
-    for(auto &v : VarMap){
-      Vars[v.second.id] = &v.second;
+    for(unsigned i = 0; i<ShardCount; i++){
+      for(auto &v : VarShards[i].map){
+        Vars[v.second.id] = &v.second;
+      }
     }
     Types.resize(TypeId);
-    for(auto &t : TypeMap){
-      Types[t.second.id] = &t.second;
+    for(unsigned i = 0; i<ShardCount; i++){
+      for(auto &t : TypeShards[i].map){
+        Types[t.second.id] = &t.second;
+      }
     }
     Funcs.resize(FuncId);
-    for(auto &f : FuncMap){
-      Funcs[f.second.id] = &f.second;
+    for(unsigned i = 0; i<ShardCount; i++){
+      for(auto &f : FuncShards[i].map){
+        Funcs[f.second.id] = &f.second;
+      }
     }
 
-    // update id
-    for(auto f : FixIdFuncs){
-      std::string id = "\"id\": ";
-      id+=std::to_string(Funcs[f]->id)+',';
-      std::string &out = *Funcs[f]->out;
-      updateId(out,id);
-    }
+    for(unsigned i = 0; i<ShardCount; i++){
+      func_shard &s = FuncShards[i];
+      // update id
+      for(auto f : s.fixid){
+        auto &id = Funcs[f]->out->fields[entry_output::ID];
+        assert(id.begin != std::string::npos && "Missing id field");
+        id.repl = std::to_string(Funcs[f]->id);
+      }
 
-    // update fids
-    for(auto &f : FuncFids){
-      if(Funcs[f.first]->kind == 0) continue;
-      std::string fids = "\"fids\": [";
-      for(auto fid : f.second){
-        fids += " " + std::to_string(fid) + ",";
+      // update fids
+      for(auto &f : s.fids){
+        if(Funcs[f.first]->kind == 0) continue;
+        std::string fids = "[";
+        for(auto fid : f.second){
+          fids += " " + std::to_string(fid) + ",";
+        }
+        fids.pop_back();
+        fids+=" ]";
+        auto &field = Funcs[f.first]->out->fields[entry_output::FIDS];
+        assert(field.begin != std::string::npos && "Missing fids field");
+        field.repl = fids;
       }
-      fids.pop_back();
-      fids+=" ]";
-      std::string &out = *Funcs[f.first]->out;
-      updateFids(out,fids);
     }
 
     // update usedrefs
-    for(auto &t : TypeUsedRefs){
-      if(t.second.refs.empty()) continue;
-      std::string &out = *Types[t.first]->out;
-      std::string usedrefs = "\"usedrefs\": [";
-      std::string useddef = "\"useddef\": [";
-      for(auto &ref : t.second.refs){
-        usedrefs+= " " + std::to_string(ref.id) + ",";
+    for(unsigned i = 0; i<ShardCount; i++){
+      for(auto &t : TypeShards[i].refs){
+        if(t.second.refs.empty()) continue;
+        entry_output &out = *Types[t.first]->out;
+        std::string usedrefs = "[";
+        std::string useddef = "[";
+        for(auto &ref : t.second.refs){
+          usedrefs+= " " + std::to_string(ref.id) + ",";
+          if(DISABLED && opts.adddefs && opts.csd){
+            useddef+= " \"" + json::json_escape(ref.def) + "\",";
+          }
+        }
+        usedrefs.pop_back();
+        usedrefs+=" ]";
+        assert(out.fields[entry_output::USEDREFS].begin != std::string::npos && "Missing usedrefs field");
+        out.fields[entry_output::USEDREFS].repl = usedrefs;
         if(DISABLED && opts.adddefs && opts.csd){
-          useddef+= " \"" + json::json_escape(ref.def) + "\",";
+          useddef.pop_back();
+          useddef += " ]";
+          out.fields[entry_output::USEDDEF].repl = useddef;
         }
       }
-      usedrefs.pop_back();
-      usedrefs+=" ]";
-      updateEntry("usedrefs",']',out,usedrefs);
-      if(DISABLED && opts.adddefs && opts.csd){
-        useddef.pop_back();
-        useddef += " ]";
-        updateEntry("useddef",']',out,useddef);
-      }
     }
   }
 
   void emitDatabase(llvm::raw_ostream &db_file){
     bool first;
+    std::string buf;
     db_file << "{\n";
     db_file << "\t\"sourcen\": " << multi::files.size() << ",\n";
     db_file << "\t\"sources\": [\n";
@@ -5117,19 +5901,20 @@ namespace multi{
     db_file << "\n\t],\n";
 
     db_file << "\t\"directory\": \"" << multi::directory << "\",\n";
+    db_file << "\t\"hash_scheme\": \"" << DeclHash::schemeName(opts.fasthash) << "\",\n";
     db_file << "\t\"typen\": " << TypeId << ",\n";
     db_file << "\t\"globaln\": " << VarId << ",\n";
     db_file << "\t\"funcdecln\": " << FuncDeclCnt << ",\n";
     db_file << "\t\"funcn\": " << FuncId - FuncDeclCnt << ",\n";
     db_file << "\t\"unresolvedfuncn\": " << 0 << ",\n";
-    db_file << "\t\"fopn\": " <<FopsMap.size()<<",\n";
+    db_file << "\t\"fopn\": " <<FopsCnt<<",\n";
 
     db_file << "\t\"globals\": [\n";
     first = true;
     for(size_t i = 0; i< VarId;i++){
       if(first) first = false;
       else db_file << ",\n";
-      db_file<<*(Vars.at(i)->out);
+      writeEntry(db_file,*Vars.at(i)->out,buf);
     }
     db_file << "\n\t],\n";
 
@@ -5138,7 +5923,7 @@ namespace multi{
     for(size_t i = 0; i< TypeId;i++){
       if(first) first = false;
       else db_file << ",\n";
-      db_file<<*(Types.at(i)->out);
+      writeEntry(db_file,*Types.at(i)->out,buf);
     }
     db_file << "\n\t],\n";
 
@@ -5151,7 +5936,7 @@ namespace multi{
       }
       if(first) first = false;
       else db_file << ",\n";
-      db_file<<*(Funcs.at(i)->out);
+      writeEntry(db_file,*Funcs.at(i)->out,buf);
     }
     db_file << "\n\t],\n";
 
@@ -5160,7 +5945,7 @@ namespace multi{
     for(size_t i = 0; i< FuncDeclCnt;i++){
       if(first) first = false;
       else db_file << ",\n";
-      db_file<<*(FDecls.at(i)->out);
+      writeEntry(db_file,*FDecls.at(i)->out,buf);
     }
     db_file << "\n\t],\n";
 
@@ -5168,10 +5953,12 @@ namespace multi{
 
     db_file << "\t\"fops\": [\n";
     first = true;
-    for(auto i = FopsMap.begin(); i != FopsMap.end();i++){
-      if(first) first = false;
-      else db_file << ",\n";
-      db_file<<*(i->second.out);
+    for(unsigned s = 0; s<ShardCount; s++){
+      for(auto i = FopsShards[s].map.begin(); i != FopsShards[s].map.end();i++){
+        if(first) first = false;
+        else db_file << ",\n";
+        writeEntry(db_file,*i->second.out,buf);
+      }
     }
     db_file << "\n\t]\n";
 
@@ -5188,9 +5975,11 @@ namespace multi{
     unsigned long ttotal=0;
     unsigned long ftotal=0;
     std::vector<std::string> vmap(VarId);
-    for(auto &v :VarMap){
-      vmap[v.second.id] = v.first;
-      vtotal+=v.second.out.get()->length();
+    for(unsigned i = 0; i<ShardCount; i++){
+      for(auto &v :VarShards[i].map){
+        vmap[v.second.id] = v.first;
+        vtotal+=v.second.out->length;
+      }
     }
     for(size_t i =0;i<VarId;i++){
       llvm::outs()<<"G"<< llvm::format_decimal(i,8)<<"  "<<vmap[i]<<'\n';
@@ -5198,19 +5987,24 @@ namespace multi{
     }
 
     std::vector<std::string> tmap(TypeId);
-    for(auto &t :TypeMap){
-      tmap[t.second.id] = t.first;
-      ttotal+=t.second.out.get()->length();
+    for(unsigned i = 0; i<ShardCount; i++){
+      for(auto &t :TypeShards[i].map){
+        tmap[t.second.id] = t.first;
+        ttotal+=t.second.out->length;
+      }
     }
     for(size_t i =0;i<TypeId;i++){
       llvm::outs()<<"T"<< llvm::format_decimal(i,8)<<"  "<<tmap[i]<<'\n';
     }
 
     std::vector<std::string> fmap(FuncId);
-    for(auto &f :FuncMap){
-      fmap[f.second.id] = f.first;
-      assert(f.second.out && "Somehow empty pointer...");
-      ftotal+=f.second.out.get()->length();
+    for(unsigned i = 0; i<ShardCount; i++){
+      for(auto &f :FuncShards[i].map){
+        // function keys are binary digests
+        fmap[f.second.id] = DeclHash::hex(f.first);
+        assert(f.second.out && "Somehow empty pointer...");
+        ftotal+=f.second.out->length;
+      }
     }
     for(size_t i =0;i<FuncId;i++){
       llvm::outs()<<"F"<< llvm::format_decimal(i,8)<<"  "<<fmap[i]<<'\n';
@@ -5220,4 +6014,17 @@ namespace multi{
     llvm::errs()<<ttotal<<'\n';
     llvm::errs()<<ftotal<<'\n';
   }
+
+  void reportLockStats(){
+    auto report = [](const char *name, lock_stats &stats){
+      llvm::errs()<<"LOCK: "<<name<<" acquired: "<<stats.acquired.load()
+        <<" contended: "<<stats.contended.load()
+        <<" wait: "<<llvm::format("%.3f",stats.wait_ns.load()/1e6)<<" ms\n";
+    };
+    llvm::errs()<<"LOCK: shards: "<<ShardCount<<'\n';
+    report("vars",VarLockStats);
+    report("types",TypeLockStats);
+    report("funcs",FuncLockStats);
+    report("fops",FopsLockStats);
+  }
 }
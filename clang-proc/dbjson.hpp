@@ -17,8 +17,7 @@
 using namespace clang;
 
 #include "utils.h"
-#include "sha.h"
-#include "base64.h"
+#include "declhash.h"
 #include "printers.h"
 #include "MacroHandler.h"
 
@@ -49,6 +48,31 @@ struct anonRecord {
   std::string hash;
 };
 
+namespace multi{
+  // JSON text of a single database entry produced by one TU. Fields that are only final once all TUs
+  // are registered (function id and fids, record usedrefs and useddef) are tracked as spans of the text and
+  // replaced while the database is streamed out. The text itself is moved to a spill file as soon as
+  // the producing TU is finished.
+  struct entry_output{
+    enum field {ID,FIDS,USEDREFS,USEDDEF,FIELD_NUM};
+    struct span{
+      size_t begin = std::string::npos;
+      size_t end = std::string::npos;
+      std::string repl;
+    };
+    std::string text;
+    span fields[FIELD_NUM];
+    int spill_fd = -1;
+    uint64_t spill_off = 0;
+    size_t length = 0;
+
+    void setField(field f, size_t begin, size_t end){
+      fields[f].begin = begin;
+      fields[f].end = end;
+    }
+  };
+}
+
 static std::string JSONReplacementToken = "\"\"\"$\"\"\"";
 static std::string ORDReplacementToken = "\"\"\"@\"\"\"";
 static std::string ARGeplacementToken = "\"\"\"&\"\"\"";
@@ -173,13 +197,22 @@ public:
   class ObjectID{
       size_t _id = 0;
       bool is_set = false;
+      unsigned space = 0;
     public:
+      // Registry id spaces. While a TU is rendered for the TU cache a second time the ids of every space
+      // are shifted by a distinct multiple of ShiftUnit which tells the ids apart from other numbers
+      enum {SPACE_VAR,SPACE_TYPE,SPACE_FUNC,SPACE_FID,SPACE_NUM};
+      static constexpr size_t ShiftUnit = (size_t)1<<28;
+      static thread_local bool shifted;
+      static size_t shift(unsigned space){
+        return shifted ? (space+1)*ShiftUnit : 0;
+      }
       ObjectID(){}
       void setID(size_t id){_id = id;}
-      void setIDProper(size_t id){_id = id; is_set = true;}
+      void setIDProper(size_t id, unsigned space){_id = id; this->space = space; is_set = true;}
       operator size_t(){
         assert(is_set);
-        return _id;
+        return _id+shift(space);
       }
   };
   struct TypeData{
@@ -188,7 +221,7 @@ public:
     size_t size;
     recordInfo_t *RInfo;
     std::string hash;
-    std::shared_ptr<std::string> output;
+    std::shared_ptr<multi::entry_output> output;
     void *usedrefs;
   };
 
@@ -283,7 +316,7 @@ public:
     size_t func_id;
     std::string loc;
     std::map <size_t,std::set<const FunctionDecl*>> fops_info; //member_id : function id
-    std::shared_ptr<std::string>output;
+    std::shared_ptr<multi::entry_output> output;
 
     bool operator<(const FopsData &other) const {
       return obj <other.obj;
@@ -852,7 +885,7 @@ public:
     ObjectID id;
     const VarDecl *Node;
     std::string hash;
-    std::shared_ptr<std::string>output;
+    std::shared_ptr<multi::entry_output> output;
     std::set<QualType> g_refTypes;
     std::set<const VarDecl*> g_refVars;
     std::set<const FunctionDecl*> g_refFuncs;
@@ -1096,7 +1129,7 @@ public:
     std::string templatePars;
     std::string nms;
     int fid;
-    std::shared_ptr<std::string> output;
+    std::shared_ptr<multi::entry_output> output;
   };
 
   struct FuncData : public FuncDeclData{
@@ -1475,6 +1508,7 @@ public:
   void computeTypeHashes();
   void computeFuncHashes();
   void processFops();
+  void computeFopsIds(DbJSONClassVisitor::FopsData &fops_data);
   void getFuncTemplatePars(DbJSONClassVisitor::FuncDeclData *func_data);
   void getFuncDeclHash(DbJSONClassVisitor::FuncDeclData *func_data);
   void getFuncHash(DbJSONClassVisitor::FuncData *func_data);
@@ -1546,6 +1580,7 @@ private:
 void load_database(std::string filepath);
 int internal_declcount(const FunctionDecl *F);
 void taint_params(const clang::FunctionDecl *F, DbJSONClassVisitor::FuncData&);
+void taint_params_single_pass(const clang::FunctionDecl *F, DbJSONClassVisitor::FuncData&);
 bool isOwnedTagDeclType(QualType DT);
 QualType resolve_Typedef_Integer_Type(QualType T);
 
@@ -1651,6 +1686,8 @@ static inline QualType walkToFunctionProtoType(QualType T) {
 namespace multi{
   extern std::string directory;
   extern std::vector<std::string> files;
+  void setShardCount(unsigned count);
+  void enableLockStats();
   void registerVar(DbJSONClassVisitor::VarData&);
   void registerType(DbJSONClassVisitor::TypeData&);
   void registerFuncDecl(DbJSONClassVisitor::FuncDeclData&);
@@ -1658,7 +1695,16 @@ namespace multi{
   void registerFunc(DbJSONClassVisitor::FuncData&);
   void registerFops(DbJSONClassVisitor::FopsData&);
   void handleRefs(void *rv, std::vector<int> rIds,std::vector<std::string> rDef);
+  bool recordingTU();
+  void beginRelocation();
+  void endRelocation();
+  void finishTU();
+  void setSpillDirectory(std::string dir);
+  void setTUCacheDirectory(std::string dir, std::string options);
+  bool replayTU(size_t fid, const std::vector<std::string> &args);
+  void endTU(const std::vector<std::string> &deps, bool ok);
   void processDatabase();
   void emitDatabase(llvm::raw_ostream&);
   void report();
+  void reportLockStats();
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef DECLHASH_H
+#define DECLHASH_H
+
+#include "sha.h"
+#include "fasthash.h"
+#include "base64.h"
+
+#include <string>
+
+/*
+ * Hash of declaration data computed with the scheme selected by the -fasthash option:
+ *  - SHA-1 (default): the digest is the 64-byte final SHA context buffer (88 characters encoded)
+ *  - fast: the 128-bit MurmurHash3 digest (24 characters encoded)
+ * Digests are kept in binary form and encoded with base64 only when written to the database
+ *  or embedded into type strings.
+ */
+class DeclHash {
+public:
+	explicit DeclHash(bool fast): fast(fast) {
+		if (fast) FH128_init(&fh);
+		else SHA_init(&sha);
+	}
+
+	void update(const void *data, size_t len) {
+		if (fast) FH128_update(&fh,data,len);
+		else SHA_update(&sha,data,len);
+	}
+
+	void update(const std::string &s) {
+		update(s.data(),s.size());
+	}
+
+	std::string digest() {
+		if (fast) {
+			return std::string(reinterpret_cast<const char*>(FH128_final(&fh)),FH128_DIGEST_SIZE);
+		}
+		SHA_final(&sha);
+		return std::string(reinterpret_cast<const char*>(sha.buf.b),sizeof(sha.buf.b));
+	}
+
+	static std::string encode(const std::string &digest) {
+		return base64_encode(reinterpret_cast<const unsigned char*>(digest.data()),digest.size());
+	}
+
+	/* Printable form of a binary digest (e.g. for diagnostics) */
+	static std::string hex(const std::string &digest) {
+		static const char digits[] = "0123456789abcdef";
+		std::string out;
+		out.reserve(2*digest.size());
+		for (unsigned char c : digest) {
+			out.push_back(digits[c>>4]);
+			out.push_back(digits[c&15]);
+		}
+		return out;
+	}
+
+	static size_t encodedSize(bool fast) {
+		return fast ? 24 : 88;
+	}
+
+	/* Value of the "hash_scheme" database field */
+	static const char *schemeName(bool fast) {
+		return fast ? "murmur3_128" : "sha1";
+	}
+
+private:
+	bool fast;
+	SHA_CTX sha;
+	FH128_CTX fh;
+};
+
+#endif
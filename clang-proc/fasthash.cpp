@@ -0,0 +1,126 @@
+/*
+ MurmurHash3 was written by Austin Appleby, and is placed in the public
+ domain. The author hereby disclaims copyright to this source code.
+*/
+
+// Incremental form of MurmurHash3_x64_128 (seed 0). The digest is the same
+// as the one computed by the reference implementation over the whole input.
+
+#include "fasthash.h"
+
+#include <string.h>
+
+#define rotl64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static const uint64_t c1 = 0x87c37b91114253d5ULL;
+static const uint64_t c2 = 0x4cf5ad432745937fULL;
+
+static inline uint64_t load64(const uint8_t* p) {
+  uint64_t v = 0;
+  int i;
+  for (i = 7; i >= 0; --i) {
+    v = (v << 8) | p[i];
+  }
+  return v;
+}
+
+static inline uint64_t fmix64(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+static inline void FH128_block(FH128_CTX* ctx, const uint8_t* p) {
+  uint64_t k1 = load64(p);
+  uint64_t k2 = load64(p + 8);
+  uint64_t h1 = ctx->h1;
+  uint64_t h2 = ctx->h2;
+
+  k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+  h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+  k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+  h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+
+  ctx->h1 = h1;
+  ctx->h2 = h2;
+}
+
+void FH128_init(FH128_CTX* ctx) {
+  ctx->h1 = 0;
+  ctx->h2 = 0;
+  ctx->count = 0;
+}
+
+void FH128_update(FH128_CTX* ctx, const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*)data;
+  size_t i = ctx->count % sizeof(ctx->buf);
+
+  ctx->count += len;
+
+  if (i) {
+    size_t n = sizeof(ctx->buf) - i;
+    if (len < n) {
+      memcpy(ctx->buf + i, p, len);
+      return;
+    }
+    memcpy(ctx->buf + i, p, n);
+    FH128_block(ctx, ctx->buf);
+    p += n;
+    len -= n;
+  }
+  while (len >= sizeof(ctx->buf)) {
+    FH128_block(ctx, p);
+    p += sizeof(ctx->buf);
+    len -= sizeof(ctx->buf);
+  }
+  memcpy(ctx->buf, p, len);
+}
+
+const uint8_t* FH128_final(FH128_CTX* ctx) {
+  const uint8_t* tail = ctx->buf;
+  uint64_t h1 = ctx->h1;
+  uint64_t h2 = ctx->h2;
+  uint64_t k1 = 0;
+  uint64_t k2 = 0;
+  int i;
+
+  switch (ctx->count & 15) {
+    case 15: k2 ^= ((uint64_t)tail[14]) << 48; /* fall through */
+    case 14: k2 ^= ((uint64_t)tail[13]) << 40; /* fall through */
+    case 13: k2 ^= ((uint64_t)tail[12]) << 32; /* fall through */
+    case 12: k2 ^= ((uint64_t)tail[11]) << 24; /* fall through */
+    case 11: k2 ^= ((uint64_t)tail[10]) << 16; /* fall through */
+    case 10: k2 ^= ((uint64_t)tail[9]) << 8;   /* fall through */
+    case 9:  k2 ^= ((uint64_t)tail[8]);
+             k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+             /* fall through */
+    case 8:  k1 ^= ((uint64_t)tail[7]) << 56;  /* fall through */
+    case 7:  k1 ^= ((uint64_t)tail[6]) << 48;  /* fall through */
+    case 6:  k1 ^= ((uint64_t)tail[5]) << 40;  /* fall through */
+    case 5:  k1 ^= ((uint64_t)tail[4]) << 32;  /* fall through */
+    case 4:  k1 ^= ((uint64_t)tail[3]) << 24;  /* fall through */
+    case 3:  k1 ^= ((uint64_t)tail[2]) << 16;  /* fall through */
+    case 2:  k1 ^= ((uint64_t)tail[1]) << 8;   /* fall through */
+    case 1:  k1 ^= ((uint64_t)tail[0]);
+             k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+  }
+
+  h1 ^= ctx->count;
+  h2 ^= ctx->count;
+  h1 += h2;
+  h2 += h1;
+  h1 = fmix64(h1);
+  h2 = fmix64(h2);
+  h1 += h2;
+  h2 += h1;
+
+  for (i = 0; i < 8; ++i) {
+    ctx->digest[i] = (uint8_t)(h1 >> (8 * i));
+    ctx->digest[8 + i] = (uint8_t)(h2 >> (8 * i));
+  }
+  return ctx->digest;
+}
@@ -0,0 +1,37 @@
+/*
+ MurmurHash3 was written by Austin Appleby, and is placed in the public
+ domain. The author hereby disclaims copyright to this source code.
+*/
+
+// Incremental form of MurmurHash3_x64_128 (seed 0): a fast 128-bit
+// non-cryptographic hash used for declaration hashes with -fasthash.
+
+#ifndef _EMBEDDED_FASTHASH_H_
+#define _EMBEDDED_FASTHASH_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+typedef struct FH128_CTX {
+  uint64_t h1;
+  uint64_t h2;
+  uint64_t count;
+  uint8_t buf[16];
+  uint8_t digest[16];
+} FH128_CTX;
+
+void FH128_init(FH128_CTX* ctx);
+void FH128_update(FH128_CTX* ctx, const void* data, size_t len);
+const uint8_t* FH128_final(FH128_CTX* ctx);
+
+#define FH128_DIGEST_SIZE 16
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // _EMBEDDED_FASTHASH_H_
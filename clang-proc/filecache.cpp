@@ -0,0 +1,146 @@
+#include "filecache.h"
+
+#include "llvm/Support/Path.h"
+
+using namespace llvm;
+
+namespace {
+	// File opened through the cache, refers to the contents owned by the cache
+	class CachedFile : public vfs::File {
+	public:
+		CachedFile(vfs::Status S, const MemoryBuffer &Buffer): S(std::move(S)), Buffer(Buffer) {}
+
+		ErrorOr<vfs::Status> status() override {
+			return S;
+		}
+
+		ErrorOr<std::unique_ptr<MemoryBuffer>> getBuffer(const Twine &Name, int64_t FileSize,
+				bool RequiresNullTerminator, bool IsVolatile) override {
+			return MemoryBuffer::getMemBuffer(Buffer.getBuffer(),Name.str(),RequiresNullTerminator);
+		}
+
+		std::error_code close() override {
+			return {};
+		}
+
+	private:
+		vfs::Status S;
+		const MemoryBuffer &Buffer;
+	};
+}
+
+void SharedFileCache::report(raw_ostream &os) {
+	os<<"LOG: FILES status: "<<status_calls<<" (cached "<<status_cached<<")"
+		<<" open: "<<open_calls<<" (cached "<<open_cached<<")"
+		<<" cached contents: "<<(bytes_cached>>20)<<" MB\n";
+}
+
+CachingFileSystem::CachingFileSystem(IntrusiveRefCntPtr<vfs::FileSystem> FS, SharedFileCache &Cache):
+		ProxyFileSystem(std::move(FS)), Cache(Cache) {
+	if (auto WD = ProxyFileSystem::getCurrentWorkingDirectory()) {
+		WorkingDirectory = *WD;
+	}
+}
+
+ErrorOr<std::string> CachingFileSystem::getCurrentWorkingDirectory() const {
+	if (WorkingDirectory.empty()) {
+		return ProxyFileSystem::getCurrentWorkingDirectory();
+	}
+	return WorkingDirectory;
+}
+
+std::error_code CachingFileSystem::setCurrentWorkingDirectory(const Twine &Path) {
+	if (auto EC = ProxyFileSystem::setCurrentWorkingDirectory(Path)) {
+		return EC;
+	}
+	SmallString<256> WD;
+	Path.toVector(WD);
+	if (!sys::path::is_absolute(WD)) {
+		// resolve against the previous working directory
+		WD = cacheKey(Path);
+	}
+	WorkingDirectory = WD.str().str();
+	return {};
+}
+
+std::string CachingFileSystem::cacheKey(const Twine &Path) const {
+	SmallString<256> Key;
+	Path.toVector(Key);
+	if (!sys::path::is_absolute(Key)) {
+		SmallString<256> Abs(WorkingDirectory);
+		sys::path::append(Abs,Key);
+		Key = Abs;
+	}
+	// '..' is kept as it is not equivalent to the parent directory with symbolic links
+	sys::path::remove_dots(Key,false);
+	return Key.str().str();
+}
+
+ErrorOr<vfs::Status> CachingFileSystem::status(const Twine &Path) {
+	std::string Key = cacheKey(Path);
+	Cache.status_calls++;
+	if (!Cache.enabled) {
+		return ProxyFileSystem::status(Path);
+	}
+	{
+		std::lock_guard<std::mutex> lock(Cache.m);
+		auto i = Cache.entries.find(Key);
+		if (i!=Cache.entries.end() && i->second.has_status) {
+			Cache.status_cached++;
+			if (i->second.error) return i->second.error;
+			return vfs::Status::copyWithNewName(i->second.status,Path);
+		}
+	}
+	auto S = ProxyFileSystem::status(Path);
+	std::lock_guard<std::mutex> lock(Cache.m);
+	SharedFileCache::entry &e = Cache.entries[Key];
+	if (!e.has_status) {
+		e.has_status = true;
+		if (S) e.status = *S;
+		else e.error = S.getError();
+	}
+	return S;
+}
+
+ErrorOr<std::unique_ptr<vfs::File>> CachingFileSystem::openFileForRead(const Twine &Path) {
+	std::string Key = cacheKey(Path);
+	Cache.open_calls++;
+	if (!Cache.enabled) {
+		return ProxyFileSystem::openFileForRead(Path);
+	}
+	unsigned opens;
+	{
+		std::lock_guard<std::mutex> lock(Cache.m);
+		SharedFileCache::entry &e = Cache.entries[Key];
+		if (e.buffer) {
+			Cache.open_cached++;
+			return std::unique_ptr<vfs::File>(new CachedFile(vfs::Status::copyWithNewName(e.status,Path),*e.buffer));
+		}
+		if (e.has_status && e.error) {
+			Cache.open_cached++;
+			return e.error;
+		}
+		opens = ++e.opens;
+	}
+
+	auto F = ProxyFileSystem::openFileForRead(Path);
+	if (!F || opens<2) return F;
+
+	// keep the contents of files opened repeatedly
+	auto S = (*F)->status();
+	if (!S || !S->isRegularFile()) return F;
+	auto B = (*F)->getBuffer(Key,S->getSize(),true,false);
+	(*F)->close();
+	if (!B) return B.getError();
+
+	std::lock_guard<std::mutex> lock(Cache.m);
+	SharedFileCache::entry &e = Cache.entries[Key];
+	if (!e.buffer) {
+		Cache.bytes_cached+=(*B)->getBufferSize();
+		e.buffer = std::move(*B);
+		e.has_status = true;
+		e.error = std::error_code();
+		e.status = *S;
+	}
+	return std::unique_ptr<vfs::File>(new CachedFile(vfs::Status::copyWithNewName(e.status,Path),*e.buffer));
+}
@@ -0,0 +1,64 @@
+#ifndef FILECACHE_H
+#define FILECACHE_H
+
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/*
+ * Process-wide cache of file status and file contents shared by the ClangTool instances of all worker threads.
+ * Entries are keyed by absolute path. Failed lookups are cached as well, as most of the status calls come from
+ * the include path search. Contents are kept once a file is opened for the second time, so headers are read
+ * from disk at most twice per run, while source files used by a single translation unit are not retained.
+ * A disabled cache only counts the requests passed to the file system.
+ */
+class SharedFileCache {
+public:
+	struct entry {
+		bool has_status = false;
+		std::error_code error;
+		llvm::vfs::Status status;
+		unsigned opens = 0;
+		std::unique_ptr<llvm::MemoryBuffer> buffer;
+	};
+
+	bool enabled = true;
+	std::atomic<uint64_t> status_calls{0};
+	std::atomic<uint64_t> status_cached{0};
+	std::atomic<uint64_t> open_calls{0};
+	std::atomic<uint64_t> open_cached{0};
+	std::atomic<uint64_t> bytes_cached{0};
+
+	std::mutex m;
+	std::unordered_map<std::string,entry> entries;
+
+	void report(llvm::raw_ostream &os);
+};
+
+/*
+ * File system of a single worker thread which answers status and open requests from the shared cache.
+ * The working directory is passed to the underlying file system (the process working directory is private
+ * to the worker thread) and remembered, so that relative paths are resolved without querying it.
+ */
+class CachingFileSystem : public llvm::vfs::ProxyFileSystem {
+public:
+	CachingFileSystem(llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS, SharedFileCache &Cache);
+
+	llvm::ErrorOr<llvm::vfs::Status> status(const llvm::Twine &Path) override;
+	llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>> openFileForRead(const llvm::Twine &Path) override;
+	llvm::ErrorOr<std::string> getCurrentWorkingDirectory() const override;
+	std::error_code setCurrentWorkingDirectory(const llvm::Twine &Path) override;
+
+private:
+	SharedFileCache &Cache;
+	std::string WorkingDirectory;
+
+	std::string cacheKey(const llvm::Twine &Path) const;
+};
+
+#endif
@@ -1,7 +1,11 @@
 #include "main.hpp"
 #include "dbjson.hpp"
+#include "filecache.h"
+#include "clang/Frontend/Utils.h"
+#include "llvm/Support/FileSystem.h"
 
 #include <thread>
+#include <algorithm>
 
 //option used in DeclPrinter
 bool enable_sa = 0;
@@ -58,9 +62,15 @@ ArgumentsAdjuster getClangStripDependencyFileAdjusterFixed() {
   };
 }
 
+// Collects every file read while preprocessing a TU (including system headers) for the TU cache
+class TUDependencyCollector : public DependencyCollector {
+public:
+  bool needSystemDependencies() override { return true; }
+};
+
 class DbJSONClassAction : public clang::ASTFrontendAction {
 public:
-	DbJSONClassAction(size_t fid): file_id(fid) {}
+	DbJSONClassAction(size_t fid, std::shared_ptr<TUDependencyCollector> deps): file_id(fid), deps(deps) {}
   virtual std::unique_ptr<clang::ASTConsumer> CreateASTConsumer (
     clang::CompilerInstance &Compiler, llvm::StringRef InFile) override {
     return std::unique_ptr<clang::ASTConsumer>(
@@ -70,10 +80,13 @@ public:
     // CI.getInvocation().generateCC1CommandLine([](const llvm::Twine &arg){llvm::errs()<<arg<<' ';});
     // llvm::errs()<<'\n';
 	  Preprocessor &PP = CI.getPreprocessor();
+    if(deps)
+      deps->attachToPreprocessor(PP);
     return true;
   }
 
   size_t file_id;
+  std::shared_ptr<TUDependencyCollector> deps;
 };
 
 template <class Action>
@@ -112,6 +125,7 @@ cl::opt<bool> DefsOption("F", cl::cat(ctCategory));
 cl::opt<bool> SwitchOption("s", cl::cat(ctCategory));
 cl::opt<bool> CSOption("t", cl::cat(ctCategory));
 cl::opt<std::string> TaintOption("pt", cl::cat(ctCategory),cl::desc("Generate taint info for functions' parameters"),cl::value_desc("database"));
+cl::opt<bool> TaintMatchersOption("ptm", cl::cat(ctCategory),cl::desc("Use the AST matcher based taint propagation instead of the single-pass engine"));
 cl::opt<bool> TUDumpOption("u", cl::cat(ctCategory));
 cl::opt<bool> TUDumpContOption("U", cl::cat(ctCategory));
 cl::opt<bool> RecordLocOption("L", cl::cat(ctCategory));
@@ -124,10 +138,19 @@ cl::opt<bool> enableStaticAssert("sa", cl::cat(ctCategory));
 cl::opt<bool> modifyStandardIncludes("nostdinc", cl::cat(ctCategory));
 cl::opt<bool> MultiOption("multi", cl::cat(ctCategory));
 cl::opt<unsigned int> ThreadCount("tc",cl::cat(ctCategory),cl::init(0));
-
+cl::opt<unsigned int> ShardCount("shards",cl::cat(ctCategory),cl::init(64),cl::desc("Number of lock shards per global registry in multi mode (1 for a single lock)"));
+cl::opt<bool> LockStatsOption("lock-stats",cl::cat(ctCategory),cl::desc("Report registry lock wait times in multi mode"));
+cl::opt<std::string> SpillDirOption("spill-dir",cl::cat(ctCategory),cl::desc("Directory for intermediate per-TU database entries (system temporary directory by default)"),cl::value_desc("dir"));
+cl::opt<std::string> TUCacheOption("tu-cache",cl::cat(ctCategory),cl::desc("Directory of the persistent per-TU result cache"),cl::value_desc("dir"));
+cl::opt<bool> NoFileCacheOption("no-file-cache",cl::cat(ctCategory),cl::desc("Do not share file status and contents between the worker threads"));
+cl::opt<bool> FileStatsOption("file-stats",cl::cat(ctCategory),cl::desc("Report the number of file system requests"));
+cl::opt<bool> FastHashOption("fasthash",cl::cat(ctCategory),cl::desc("Use a fast 128-bit non-cryptographic hash (MurmurHash3) instead of SHA-1 for declaration hashes"));
+
+bool tu_cache = false;
 std::string builtInIncludePath;
 std::map<std::string,std::string> macroReplacementTokens;
 struct main_opts opts;
+SharedFileCache FileCache;
 
 std::atomic_int32_t counter(0);
 void run(const CompilationDatabase &compilations,const CommandLineArguments &sources){
@@ -139,72 +162,105 @@ void run(const CompilationDatabase &compilations,const CommandLineArguments &sou
   int current = counter++;
   std::string buf;
   llvm::raw_string_ostream dbg(buf);
+  // created after unshare so that the working directory of this thread is used
+  llvm::IntrusiveRefCntPtr<CachingFileSystem> FS(new CachingFileSystem(llvm::vfs::getRealFileSystem(),FileCache));
 
   while(current<max){
     std::string file = sources.at(current);
     multi::files[current] = file;
     std::string directory = compilations.getCompileCommands(file).at(0).Directory;
-    ClangTool Tool(compilations,file);
+    ClangTool Tool(compilations,file,std::make_shared<PCHContainerOperations>(),FS);
     IgnoringDiagConsumer Diag;
     // Tool.setDiagnosticConsumer(&Diag);
+    ArgumentsAdjuster Adjuster;
+    auto appendAdjuster = [&](ArgumentsAdjuster A){
+      Tool.appendArgumentsAdjuster(A);
+      Adjuster = combineAdjusters(Adjuster,A);
+    };
 
     if (IncludeOption.getValue()) {
       auto arg = "-I" + builtInIncludePath;
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(arg.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(arg.c_str()));
     }
 
     for (unsigned i = 0; i != AdditionalIncludePathsOption.size(); ++i) {
       auto arg = "-I" + AdditionalIncludePathsOption[i];
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(arg.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(arg.c_str()));
     }
 
     if(modifyStandardIncludes.getValue()){
       std::string arg = "-nostdinc";
       std::string path;
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(arg.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(arg.c_str()));
 
       arg = "-isystem";
       path = "prebuilts/clang/host/linux-x86/clang-r522817/lib/clang/18/include";
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(arg.c_str()));
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(path.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(arg.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(path.c_str()));
 
       path = "prebuilts/gcc/linux-x86/host/x86_64-linux-glibc2.17-4.8/sysroot/usr/local/include";
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(arg.c_str()));
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(path.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(arg.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(path.c_str()));
 
       path = "prebuilts/gcc/linux-x86/host/x86_64-linux-glibc2.17-4.8/sysroot/usr/include/x86_64-linux-gnu";
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(arg.c_str()));
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(path.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(arg.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(path.c_str()));
 
       path = "prebuilts/gcc/linux-x86/host/x86_64-linux-glibc2.17-4.8/sysroot/include";
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(arg.c_str()));
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(path.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(arg.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(path.c_str()));
 
       path = "prebuilts/gcc/linux-x86/host/x86_64-linux-glibc2.17-4.8/sysroot/usr/include";
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(arg.c_str()));
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(path.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(arg.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(path.c_str()));
     }
 
     for (auto &token : macroReplacementTokens) {
       auto arg = "-D__macro_replacement__" + token.first + "=" + token.second;
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(arg.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(arg.c_str()));
     }
-    Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster("-Wno-implicit-function-declaration"));
+    appendAdjuster(getInsertArgumentAdjuster("-Wno-implicit-function-declaration"));
 
     for (unsigned i = 0; i != AdditionalDefinesOption.size(); ++i) {
       auto arg = "-D" + AdditionalDefinesOption[i];
-      Tool.appendArgumentsAdjuster(getInsertArgumentAdjuster(arg.c_str()));
+      appendAdjuster(getInsertArgumentAdjuster(arg.c_str()));
     }
 
-    Tool.appendArgumentsAdjuster(getStripWarningsAdjuster());
-    Tool.appendArgumentsAdjuster(getClangStripDependencyFileAdjusterFixed());
+    appendAdjuster(getStripWarningsAdjuster());
+    appendAdjuster(getClangStripDependencyFileAdjusterFixed());
 
     dbg<<llvm::format_decimal(current,6)<<"  "<<file<<"\n";
     dbg.flush();
     // llvm::errs()<<"LOG: "+buf;
 
-    DBFactory<DbJSONClassAction> Factory(current);
-    Tool.run(&Factory);
+    // effective command lines of the TU
+    std::vector<std::string> args;
+    if(tu_cache){
+      for(auto &cmd : compilations.getCompileCommands(file)){
+        args.push_back(cmd.Directory);
+        for(auto &arg : Adjuster(cmd.CommandLine,cmd.Filename))
+          args.push_back(arg);
+      }
+    }
+
+    if(tu_cache && multi::replayTU(current,args)){
+      dbg<<"        (cached)\n";
+      dbg.flush();
+    }
+    else{
+      auto deps = tu_cache ? std::make_shared<TUDependencyCollector>() : nullptr;
+      DBFactory<DbJSONClassAction> Factory(current,deps);
+      int status = Tool.run(&Factory);
+      if(tu_cache){
+        std::vector<std::string> depfiles;
+        for(auto &dep : deps->getDependencies()){
+          llvm::SmallString<128> path(dep);
+          llvm::sys::fs::make_absolute(directory,path);
+          depfiles.push_back(path.str().str());
+        }
+        multi::endTU(depfiles,status == 0);
+      }
+    }
 
     llvm::errs()<<"LOG: "+buf;
     buf.clear();
@@ -243,6 +299,7 @@ int main(int argc, const char **argv)
     opts.adddefs = DefsOption.getValue();
     opts.cstmt = CSOption.getValue();
     opts.taint = TaintOption.getValue().size();
+    opts.taint_matchers = TaintMatchersOption.getValue();
     opts.tudump = TUDumpOption.getValue();
     opts.tudumpcont = TUDumpContOption.getValue();
     opts.tudumpwithsrc = TUDumpWithSrcOption.getValue();
@@ -251,6 +308,7 @@ int main(int argc, const char **argv)
     opts.exit_on_error = ExitOnErrorOption.getValue();
     opts.csd = CustomStructDefs.getValue();
     opts.save_expansions = opts.addbody && SaveMacroExpansionOption.getValue();
+    opts.fasthash = FastHashOption.getValue();
 
     if (IncludeOption.getValue()) {
       builtInIncludePath = utils::getClangBuiltInIncludePath(argv[0]);
@@ -268,6 +326,37 @@ int main(int argc, const char **argv)
       load_database(TaintOption.getValue());
     }
 
+    if(SpillDirOption.getValue().size()){
+      multi::setSpillDirectory(SpillDirOption.getValue());
+    }
+
+    if(TUCacheOption.getValue().size()){
+      if(opts.onlysrc || opts.tudump || opts.tudumpcont || opts.tudumpwithsrc || opts.brk){
+        llvm::errs()<<"LOG: TU cache is not used with dump options, disabled\n";
+      }
+      else{
+        // entries are only valid for the same clang-proc options (the thread count doesn't change them)
+        std::string options;
+        auto sources = optionsParser.getSourcePathList();
+        for(int i = 1; i<argc; i++){
+          llvm::StringRef arg(argv[i]);
+          if(arg == "-tc" || arg == "--tc"){
+            i++;
+            continue;
+          }
+          if(arg.startswith("-tc=") || arg.startswith("--tc="))
+            continue;
+          if(std::find(sources.begin(),sources.end(),argv[i]) == sources.end())
+            options.append(argv[i]).push_back('\0');
+        }
+        multi::setTUCacheDirectory(TUCacheOption.getValue(),options);
+        tu_cache = true;
+      }
+    }
+
+    if(NoFileCacheOption.getValue())
+      FileCache.enabled = false;
+
     multi::directory = optionsParser.getCompilations().getCompileCommands(optionsParser.getSourcePathList().front())[0].Directory;
     multi::files.resize(AllFiles.size());
     if(MultiOption.getValue()){
@@ -275,6 +364,9 @@ int main(int argc, const char **argv)
       if(AllFiles.size()<threadcount)
         threadcount = AllFiles.size();
       llvm::errs()<<"LOG: "<<"Number of threads: "<<threadcount<<'\n';
+      multi::setShardCount(ShardCount.getValue());
+      if(LockStatsOption.getValue())
+        multi::enableLockStats();
 
       clang_prepare();
 
@@ -287,6 +379,10 @@ int main(int argc, const char **argv)
         t.join();
       }
       llvm::errs()<<"LOG: Done.\n";
+      if(FileStatsOption.getValue())
+        FileCache.report(llvm::errs());
+      if(LockStatsOption.getValue())
+        multi::reportLockStats();
 
       multi::processDatabase();
       multi::emitDatabase(llvm::outs());
@@ -294,6 +390,8 @@ int main(int argc, const char **argv)
     }
     else{ //normal pass for backwards compatibility
       run(std::ref(optionsParser.getCompilations()),std::ref(AllFiles));
+      if(FileStatsOption.getValue())
+        FileCache.report(llvm::errs());
       multi::processDatabase();
       multi::emitDatabase(llvm::outs());
     }
@@ -25,6 +25,7 @@ struct main_opts {
 	bool switchopt;
 	bool cstmt;
 	bool taint;
+	bool taint_matchers;
 	bool tudump;
 	bool tudumpcont;
 	bool tudumpwithsrc;
@@ -33,6 +34,7 @@ struct main_opts {
 	bool exit_on_error;
 	bool csd;
 	bool save_expansions;
+	bool fasthash;
 };
 
 extern main_opts opts;
@@ -1,51 +1,42 @@
 #include "clang/ASTMatchers/ASTMatchers.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h" 
 #include "clang/Tooling/Tooling.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "llvm/ADT/BitVector.h"
 #include <map>
 #include <set>
+#include <deque>
+#include <unordered_set>
 
 namespace json {
 class JSON;
 }
 
 #include "dbjson.hpp"
+#include "taintdb.h"
 
 using namespace clang::tooling;
 using namespace llvm;
 using namespace clang;
 using namespace ast_matchers;
 
-  typedef std::string name_t;
-  typedef int to_index;
-  typedef int from_index;
   typedef std::multimap<name_t,std::pair<to_index,from_index>> db_t;
-  typedef std::vector<std::pair<to_index,from_index>> data_t;
-  typedef std::unordered_map<name_t,data_t> ndb_t;
 
   ndb_t tracked_functions; 
   ndb_t tracked_functions_regex;
+  TaintIndex tracked_functions_index;
 
 //database
   int load_taint_function_database(std::string filepath, ndb_t &exact, ndb_t &regex);
   //loads database from file (called from main)
   void load_database(std::string filepath){
     load_taint_function_database(filepath, tracked_functions,tracked_functions_regex);
+    tracked_functions_index.build(tracked_functions,tracked_functions_regex);
   }
 
   //get taint info for function from database
-  const data_t* match_database(name_t name){
-    //fullname
-    for(auto &f : tracked_functions){
-      if(name.compare(f.first) == 0)
-        return &f.second;
-    }
-    //regex
-    for(auto &f : tracked_functions_regex){
-      if(name.compare(0,f.first.length(),f.first) == 0)
-        return &f.second;
-    }
-    //not found
-    return nullptr;
+  const data_t* match_database(const name_t &name){
+    return tracked_functions_index.match(name);
   }
 
 //declaration counting
@@ -336,3 +327,200 @@ using namespace ast_matchers;
       }
     }
   }
+
+//single pass tainting
+  //data flows of a function collected with a single traversal of its AST
+  //(the same flows the matchers above look for, in the order the matchers report them)
+  class TaintFlowCollector : public RecursiveASTVisitor<TaintFlowCollector> {
+    using Base = RecursiveASTVisitor<TaintFlowCollector>;
+    public:
+      typedef std::vector<const VarDecl*> refs_t;
+      struct flow_t {
+        const VarDecl *target;
+        refs_t *sources;
+      };
+      struct call_t {
+        const CallExpr *call;
+        const FunctionDecl *callee;
+        std::vector<refs_t*> args;
+      };
+
+      //variables referenced anywhere within variable declarations
+      std::vector<flow_t> inits;
+      //first variable referenced in the left-hand side of assignments and variables referenced below their right-hand side
+      std::vector<flow_t> assigns;
+      //variables referenced in arguments of direct calls
+      std::vector<call_t> calls;
+
+      bool shouldVisitTemplateInstantiations() const { return true; }
+      bool shouldVisitImplicitCode() const { return true; }
+
+      bool TraverseDecl(Decl *D){
+        auto V = dyn_cast_or_null<VarDecl>(D);
+        if(!V) return Base::TraverseDecl(D);
+        inits.push_back({V,newRefs()});
+        refs_t *refs = inits.back().sources;
+        open.push_back(refs);
+        bool rv = Base::TraverseDecl(D);
+        open.pop_back();
+        return rv;
+      }
+
+      bool TraverseStmt(Stmt *S){
+        if(auto B = dyn_cast_or_null<BinaryOperator>(S)){
+          if(B->isAssignmentOp()) return traverseAssign(B);
+        }
+        if(auto C = dyn_cast_or_null<CallExpr>(S)){
+          return traverseCall(C);
+        }
+        return Base::TraverseStmt(S);
+      }
+
+      bool VisitDeclRefExpr(DeclRefExpr *E){
+        if(auto V = dyn_cast<VarDecl>(E->getDecl())){
+          for(auto refs : open) refs->push_back(V);
+        }
+        return true;
+      }
+
+    private:
+      //collectors of the nodes currently traversed
+      std::vector<refs_t*> open;
+      std::deque<refs_t> pool;
+
+      refs_t *newRefs(){
+        pool.emplace_back();
+        return &pool.back();
+      }
+
+      bool traverseAssign(BinaryOperator *B){
+        size_t i = assigns.size();
+        assigns.push_back({nullptr,newRefs()});
+        refs_t *lhs = newRefs();
+        open.push_back(lhs);
+        bool rv = TraverseStmt(B->getLHS());
+        open.pop_back();
+        if(!lhs->empty()) assigns[i].target = lhs->front();
+        //only references strictly below the right-hand side count
+        if(!isa<DeclRefExpr>(B->getRHS())) open.push_back(assigns[i].sources);
+        rv = rv && TraverseStmt(B->getRHS());
+        if(!isa<DeclRefExpr>(B->getRHS())) open.pop_back();
+        return rv;
+      }
+
+      bool traverseCall(CallExpr *C){
+        size_t i = calls.size();
+        calls.push_back({C,dyn_cast_or_null<FunctionDecl>(C->getCalleeDecl()),{}});
+        if(!TraverseStmt(C->getCallee())) return false;
+        for(unsigned n = 0; n<C->getNumArgs(); n++){
+          refs_t *refs = newRefs();
+          calls[i].args.push_back(refs);
+          open.push_back(refs);
+          bool rv = TraverseStmt(C->getArg(n));
+          open.pop_back();
+          if(!rv) return false;
+        }
+        return true;
+      }
+  };
+
+  //taints parameters of the function by walking its body once
+  //every variable keeps the set of parameters tainting it (variables with the same name and location are merged
+  //as in the matcher based tainting) and the result is identical to taint_params
+  void taint_params_single_pass(const FunctionDecl *f, DbJSONClassVisitor::FuncData &func_data){
+    DbJSONClassVisitor::taintdata_t& data = func_data.taintdata;
+    TaintFlowCollector Flows;
+    Flows.TraverseDecl(const_cast<FunctionDecl*>(f));
+
+    func_data.declcount = 0;
+    for(auto &init : Flows.inits){
+      if(!isa<ParmVarDecl>(init.target)) func_data.declcount++;
+    }
+    if(!f->getNumParams()) return;
+
+    //variables tainted by each variable, in the order of discovery
+    std::unordered_map<const VarDecl*,std::vector<const VarDecl*>> out;
+    auto addFlow = [&](const VarDecl *target, const TaintFlowCollector::refs_t &sources){
+      if(!target) return;
+      std::unordered_set<const VarDecl*> seen;
+      for(auto source : sources){
+        if(seen.insert(source).second) out[source].push_back(target);
+      }
+    };
+    for(auto &init : Flows.inits){
+      addFlow(init.target,*init.sources);
+    }
+    for(auto &assign : Flows.assigns){
+      addFlow(assign.target,*assign.sources);
+    }
+    for(auto &call : Flows.calls){
+      if(!call.callee) continue;
+      const data_t *taints = match_database(call.callee->getNameAsString());
+      if(!taints) continue;
+      int nargs = call.args.size();
+      auto addArgFlow = [&](int to, int from){
+        if(to<0 || from<0 || to>=nargs || from>=nargs) return;
+        if(call.args[to]->empty()) return;
+        addFlow(call.args[to]->front(),*call.args[from]);
+      };
+      for(auto taint : *taints){
+        //normal function taint
+        if(taint.first && taint.second){
+          addArgFlow(taint.first-1,taint.second-1);
+        }
+        //to variadic argument
+        else if(taint.first == 0){
+          if(!call.callee->isVariadic()) errs()<<call.callee->getNameAsString()<<" IS NOT VARIADIC!\n";
+          for(int i = call.callee->getNumParams();i<nargs;i++){
+            addArgFlow(i,taint.second-1);
+          }
+        }
+        //from variadic argument
+        else if(taint.second == 0){
+          if(!call.callee->isVariadic()) errs()<<call.callee->getNameAsString()<<" IS NOT VARIADIC!\n";
+          for(int i = call.callee->getNumParams();i<nargs;i++){
+            addArgFlow(taint.first-1,i);
+          }
+        }
+      }
+    }
+
+    //parameters tainting each variable
+    std::unordered_map<std::string,BitVector> params_by_key;
+    std::unordered_map<const VarDecl*,BitVector*> params;
+    auto taint = [&](const VarDecl *var, unsigned param_index){
+      BitVector *&bits = params[var];
+      if(!bits){
+        std::string key = var->getNameAsString();
+        key.push_back('\0');
+        key.append(var->getLocation().printToString(var->getASTContext().getSourceManager()));
+        bits = &params_by_key[key];
+        if(bits->empty()) bits->resize(f->getNumParams());
+      }
+      if(bits->test(param_index)) return false;
+      bits->set(param_index);
+      return true;
+    };
+
+    for(auto param : f->parameters()){
+      int param_index = param->getFunctionScopeIndex();
+      std::vector<const VarDecl*> tainted = {param};
+      taint(param,param_index);
+
+      int depth = 0;
+      size_t index = 0;
+      while(index<tainted.size()){
+        for(size_t size = tainted.size();index<size;index++){
+          const VarDecl *var = tainted[index];
+          data[param_index].insert({depth,var});
+          auto targets = out.find(var);
+          if(targets == out.end()) continue;
+          for(auto target : targets->second){
+            if(!target->isDefinedOutsideFunctionOrMethod() && taint(target,param_index))
+              tainted.push_back(target);
+          }
+        }
+        depth++;
+      }
+    }
+  }
@@ -0,0 +1,62 @@
+#ifndef TAINTDB_H
+#define TAINTDB_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+typedef std::string name_t;
+typedef int to_index;
+typedef int from_index;
+typedef std::vector<std::pair<to_index,from_index>> data_t;
+typedef std::unordered_map<name_t,data_t> ndb_t;
+
+/*
+ * Lookup index of the taint function database (-pt).
+ * Exact names are resolved with a single hash lookup. Prefix entries ("regex_name") are grouped by their
+ * length, so a name is looked up once per distinct prefix length. When several prefixes match a name,
+ * the entry which comes first in the iteration order of the database wins (as with a linear scan).
+ * The index is built once when the database is loaded and is only read by worker threads afterwards.
+ */
+class TaintIndex {
+public:
+	void build(const ndb_t &exact_db, const ndb_t &regex_db) {
+		exact = &exact_db;
+		prefixes.clear();
+		lengths.clear();
+		size_t rank = 0;
+		for (auto &f : regex_db) {
+			prefixes.insert({std::string_view(f.first),{rank++,&f.second}});
+			lengths.push_back(f.first.size());
+		}
+		std::sort(lengths.begin(),lengths.end());
+		lengths.erase(std::unique(lengths.begin(),lengths.end()),lengths.end());
+	}
+
+	const data_t *match(const name_t &name) const {
+		if (exact) {
+			auto f = exact->find(name);
+			if (f!=exact->end()) return &f->second;
+		}
+		const prefix_entry *best = nullptr;
+		for (size_t len : lengths) {
+			if (len>name.size()) break;
+			auto f = prefixes.find(std::string_view(name.data(),len));
+			if (f!=prefixes.end() && (!best || f->second.rank<best->rank)) best = &f->second;
+		}
+		return best ? best->data : nullptr;
+	}
+
+private:
+	struct prefix_entry {
+		size_t rank;
+		const data_t *data;
+	};
+	const ndb_t *exact = nullptr;
+	std::vector<size_t> lengths;
+	std::unordered_map<std::string_view,prefix_entry> prefixes;
+};
+
+#endif
@@ -214,10 +214,9 @@ std::string json_escape( const std::string &str ) {
 			  Decls.clear();
 		  }
 		  short_ptr--;
-		  SHA_CTX c;
-		  SHA_init(&c);
-		  SHA_update(&c,rargs.data(),rargs.length());
-		  SHA_final(&c);
+		  DeclHash c(opts.fasthash);
+		  c.update(rargs);
+		  std::string rhash = DeclHash::encode(c.digest());
 		  std::string outerFn;
 		  if (!rD->isDefinedOutsideFunctionOrMethod()) {
 			  std::stringstream outerStr;
@@ -226,7 +225,7 @@ std::string json_escape( const std::string &str ) {
 			  DbJSONClassVisitor::FuncData &fnfo = Visitor.getFuncMap().at(outerDef);
 			  // build ahead of time
 			  if(!fnfo.hash.size()) getFuncHash(&fnfo);
-			  outerStr << Visitor.parentFunctionOrMethodString(rD) << ":" << fnfo.hash;
+			  outerStr << Visitor.parentFunctionOrMethodString(rD) << ":" << DeclHash::encode(fnfo.hash);
 			  if (opts.cstmt) {
 				  if ((Visitor.getRecordCSMap().find(rD)!=Visitor.getRecordCSMap().end()) &&
 						  (Visitor.getRecordCSMap()[rD]!=0)) {
@@ -276,7 +275,7 @@ std::string json_escape( const std::string &str ) {
 				  DBG(DEBUG_HASH, llvm::outs() << "build Record()(" << qualifierString << ")\n" );
 			  }
 		  }
-		  ss << base64_encode(reinterpret_cast<const unsigned char*>(c.buf.b), 64) << ":" << Visitor.getTypeData(T).size << ";";
+		  ss << rhash << ":" << Visitor.getTypeData(T).size << ";";
 		  rstr.append(ss.str());
 		  TypeStringMap.insert(std::pair<QualType,std::string>(T,rstr));
 		  typeString.append(rstr);
@@ -704,25 +703,24 @@ std::string json_escape( const std::string &str ) {
 				  assert(pos!=typeString.npos);
 				  pos = typeString.rfind(":",pos);
 				  assert(pos!=typeString.npos);
-				  if(pos<88){
+				  size_t hsize = DeclHash::encodedSize(opts.fasthash);
+				  if(pos<hsize){
 					llvm::errs()<<typeString<<'\n';
 					T.dump();
-				  	assert(pos>=88);
+				  	assert(pos>=hsize);
 				  }
-				  std::string odt = base64_decode(typeString.substr(pos-88,88));
-				  SHA_CTX c;
-				  SHA_init(&c);
-				  SHA_update(&c,odt.data(),odt.length());
+				  std::string odt = base64_decode(typeString.substr(pos-hsize,hsize));
+				  DeclHash c(opts.fasthash);
+				  c.update(odt);
 				  std::set<std::string> ordered;
 				  for (auto u = Visitor.gtp_refVars[rD].begin(); u!=Visitor.gtp_refVars[rD].end(); ++u) {
 					  std::string &vhash = Visitor.getVarData(*u).hash;
 					  ordered.insert(vhash);
 				  }
 				  for(auto &vhash : ordered){
-					  SHA_update(&c,vhash.data(),vhash.length());
+					  c.update(vhash);
 				  }
-				  SHA_final(&c);
-				  typeString.replace(pos-88,88,base64_encode(reinterpret_cast<const unsigned char*>(c.buf.b), 64));
+				  typeString.replace(pos-hsize,hsize,DeclHash::encode(c.digest()));
 			  }
 		  }
 		  break;
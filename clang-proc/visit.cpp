@@ -581,8 +581,13 @@ bool DbJSONClassVisitor::VisitFunctionDeclStart(const FunctionDecl *D) {
 			lastFunctionDef->CSId = 0;
 			lastFunctionDef->varId = 0;
 			if(opts.taint){
-				FuncMap[D].declcount = internal_declcount(D);
-				taint_params(D,FuncMap[D]);
+				if(opts.taint_matchers){
+					FuncMap[D].declcount = internal_declcount(D);
+					taint_params(D,FuncMap[D]);
+				}
+				else{
+					taint_params_single_pass(D,FuncMap[D]);
+				}
 			}
 		}
 	}
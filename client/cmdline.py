@@ -67,7 +67,7 @@ def process_commandline(cas_db: libcas.CASDatabase, commandline: "str | List[str
             try:
                 ftdb_required = any([x.name in ftdb_cmds for x in pipeline_args])
                 if ftdb_required:
-                    ft_db.load_db(os.path.join(common_args.ftdb_dir, common_args.ftdb), debug=common_args.debug, quiet=True)
+                    ft_db.load_db(os.path.join(common_args.ftdb_dir, common_args.ftdb), debug=common_args.debug, quiet=True, prelink=True)
             except FtdbError:
                 raise LibFtdbException("ERROR: Failed to load ftdb database. Check if {} is proper database file path.".format(os.path.join(common_args.ftdb_dir, common_args.ftdb)))
 
@@ -75,7 +75,7 @@ def process_commandline(cas_db: libcas.CASDatabase, commandline: "str | List[str
             db_required = not all([x.name in ["parse", "postprocess", "pp", "cache", "config", "cfg", "compiler_pattern", "linker_pattern"]+ftdb_cmds for x in pipeline_args])
             try:
                 if db_required:
-                    cas_db.load_db(os.path.join(common_args.dbdir, common_args.database), debug=common_args.debug)
+                    cas_db.load_db(os.path.join(common_args.dbdir, common_args.database), debug=common_args.debug, prelink=True)
             except libetrace.error as e:
                 raise MessageException("ERROR: Failed to load database. Check if {} is proper database file path.".format(os.path.join(common_args.dbdir, common_args.database))) from e
 
@@ -84,7 +84,7 @@ def process_commandline(cas_db: libcas.CASDatabase, commandline: "str | List[str
             else:
                 try:
                     if db_required and cas_db is not None:
-                        cas_db.load_deps_db(os.path.join(common_args.dbdir, common_args.deps_database), debug=common_args.debug)
+                        cas_db.load_deps_db(os.path.join(common_args.dbdir, common_args.deps_database), debug=common_args.debug, prelink=True)
                 except libetrace.error as e:
                     raise MessageException("ERROR: Failed to load deps database. Check if {} is proper database file path.".format(os.path.join(common_args.dbdir, common_args.deps_database))) from e
 
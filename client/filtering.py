@@ -1,7 +1,7 @@
 from abc import abstractmethod
 import re
 from fnmatch import translate as translate_wc_to_re
-from typing import List, Dict, Tuple, Optional, Any
+from typing import List, Dict, Tuple, Optional, Any, Iterable
 import libetrace
 from client.misc import get_file_info
 from client.exceptions import FilterException
@@ -20,7 +20,8 @@ class Filter:
     parameters_schema = {}
     typed_keywords = []
 
-    def __init__(self, flt:"str | List[List[Dict[str, Any]]]", origin, config: CASConfig, source_root: str, ft_db:"FTDatabase | None"=None) -> None:
+    def __init__(self, flt:"str | List[List[Dict[str, Any]]]", origin, config: CASConfig, source_root: str, ft_db:"FTDatabase | None"=None,
+                 nfsdb: "libetrace.nfsdb | None"=None) -> None:
         self.filter_dict: List[List[Dict[str, Any]]] = flt if isinstance(flt, list) else self._filter_str_to_dict(flt)
         self.libetrace_filter = self.filter_to_libetrace(self.filter_dict)
         self.config = config
@@ -75,19 +76,10 @@ class Filter:
                 if 'type' in f_and and f_and['type'] == "wc":
                     raise FilterException("DEBUG! Some wildcards not cached to re! - this should never happen! {}".format(f_and))
 
-                if 'class' in f_and and f_and['class'] == 'compiler':
-                    self.comp_re = "|".join([x+"$" for x in self.config.config_info["gcc_spec"] + self.config.config_info["gpp_spec"]
-                                            + self.config.config_info["clang_spec"] + self.config.config_info["clangpp_spec"] + self.config.config_info["armcc_spec"]])
-                    self.comp_re = self.comp_re.replace('+', r'\+').replace('.', r'\.').replace('/', r'\/').replace('*', '.*')
-                    self.comp_re = re.compile(self.comp_re)
-                if 'class' in f_and and f_and['class'] == 'linker':
-                    self.link_re = "|".join([x+"$" for x in self.config.config_info["ld_spec"] + self.config.config_info["ar_spec"]])
-                    self.link_re = self.link_re.replace('+', r'\+').replace('.', r'\.').replace('/', r'\/').replace('*', '.*')
-                    self.link_re = re.compile(self.link_re)
-
                 f_and["filter_class"] = 'class' in f_and
                 f_and["filter_source_type"] = 'source_type' in f_and
                 f_and["filter_access"] = 'access' in f_and
+                f_and["filter_global_access"] = 'global_access' in f_and
                 f_and["filter_exists"] = 'exists' in f_and
                 f_and["filter_link"] = 'link' in f_and
                 f_and["filter_path"] = 'path' in f_and
@@ -95,8 +87,10 @@ class Filter:
                 f_and["filter_cmd"] = 'cmd' in f_and
                 f_and["filter_cwd"] = 'cwd' in f_and
                 f_and["filter_bin"] = 'bin' in f_and
-                f_and["filter_ppid"] = 'pid' in f_and
-                f_and["filter_negate"] = 'negate' in f_and
+                f_and["filter_cwd_source_root"] = 'cwd_source_root' in f_and
+                f_and["filter_bin_source_root"] = 'bin_source_root' in f_and
+                f_and["filter_ppid"] = 'ppid' in f_and
+                f_and["filter_negate"] = 'negate' in f_and and f_and['negate'] in ("1", "true")
                 f_and["filter_has_func"] = 'has_func' in f_and
                 f_and["filter_has_global"] = 'has_global' in f_and
                 f_and["filter_has_funcdecl"] = 'has_funcdecl' in f_and
@@ -105,6 +99,11 @@ class Filter:
 
         self.ored = len(self.filter_dict) > 1
         self.anded = len([f_and for f_or in self.filter_dict for f_and in f_or]) > 1
+
+        if nfsdb is None and self.origin is not None and getattr(getattr(self.origin, "nfsdb", None), "db_loaded", False):
+            nfsdb = self.origin.nfsdb.db
+        self.nfsdb = nfsdb
+        self.native_filter = self.compile_native_filter(nfsdb) if nfsdb is not None else None
         if self.origin and self.origin.args.debug:
             print(f"DEBUG: Filter dict:\n {self.filter_dict}")
         if self.origin and self.origin.args.debug:
@@ -156,6 +155,46 @@ class Filter:
             filter_string = filter_string.replace("( ", "(").replace(" (", "(").replace(") ", ")").replace(" )", ")")
         return [[Filter._process_part(f) for f in ors.split(")and(")] if ")and(" in ors else [Filter._process_part(ors)] for ors in filter_string.split(")or(")]
 
+    def _resolve_filters(self, ent) -> bool:
+        """
+        Function check in Python (with _match_filter) if the object should pass all filters.
+
+        :param ent: filtered object
+        :type ent: Any
+        :return: True if the object matches filters conditions otherwise False
+        :rtype: bool
+        """
+        if not self.anded:
+            return self._match_filter(ent, self.filter_dict[0][0])
+        if self.ored:
+            return any([all([self._match_filter(ent, f) for f in o]) for o in self.filter_dict])
+        else:
+            return all([self._match_filter(ent, f) for f in self.filter_dict[0]])
+
+    def compile_native_filter(self, nfsdb: libetrace.nfsdb) -> Any:
+        """
+        Function compiles the libetrace filter into the native filter evaluated inside libetrace.
+
+        :param nfsdb: database the filtered objects come from
+        :type nfsdb: libetrace.nfsdb
+        :return: compiled filter callable on a single object or None if the filter can't be evaluated natively
+        :rtype: Any
+        """
+        return None
+
+    def filter(self, items: Iterable) -> List:
+        """
+        Function returns the objects that pass all filters (the compiled native filter checks all of them in one call).
+
+        :param items: filtered objects
+        :type items: Iterable
+        :return: list of objects that match filters conditions
+        :rtype: List
+        """
+        if self.native_filter is not None:
+            return self.native_filter.filter(items)
+        return [x for x in items if self._resolve_filters(x)]
+
     @staticmethod
     @abstractmethod
     def filter_to_libetrace(filter_dict: Optional[List]) -> List:
@@ -200,32 +239,18 @@ class OpenFilter(Filter):
         """
         ret:bool = True
 
-        if ret and filter_part["filter_class"]:
-            if filter_part["class"] == "compiled":
-                ret = ret and (opn.opaque is not None and opn.opaque.compilation_info is not None and opn.opaque.compilation_info.file_paths[0] == opn.path)
-            elif filter_part["class"] == "linked":
-                ret = ret and (opn.opaque is not None and opn.opaque.linked_file is not None and opn.opaque.linked_path == opn.path)
-            elif filter_part["class"] == "linked_static":
-                ret = ret and (opn.opaque is not None and opn.opaque.linked_file is not None and opn.opaque.linked_path == opn.path and opn.opaque.linked_type == 0)
-            elif filter_part["class"] == "linked_shared":
-                ret = ret and (opn.opaque is not None and opn.opaque.linked_file is not None and opn.opaque.linked_path == opn.path and opn.opaque.linked_type == 1 and ("-shared" in opn.opaque.argv or "--shared" in opn.opaque.argv))
-            elif filter_part["class"] == "linked_exe":
-                ret = ret and (opn.opaque is not None and opn.opaque.linked_file is not None and opn.opaque.linked_path == opn.path and opn.opaque.linked_type == 1 and not ("-shared" in opn.opaque.argv or "--shared" in opn.opaque.argv))
-            elif filter_part["class"] == "compiler":
-                ret = ret and (opn.opaque is not None and opn.opaque.compilation_info is not None)
-            elif filter_part["class"] == "linker":
-                ret = ret and (opn.opaque is not None and opn.opaque.linked_file is not None)
-            elif filter_part["class"] == "plain":
-                ret = ret and (opn.opaque is None)
+        if ret and (filter_part["filter_class"] or filter_part["filter_link"]):
+            ret = ret and self._match_class(opn, filter_part["class"] if filter_part["filter_class"] else None,
+                                            filter_part["link"] in ("1", "true") if filter_part["filter_link"] else None)
 
         if ret and filter_part["filter_source_type"]:
-            if opn.path in self.origin.get_src_types():
+            if opn.is_compiled():
                 if filter_part["source_type"] == "c":
-                    ret = ret and (self.origin.get_src_types()[opn.path] == 1)
+                    ret = ret and (opn.opaque.compilation_info.type == 1)
                 elif filter_part["source_type"] == "c++":
-                    ret = ret and (self.origin.get_src_types()[opn.path] == 2)
+                    ret = ret and (opn.opaque.compilation_info.type == 2)
                 elif filter_part["source_type"] == "other":
-                    ret = ret and (self.origin.get_src_types()[opn.path] != 1 and self.origin.get_src_types()[opn.path] != 2)
+                    ret = ret and (opn.opaque.compilation_info.type != 1 and opn.opaque.compilation_info.type != 2)
             else:
                 ret = ret and False
 
@@ -238,27 +263,33 @@ class OpenFilter(Filter):
             elif filter_part["access"] == "rw":
                 ret = ret and (mode == 2)
 
+        if filter_part["filter_global_access"] and self.nfsdb is None:
+            raise FilterException("global_access filter needs a loaded database!")
+
+        if ret and filter_part["filter_global_access"]:
+            read = self.nfsdb.path_read(opn.path)
+            write = self.nfsdb.path_write(opn.path)
+            if filter_part["global_access"] == "r":
+                ret = ret and (read and not write)
+            elif filter_part["global_access"] == "w":
+                ret = ret and (write and not read)
+            elif filter_part["global_access"] == "rw":
+                ret = ret and (read and write)
+
         if ret and filter_part["filter_exists"]:
-            exist, stat, mode = get_file_info(opn.mode)
             if filter_part["exists"] == "1":
-                ret = ret and (not stat == 2 and exist)
+                ret = ret and (opn.exists() and not opn.is_dir())
             elif filter_part["exists"] == "0":
-                ret = ret and (not exist)
+                ret = ret and (not opn.exists())
             elif filter_part["exists"] == "2":
-                ret = ret and (stat == 2 and exist)
-
-        if ret and filter_part["filter_link"]:
-            exist, stat, mode = get_file_info(opn.mode)
-            if filter_part["link"] == "1":
-                ret = ret and (stat == 10)
-            elif filter_part["link"] == "0":
-                ret = ret and (not stat == 10)
+                ret = ret and opn.is_dir()
 
         if ret and filter_part["filter_source_root"]:
+            at_source_root = len(opn.path) > len(self.source_root) and opn.path.startswith(self.source_root)
             if filter_part["source_root"] == "1" or filter_part["source_root"] == "true":
-                ret = ret and (opn.path.startswith(self.source_root))
+                ret = ret and at_source_root
             elif filter_part["source_root"] == "0" or filter_part["source_root"] == "false":
-                ret = ret and (not opn.path.startswith(self.source_root))
+                ret = ret and (not at_source_root)
 
         if ret and filter_part["filter_path"]:
             if "path_pattern" in filter_part:
@@ -271,6 +302,39 @@ class OpenFilter(Filter):
 
         return ret
 
+    @staticmethod
+    def _match_class(opn: libetrace.nfsdbEntryOpenfile, file_class: Optional[str], link: Optional[bool]) -> bool:
+        """
+        Function check if open is of the given class and (if link is not None) is a symlink or an existing non-symlink file
+        (the same way the libetrace 'is_class' filter does).
+
+        :param opn: open file object
+        :type opn: libetrace.nfsdbEntryOpenfile
+        :param file_class: 'class' filter value
+        :type file_class: Optional[str]
+        :param link: 'link' filter value
+        :type link: Optional[bool]
+        :return: True if open matches the class conditions otherwise False
+        :rtype: bool
+        """
+        if file_class is not None and file_class != "plain":
+            if file_class == "linker":
+                ret = opn.is_linker() and not opn.is_compiler()
+            else:
+                ret = getattr(opn, "is_" + file_class)()
+        elif link is None:
+            return opn.is_plain() if file_class == "plain" else True
+        else:
+            ret = True
+        if link is True:
+            ret = ret and opn.is_symlink()
+        elif link is False:
+            ret = ret and (opn.exists() and not opn.is_symlink())
+        return ret
+
+    def compile_native_filter(self, nfsdb: libetrace.nfsdb) -> Any:
+        return nfsdb.opens_filter(self.libetrace_filter)
+
     def resolve_filters(self, opn: libetrace.nfsdbEntryOpenfile) -> bool:
         """
         Function check if open should pass all filters.
@@ -280,12 +344,9 @@ class OpenFilter(Filter):
         :return: True if open matches filters conditions otherwise False
         :rtype: bool
         """
-        if not self.anded:
-            return self._match_filter(opn, self.filter_dict[0][0])
-        if self.ored:
-            return any([all([self._match_filter(opn, f) for f in o]) for o in self.filter_dict])
-        else:
-            return all([self._match_filter(opn, f) for f in self.filter_dict[0]])
+        if self.native_filter is not None:
+            return self.native_filter(opn)
+        return self._resolve_filters(opn)
 
     @staticmethod
     def filter_to_libetrace(filter_dict: "List | str") -> List:
@@ -363,9 +424,9 @@ class OpenFilter(Filter):
 
         def get_src_root(flt: Dict) -> Optional[Tuple[str,None]]:
             if "source_root" in flt:
-                if flt["source_root"] == "1":
+                if flt["source_root"] == "1" or flt["source_root"] == "true":
                     return ("at_source_root", None)
-                elif flt["source_root"] == "0":
+                elif flt["source_root"] == "0" or flt["source_root"] == "false":
                     return ("not_at_source_root", None)
             return None
         def get_src_type(flt: Dict) -> Optional[Tuple[str,int]]:
@@ -390,7 +451,7 @@ class OpenFilter(Filter):
                         get_class(and_dict),
                         get_exists(and_dict),
                         get_access(and_dict),
-                        True if "negate" in and_dict else False,
+                        True if "negate" in and_dict and (and_dict["negate"] == "1" or and_dict["negate"] == "true") else False,
                         get_src_root(and_dict),
                         get_src_type(and_dict))
         return filter_list
@@ -449,23 +510,28 @@ class CommandFilter(Filter):
 
         if filter_part["filter_class"]:
             if filter_part["class"] == "compiler":
-                ret = ret and exe.compilation_info is not None
+                ret = ret and exe.has_compilations()
             elif filter_part["class"] == "linker":
-                ret = ret and exe.linked_file is not None
+                ret = ret and exe.is_linking()
             elif filter_part["class"] == "command":
-                ret = ret and (exe.bpath is not None)
+                ret = ret and (len(exe.bpath) > 0 and len(exe.argv) > 0)
 
-        if filter_part["filter_source_root"]:
-            if filter_part["source_root"] == "1":
-                ret = ret and (exe.bpath.startswith(self.source_root))
-            elif filter_part["source_root"] == "0":
-                ret = ret and (not exe.bpath.startswith(self.source_root))
+        for name, path in (("cwd_source_root", exe.cwd), ("bin_source_root", exe.bpath)):
+            if filter_part["filter_"+name]:
+                at_source_root = len(path) > len(self.source_root) and path.startswith(self.source_root)
+                if filter_part[name] == "1" or filter_part[name] == "true":
+                    ret = ret and at_source_root
+                elif filter_part[name] == "0" or filter_part[name] == "false":
+                    ret = ret and (not at_source_root)
 
         if filter_part["filter_negate"]:
             ret = not ret
 
         return ret
 
+    def compile_native_filter(self, nfsdb: libetrace.nfsdb) -> Any:
+        return nfsdb.commands_filter(self.libetrace_filter)
+
     def resolve_filters(self, exe: libetrace.nfsdbEntry) -> bool:
         """
         Function check if exec should pass all filters.
@@ -475,12 +541,9 @@ class CommandFilter(Filter):
         :return: True if exec matches filters conditions otherwise False
         :rtype: bool
         """
-        if not self.anded:
-            return self._match_filter(exe, self.filter_dict[0][0])
-        if self.ored:
-            return any([all([self._match_filter(exe, f) for f in o]) for o in self.filter_dict])
-        else:
-            return all([self._match_filter(exe, f) for f in self.filter_dict[0]])
+        if self.native_filter is not None:
+            return self.native_filter(exe)
+        return self._resolve_filters(exe)
 
     @staticmethod
     def filter_to_libetrace(filter_dict: "List | str") -> List:
@@ -539,6 +602,8 @@ class CommandFilter(Filter):
             return ("is_class", cls_vals) if cls_vals != 0 else None
 
         def get_src_root(flt: Dict) -> Optional[Tuple[str,None]]:
+            if "cwd_source_root" in flt and "bin_source_root" in flt:
+                raise FilterException("Can't use cwd_source_root and bin_source_root in same time!")
             if "cwd_source_root" in flt:
                 if flt["cwd_source_root"] == "1" or flt["cwd_source_root"] == "true":
                     return ("cwd_at_source_root", None)
@@ -587,6 +652,7 @@ class FtdbSimpleFilter(Filter):
         "location": None
     }
     def __init__(self, flt:"str | List[List[Dict[str, Any]]]", origin, config: CASConfig, source_root: str, ft_db:"FTDatabase") -> None:
+        self.libftdb_filter = self.filter_to_libftdb(flt)
         super().__init__(flt, origin, config, source_root, ft_db)
         for f_or in self.filter_dict:
             for f_and in f_or:
@@ -676,16 +742,34 @@ class FtdbSimpleFilter(Filter):
         return ret
 
     def resolve_filters(self, src)->bool:
-        if not self.anded:
-            return self._match_filter(src, self.filter_dict[0][0])
-        if self.ored:
-            return any([all([self._match_filter(src, f) for f in o]) for o in self.filter_dict])
-        else:
-            return all([self._match_filter(src, f) for f in self.filter_dict[0]])
+        return self._resolve_filters(src)
 
     @staticmethod
-    def filter_to_libftdb(filter_dict: List) -> List:
+    def filter_to_libftdb(filter_dict: "List | str") -> Optional[List]:
         """
-            Method to potentialy translate filter to libftdb filtering 
+        Function generate libftdb filter (used by the collections 'count' method) from parsed filter list.
+        Only the "name" and "location" wildcard (or substring) filters are translated.
+
+        :param filter_dict: parsed filter
+        :type filter_dict: List | str
+        :return: libftdb compatible filter list or None if the filter has to be resolved in python
+        :rtype: Optional[List]
         """
-        pass
+        filter_dict = filter_dict if isinstance(filter_dict, list) else Filter._filter_str_to_dict(filter_dict)
+        # [ [(FIELD,WC_PATTERN,NEGATE),(...),...], ... ]
+        ret = []
+        for f_or in filter_dict:
+            and_filters = []
+            for f_and in f_or:
+                fields = [k for k in ("name", "location") if k in f_and]
+                if len(fields) != 1 or any(k not in ("name", "location", "type", "negate") for k in f_and):
+                    return None
+                f_type = f_and.get("type", "sp")
+                if f_type == "wc":
+                    and_filters.append((fields[0], f_and[fields[0]], f_and.get("negate") in ("1", "true")))
+                elif f_type == "sp":
+                    and_filters.append((fields[0], f"*{f_and[fields[0]]}*", f_and.get("negate") in ("1", "true")))
+                else:
+                    return None
+            ret.append(and_filters)
+        return ret
@@ -405,7 +405,8 @@ async def search_files(
             command_filter, 
             None, 
             nfsdb.config, 
-            nfsdb.source_root
+            nfsdb.source_root,
+            nfsdb=nfsdb.db
         )
     
     execs = []
@@ -413,12 +414,11 @@ async def search_files(
         # Get opened files matching filename
         filepaths = get_opened_files(nfsdb, filename)
         if cmd_filter:
-            execs = [
+            execs = cmd_filter.filter(
                 open.parent
                 for openedFile in filepaths
                 for open in nfsdb.get_opens_of_path(openedFile)
-                if cmd_filter.resolve_filters(open.parent)
-            ]
+            )
         else:
             execs = [
                 open.parent
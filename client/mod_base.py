@@ -2,7 +2,7 @@ import fnmatch
 from functools import lru_cache
 import re
 from abc import abstractmethod
-from typing import Any, Iterator, List, Dict, Optional, Tuple, Generator, Callable, Set
+from typing import Any, Iterable, Iterator, List, Dict, Optional, Tuple, Generator, Callable, Set
 import argparse
 from fastapi import Response
 import libetrace
@@ -29,7 +29,7 @@ class ModulePipeline:
     def render(self):
         data = []
         renderer = None
-        sort_lambda: "Callable | None" = None
+        sort_lambda: "Callable | str | None" = None
         pipe_type: "type | None" = None
         for mdl in self.modules:
             printdbg("DEBUG: START pipeline step {}".format(mdl.args.module.__name__), mdl.args)
@@ -112,6 +112,17 @@ class Module:
     def set_pipeline(self, module_pipeline):
         self.module_pipeline = module_pipeline
 
+    @property
+    def count_only(self) -> bool:
+        """
+        Only the number of returned entries is rendered (--count in the last pipeline step),
+        so the module can count them natively instead of creating the entries.
+        """
+        if not self.args.count or getattr(self.args, "ftdb_create", False) or \
+                getattr(self.args, "save_zip_archive", None) or getattr(self.args, "save_tar_archive", None):
+            return False
+        return self.module_pipeline is None or self.module_pipeline.modules[-1] is self
+
     @abstractmethod
     def subject(self, ent) -> str:
         """
@@ -261,12 +272,14 @@ class Module:
         """
         return self.has_pipe_path or self.has_exclude or self.has_open_filter or self.has_select or self.has_append
 
-    def filter_open(self, opn: libetrace.nfsdbEntryOpenfile) -> bool:
+    def filter_open(self, opn: libetrace.nfsdbEntryOpenfile, with_open_filter: bool = True) -> bool:
         """
         Function check if provided open element matches filters.
 
         :param opn: open element
         :type opn: `libetrace.nfsdbEntryOpenfile`
+        :param with_open_filter: whether to check the open filter as well
+        :type with_open_filter: bool
         :return: `True` if filtering allow given element otherwise `False`
         :rtype: bool
         """
@@ -278,7 +291,7 @@ class Module:
         if self.has_exclude:
             ret = ret and (not self.filename_matcher(self.exclude_subject(opn), self.args.exclude))
 
-        if self.has_open_filter and self.open_filter is not None:
+        if with_open_filter and self.has_open_filter and self.open_filter is not None:
             ret = ret and self.open_filter.resolve_filters(opn)
 
         if self.has_select:
@@ -286,6 +299,19 @@ class Module:
 
         return ret
 
+    def filter_opens(self, opens: Iterable[libetrace.nfsdbEntryOpenfile]) -> List[libetrace.nfsdbEntryOpenfile]:
+        """
+        Function returns open elements that match filters. The open filter is applied to all elements at once.
+
+        :param opens: open elements
+        :type opens: Iterable[libetrace.nfsdbEntryOpenfile]
+        :return: open elements allowed by filtering
+        :rtype: List[libetrace.nfsdbEntryOpenfile]
+        """
+        if self.has_open_filter and self.open_filter is not None:
+            opens = self.open_filter.filter(opens)
+        return [o for o in opens if self.filter_open(o, with_open_filter=False)]
+
     def needs_exec_filtering(self) -> bool:
         """
         Function check if advanced filtering is necessary. 
@@ -296,12 +322,14 @@ class Module:
         """
         return self.has_exclude or self.has_pid or self.has_command_filter or self.has_select
 
-    def filter_exec(self, ent: libetrace.nfsdbEntry) -> bool:
+    def filter_exec(self, ent: libetrace.nfsdbEntry, with_command_filter: bool = True) -> bool:
         """
         Function check if provided exec element matches filters.
 
         :param ent: exec element
         :type ent: `libetrace.nfsdbEntryOpenfile`
+        :param with_command_filter: whether to check the command filter as well
+        :type with_command_filter: bool
         :return: `True` if filtering allow given element otherwise `False`
         :rtype: bool
         """
@@ -317,7 +345,7 @@ class Module:
         if self.has_pid:
             ret = ret and (ent.eid.pid in self.args.pid)
 
-        if self.has_command_filter and self.command_filter is not None:
+        if with_command_filter and self.has_command_filter and self.command_filter is not None:
             ret = ret and self.command_filter.resolve_filters(ent)
 
         if self.has_select:
@@ -325,6 +353,25 @@ class Module:
 
         return ret
     
+    def filter_execs(self, execs: Iterable[libetrace.nfsdbEntry]) -> List[libetrace.nfsdbEntry]:
+        """
+        Function returns exec elements that match filters. The command filter is applied to all elements at once.
+
+        :param execs: exec elements
+        :type execs: Iterable[libetrace.nfsdbEntry]
+        :return: exec elements allowed by filtering
+        :rtype: List[libetrace.nfsdbEntry]
+        """
+        if self.has_command_filter and self.command_filter is not None:
+            execs = self.command_filter.filter(execs)
+        return [e for e in execs if self.filter_exec(e, with_command_filter=False)]
+
+    def count_ftdb_natively(self) -> bool:
+        """
+        Checks if the count-only query can be resolved by libftdb (no filter or filter translated to libftdb).
+        """
+        return self.count_only and (self.ftdb_simple_filter is None or self.ftdb_simple_filter.libftdb_filter is not None)
+
     def filter_ftdb(self, ent) -> bool:
 
         ret = True
@@ -367,9 +414,8 @@ class Module:
         :rtype: Generator
         """
         for ent in self.nfsdb.get_entries_with_pids(pids):
-            for o in (ent.opens_with_children if self.args.with_children else ent.opens):
-                if self.filter_open(o):
-                    yield o.path
+            for o in self.filter_opens(ent.opens_with_children if self.args.with_children else ent.opens):
+                yield o.path
 
     def yield_open_from_pid(self, pids: "List[Tuple[int, int]] | List[Tuple[int,]]") -> Generator:
         """
@@ -381,9 +427,8 @@ class Module:
         :rtype: Generator
         """
         for ent in self.nfsdb.get_entries_with_pids(pids):
-            for o in (ent.opens_with_children if self.args.with_children else ent.opens):
-                if self.filter_open(o):
-                    yield o
+            for o in self.filter_opens(ent.opens_with_children if self.args.with_children else ent.opens):
+                yield o
 
     def get_multi_deps(self, epaths: "List[libcas.DepsParam | str]") -> List[libetrace.nfsdbEntryOpenfile]:
         """
@@ -38,8 +38,7 @@ class Compiled(Module, FilterableModule):
             data = list({
                 ent
                 for ent in self.nfsdb.filtered_execs_iter(self.command_filter.libetrace_filter if self.command_filter else None, has_comp_info=True)
-                for o in ent.compilation_info.files
-                if self.filter_open(o) and self.filter_exec(ent)
+                if self.filter_exec(ent) and self.filter_opens(ent.compilation_info.files)
             })
             if self.args.cdb:
                 data = list(self.cdb_fix_multiple(data))
@@ -48,17 +47,17 @@ class Compiled(Module, FilterableModule):
         elif self.args.details:
             data = list({
                 o
-                for ent in self.nfsdb.filtered_execs_iter(self.command_filter.libetrace_filter if self.command_filter else None, has_comp_info=True)
-                for o in ent.compilation_info.files
-                if self.filter_open(o)
+                for o in self.filter_opens(f
+                    for ent in self.nfsdb.filtered_execs_iter(self.command_filter.libetrace_filter if self.command_filter else None, has_comp_info=True)
+                    for f in ent.compilation_info.files)
             })
             return data, DataTypes.compiled_data, lambda x: x.path, libetrace.nfsdbEntryOpenfile
         else:
             data = list({
                 o.path
-                for ent in self.nfsdb.filtered_execs_iter(self.command_filter.libetrace_filter if self.command_filter else None, has_comp_info=True)
-                for o in ent.compilation_info.files
-                if self.filter_open(o)
+                for o in self.filter_opens(f
+                    for ent in self.nfsdb.filtered_execs_iter(self.command_filter.libetrace_filter if self.command_filter else None, has_comp_info=True)
+                    for f in ent.compilation_info.files)
             })
 
             if self.args.revdeps:
@@ -105,9 +104,11 @@ class RevCompsFor(Module, PipedModule, FilterableModule):
         if self.args.show_commands or self.args.details:
             data = list({
                 oo.opaque
-                for opn in self.nfsdb.get_opens_of_path(self.args.path)
-                for oo in opn.parent.parent.opens_with_children
-                if oo.opaque is not None and oo.opaque.compilation_info and self.filter_open(oo) and self.filter_exec(oo.opaque)
+                for oo in self.filter_opens(o
+                    for opn in self.nfsdb.get_opens_of_path(self.args.path)
+                    for o in opn.parent.parent.opens_with_children
+                    if o.opaque is not None and o.opaque.compilation_info)
+                if self.filter_exec(oo.opaque)
             })
             return data, DataTypes.commands_data, lambda x: x.compilation_info.files[0], libetrace.nfsdbEntry
         elif self.args.rcm:
@@ -115,18 +116,20 @@ class RevCompsFor(Module, PipedModule, FilterableModule):
             for p in self.args.path:
                 data.append( [p, list({
                     oo.opaque.compilation_info.files[0].path
-                    for opn in self.nfsdb.get_opens_of_path(p)
-                    for oo in opn.parent.parent.opens_with_children
-                    if oo.opaque is not None and oo.opaque.compilation_info and self.filter_open(oo)
+                    for oo in self.filter_opens(o
+                        for opn in self.nfsdb.get_opens_of_path(p)
+                        for o in opn.parent.parent.opens_with_children
+                        if o.opaque is not None and o.opaque.compilation_info)
                 })]
                 )
             return data, DataTypes.cdm_data, None, None
         else:
             data = list({
                 oo.opaque.compilation_info.files[0].path
-                for opn in self.nfsdb.get_opens_of_path(self.args.path)
-                for oo in opn.parent.parent.opens_with_children
-                if oo.opaque is not None and oo.opaque.compilation_info and self.filter_open(oo)
+                for oo in self.filter_opens(o
+                    for opn in self.nfsdb.get_opens_of_path(self.args.path)
+                    for o in opn.parent.parent.opens_with_children
+                    if o.opaque is not None and o.opaque.compilation_info)
             })
             if self.args.revdeps:
                 data = self.get_revdeps(data)
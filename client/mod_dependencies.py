@@ -94,8 +94,8 @@ class DepsFor(Module, PipedModule, FilterableModule):
         elif self.args.show_commands:
             data = list({
                 self.get_exec_of_open(d)
-                for d in self.get_multi_deps(paths)
-                if self.filter_exec(self.get_exec_of_open(d)) and self.should_display_open(d) and self.filter_open(d)
+                for d in self.filter_opens(self.get_multi_deps(paths))
+                if self.filter_exec(self.get_exec_of_open(d)) and self.should_display_open(d)
             })
             if self.args.cdb:
                 data = list(self.cdb_fix_multiple(data))
@@ -105,30 +105,28 @@ class DepsFor(Module, PipedModule, FilterableModule):
             if self.args.deep:
                 data = list({
                     f
-                    for d in self.get_multi_deps(paths)
-                    for f in self.get_deep_comps(d)
-                    if self.filter_open(f)
+                    for f in self.filter_opens(f
+                        for d in self.get_multi_deps(paths)
+                        for f in self.get_deep_comps(d))
                 })
             else:
                 data = list({
                     d
-                    for d in self.get_multi_deps(paths)
-                    if self.filter_open(d)
+                    for d in self.filter_opens(self.get_multi_deps(paths))
                 })
             return data, DataTypes.file_data, lambda x: x.path, libetrace.nfsdbEntryOpenfile
         else:
             if self.args.deep:
                 data = list({
                     f.path
-                    for d in self.get_multi_deps(paths)
-                    for f in self.get_deep_comps(d)
-                    if self.filter_open(f)
+                    for f in self.filter_opens(f
+                        for d in self.get_multi_deps(paths)
+                        for f in self.get_deep_comps(d))
                 })
             else:
                 data = list({
                     d.path
-                    for d in self.get_multi_deps(paths)
-                    if self.filter_open(d)
+                    for d in self.filter_opens(self.get_multi_deps(paths))
                 })
 
             if self.args.rdm:
@@ -219,16 +217,14 @@ class RevDepsFor(Module, PipedModule, FilterableModule):
         elif self.args.details:
             data = list({
                 o
-                for o in rdeps
-                if self.filter_open(o)
+                for o in self.filter_opens(rdeps)
             })
 
             return data, DataTypes.file_data, lambda x: x.path, libetrace.nfsdbEntryOpenfile
         else:
             data = list({
                 o.path
-                for o in rdeps
-                if self.filter_open(o)
+                for o in self.filter_opens(rdeps)
             })
 
             if self.args.cdm:
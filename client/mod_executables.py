@@ -1,7 +1,7 @@
 from typing import Any, Tuple, Callable
 from client.mod_base import Module, PipedModule, FilterableModule
 from client.misc import printdbg
-from client.output_renderers.output import DataTypes
+from client.output_renderers.output import DataTypes, EntriesCount
 import libetrace
 
 
@@ -37,6 +37,11 @@ class Binaries(Module, FilterableModule):
 
         args = self.prepare_args()
 
+        if self.count_only and not self.args.generate:
+            if self.args.details or self.args.show_commands:
+                return EntriesCount(self.nfsdb.filtered_execs_iter(**args).count()), DataTypes.commands_data, lambda x: x.bpath, str
+            return EntriesCount(self.nfsdb.filtered_execs_iter(**args).count("bin")), DataTypes.binary_data, lambda x: x, str
+
         if self.args.details or self.args.show_commands:
             data = list({e
                          for e in self.nfsdb.filtered_execs_iter(**args)
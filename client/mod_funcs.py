@@ -3,7 +3,7 @@ import libft_db
 from argparse import ArgumentParser
 from typing import Any, Callable, Tuple
 from client.mod_base import Module, PipedModule, FilterableModule
-from client.output_renderers.output import DataTypes
+from client.output_renderers.output import DataTypes, EntriesCount
 
 class FunctionsModule(Module, FilterableModule, PipedModule):
     """ Functions - returns list of functions from Function Type Database """
@@ -12,14 +12,21 @@ class FunctionsModule(Module, FilterableModule, PipedModule):
         return Module.add_args(["ftdb-simple-filter", "details", "body", "ubody"], FunctionsModule)
     
     def set_piped_arg(self, data, data_type: type) -> None:
-        if data_type in (libft_db.ftdbSourceEntry, libft_db.ftdbModuleEntry):
+        if data_type == libft_db.ftdbSourceEntry:
             self.args.fids = [d.fid for d in data]
+        elif data_type == libft_db.ftdbModuleEntry:
+            self.args.mids = [d.mid for d in data]
     
     def get_data(self) -> Tuple[Any, DataTypes, "Callable|None", "type|None"]:
+        fids = getattr(self.args, 'fids', None)
+        mids = getattr(self.args, 'mids', None)
+        if self.count_ftdb_natively():
+            flt = self.ftdb_simple_filter.libftdb_filter if self.ftdb_simple_filter else None
+            return EntriesCount(self.ft_db.count_funcs(fids, flt, mids)), DataTypes.function_data, lambda x: x.name, None
         if self.has_ftdb_simple_filter:
-            funcs = [func for func in self.ft_db.get_funcs(getattr(self.args, 'fids', None)) if self.filter_ftdb(func)]
+            funcs = [func for func in self.ft_db.get_funcs(fids, mids) if self.filter_ftdb(func)]
         else:
-            funcs = [func for func in self.ft_db.get_funcs(getattr(self.args, 'fids', None))]
+            funcs = [func for func in self.ft_db.get_funcs(fids, mids)]
         return funcs, DataTypes.function_data, lambda x: x.name, None
 
 
@@ -30,10 +37,16 @@ class FuncDeclModule(Module, FilterableModule, PipedModule):
         return Module.add_args(["ftdb-simple-filter", "details", "declbody"], FuncDeclModule)
     
     def set_piped_arg(self, data, data_type: type) -> None:
-        if data_type in (libft_db.ftdbSourceEntry, libft_db.ftdbModuleEntry):
+        if data_type == libft_db.ftdbSourceEntry:
             self.args.fids = [d.fid for d in data]
+        elif data_type == libft_db.ftdbModuleEntry:
+            # Declarations are not linked in modules, take the ones from the files of the module functions
+            self.args.fids = list({fid for func in self.ft_db.get_funcs(mids=[d.mid for d in data]) for fid in func.fids})
 
     def get_data(self) -> Tuple[Any, DataTypes, "Callable|None", "type|None"]:
+        if self.count_ftdb_natively():
+            flt = self.ftdb_simple_filter.libftdb_filter if self.ftdb_simple_filter else None
+            return EntriesCount(self.ft_db.count_funcdecls(getattr(self.args, 'fids', None), flt)), DataTypes.funcdecl_data, lambda x: x.name, None
         if self.has_ftdb_simple_filter:
             funcdecls = [fd for fd in self.ft_db.get_funcdecls(getattr(self.args, 'fids', None)) if self.filter_ftdb(fd)]
         else:
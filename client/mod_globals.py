@@ -3,7 +3,7 @@ import libftdb
 from argparse import ArgumentParser
 from typing import Any, Callable, Tuple
 from client.mod_base import Module, PipedModule, FilterableModule
-from client.output_renderers.output import DataTypes
+from client.output_renderers.output import DataTypes, EntriesCount
 
 class GlobalsModule(Module, FilterableModule, PipedModule):
     """ Globals - returns list of global variables from Function Type Database """
@@ -12,14 +12,21 @@ class GlobalsModule(Module, FilterableModule, PipedModule):
         return Module.add_args(["details", "ftdb-simple-filter", "definition"], GlobalsModule)
 
     def set_piped_arg(self, data, data_type: type) -> None:
-        if data_type in (libft_db.ftdbSourceEntry, libft_db.ftdbModuleEntry):
+        if data_type == libft_db.ftdbSourceEntry:
             self.args.fids = [d.fid for d in data]
+        elif data_type == libft_db.ftdbModuleEntry:
+            self.args.mids = [d.mid for d in data]
 
     def get_data(self) -> Tuple[Any, DataTypes, "Callable|None", "type|None"]:
+        fids = getattr(self.args, 'fids', None)
+        mids = getattr(self.args, 'mids', None)
+        if self.count_ftdb_natively() and mids is None:
+            flt = self.ftdb_simple_filter.libftdb_filter if self.ftdb_simple_filter else None
+            return EntriesCount(self.ft_db.count_globs(fids, flt)), DataTypes.global_data, lambda x: x.name, None
         if self.has_ftdb_simple_filter:
-            globs = [glob for glob in self.ft_db.get_globs(getattr(self.args, 'fids', None)) if self.filter_ftdb(glob)]
+            globs = [glob for glob in self.ft_db.get_globs(fids, mids) if self.filter_ftdb(glob)]
         else:
-            globs = [glob for glob in self.ft_db.get_globs(getattr(self.args, 'fids', None))]
+            globs = [glob for glob in self.ft_db.get_globs(fids, mids)]
         return globs, DataTypes.global_data, lambda x: x.name, None 
 
 
@@ -30,6 +37,8 @@ class TypesModule(Module, FilterableModule):
         return Module.add_args(["details", "ftdb-simple-filter"], TypesModule)
 
     def get_data(self) -> Tuple[Any, DataTypes, "Callable|None", "type|None"]:
+        if self.count_only and not self.has_ftdb_simple_filter:
+            return EntriesCount(len(self.ft_db.get_types())), DataTypes.type_data, lambda x: x.name, None
         if self.has_ftdb_simple_filter:
             types = [t for t in self.ft_db.get_types() if self.filter_ftdb(t)]
         else:
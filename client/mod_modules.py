@@ -45,8 +45,8 @@ class LinkedModules(Module, PipedModule, FilterableModule):
         if self.args.show_commands:
             data = list({
                 self.get_exec_of_open(o)
-                for o in self.nfsdb.linked_modules()
-                if self.filter_open(o) and self.filter_exec(self.get_exec_of_open(o)) and self.should_display_open(o)
+                for o in self.filter_opens(self.nfsdb.linked_modules())
+                if self.filter_exec(self.get_exec_of_open(o)) and self.should_display_open(o)
             } if self.needs_open_filtering() or self.needs_exec_filtering() else {
                 self.get_exec_of_open(o)
                 for o in self.nfsdb.linked_modules()
@@ -57,8 +57,7 @@ class LinkedModules(Module, PipedModule, FilterableModule):
         elif self.args.details:
             data = list({
                 o
-                for o in self.nfsdb.linked_modules()
-                if self.filter_open(o)
+                for o in self.filter_opens(self.nfsdb.linked_modules())
             }) if self.needs_open_filtering() else list({
                 o
                 for o in self.nfsdb.linked_modules()
@@ -69,8 +68,7 @@ class LinkedModules(Module, PipedModule, FilterableModule):
         else:
             data = list({
                 o.path
-                for o in self.nfsdb.linked_modules()
-                if self.filter_open(o)
+                for o in self.filter_opens(self.nfsdb.linked_modules())
             }) if self.needs_open_filtering() else list({
                 o.path
                 for o in self.nfsdb.linked_modules()
@@ -135,28 +133,28 @@ class ModDepsFor(Module, PipedModule, FilterableModule):
         if self.args.show_commands:
             data = list({
                 self.get_exec_of_open(o)
-                for o in self.nfsdb.get_module_dependencies(self.args.path, direct=self.args.direct)
-                if o.path in linked_modules and (self.args.all or o.opaque is not None) and self.filter_open(o) and self.filter_exec(o.parent)
+                for o in self.filter_opens(self.nfsdb.get_module_dependencies(self.args.path, direct=self.args.direct))
+                if o.path in linked_modules and (self.args.all or o.opaque is not None) and self.filter_exec(o.parent)
             } if self.args.generate else {
                 self.get_exec_of_open(o)
-                for o in self.nfsdb.get_module_dependencies(self.args.path, direct=self.args.direct)
-                if o.path in linked_modules and self.filter_open(o) and self.filter_exec(o.parent)
+                for o in self.filter_opens(self.nfsdb.get_module_dependencies(self.args.path, direct=self.args.direct))
+                if o.path in linked_modules and self.filter_exec(o.parent)
             })
 
             return data, DataTypes.commands_data, lambda x: x.eid.pid, libetrace.nfsdbEntry
         elif self.args.details:
             data = list({
                 o
-                for o in self.nfsdb.get_module_dependencies(self.args.path, direct=self.args.direct)
-                if o.path in linked_modules and self.filter_open(o)
+                for o in self.filter_opens(self.nfsdb.get_module_dependencies(self.args.path, direct=self.args.direct))
+                if o.path in linked_modules
             })
 
             return data, DataTypes.file_data, lambda x: x.path, libetrace.nfsdbEntryOpenfile
         else:
             data = list({
                 o.path
-                for o in self.nfsdb.get_module_dependencies(self.args.path, direct=self.args.direct)
-                if o.path in linked_modules and self.filter_open(o) and o.path not in self.args.path
+                for o in self.filter_opens(self.nfsdb.get_module_dependencies(self.args.path, direct=self.args.direct))
+                if o.path in linked_modules and o.path not in self.args.path
             })
 
             return data, DataTypes.file_data, None, str
@@ -207,28 +205,26 @@ class RevModDepsFor(Module, PipedModule, FilterableModule):
         if self.args.show_commands:
             data = list({
                 o.parent if self.args.all else o.opaque
-                for o in self.get_reverse_dependencies_opens(self.args.path, recursive=self.args.recursive)
-                if (self.args.all or o.opaque is not None) and self.filter_open(o) and self.filter_exec(o.parent if self.args.all else o.opaque)
+                for o in self.filter_opens(self.get_reverse_dependencies_opens(self.args.path, recursive=self.args.recursive))
+                if (self.args.all or o.opaque is not None) and self.filter_exec(o.parent if self.args.all else o.opaque)
             } if self.args.generate else {
                 o.parent
-                for o in self.get_reverse_dependencies_opens(self.args.path, recursive=self.args.recursive)
-                if self.filter_open(o) and self.filter_exec(o.parent)
+                for o in self.filter_opens(self.get_reverse_dependencies_opens(self.args.path, recursive=self.args.recursive))
+                if self.filter_exec(o.parent)
             })
 
             return data, DataTypes.commands_data, lambda x: x.eid.pid, libetrace.nfsdbEntry
         elif self.args.details:
             data = list({
                 o
-                for o in self.get_reverse_dependencies_opens(self.args.path, recursive=self.args.recursive)
-                if self.filter_open(o)
+                for o in self.filter_opens(self.get_reverse_dependencies_opens(self.args.path, recursive=self.args.recursive))
             })
 
             return data, DataTypes.file_data, lambda x: x.path, libetrace.nfsdbEntryOpenfile
         else:
             data = list({
                 o.path
-                for o in self.get_reverse_dependencies_opens(self.args.path, recursive=self.args.recursive)
-                if self.filter_open(o)
+                for o in self.filter_opens(self.get_reverse_dependencies_opens(self.args.path, recursive=self.args.recursive))
             })
 
             return data, DataTypes.file_data, None, str
@@ -2,7 +2,7 @@
 from typing import Any, Tuple, Callable
 from client.mod_base import Module, PipedModule, FilterableModule
 from client.misc import printdbg
-from client.output_renderers.output import DataTypes
+from client.output_renderers.output import DataTypes, EntriesCount
 from client.exceptions import PipelineException
 import libetrace
 
@@ -41,8 +41,8 @@ class Faccess(Module, PipedModule, FilterableModule):
         if self.args.show_commands:
             data = list({
                 self.get_exec_of_open(o)
-                for o in self.nfsdb.get_opens_of_path(self.args.path)
-                if self.filter_open(o) and self.filter_exec(self.get_exec_of_open(o))
+                for o in self.filter_opens(self.nfsdb.get_opens_of_path(self.args.path))
+                if self.filter_exec(self.get_exec_of_open(o))
             })
             if self.args.cdb:
                 data = list(self.cdb_fix_multiple(data))
@@ -51,15 +51,14 @@ class Faccess(Module, PipedModule, FilterableModule):
         elif self.args.details:
             data = list({
                 o
-                for o in self.nfsdb.get_opens_of_path(self.args.path)
-                if self.filter_open(o)
+                for o in self.filter_opens(self.nfsdb.get_opens_of_path(self.args.path))
             })
             return data, DataTypes.file_data, lambda x: x.parent.eid.pid ,libetrace.nfsdbEntryOpenfile
         else:
             data = list({
                 (o.parent.eid.pid, o.mode)
-                for o in self.nfsdb.get_opens_of_path(self.args.path)
-                if self.filter_open(o) and self.filter_exec(o.parent)
+                for o in self.filter_opens(self.nfsdb.get_opens_of_path(self.args.path))
+                if self.filter_exec(o.parent)
             })
             return data, DataTypes.process_data, lambda x: x[0], int
 
@@ -106,7 +105,7 @@ class ProcRef(Module, PipedModule, FilterableModule):
         if self.args.show_commands:
             data = list({ self.get_exec_of_open(o)
                 for o in self.yield_open_from_pid([(int(pid),) for pid in self.args.pid])
-                if self.filter_exec(self.get_exec_of_open(o)) and self.filter_open(o)
+                if self.filter_exec(self.get_exec_of_open(o))
             })
             if self.args.cdb:
                 data = list(self.cdb_fix_multiple(data))
@@ -158,7 +157,13 @@ class RefFiles(Module, FilterableModule):
         else:
             return ent.path
 
-    def get_data(self) -> Tuple[Any, DataTypes, "Callable|None", "type|None"]:
+    def get_data(self) -> Tuple[Any, DataTypes, "Callable|str|None", "type|None"]:
+        if self.count_only and self.args.show_commands and not self.command_filter and not self.args.cdb and \
+                not (self.args.generate and not self.args.all):
+            # Number of distinct executions that opened the (filtered) files
+            opens = self.nfsdb.filtered_opens_iter(self.open_filter.libetrace_filter) if self.open_filter else self.nfsdb.opens_iter()
+            return EntriesCount(opens.count("exec")), DataTypes.commands_data, lambda x: x.eid.pid, libetrace.nfsdbEntry
+
         if self.args.show_commands:
             if self.open_filter:
                 data = list({
@@ -172,7 +177,7 @@ class RefFiles(Module, FilterableModule):
                     })
 
             if self.command_filter:
-                data = [ex for ex in data if self.filter_exec(ex)]
+                data = self.filter_execs(data)
 
             if self.args.cdb:
                 data = list(self.cdb_fix_multiple(data))
@@ -188,11 +193,13 @@ class RefFiles(Module, FilterableModule):
             if self.has_select:
                 data = [o for o in data if o.path in self.args.select]
 
-            return data, DataTypes.file_data, lambda x: x.path, libetrace.nfsdbEntryOpenfile
+            return data, DataTypes.file_data, "path", libetrace.nfsdbEntryOpenfile
 
         else:
             if self.open_filter:
                 data = self.nfsdb.filtered_paths_iter(file_filter=self.open_filter.libetrace_filter)
+            elif self.count_only and not self.has_append:
+                data = self.nfsdb.filtered_paths_iter()
             else:
                 data = self.nfsdb.opens_paths()
 
@@ -1,7 +1,7 @@
 from abc import abstractmethod
 import itertools
 from enum import IntEnum
-from typing import Iterator, Callable
+from typing import Dict, Iterator, Callable
 
 import libetrace
 from client.exceptions import ParameterException
@@ -43,13 +43,24 @@ class DataTypes(IntEnum):
     null_data = 104
 
 
+class EntriesCount:
+    """
+    Number of entries computed natively by the module in place of the entries (count-only query).
+    """
+    def __init__(self, count: int) -> None:
+        self.count = count
+
+    def __len__(self) -> int:
+        return self.count
+
+
 class OutputRenderer:
     default_entries_count = 0
 
     def __init__(self, data, args, origin, output_type: DataTypes, sort_lambda: Callable) -> None:
         self.args = args
         self.data = data
-        self.count = len(data) if isinstance(data, list) or isinstance(data, Iterator) else -1
+        self.count = len(data) if isinstance(data, (list, Iterator, EntriesCount)) else -1
         self.sort_lambda = self.get_sorting_lambda(sort_lambda)
 
         if self.args.entries_per_page is None:
@@ -91,35 +102,91 @@ class OutputRenderer:
             DataTypes.type_data: self.types_data_renderer
         }[self.output_type]
 
+    exec_sort_keys: Dict[str, Callable] = {
+        "bin": lambda x: x.bpath,
+        "cwd": lambda x: x.cwd,
+        "cmd": lambda x: " ".join(x.argv)
+    }
+    open_sort_keys: Dict[str, Callable] = {
+        "mode": lambda x: x.mode,
+        "path": lambda x: x.path,
+        "original_path": lambda x: x.original_path
+    }
+
     def get_sorting_lambda(self, original_sort_lambda):
+        self.native_sort_key = None
+        if self.args.sorted and isinstance(self.data, (libetrace.nfsdbIter, libetrace.nfsdbFilteredCommandsIter)):
+            # Sorting and the page window are pushed down into libetrace (see render_data)
+            if self.args.sorting_key is not None:
+                if self.args.sorting_key not in self.exec_sort_keys:
+                    raise ParameterException("Wrong sorted-key value! Allowed [ bin, cwd, cmd ]")
+                self.native_sort_key = self.args.sorting_key
+            elif isinstance(original_sort_lambda, str):
+                self.native_sort_key = original_sort_lambda
+
+        if self.args.sorted and isinstance(self.data, (libetrace.nfsdbOpensIter, libetrace.nfsdbFilteredOpensIter)):
+            if self.args.sorting_key is not None:
+                if self.args.sorting_key not in self.open_sort_keys:
+                    raise ParameterException("Wrong sorted-key value! Allowed [ path, original_path, mode ]")
+                self.native_sort_key = self.args.sorting_key
+            elif isinstance(original_sort_lambda, str):
+                self.native_sort_key = original_sort_lambda
+
         if self.args.sorted and isinstance(self.data, list) and self.count > 0:
             if isinstance(self.data[0], libetrace.nfsdbEntry):
                 if self.args.sorting_key is not None:
-                    if self.args.sorting_key == "bin":
-                        return lambda x: x.bpath
-                    elif self.args.sorting_key == "cwd":
-                        return lambda x: x.cwd
-                    elif self.args.sorting_key == "cmd":
-                        return lambda x: " ".join(x.argv)
+                    if self.args.sorting_key in self.exec_sort_keys:
+                        return self.exec_sort_keys[self.args.sorting_key]
                     else:
                         raise ParameterException("Wrong sorted-key value! Allowed [ bin, cwd, cmd ]")
 
             if isinstance(self.data[0], libetrace.nfsdbEntryOpenfile):
                 if self.args.sorting_key is not None:
-                    if self.args.sorting_key == "mode":
-                        return lambda x: x.mode
-                    if self.args.sorting_key == "path":
-                        return lambda x: x.path
-                    if self.args.sorting_key == "original_path":
-                        return lambda x: x.original_path
+                    if self.args.sorting_key in self.open_sort_keys:
+                        return self.open_sort_keys[self.args.sorting_key]
                     else:
                         raise ParameterException("Wrong sorted-key value! Allowed [ path, original_path, mode ]")
 
+        # Modules can name the native sorting key of the returned objects instead of providing the lambda
+        if isinstance(original_sort_lambda, str):
+            return self.open_sort_keys.get(original_sort_lambda, self.exec_sort_keys.get(original_sort_lambda))
         return original_sort_lambda
 
+    def get_window(self):
+        """
+        Returns the (start, stop, step) slice of the sorted data selected by the range or page arguments
+        or None when the slice cannot be computed before sorting (negative range bounds).
+        """
+        if self.args.range:
+            parts = self.args.range.replace("[", "").replace("]", "").split(":")
+            bounds = [int(p) if p != '' else None for p in parts]
+            if len(parts) > 3 or any(b is not None and b < 0 for b in bounds):
+                return None
+            start = bounds[0] if bounds[0] is not None else 0
+            if len(parts) == 1:
+                return (start, start + 1, None)
+            return (start, bounds[1], bounds[2] if len(parts) > 2 else None)
+        elif self.args.entries_per_page != 0:
+            if self.count < (self.args.page * self.args.entries_per_page):
+                self.args.page = int(self.count/self.args.entries_per_page)
+            return (self.args.page * self.args.entries_per_page, (self.args.page + 1) * self.args.entries_per_page, None)
+        return (0, None, None)
+
     def render_data(self):
         if self.args.count:
             return self.count_renderer()
+        if self.native_sort_key is not None and self.output_type.value < DataTypes.config_data.value:
+            window = self.get_window()
+            if window is not None:
+                # Only the selected window of the sorted data is created (partial sort in libetrace)
+                start, stop, step = window
+                self.data = self.data.sorted_window(self.native_sort_key, start, stop, reverse=bool(self.args.reverse))
+                if step is not None:
+                    self.data = self.data[::step]
+                if not self.args.plain:
+                    self.num_entries = len(self.data)
+                return self.output_renderer()
+
         if not self.args.count and self.args.sorted and self.output_type.value < DataTypes.config_data.value:
             self.data = sorted(self.data, key=self.sort_lambda, reverse=self.args.reverse)
 
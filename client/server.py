@@ -115,7 +115,10 @@ class DBProvider:
                     self.db_map[db_name]["nfsdb"].set_config(self.db_map[db_name]["config"])
                     try:
                         self.db_map[db_name]["nfsdb"].load_db(self.db_map[db_name]["nfsdb_path"], debug=self.args.debug, quiet=not self.args.verbose)
+                        self.log_image(db_name, self.db_map[db_name]["nfsdb_path"], self.db_map[db_name]["nfsdb"].db.mapped)
                         self.db_map[db_name]["nfsdb"].load_deps_db(self.db_map[db_name]["deps_path"], debug=self.args.debug, quiet=not self.args.verbose)
+                        if self.db_map[db_name]["nfsdb"].cache_db_loaded:
+                            self.log_image(db_name, self.db_map[db_name]["deps_path"], self.db_map[db_name]["nfsdb"].db.deps_mapped)
                         self.db_map[db_name]["db_version"] = libcas.CASDatabase.get_db_version(self.db_map[db_name]["nfsdb_path"])
                     except Exception as e:
                         self.db_map[db_name]["nfsdb"] = None
@@ -126,6 +129,38 @@ class DBProvider:
         else:
             raise EndpointException(f"Endpoint database '{db_name}' does not exists!")
 
+    def log_image(self, db_name: str, image_path: str, mapped: bool):
+        """
+        Function reports whether the current (worker) process mapped the prelinked copy of the loaded image, which is
+        shared with the other processes, or unflattened a private copy of it.
+        """
+        print(f"[{os.getpid()}] Database '{db_name}': {'mapped' if mapped else 'unflattened'} image '{image_path}'")
+
+    def prelink_dbs(self):
+        """
+        Function loads every database image once so that the missing prelinked images (<image>.mmap) are written
+        before the server worker processes start. Workers then map the same prelinked files and share their pages
+        instead of unflattening a private copy of every image each.
+        """
+        self.refresh_dbs()
+        for db_name, db in self.db_map.items():
+            start = time.time()
+            try:
+                nfsdb = libcas.CASDatabase()
+                nfsdb.db.load(db["nfsdb_path"], debug=self.args.debug, quiet=not self.args.verbose, prelink=True)
+                if exists(db["deps_path"]):
+                    nfsdb.db.load_deps(db["deps_path"], debug=self.args.debug, quiet=not self.args.verbose, prelink=True)
+                del nfsdb
+                for ftdb_path in db["ftdb_files"]:
+                    ftdb = libft_db.FTDatabase()
+                    ftdb.load_db(ftdb_path, debug=self.args.debug, quiet=not self.args.verbose, prelink=True)
+                    del ftdb
+            except Exception as e:
+                print(f"WARNING: Failed to prelink database '{db_name}': {e}")
+                continue
+            if self.args.verbose:
+                print(f"Prelinked database '{db_name}' [{time.time() - start:.2f}s]")
+
     def process_command(self, db_name: str, cmd: List[str]):
         self.ensure_db(db_name)
         self.db_map[db_name]["last_access"] = time.time()
@@ -146,6 +181,7 @@ class DBProvider:
         self.db_map[db_name]["ftdb"].unload_db()
         if ftdb_name in self.db_map[db_name]["ftdb_files"]:
             self.db_map[db_name]["ftdb"].load_db(ftdb_name)
+            self.log_image(db_name, ftdb_name, self.db_map[db_name]["ftdb"].db.mapped)
             return True
         return False
 
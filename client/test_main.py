@@ -5,10 +5,12 @@ import os
 import fnmatch
 import sys
 import json
+from itertools import islice
 from typing import Iterator, Generator, List
 import pytest
 import timeout_decorator
 import libcas
+import libetrace
 
 from client.cmdline import process_commandline
 from client.argparser import get_api_modules, get_args, merge_args, get_bash_complete, get_api_keywords
@@ -567,6 +569,81 @@ class TestGeneric:
         assert fil.libetrace_filter[1][2] == (None, ("has_ppid", 123), ('is_class', 0x0001), False, ('bin_not_at_source_root', None))
         assert fil.libetrace_filter[1][3] == (('bin_contains_path', '/bash'), None, None, False, None)
 
+    @staticmethod
+    def get_opn_filters(flt):
+        return (OpenFilter(flt, None, config, nfsdb.source_root),
+                OpenFilter(flt, None, config, nfsdb.source_root, nfsdb=nfsdb.db))
+
+    @staticmethod
+    def get_cmd_filters(flt):
+        return (CommandFilter(flt, None, config, nfsdb.source_root),
+                CommandFilter(flt, None, config, nfsdb.source_root, nfsdb=nfsdb.db))
+
+    @staticmethod
+    def sample_opens():
+        return list(islice(nfsdb.opens_iter(), 100000))
+
+    @staticmethod
+    def sample_execs():
+        return list(islice(nfsdb.db.iter(), 100000))
+
+    def test_filter_python_negate(self):
+        opens = self.sample_opens()
+        for python_fil, native_fil in [self.get_opn_filters("[path=*.c,type=wc]"), self.get_opn_filters("[path=*.c,type=wc,negate=false]"),
+                                       self.get_opn_filters("[path=*.c,type=wc,negate=0]")]:
+            assert not python_fil.filter_dict[0][0]["filter_negate"] and not python_fil.libetrace_filter[0][0][4]
+            assert [python_fil.resolve_filters(o) for o in opens] == [o.path.endswith(".c") for o in opens]
+            assert [native_fil.resolve_filters(o) for o in opens] == [o.path.endswith(".c") for o in opens]
+        for python_fil, native_fil in [self.get_opn_filters("[path=*.c,type=wc,negate=true]"), self.get_opn_filters("[path=*.c,type=wc,negate=1]")]:
+            assert [python_fil.resolve_filters(o) for o in opens] == [not o.path.endswith(".c") for o in opens]
+            assert [native_fil.resolve_filters(o) for o in opens] == [not o.path.endswith(".c") for o in opens]
+        execs = self.sample_execs()
+        python_fil, native_fil = self.get_cmd_filters("[class=compiler,negate=false]")
+        assert [python_fil.resolve_filters(e) for e in execs] == [e.has_compilations() for e in execs]
+        assert [native_fil.resolve_filters(e) for e in execs] == [e.has_compilations() for e in execs]
+
+    def test_filter_python_plain_class(self):
+        opens = self.sample_opens()
+        python_fil, native_fil = self.get_opn_filters("[class=plain]")
+        assert [python_fil.resolve_filters(o) for o in opens] == [o.is_plain() for o in opens]
+        assert [native_fil.resolve_filters(o) for o in opens] == [o.is_plain() for o in opens]
+
+    def test_filter_python_source_root(self):
+        opens = self.sample_opens()
+        for flt in ["[source_root=1]", "[source_root=true]", "[source_root=0]", "[source_root=false]"]:
+            python_fil, native_fil = self.get_opn_filters(flt)
+            assert [python_fil.resolve_filters(o) for o in opens] == [native_fil.resolve_filters(o) for o in opens]
+        python_fil, _ = self.get_opn_filters("[source_root=1]")
+        assert not any(python_fil.resolve_filters(o) for o in opens if o.path == nfsdb.source_root)
+
+    def test_filter_python_command_keys(self):
+        execs = self.sample_execs()
+        ppid = execs[len(execs)//2].parent_eid.pid
+        for flt in [f"[ppid={ppid}]", "[cwd_source_root=1]", "[cwd_source_root=false]", "[bin_source_root=1]", "[bin_source_root=0]",
+                    "[cwd_source_root=1,class=command]or[bin_source_root=true,negate=true]"]:
+            python_fil, native_fil = self.get_cmd_filters(flt)
+            assert [python_fil.resolve_filters(e) for e in execs] == [native_fil.resolve_filters(e) for e in execs]
+        python_fil, _ = self.get_cmd_filters(f"[ppid={ppid}]")
+        assert [python_fil.resolve_filters(e) for e in execs] == [e.parent_eid.pid == ppid for e in execs]
+
+    def test_filter_python_global_access(self):
+        opens = self.sample_opens()[:100]
+        python_fil, native_fil = self.get_opn_filters("[global_access=r]")
+        try:
+            python_fil.filter(opens)
+            assert False
+        except FilterException as err:
+            assert "needs a loaded database" in err.message
+        assert native_fil.filter(opens) == [o for o in opens if nfsdb.db.path_read(o.path) and not nfsdb.db.path_write(o.path)]
+
+    def test_filter_source_root_keys_exclusive(self):
+        self.trigger_cmd_filter_exception(["binaries", "--command-filter=[cwd_source_root=1,bin_source_root=1]"], "Can't use cwd_source_root and bin_source_root")
+
+    def test_eid_unsigned(self):
+        assert libetrace.eid(2**64-1).pid == 2**64-1
+        assert libetrace.eid(2**64-1, 1).index == 1
+        assert all(e.parent_eid.pid >= 0 for e in self.sample_execs())
+
 
 class TestBinaries:
     def test_simple(self):
@@ -19,7 +19,7 @@ struct ftdb_type_entry* libftdb_c_get_type_entry_by_id(CFtdb ftdb_c, unsigned lo
  * FTDB_VERSION - required libftdb version to support file
  */
 #define FTDB_MAGIC_NUMBER		0x4244544642494cULL		/* b'LIBFTDB\0' */
-#define FTDB_VERSION			6ULL
+#define FTDB_VERSION			8ULL
 
 
 enum functionLinkage {
@@ -916,6 +916,26 @@ struct ftdb {
     unsigned long func_fptrs_data_count;
     struct rb_root BAS_data_index;
     struct rb_root static_funcs_map_index;
+    /* Scheme of the declaration hashes ("sha1" or "murmur3_128") */
+    const char* hash_scheme;
+    /*
+     * Inverted file (fid) and module (mid) indexes in the CSR layout: the indexes of the entries
+     *  referencing the key k are stored (ascending) in X_index[X_offsets[k]..X_offsets[k+1])
+     */
+    unsigned long fid_keys_count;
+    unsigned long* fid_funcs_offsets;
+    unsigned long* fid_funcs_index;
+    unsigned long fid_funcs_index_count;
+    unsigned long* fid_globals_offsets;
+    unsigned long* fid_globals_index;
+    unsigned long fid_globals_index_count;
+    unsigned long* fid_funcdecls_offsets;
+    unsigned long* fid_funcdecls_index;
+    unsigned long fid_funcdecls_index_count;
+    unsigned long mid_keys_count;
+    unsigned long* mid_funcs_offsets;
+    unsigned long* mid_funcs_index;
+    unsigned long mid_funcs_index_count;
 };
 
 #endif /* __FTDB_H__ */
@@ -0,0 +1,322 @@
+extern "C" {
+#include "prelink.h"
+}
+#include <map>
+#include <string>
+#include <utility>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+/*
+ * Prelinked images are placed in 256 slots of 256GB starting at 32TB of the (47-bit) user address space,
+ *  far away from the regions used by the heap, shared libraries and the stack. The first slot tried is derived
+ *  from the identity of the original image and the following ones are probed when it is already taken
+ */
+#define PRELINK_AREA_START 0x200000000000UL
+#define PRELINK_SLOT_SIZE  0x4000000000UL
+#define PRELINK_SLOT_COUNT 256UL
+
+struct prelink {
+    struct stat src;
+    /* Absolute path of the original image */
+    std::string src_path;
+    std::string path;
+    bool shared;
+    uintptr_t base;
+    size_t reserved;
+    size_t used;
+    bool failed;
+    /* Source memory already copied into the image: source begin -> (source end, image address) */
+    std::map<uintptr_t, std::pair<uintptr_t, uintptr_t>> regions;
+};
+
+static uint64_t prelink_slot(const struct stat *st) {
+    uint64_t h = ((uint64_t)st->st_dev << 32) ^ (uint64_t)st->st_ino;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h % PRELINK_SLOT_COUNT;
+}
+
+/*
+ * Reserves 'size' bytes at the beginning of the first free slot starting from the slot of the original image and returns
+ *  the address or 0 (with errno set) when no slot is free or the prelink area is not available at all (e.g. it lies
+ *  outside of the user address space of a 39 or 42-bit VA kernel)
+ */
+static uintptr_t prelink_reserve(const struct stat *st, size_t size) {
+    uint64_t slot = prelink_slot(st);
+    for (uint64_t k = 0; k < PRELINK_SLOT_COUNT; ++k) {
+        uintptr_t base = PRELINK_AREA_START + ((slot + k) % PRELINK_SLOT_COUNT) * PRELINK_SLOT_SIZE;
+        void *p = mmap((void *)base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+        if (p == MAP_FAILED) {
+            if (errno != EEXIST)
+                return 0;
+            continue;
+        }
+        if ((uintptr_t)p == base)
+            return base;
+        /* Kernels before 4.17 treat the address as a hint only */
+        munmap(p, size);
+    }
+    errno = EEXIST;
+    return 0;
+}
+
+/*
+ * Path of the prelinked image in the shared directory (PRELINK_DIR_ENV) or an empty string if none is set; the name
+ *  carries the identity of the original image so that images with the same name don't collide there
+ */
+static std::string prelink_shared_path(const char *image_path, const struct stat *st) {
+    const char *dir = getenv(PRELINK_DIR_ENV);
+    if (!dir || !*dir)
+        return std::string();
+    const char *name = strrchr(image_path, '/');
+    name = name ? name + 1 : image_path;
+    char ident[64];
+    snprintf(ident, sizeof(ident), ".%lx-%lx", (unsigned long)st->st_dev, (unsigned long)st->st_ino);
+    return std::string(dir) + "/" + name + ident + PRELINK_SUFFIX;
+}
+
+/*
+ * Removes the shared copies of the previous versions of the original image (i.e. before it was replaced by a file with
+ *  another inode) from the shared directory; images with the same name saved from other paths are kept. Processes that
+ *  still map a removed copy keep using it until they unmap it
+ */
+static void prelink_remove_stale(const struct prelink *pl) {
+    if (pl->src_path.empty())
+        return;
+    size_t slash = pl->path.rfind('/');
+    std::string dir = pl->path.substr(0, slash);
+    std::string current = pl->path.substr(slash + 1);
+    size_t suffix_size = strlen(PRELINK_SUFFIX);
+    /* '<image name>.' */
+    std::string prefix = current.substr(0, current.rfind('.', current.size() - suffix_size - 1) + 1);
+
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return;
+    struct dirent *de;
+    while ((de = readdir(d))) {
+        std::string name = de->d_name;
+        if ((name == current) || (name.size() <= prefix.size() + suffix_size) || name.compare(0, prefix.size(), prefix) ||
+            name.compare(name.size() - suffix_size, suffix_size, PRELINK_SUFFIX))
+            continue;
+        std::string ident = name.substr(prefix.size(), name.size() - prefix.size() - suffix_size);
+        unsigned long dev, ino;
+        int n = 0;
+        if ((sscanf(ident.c_str(), "%lx-%lx%n", &dev, &ino, &n) != 2) || ((size_t)n != ident.size()))
+            continue;
+
+        std::string path = dir + "/" + name;
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        struct prelink_header header;
+        bool stale = (pread(fd, &header, sizeof(header), 0) == sizeof(header)) && (header.magic == PRELINK_MAGIC_NUMBER) &&
+                     (strnlen(header.src_path, sizeof(header.src_path)) < sizeof(header.src_path)) && (pl->src_path == header.src_path);
+        close(fd);
+        if (stale)
+            unlink(path.c_str());
+    }
+    closedir(d);
+}
+
+static size_t page_align(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (size + page - 1) & ~(page - 1);
+}
+
+struct prelink *prelink_init(const char *image_path) {
+    struct stat st;
+    if (stat(image_path, &st))
+        return NULL;
+
+    /* Unflattened memory never exceeds the size of the image it was loaded from */
+    size_t reserved = page_align(2 * (size_t)st.st_size + PRELINK_HEADER_SIZE + (64UL << 20));
+    if (reserved > PRELINK_SLOT_SIZE) {
+        fprintf(stderr, "WARNING: Image '%s' is too large to be prelinked, using unflatten\n", image_path);
+        return NULL;
+    }
+
+    uintptr_t base = prelink_reserve(&st, reserved);
+    if (!base) {
+        fprintf(stderr, "WARNING: Cannot reserve the address range for the prelinked image of '%s' (%s), using unflatten\n",
+                image_path, (errno == EEXIST) ? "all slots are taken" : strerror(errno));
+        return NULL;
+    }
+
+    struct prelink *pl = new prelink;
+    pl->src = st;
+    char *src_path = realpath(image_path, NULL);
+    if (src_path)
+        pl->src_path = src_path;
+    free(src_path);
+    pl->path = prelink_shared_path(image_path, &st);
+    pl->shared = !pl->path.empty();
+    if (!pl->shared)
+        pl->path = std::string(image_path) + PRELINK_SUFFIX;
+    pl->base = base;
+    pl->reserved = reserved;
+    pl->used = PRELINK_HEADER_SIZE;
+    pl->failed = false;
+    return pl;
+}
+
+void *prelink_copy(struct prelink *pl, const void *src, size_t size, size_t align, int *fresh) {
+    if (!src || !size || pl->failed)
+        return NULL;
+
+    uintptr_t s = (uintptr_t)src;
+    auto i = pl->regions.upper_bound(s);
+    if (i != pl->regions.begin()) {
+        --i;
+        if (s + size <= i->second.first) {
+            /* Already copied (possibly as a part of a larger array) */
+            if (fresh)
+                *fresh = 0;
+            return (void *)(i->second.second + (s - i->first));
+        }
+    }
+
+    size_t off = (pl->used + align - 1) & ~(align - 1);
+    if (off + size > pl->reserved) {
+        pl->failed = true;
+        return NULL;
+    }
+    void *dst = (void *)(pl->base + off);
+    memcpy(dst, src, size);
+    pl->used = off + size;
+    pl->regions[s] = std::make_pair(s + size, (uintptr_t)dst);
+    if (fresh)
+        *fresh = 1;
+    return dst;
+}
+
+const char *prelink_string(struct prelink *pl, const char *s) {
+    if (!s)
+        return NULL;
+    return (const char *)prelink_copy(pl, s, strlen(s) + 1, 1, NULL);
+}
+
+int prelink_write(struct prelink *pl, const void *root) {
+    if (pl->failed || !root) {
+        fprintf(stderr, "WARNING: Prelinked image of '%s' exceeds the reserved address range, using unflatten\n", pl->src_path.c_str());
+        return -1;
+    }
+
+    struct prelink_header *header = (struct prelink_header *)pl->base;
+    header->magic = PRELINK_MAGIC_NUMBER;
+    header->base = pl->base;
+    header->size = pl->used;
+    header->root = (uintptr_t)root;
+    header->src_dev = pl->src.st_dev;
+    header->src_ino = pl->src.st_ino;
+    header->src_size = pl->src.st_size;
+    header->src_mtime_sec = pl->src.st_mtim.tv_sec;
+    header->src_mtime_nsec = pl->src.st_mtim.tv_nsec;
+    if (pl->src_path.size() < sizeof(header->src_path))
+        memcpy(header->src_path, pl->src_path.c_str(), pl->src_path.size() + 1);
+
+    /* Write to a temporary file first so that concurrent readers never see a partial image */
+    std::string tmp = pl->path + ".XXXXXX";
+    int fd = mkstemp(&tmp[0]);
+    if (fd < 0) {
+        fprintf(stderr, "WARNING: Cannot create the prelinked image '%s' (%s), using unflatten\n", tmp.c_str(), strerror(errno));
+        return -1;
+    }
+
+    const char *p = (const char *)pl->base;
+    size_t left = pl->used;
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        p += n;
+        left -= n;
+    }
+    bool ok = (left == 0) && !fchmod(fd, 0644);
+    if (close(fd))
+        ok = false;
+    if (!ok || rename(tmp.c_str(), pl->path.c_str())) {
+        fprintf(stderr, "WARNING: Cannot save the prelinked image '%s' (%s), using unflatten\n", pl->path.c_str(), strerror(errno));
+        unlink(tmp.c_str());
+        return -1;
+    }
+    if (pl->shared)
+        prelink_remove_stale(pl);
+    return 0;
+}
+
+void prelink_fini(struct prelink *pl) {
+    munmap((void *)pl->base, pl->reserved);
+    delete pl;
+}
+
+static const struct prelink_header *prelink_map_file(const std::string &path, const struct stat *src) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    struct prelink_header header;
+    struct stat st;
+    if ((pread(fd, &header, sizeof(header), 0) != sizeof(header)) || fstat(fd, &st) ||
+        (header.magic != PRELINK_MAGIC_NUMBER) || (header.size != (uint64_t)st.st_size) ||
+        (header.src_dev != (uint64_t)src->st_dev) || (header.src_ino != (uint64_t)src->st_ino) ||
+        (header.src_size != (uint64_t)src->st_size) ||
+        (header.src_mtime_sec != (uint64_t)src->st_mtim.tv_sec) ||
+        (header.src_mtime_nsec != (uint64_t)src->st_mtim.tv_nsec)) {
+        /* Not a prelinked image or it was created for a different version of the original image */
+        close(fd);
+        return NULL;
+    }
+
+    void *p = mmap((void *)header.base, header.size, PROT_READ, MAP_PRIVATE | MAP_FIXED_NOREPLACE, fd, 0);
+    int err = errno;
+    close(fd);
+    if ((p != MAP_FAILED) && ((uintptr_t)p != header.base)) {
+        munmap(p, header.size);
+        p = MAP_FAILED;
+        err = EEXIST;
+    }
+    if (p == MAP_FAILED) {
+        /* EEXIST when the range is taken in this process, ENOMEM when it lies outside of the user address space */
+        fprintf(stderr, "WARNING: Cannot map the prelinked image '%s' at 0x%lx (%s), using unflatten\n", path.c_str(),
+                (unsigned long)header.base, strerror(err));
+        return NULL;
+    }
+    return (const struct prelink_header *)p;
+}
+
+const struct prelink_header *prelink_map(const char *image_path) {
+    struct stat src;
+    if (stat(image_path, &src))
+        return NULL;
+
+    /* The shared directory takes precedence over the prelinked image saved next to the original one */
+    std::string shared = prelink_shared_path(image_path, &src);
+    const struct prelink_header *header = NULL;
+    if (!shared.empty())
+        header = prelink_map_file(shared, &src);
+    if (!header)
+        header = prelink_map_file(std::string(image_path) + PRELINK_SUFFIX, &src);
+    return header;
+}
+
+void prelink_unmap(const struct prelink_header *header) {
+    if (header)
+        munmap((void *)header, header->size);
+}
@@ -0,0 +1,157 @@
+#ifndef __PRELINK_H__
+#define __PRELINK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Prelinked images
+ *
+ * A prelinked image is a copy of the unflattened database laid out in a single memory area at a fixed
+ *  virtual address and saved next to the original image (as '<image>.mmap'). As all pointers inside
+ *  are already valid for that address the file can be mapped read-only and used in place without any
+ *  relocation. Every process that maps the same file shares the same page cache pages (see also the
+ *  ftdb_image_map which shares one loaded image between ftdb objects within a process).
+ *
+ * The implementation is shared by libftdb and libetrace which generate the copy functions for their own
+ *  images from the flatten recipes (see PRELINK_RECIPES below, ftdb_prelink() and nfsdb_prelink()).
+ *
+ * The base address is derived from the identity of the original image file (device and inode), with the
+ *  following slots probed when it is already taken in the writing process, and is stored in the header.
+ *  The prelinked file is bound to the original file (size and modification time) so that a regenerated
+ *  image invalidates its stale prelinked copy. Whenever the file cannot be written or mapped at its base
+ *  address (e.g. the address range is already taken in the process or lies outside of the user address
+ *  space) a warning is printed to stderr and the callers fall back to unflatten.
+ *
+ * When the PRELINK_DIR_ENV environment variable names a directory (e.g. /dev/shm) prelinked images are
+ *  saved there instead (as '<image name>.<device>-<inode>.mmap') and looked up there first. This allows
+ *  sharing a single copy of images kept in read-only directories among the server worker processes.
+ *  Writing a new copy there removes the copies of the previous versions of the same original image
+ *  (recognized by the absolute path of the original image stored in the header).
+ */
+
+#define PRELINK_MAGIC_NUMBER 0x4b4e494c4552504dULL /* b'MPRELINK' */
+#define PRELINK_SUFFIX ".mmap"
+#define PRELINK_DIR_ENV "CAS_PRELINK_DIR"
+#define PRELINK_HEADER_SIZE 4096
+#define PRELINK_SRC_PATH_SIZE 3072
+
+struct prelink_header {
+    uint64_t magic;
+    uint64_t base;
+    uint64_t size;
+    uint64_t root;
+    uint64_t src_dev;
+    uint64_t src_ino;
+    uint64_t src_size;
+    uint64_t src_mtime_sec;
+    uint64_t src_mtime_nsec;
+    char src_path[PRELINK_SRC_PATH_SIZE];
+};
+
+struct prelink;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct prelink *prelink_init(const char *image_path);
+void *prelink_copy(struct prelink *pl, const void *src, size_t size, size_t align, int *fresh);
+const char *prelink_string(struct prelink *pl, const char *s);
+int prelink_write(struct prelink *pl, const void *root);
+void prelink_fini(struct prelink *pl);
+
+const struct prelink_header *prelink_map(const char *image_path);
+void prelink_unmap(const struct prelink_header *header);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef PRELINK_RECIPES
+/*
+ * Alternative definitions of the flatten recipe macros (see recipe.h). Including the recipes with
+ *  these definitions in place generates 'prelink_struct_array_<type>' functions that copy the
+ *  unflattened objects into the prelinked image and translate every pointer the recipes describe.
+ */
+#define PRELINK_ALIGN 8
+
+#define ATTR(f) (__attr->f)
+#define STRUCT_ALIGN(n)
+
+#define PRELINK_DECLARE_STRUCT(N, T) \
+    static void *prelink_struct_array_##N(struct prelink *__pl, const T *__src, size_t __n)
+
+#define PRELINK_DEFINE_STRUCT(N, T, ...)                                                          \
+    PRELINK_DECLARE_STRUCT(N, T);                                                                 \
+    static void prelink_struct_##N(struct prelink *__pl, T *__dst, const T *__attr) {             \
+        (void)__pl;                                                                               \
+        (void)__dst;                                                                              \
+        (void)__attr;                                                                             \
+        __VA_ARGS__                                                                               \
+    }                                                                                             \
+    PRELINK_DECLARE_STRUCT(N, T) {                                                                \
+        int __fresh = 0;                                                                          \
+        T *__dst = prelink_copy(__pl, __src, __n * sizeof(T), PRELINK_ALIGN, &__fresh);           \
+        if (__dst && __fresh) {                                                                   \
+            for (size_t __i = 0; __i < __n; ++__i) {                                              \
+                prelink_struct_##N(__pl, &__dst[__i], &__src[__i]);                               \
+            }                                                                                     \
+        }                                                                                         \
+        return __dst;                                                                             \
+    }
+
+#define FUNCTION_DECLARE_FLATTEN_STRUCT(T) PRELINK_DECLARE_STRUCT(T, struct T)
+#define FUNCTION_DECLARE_FLATTEN_STRUCT_TYPE(T) PRELINK_DECLARE_STRUCT(T, T)
+#define FUNCTION_DEFINE_FLATTEN_STRUCT(T, ...) PRELINK_DEFINE_STRUCT(T, struct T, __VA_ARGS__)
+#define FUNCTION_DEFINE_FLATTEN_STRUCT_TYPE(T, ...) PRELINK_DEFINE_STRUCT(T, T, __VA_ARGS__)
+
+#define AGGREGATE_FLATTEN_STRING(f) \
+    __dst->f = (__typeof__(__dst->f))prelink_string(__pl, __attr->f)
+
+#define AGGREGATE_FLATTEN_TYPE_ARRAY(T, f, n) \
+    __dst->f = (__typeof__(__dst->f))prelink_copy(__pl, __attr->f, (n) * sizeof(T), PRELINK_ALIGN, 0)
+
+#define AGGREGATE_FLATTEN_STRUCT_ARRAY(T, f, n) \
+    __dst->f = (__typeof__(__dst->f))prelink_struct_array_##T(__pl, (const void *)__attr->f, (n))
+
+#define AGGREGATE_FLATTEN_STRUCT(T, f) AGGREGATE_FLATTEN_STRUCT_ARRAY(T, f, 1)
+#define AGGREGATE_FLATTEN_STRUCT_TYPE(T, f) AGGREGATE_FLATTEN_STRUCT_ARRAY(T, f, 1)
+
+/* Pointer with the two least significant bits used for other data (i.e. rb_node parent and color) */
+#define AGGREGATE_FLATTEN_STRUCT_EMBEDDED_POINTER(T, f, pre_f, post_f)                                     \
+    __dst->f = (__typeof__(__dst->f))((uintptr_t)prelink_struct_array_##T(__pl,                            \
+                                          (const void *)(__attr->f & ~3UL), 1) | (__attr->f & 3UL))
+
+#define AGGREGATE_FLATTEN_STRUCT_TYPE_EMBEDDED_POINTER(T, f, pre_f, post_f) \
+    AGGREGATE_FLATTEN_STRUCT_EMBEDDED_POINTER(T, f, pre_f, post_f)
+
+/* Iterates over the array of pointers stored in the destination object; 'p' is evaluated with ATTR()
+ *  bound to the destination so the (possibly not yet copied) array can be stored back there */
+#define FOREACH_POINTER(PT, v, p, s, ...)                                               \
+    do {                                                                                \
+        PT const *__old = (PT const *)(p);                                              \
+        size_t __count = (s);                                                           \
+        PT *__new = prelink_copy(__pl, __old, __count * sizeof(PT), PRELINK_ALIGN, 0);  \
+        {                                                                               \
+            __typeof__(__dst) __attr = __dst;                                           \
+            *(PT **)&(p) = __new;                                                       \
+        }                                                                               \
+        if (__new) {                                                                    \
+            for (size_t __i = 0; __i < __count; ++__i) {                                \
+                PT v = __old[__i];                                                      \
+                PT *__slot = &__new[__i];                                               \
+                __VA_ARGS__                                                             \
+            }                                                                           \
+        }                                                                               \
+    } while (0)
+
+#define FLATTEN_STRING(v) \
+    *(const char **)__slot = prelink_string(__pl, (const char *)(v))
+
+#define FLATTEN_STRUCT(T, v) \
+    *(void **)__slot = prelink_struct_array_##T(__pl, (const void *)(v), 1)
+
+#endif /* PRELINK_RECIPES */
+
+#endif /* __PRELINK_H__ */
@@ -0,0 +1,178 @@
+#include "pyftdb.h"
+
+static int libftdb_ulong_cmp(const void *a, const void *b) {
+    unsigned long ua = *(const unsigned long *)a;
+    unsigned long ub = *(const unsigned long *)b;
+    return (ua > ub) - (ua < ub);
+}
+
+/*
+ * Collects the (ascending and unique) entry indexes from the posting lists of the given keys
+ *  of the CSR inverted index (keys not below the 'key_limit' have no entries)
+ */
+unsigned long *libftdb_ftdb_csr_collect(const unsigned long *keys, unsigned long keys_count, unsigned long key_limit,
+                                        const unsigned long *offsets, const unsigned long *index, unsigned long *entries_count) {
+    unsigned long count = 0;
+    unsigned long lists = 0;
+    for (unsigned long i = 0; i < keys_count; ++i) {
+        if (keys[i] < key_limit && offsets[keys[i] + 1] > offsets[keys[i]]) {
+            count += offsets[keys[i] + 1] - offsets[keys[i]];
+            lists++;
+        }
+    }
+
+    unsigned long *entries = malloc((count + 1) * sizeof(unsigned long));
+    unsigned long u = 0;
+    for (unsigned long i = 0; i < keys_count; ++i) {
+        if (keys[i] < key_limit) {
+            for (unsigned long j = offsets[keys[i]]; j < offsets[keys[i] + 1]; ++j) {
+                entries[u++] = index[j];
+            }
+        }
+    }
+
+    /* A single posting list is already ordered */
+    if (lists > 1) {
+        qsort(entries, count, sizeof(unsigned long), libftdb_ulong_cmp);
+        unsigned long n = 0;
+        for (unsigned long i = 0; i < count; ++i) {
+            if (!n || entries[n - 1] != entries[i])
+                entries[n++] = entries[i];
+        }
+        count = n;
+    }
+
+    *entries_count = count;
+    return entries;
+}
+
+/*
+ * Parses the sequence of keys (file or module ids) and collects the entries referencing any of them
+ */
+PyObject *libftdb_ftdb_collection_view_by_keys(libftdb_ftdb_collection_object *collection, PyObject *args, PyTypeObject *entry_type,
+                                               const char *name, unsigned long key_limit, const unsigned long *offsets, const unsigned long *index) {
+    PyObject *py_keys;
+    if (!PyArg_ParseTuple(args, "O", &py_keys))
+        return NULL;
+
+    if (!offsets) {
+        PyErr_SetString(libftdb_ftdbError, "No inverted index in the database image");
+        return NULL;
+    }
+
+    PyObject *keys_seq = PySequence_Fast(py_keys, "Invalid keys argument (not a sequence)");
+    if (!keys_seq)
+        return NULL;
+
+    unsigned long keys_count = PySequence_Fast_GET_SIZE(keys_seq);
+    unsigned long *keys = malloc((keys_count + 1) * sizeof(unsigned long));
+    for (unsigned long i = 0; i < keys_count; ++i) {
+        keys[i] = PyLong_AsUnsignedLong(PySequence_Fast_GET_ITEM(keys_seq, i));
+        if (PyErr_Occurred()) {
+            free(keys);
+            Py_DecRef(keys_seq);
+            return NULL;
+        }
+    }
+    Py_DecRef(keys_seq);
+
+    unsigned long entries_count;
+    unsigned long *entries = libftdb_ftdb_csr_collect(keys, keys_count, key_limit, offsets, index, &entries_count);
+    free(keys);
+
+    PyObject *view_args = PyTuple_New(5);
+    PYTUPLE_SET_ULONG(view_args, 0, (uintptr_t)collection);
+    PYTUPLE_SET_ULONG(view_args, 1, (uintptr_t)entry_type);
+    PYTUPLE_SET_ULONG(view_args, 2, (uintptr_t)entries);
+    PYTUPLE_SET_ULONG(view_args, 3, entries_count);
+    PYTUPLE_SET_ULONG(view_args, 4, (uintptr_t)name);
+    PyObject *view = PyObject_CallObject((PyObject *)&libftdb_ftdbCollectionViewType, view_args);
+    Py_DecRef(view_args);
+    if (!view)
+        free(entries);
+    return view;
+}
+
+static void libftdb_ftdb_collection_view_dealloc(libftdb_ftdb_collection_view_object *self) {
+    free(self->entries);
+    Py_DecRef((PyObject *)self->collection);
+    Py_TYPE(self)->tp_free(self);
+}
+
+static PyObject *libftdb_ftdb_collection_view_repr(PyObject *self) {
+    static char repr[1024];
+    libftdb_ftdb_collection_view_object *__self = (libftdb_ftdb_collection_view_object *)self;
+    int written = snprintf(repr, 1024, "<%s object at %lx : ", __self->name, (uintptr_t)self);
+    written += snprintf(repr + written, 1024 - written, "%ld elements>", __self->entries_count);
+    return PyUnicode_FromString(repr);
+}
+
+/* The view takes the ownership of the (malloc'ed) entry index array */
+static PyObject *libftdb_ftdb_collection_view_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds) {
+    libftdb_ftdb_collection_view_object *self;
+    self = (libftdb_ftdb_collection_view_object *)subtype->tp_alloc(subtype, 0);
+    if (self != 0) {
+        self->collection = (const libftdb_ftdb_collection_object *)PyLong_AsLong(PyTuple_GetItem(args, 0));
+        self->entry_type = (PyTypeObject *)PyLong_AsLong(PyTuple_GetItem(args, 1));
+        self->entries = (unsigned long *)PyLong_AsLong(PyTuple_GetItem(args, 2));
+        self->entries_count = PyLong_AsUnsignedLong(PyTuple_GetItem(args, 3));
+        self->name = (const char *)PyLong_AsLong(PyTuple_GetItem(args, 4));
+        Py_IncRef((PyObject *)self->collection);
+    }
+    return (PyObject *)self;
+}
+
+static Py_ssize_t libftdb_ftdb_collection_view_sq_length(PyObject *self) {
+    libftdb_ftdb_collection_view_object *__self = (libftdb_ftdb_collection_view_object *)self;
+    return __self->entries_count;
+}
+
+static PyObject *libftdb_ftdb_collection_view_sq_item(PyObject *self, Py_ssize_t i) {
+    libftdb_ftdb_collection_view_object *__self = (libftdb_ftdb_collection_view_object *)self;
+
+    if (i < 0 || (unsigned long)i >= __self->entries_count) {
+        PyErr_SetString(PyExc_IndexError, "view index out of range");
+        return 0;
+    }
+
+    PyObject *args = PyTuple_New(2);
+    PYTUPLE_SET_ULONG(args, 0, (uintptr_t)__self->collection);
+    PYTUPLE_SET_ULONG(args, 1, __self->entries[i]);
+    PyObject *entry = PyObject_CallObject((PyObject *)__self->entry_type, args);
+    Py_DecRef(args);
+    return entry;
+}
+
+static PyObject *libftdb_ftdb_collection_view_get_indexes(PyObject *self, void *closure) {
+    libftdb_ftdb_collection_view_object *__self = (libftdb_ftdb_collection_view_object *)self;
+
+    PyObject *indexes = PyList_New(__self->entries_count);
+    for (unsigned long i = 0; i < __self->entries_count; ++i) {
+        PyList_SetItem(indexes, i, PyLong_FromUnsignedLong(__self->entries[i]));
+    }
+    return indexes;
+}
+
+static PySequenceMethods libftdb_ftdbCollectionView_sequence_methods = {
+    .sq_length = libftdb_ftdb_collection_view_sq_length,
+    .sq_item = libftdb_ftdb_collection_view_sq_item,
+};
+
+static PyGetSetDef libftdb_ftdbCollectionView_getset[] = {
+    {"indexes", libftdb_ftdb_collection_view_get_indexes, 0, "ftdb collection view entry indexes", 0},
+    {0, 0, 0, 0, 0},
+};
+
+PyTypeObject libftdb_ftdbCollectionViewType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "libftdb.ftdbCollectionView",
+    .tp_basicsize = sizeof(libftdb_ftdb_collection_view_object),
+    .tp_dealloc = (destructor)libftdb_ftdb_collection_view_dealloc,
+    .tp_repr = (reprfunc)libftdb_ftdb_collection_view_repr,
+    .tp_as_sequence = &libftdb_ftdbCollectionView_sequence_methods,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "libftdb ftdb collection view (entries of the collection selected by the inverted index)",
+    .tp_iter = PySeqIter_New,
+    .tp_getset = libftdb_ftdbCollectionView_getset,
+    .tp_new = libftdb_ftdb_collection_view_new,
+};
@@ -0,0 +1,15 @@
+#include <stdint.h>
+#include <ftdb.h>
+
+#define PRELINK_RECIPES
+#include <prelink.h>
+#include "recipe.h"
+
+int ftdb_prelink(const char *image_path, const struct ftdb *ftdb) {
+    struct prelink *pl = prelink_init(image_path);
+    if (!pl)
+        return -1;
+    int err = prelink_write(pl, prelink_struct_array_ftdb(pl, ftdb, 1));
+    prelink_fini(pl);
+    return err;
+}
@@ -22,7 +22,92 @@ gnrefmap:		global_name -> global_entry
 fdrefmap:		fdecl_id -> func_decl_entry
 fdhrefmap:		fdeclhash -> func_decl_entry
 fdnrefmap:		fdeclname -> [func_decl_entry, func_decl_entry...]
+
+ Inverted indexes (CSR offsets and entry index arrays)
+fid_funcs:		fid -> [func index, func index...]
+fid_globals:		fid -> [global index, global index...]
+fid_funcdecls:		fid -> [funcdecl index, funcdecl index...]
+mid_funcs:		mid -> [func index, func index...]
 */
+
+/* Builds the CSR posting lists of the keys returned by 'keys(i)' for every entry 'i' (keys repeated in an entry count once) */
+template <typename Keys>
+static void build_csr_index(unsigned long entry_count, unsigned long keys_count, Keys keys,
+                            unsigned long **offsets, unsigned long **index, unsigned long *index_count) {
+    *offsets = (unsigned long *)calloc(keys_count + 1, sizeof(unsigned long));
+    std::vector<unsigned long> entry_keys;
+    for (unsigned long i = 0; i < entry_count; ++i) {
+        keys(i, entry_keys);
+        for (unsigned long k : entry_keys) {
+            (*offsets)[k + 1]++;
+        }
+    }
+    for (unsigned long k = 0; k < keys_count; ++k) {
+        (*offsets)[k + 1] += (*offsets)[k];
+    }
+    *index_count = (*offsets)[keys_count];
+    *index = (unsigned long *)malloc((*index_count ? *index_count : 1) * sizeof(unsigned long));
+    std::vector<unsigned long> fill(*offsets, *offsets + keys_count);
+    for (unsigned long i = 0; i < entry_count; ++i) {
+        keys(i, entry_keys);
+        for (unsigned long k : entry_keys) {
+            (*index)[fill[k]++] = i;
+        }
+    }
+}
+
+static void ids_unique(const unsigned long *ids, unsigned long ids_count, std::vector<unsigned long> &out) {
+    out.assign(ids, ids + ids_count);
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+static void build_fid_mid_index(struct ftdb *ftdb, int show_stats) {
+    unsigned long fid_limit = ftdb->sourceindex_table_count;
+    unsigned long mid_limit = ftdb->moduleindex_table_count;
+    for (unsigned long i = 0; i < ftdb->funcs_count; ++i) {
+        struct ftdb_func_entry *func_entry = &ftdb->funcs[i];
+        for (unsigned long j = 0; j < func_entry->fids_count; ++j) {
+            fid_limit = std::max(fid_limit, func_entry->fids[j] + 1);
+        }
+        for (unsigned long j = 0; j < func_entry->mids_count; ++j) {
+            mid_limit = std::max(mid_limit, func_entry->mids[j] + 1);
+        }
+    }
+    for (unsigned long i = 0; i < ftdb->globals_count; ++i) {
+        fid_limit = std::max(fid_limit, ftdb->globals[i].fid + 1);
+    }
+    for (unsigned long i = 0; i < ftdb->funcdecls_count; ++i) {
+        fid_limit = std::max(fid_limit, ftdb->funcdecls[i].fid + 1);
+    }
+    ftdb->fid_keys_count = fid_limit;
+    ftdb->mid_keys_count = mid_limit;
+
+    build_csr_index(
+        ftdb->funcs_count, fid_limit,
+        [ftdb](unsigned long i, std::vector<unsigned long> &keys) { ids_unique(ftdb->funcs[i].fids, ftdb->funcs[i].fids_count, keys); },
+        &ftdb->fid_funcs_offsets, &ftdb->fid_funcs_index, &ftdb->fid_funcs_index_count);
+    build_csr_index(
+        ftdb->globals_count, fid_limit,
+        [ftdb](unsigned long i, std::vector<unsigned long> &keys) { keys.assign(1, ftdb->globals[i].fid); },
+        &ftdb->fid_globals_offsets, &ftdb->fid_globals_index, &ftdb->fid_globals_index_count);
+    build_csr_index(
+        ftdb->funcdecls_count, fid_limit,
+        [ftdb](unsigned long i, std::vector<unsigned long> &keys) { keys.assign(1, ftdb->funcdecls[i].fid); },
+        &ftdb->fid_funcdecls_offsets, &ftdb->fid_funcdecls_index, &ftdb->fid_funcdecls_index_count);
+    build_csr_index(
+        ftdb->funcs_count, mid_limit,
+        [ftdb](unsigned long i, std::vector<unsigned long> &keys) { ids_unique(ftdb->funcs[i].mids, ftdb->funcs[i].mids_count, keys); },
+        &ftdb->mid_funcs_offsets, &ftdb->mid_funcs_index, &ftdb->mid_funcs_index_count);
+
+    if (show_stats) {
+        printf("fid_funcs keys: %lu entry count: %lu\n", ftdb->fid_keys_count, ftdb->fid_funcs_index_count);
+        printf("fid_globals keys: %lu entry count: %lu\n", ftdb->fid_keys_count, ftdb->fid_globals_index_count);
+        printf("fid_funcdecls keys: %lu entry count: %lu\n", ftdb->fid_keys_count, ftdb->fid_funcdecls_index_count);
+        printf("mid_funcs keys: %lu entry count: %lu\n", ftdb->mid_keys_count, ftdb->mid_funcs_index_count);
+    }
+}
+
 int ftdb_maps(struct ftdb *ftdb, int show_stats) {
     for (unsigned long i = 0; i < ftdb->types_count; ++i) {
         struct ftdb_type_entry *type_entry = &ftdb->types[i];
@@ -71,5 +156,7 @@ int ftdb_maps(struct ftdb *ftdb, int show_stats) {
 
     BUILD_STRINGREF_ENTRYLIST_MAP(ftdb, fdnrefmap, fdnrefmap);
 
+    build_fid_mid_index(ftdb, show_stats);
+
     return 1;
 }
@@ -200,6 +200,40 @@ static int libftdb_ftdb_funcdecls_sq_contains(PyObject *self, PyObject *key) {
     return 0;
 }
 
+static PyObject *libftdb_ftdb_funcdecls_count(libftdb_ftdb_collection_object *self, PyObject *args, PyObject *kwargs) {
+    struct ftdb_collection_count_args cargs;
+    if (!libftdb_ftdb_collection_count_args_parse(args, kwargs, &cargs))
+        return NULL;
+    if (cargs.has_mids) {
+        libftdb_ftdb_collection_count_args_destroy(&cargs);
+        PyErr_SetString(libftdb_ftdbError, "The 'mids' argument is not supported for funcdecl entries");
+        return NULL;
+    }
+
+    /* Only the entries from the given files are visited (through the inverted file index) */
+    unsigned long entries_count = self->ftdb->funcdecls_count;
+    unsigned long *entries = NULL;
+    if (cargs.has_fids)
+        entries = libftdb_ftdb_csr_collect(cargs.fids, cargs.fids_count, self->ftdb->fid_keys_count, self->ftdb->fid_funcdecls_offsets,
+                                           self->ftdb->fid_funcdecls_index, &entries_count);
+
+    unsigned long count = 0;
+    for (unsigned long i = 0; i < entries_count; ++i) {
+        const struct ftdb_funcdecl_entry *entry = &self->ftdb->funcdecls[entries ? entries[i] : i];
+        if (libftdb_ftdb_collection_count_args_match(&cargs, entry->name, entry->location))
+            ++count;
+    }
+
+    free(entries);
+    libftdb_ftdb_collection_count_args_destroy(&cargs);
+    return PyLong_FromUnsignedLong(count);
+}
+
+static PyObject *libftdb_ftdb_funcdecls_entries_by_fids(libftdb_ftdb_collection_object *self, PyObject *args) {
+    return libftdb_ftdb_collection_view_by_keys(self, args, &libftdb_ftdbFuncdeclsEntryType, "ftdbFuncdeclsView", self->ftdb->fid_keys_count,
+                                                self->ftdb->fid_funcdecls_offsets, self->ftdb->fid_funcdecls_index);
+}
+
 PyMethodDef libftdb_ftdbFuncdecls_methods[] = {
     {"entry_by_id", (PyCFunction)libftdb_ftdb_funcdecls_entry_by_id, METH_VARARGS, "Returns the ftdb funcdecl entry with a given id"},
     {"contains_id", (PyCFunction)libftdb_ftdb_funcdecls_contains_id, METH_VARARGS, "Check whether there is a funcdecl entry with a given id"},
@@ -207,6 +241,8 @@ PyMethodDef libftdb_ftdbFuncdecls_methods[] = {
     {"contains_hash", (PyCFunction)libftdb_ftdb_funcdecls_contains_hash, METH_VARARGS, "Check whether there is a funcdecl entry with a given hash"},
     {"entry_by_name", (PyCFunction)libftdb_ftdb_funcdecls_entry_by_name, METH_VARARGS, "Returns the ftdb funcdecl entry with a given name"},
     {"contains_name", (PyCFunction)libftdb_ftdb_funcdecls_contains_name, METH_VARARGS, "Check whether there is a funcdecl entry with a given name"},
+    {"count", (PyCFunction)libftdb_ftdb_funcdecls_count, METH_VARARGS | METH_KEYWORDS, "Returns the number of funcdecl entries from the given files (if any) matching a given filter"},
+    {"entries_by_fids", (PyCFunction)libftdb_ftdb_funcdecls_entries_by_fids, METH_VARARGS, "Returns the view of the funcdecl entries from any of the given files"},
     {NULL, NULL, 0, NULL}
 };
 
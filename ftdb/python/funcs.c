@@ -216,6 +216,43 @@ static PyObject *libftdb_ftdb_funcs_get_refcount(PyObject *self, void *closure)
     return PyLong_FromLong(self->ob_refcnt);
 }
 
+static PyObject *libftdb_ftdb_funcs_count(libftdb_ftdb_collection_object *self, PyObject *args, PyObject *kwargs) {
+    struct ftdb_collection_count_args cargs;
+    if (!libftdb_ftdb_collection_count_args_parse(args, kwargs, &cargs))
+        return NULL;
+
+    /* Only the entries from the given files or modules are visited (through the inverted file and module indexes) */
+    unsigned long entries_count = self->ftdb->funcs_count;
+    unsigned long *entries = NULL;
+    if (cargs.has_fids)
+        entries = libftdb_ftdb_csr_collect(cargs.fids, cargs.fids_count, self->ftdb->fid_keys_count, self->ftdb->fid_funcs_offsets,
+                                           self->ftdb->fid_funcs_index, &entries_count);
+    else if (cargs.has_mids)
+        entries = libftdb_ftdb_csr_collect(cargs.mids, cargs.mids_count, self->ftdb->mid_keys_count, self->ftdb->mid_funcs_offsets,
+                                           self->ftdb->mid_funcs_index, &entries_count);
+
+    unsigned long count = 0;
+    for (unsigned long i = 0; i < entries_count; ++i) {
+        const struct ftdb_func_entry *entry = &self->ftdb->funcs[entries ? entries[i] : i];
+        if (libftdb_ftdb_collection_count_args_match(&cargs, entry->name, entry->location))
+            ++count;
+    }
+
+    free(entries);
+    libftdb_ftdb_collection_count_args_destroy(&cargs);
+    return PyLong_FromUnsignedLong(count);
+}
+
+static PyObject *libftdb_ftdb_funcs_entries_by_fids(libftdb_ftdb_collection_object *self, PyObject *args) {
+    return libftdb_ftdb_collection_view_by_keys(self, args, &libftdb_ftdbFuncsEntryType, "ftdbFuncsView", self->ftdb->fid_keys_count,
+                                                self->ftdb->fid_funcs_offsets, self->ftdb->fid_funcs_index);
+}
+
+static PyObject *libftdb_ftdb_funcs_entries_by_mids(libftdb_ftdb_collection_object *self, PyObject *args) {
+    return libftdb_ftdb_collection_view_by_keys(self, args, &libftdb_ftdbFuncsEntryType, "ftdbFuncsView", self->ftdb->mid_keys_count,
+                                                self->ftdb->mid_funcs_offsets, self->ftdb->mid_funcs_index);
+}
+
 PyMethodDef libftdb_ftdbFuncs_methods[] = {
     {"entry_by_id", (PyCFunction)libftdb_ftdb_funcs_entry_by_id, METH_VARARGS, "Returns the ftdb func entry with a given id"},
     {"contains_id", (PyCFunction)libftdb_ftdb_funcs_contains_id, METH_VARARGS, "Check whether there is a func entry with a given id"},
@@ -223,6 +260,9 @@ PyMethodDef libftdb_ftdbFuncs_methods[] = {
     {"contains_hash", (PyCFunction)libftdb_ftdb_funcs_contains_hash, METH_VARARGS, "Check whether there is a func entry with a given hash"},
     {"entry_by_name", (PyCFunction)libftdb_ftdb_funcs_entry_by_name, METH_VARARGS, "Returns the list of ftdb func entries with a given name"},
     {"contains_name", (PyCFunction)libftdb_ftdb_funcs_contains_name, METH_VARARGS, "Check whether there is a func entry with a given name"},
+    {"count", (PyCFunction)libftdb_ftdb_funcs_count, METH_VARARGS | METH_KEYWORDS, "Returns the number of func entries defined in any of the given files or modules (if any) matching a given filter"},
+    {"entries_by_fids", (PyCFunction)libftdb_ftdb_funcs_entries_by_fids, METH_VARARGS, "Returns the view of the func entries from any of the given files"},
+    {"entries_by_mids", (PyCFunction)libftdb_ftdb_funcs_entries_by_mids, METH_VARARGS, "Returns the view of the func entries from any of the given modules"},
     {NULL, NULL, 0, NULL}
 };
 
@@ -61,3 +61,137 @@ static Py_ssize_t libftdb_ftdb_collection_iter_sq_length(PyObject *self) {
 PySequenceMethods libftdb_ftdbCollectionIter_sequence_methods = {
     .sq_length = libftdb_ftdb_collection_iter_sq_length,
 };
+
+void libftdb_ftdb_collection_count_args_destroy(struct ftdb_collection_count_args *cargs) {
+    for (unsigned long i = 0; i < cargs->parts_count; ++i) {
+        PYASSTR_DECREF(cargs->parts[i].pattern);
+    }
+    free(cargs->fids);
+    free(cargs->mids);
+    free(cargs->parts);
+    free(cargs->and_count);
+}
+
+/* Converts the sequence of file (or module) ids into the allocated array */
+static unsigned long *libftdb_ftdb_collection_count_args_keys(PyObject *py_keys, const char *error, unsigned long *keys_count) {
+    PyObject *keys = PySequence_Fast(py_keys, error);
+    if (!keys)
+        return NULL;
+    *keys_count = PySequence_Fast_GET_SIZE(keys);
+    unsigned long *ret = malloc((*keys_count + 1) * sizeof(unsigned long));
+    for (unsigned long i = 0; i < *keys_count; ++i) {
+        ret[i] = PyLong_AsUnsignedLong(PySequence_Fast_GET_ITEM(keys, i));
+        if (PyErr_Occurred()) {
+            Py_DecRef(keys);
+            free(ret);
+            return NULL;
+        }
+    }
+    Py_DecRef(keys);
+    return ret;
+}
+
+/*
+ * Parses the (fids=None, filter=None, mids=None) arguments of the collections 'count' method
+ *  fids: sequence of file ids the counted entries have to be defined in
+ *  filter: [ [(FIELD, WC_PATTERN, NEGATE), ...], ... ] list of OR-ed lists of AND-ed wildcard matches of
+ *          the entry 'name' or 'location' field
+ *  mids: sequence of module ids the counted entries have to be linked in (only the funcs have the module index)
+ */
+int libftdb_ftdb_collection_count_args_parse(PyObject *args, PyObject *kwargs, struct ftdb_collection_count_args *cargs) {
+    static char *kwlist[] = {"fids", "filter", "mids", NULL};
+    PyObject *py_fids = Py_None;
+    PyObject *py_filter = Py_None;
+    PyObject *py_mids = Py_None;
+
+    memset(cargs, 0, sizeof(struct ftdb_collection_count_args));
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OOO", kwlist, &py_fids, &py_filter, &py_mids))
+        return 0;
+
+    if (py_fids != Py_None && py_mids != Py_None) {
+        PyErr_SetString(libftdb_ftdbError, "Only one of the 'fids' and 'mids' arguments can be given");
+        return 0;
+    }
+
+    if (py_fids != Py_None) {
+        cargs->fids = libftdb_ftdb_collection_count_args_keys(py_fids, "Invalid 'fids' argument (not a sequence)", &cargs->fids_count);
+        if (!cargs->fids)
+            return 0;
+        cargs->has_fids = 1;
+    }
+
+    if (py_mids != Py_None) {
+        cargs->mids = libftdb_ftdb_collection_count_args_keys(py_mids, "Invalid 'mids' argument (not a sequence)", &cargs->mids_count);
+        if (!cargs->mids)
+            return 0;
+        cargs->has_mids = 1;
+    }
+
+    if (py_filter != Py_None) {
+        if (!PyList_Check(py_filter)) {
+            PyErr_SetString(libftdb_ftdbError, "Invalid 'filter' argument (not a list)");
+            libftdb_ftdb_collection_count_args_destroy(cargs);
+            return 0;
+        }
+        cargs->or_count = PyList_Size(py_filter);
+        cargs->and_count = calloc(cargs->or_count + 1, sizeof(unsigned long));
+        unsigned long parts_alloc = 0;
+        for (unsigned long i = 0; i < cargs->or_count; ++i) {
+            PyObject *f_or = PyList_GetItem(py_filter, i);
+            if (!PyList_Check(f_or)) {
+                PyErr_SetString(libftdb_ftdbError, "Invalid 'filter' argument (OR-ed part is not a list)");
+                libftdb_ftdb_collection_count_args_destroy(cargs);
+                return 0;
+            }
+            parts_alloc += PyList_Size(f_or);
+        }
+        cargs->parts = calloc(parts_alloc + 1, sizeof(struct ftdb_collection_filter_part));
+        for (unsigned long i = 0; i < cargs->or_count; ++i) {
+            PyObject *f_or = PyList_GetItem(py_filter, i);
+            for (Py_ssize_t j = 0; j < PyList_Size(f_or); ++j) {
+                PyObject *f_and = PyList_GetItem(f_or, j);
+                if (!PyTuple_Check(f_and) || (PyTuple_Size(f_and) != 3) || !PyUnicode_Check(PyTuple_GetItem(f_and, 0)) ||
+                    !PyUnicode_Check(PyTuple_GetItem(f_and, 1))) {
+                    PyErr_SetString(libftdb_ftdbError, "Invalid 'filter' argument (expected (str, str, bool) tuple)");
+                    libftdb_ftdb_collection_count_args_destroy(cargs);
+                    return 0;
+                }
+                const char *field = PyString_get_c_str(PyTuple_GetItem(f_and, 0));
+                int is_name = !strcmp(field, "name");
+                int is_location = !strcmp(field, "location");
+                PYASSTR_DECREF(field);
+                if (!is_name && !is_location) {
+                    PyErr_SetString(libftdb_ftdbError, "Invalid 'filter' field (expected 'name' or 'location')");
+                    libftdb_ftdb_collection_count_args_destroy(cargs);
+                    return 0;
+                }
+                struct ftdb_collection_filter_part *part = &cargs->parts[cargs->parts_count++];
+                part->location = is_location;
+                part->pattern = PyString_get_c_str(PyTuple_GetItem(f_and, 1));
+                part->negate = PyObject_IsTrue(PyTuple_GetItem(f_and, 2)) == 1;
+                cargs->and_count[i]++;
+            }
+        }
+    }
+
+    return 1;
+}
+
+int libftdb_ftdb_collection_count_args_match(const struct ftdb_collection_count_args *cargs, const char *name, const char *location) {
+    if (!cargs->or_count)
+        return 1;
+
+    const struct ftdb_collection_filter_part *part = cargs->parts;
+    for (unsigned long i = 0; i < cargs->or_count; ++i) {
+        int match = 1;
+        for (unsigned long j = 0; j < cargs->and_count[i]; ++j, ++part) {
+            if (match) {
+                const char *value = part->location ? location : name;
+                match = (fnmatch(part->pattern, value ? value : "", 0) == 0) != part->negate;
+            }
+        }
+        if (match)
+            return 1;
+    }
+    return 0;
+}
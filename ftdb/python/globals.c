@@ -214,6 +214,40 @@ static PyObject *libftdb_ftdb_globals_entry_deepcopy(PyObject *self, PyObject *m
     return (PyObject *)self;
 }
 
+static PyObject *libftdb_ftdb_globals_count(libftdb_ftdb_collection_object *self, PyObject *args, PyObject *kwargs) {
+    struct ftdb_collection_count_args cargs;
+    if (!libftdb_ftdb_collection_count_args_parse(args, kwargs, &cargs))
+        return NULL;
+    if (cargs.has_mids) {
+        libftdb_ftdb_collection_count_args_destroy(&cargs);
+        PyErr_SetString(libftdb_ftdbError, "The 'mids' argument is not supported for global entries");
+        return NULL;
+    }
+
+    /* Only the entries from the given files are visited (through the inverted file index) */
+    unsigned long entries_count = self->ftdb->globals_count;
+    unsigned long *entries = NULL;
+    if (cargs.has_fids)
+        entries = libftdb_ftdb_csr_collect(cargs.fids, cargs.fids_count, self->ftdb->fid_keys_count, self->ftdb->fid_globals_offsets,
+                                           self->ftdb->fid_globals_index, &entries_count);
+
+    unsigned long count = 0;
+    for (unsigned long i = 0; i < entries_count; ++i) {
+        const struct ftdb_global_entry *entry = &self->ftdb->globals[entries ? entries[i] : i];
+        if (libftdb_ftdb_collection_count_args_match(&cargs, entry->name, entry->location))
+            ++count;
+    }
+
+    free(entries);
+    libftdb_ftdb_collection_count_args_destroy(&cargs);
+    return PyLong_FromUnsignedLong(count);
+}
+
+static PyObject *libftdb_ftdb_globals_entries_by_fids(libftdb_ftdb_collection_object *self, PyObject *args) {
+    return libftdb_ftdb_collection_view_by_keys(self, args, &libftdb_ftdbGlobalEntryType, "ftdbGlobalsView", self->ftdb->fid_keys_count,
+                                                self->ftdb->fid_globals_offsets, self->ftdb->fid_globals_index);
+}
+
 PyMethodDef libftdb_ftdbGlobals_methods[] = {
     {"entry_by_id", (PyCFunction)libftdb_ftdb_globals_entry_by_id, METH_VARARGS, "Returns the ftdb global entry with a given id"},
     {"contains_id", (PyCFunction)libftdb_ftdb_globals_contains_id, METH_VARARGS, "Check whether there is a global entry with a given id"},
@@ -221,6 +255,8 @@ PyMethodDef libftdb_ftdbGlobals_methods[] = {
     {"contains_hash", (PyCFunction)libftdb_ftdb_globals_contains_hash, METH_VARARGS, "Check whether there is a global entry with a given hash"},
     {"entry_by_name", (PyCFunction)libftdb_ftdb_globals_entry_by_name, METH_VARARGS, "Returns the list of ftdb global entries with a given name"},
     {"contains_name", (PyCFunction)libftdb_ftdb_globals_contains_name, METH_VARARGS, "Check whether there is a global entry with a given name"},
+    {"count", (PyCFunction)libftdb_ftdb_globals_count, METH_VARARGS | METH_KEYWORDS, "Returns the number of global entries from the given files (if any) matching a given filter"},
+    {"entries_by_fids", (PyCFunction)libftdb_ftdb_globals_entries_by_fids, METH_VARARGS, "Returns the view of the global entries from any of the given files"},
     {NULL, NULL, 0, NULL}
 };
 
@@ -48,6 +48,7 @@ struct stringRef_entryListMap_node {
 };
 
 typedef struct stringRef_entryListMap_node ftdb_stringRef_func_entryListMap;
+typedef struct stringRef_entryListMap_node ftdb_stringRef_funcdecl_entryListMap;
 typedef struct stringRef_entryListMap_node ftdb_stringRef_global_entryListMap;
 
 struct ulong_entryMap_node *ulong_entryMap_search(const struct rb_root *ulong_entryMap, unsigned long key);
@@ -41,9 +41,12 @@ void libftdb_ftdb_dealloc(libftdb_ftdb_object *self) {
             if (--ftdb_ref->refcount == 0) {
                 /* No more ftdb objects are holding this image file */
                 stringRefMap_remove(&ftdb_image_map, self->ftdb_image_map_node);
+                if (ftdb_ref->mapped)
+                    prelink_unmap(ftdb_ref->mapped);
+                else
+                    unflatten_deinit(self->unflatten);
                 free((void *)self->ftdb_image_map_node->value);
                 free((void *)self->ftdb_image_map_node);
-                unflatten_deinit(self->unflatten);
             }
             pthread_mutex_unlock(&unflatten_lock);
         }
@@ -65,13 +68,15 @@ PyObject *libftdb_ftdb_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds
 }
 
 PyObject *libftdb_ftdb_load(libftdb_ftdb_object *self, PyObject *args, PyObject *kwargs) {
-    static char *kwlist[] = {"filename", "quiet", "debug", NULL};
+    static char *kwlist[] = {"filename", "quiet", "debug", "no_map_memory", "prelink", NULL};
     const char *cache_filename = "db.img";
     int debug = self->debug;
     int quiet = 0;
+    int no_map_memory = 0;
+    int prelink = 0;
     bool err = true;
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|s$pp", kwlist, &cache_filename, &quiet, &debug))
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|s$pppp", kwlist, &cache_filename, &quiet, &debug, &no_map_memory, &prelink))
         return NULL; /* Exception is already set by PyArg_ParseTupleAndKeywords */
 
     DBG(debug, "--- libftdb_ftdb_load(\"%s\")\n", cache_filename);
@@ -96,53 +101,83 @@ PyObject *libftdb_ftdb_load(libftdb_ftdb_object *self, PyObject *args, PyObject
         ((struct ftdb_ref *)node->value)->refcount++;
         DBG(true, "Re-used loaded input file\n");
     } else {
-        /* Try to load new cache database file */
-        FILE *in = fopen(cache_filename, "r+b");
-        if (!in) {
-            in = fopen(cache_filename, "rb");
+        /* Use the prelinked image in place when there is an up-to-date one for this cache file */
+        const struct prelink_header *mapped = NULL;
+        if (!no_map_memory)
+            mapped = prelink_map(cache_filename);
+
+        if (mapped) {
+            DBG(debug, "--- mapped prelinked image at %p\n", (void *)mapped->base);
+            self->ftdb = (const struct ftdb *)mapped->root;
+        } else {
+            /* Try to load new cache database file */
+            FILE *in = fopen(cache_filename, "r+b");
             if (!in) {
-                PyErr_Format(libftdb_ftdbError, "Cannot open cache file - (%d) %s", errno, strerror(errno));
-                goto done;
+                in = fopen(cache_filename, "rb");
+                if (!in) {
+                    PyErr_Format(libftdb_ftdbError, "Cannot open cache file - (%d) %s", errno, strerror(errno));
+                    goto done;
+                }
             }
-        }
 
-        int debug_level = 0;
-        if (debug)
-            debug_level = 2;
-        else if (!quiet)
-            debug_level = 1;
+            int debug_level = 0;
+            if (debug)
+                debug_level = 2;
+            else if (!quiet)
+                debug_level = 1;
 
-        self->unflatten = unflatten_init(debug_level);
-        if (self->unflatten == NULL) {
-            PyErr_SetString(libftdb_ftdbError, "Failed to intialize unflatten library");
-            goto done;
-        }
+            self->unflatten = unflatten_init(debug_level);
+            if (self->unflatten == NULL) {
+                PyErr_SetString(libftdb_ftdbError, "Failed to intialize unflatten library");
+                fclose(in);
+                goto done;
+            }
 
-        UnflattenStatus status = unflatten_load_continuous(self->unflatten, in, NULL);
-        if (status) {
-            PyErr_Format(libftdb_ftdbError, "Failed to read cache file: %s\n", unflatten_explain_status(status));
-            unflatten_deinit(self->unflatten);
-            goto done;
-        }
-        fclose(in);
+            UnflattenStatus status = unflatten_load_continuous(self->unflatten, in, NULL);
+            if (status) {
+                PyErr_Format(libftdb_ftdbError, "Failed to read cache file: %s\n", unflatten_explain_status(status));
+                unflatten_deinit(self->unflatten);
+                fclose(in);
+                goto done;
+            }
+            fclose(in);
 
-        self->ftdb = (const struct ftdb *)unflatten_root_pointer_next(self->unflatten);
+            self->ftdb = (const struct ftdb *)unflatten_root_pointer_next(self->unflatten);
+        }
 
         /* Check whether it's correct file and in supported version */
         if (self->ftdb->db_magic != FTDB_MAGIC_NUMBER) {
             PyErr_Format(libftdb_ftdbError, "Failed to parse cache file - invalid magic %p", self->ftdb->db_magic);
-            unflatten_deinit(self->unflatten);
+            if (mapped)
+                prelink_unmap(mapped);
+            else
+                unflatten_deinit(self->unflatten);
             goto done;
         }
         if (self->ftdb->db_version != FTDB_VERSION) {
             PyErr_Format(libftdb_ftdbError, "Failed to parse cache file - unsupported image version %p (required: %p)", self->ftdb->db_version, FTDB_VERSION);
-            unflatten_deinit(self->unflatten);
+            if (mapped)
+                prelink_unmap(mapped);
+            else
+                unflatten_deinit(self->unflatten);
             goto done;
         }
 
+        /* Save the prelinked image for subsequent loads when requested and switch to it right away (failures are not fatal) */
+        if (!mapped && !no_map_memory && prelink && (ftdb_prelink(cache_filename, self->ftdb) == 0)) {
+            mapped = prelink_map(cache_filename);
+            if (mapped) {
+                DBG(debug, "--- saved prelinked image at %p\n", (void *)mapped->base);
+                unflatten_deinit(self->unflatten);
+                self->unflatten = NULL;
+                self->ftdb = (const struct ftdb *)mapped->root;
+            }
+        }
+
         struct ftdb_ref *ftdb_ref = malloc(sizeof(struct ftdb_ref));
         ftdb_ref->ftdb = self->ftdb;
         ftdb_ref->refcount = 1;
+        ftdb_ref->mapped = mapped;
         self->ftdb_image_map_node = stringRefMap_insert(&ftdb_image_map, cache_filename, (unsigned long)ftdb_ref);
     }
 
@@ -220,6 +255,20 @@ PyObject *libftdb_ftdb_get_release(PyObject *self, void *closure) {
     return PyUnicode_FromString(__self->ftdb->release);
 }
 
+PyObject *libftdb_ftdb_get_hash_scheme(PyObject *self, void *closure) {
+    libftdb_ftdb_object *__self = (libftdb_ftdb_object *)self;
+    FTDB_MODULE_INIT_CHECK;
+
+    return PyUnicode_FromString(__self->ftdb->hash_scheme);
+}
+
+PyObject *libftdb_ftdb_get_mapped(PyObject *self, void *closure) {
+    libftdb_ftdb_object *__self = (libftdb_ftdb_object *)self;
+    FTDB_MODULE_INIT_CHECK;
+
+    return PyBool_FromLong(((struct ftdb_ref *)__self->ftdb_image_map_node->value)->mapped != NULL);
+}
+
 PyObject *libftdb_ftdb_get_sources(PyObject *self, void *closure) {
     libftdb_ftdb_object *__self = (libftdb_ftdb_object *)self;
     FTDB_MODULE_INIT_CHECK;
@@ -745,6 +794,9 @@ PyObject *libftdb_ftdb_mp_subscript(PyObject *self, PyObject *slice) {
     } else if (!strcmp(attr, "release")) {
         PYASSTR_DECREF(attr);
         return libftdb_ftdb_get_release(self, 0);
+    } else if (!strcmp(attr, "hash_scheme")) {
+        PYASSTR_DECREF(attr);
+        return libftdb_ftdb_get_hash_scheme(self, 0);
     } else if (!strcmp(attr, "sources")) {
         PYASSTR_DECREF(attr);
         return libftdb_ftdb_get_sources_as_list(self, 0);
@@ -875,6 +927,9 @@ int libftdb_ftdb_sq_contains(PyObject *self, PyObject *key) {
     } else if (!strcmp(attr, "release")) {
         PYASSTR_DECREF(attr);
         return 1;
+    } else if (!strcmp(attr, "hash_scheme")) {
+        PYASSTR_DECREF(attr);
+        return 1;
     } else if (!strcmp(attr, "sources")) {
         PYASSTR_DECREF(attr);
         return !!__self->ftdb->sourceindex_table;
@@ -1830,6 +1885,11 @@ PyObject *libftdb_create_ftdb(PyObject *self, PyObject *args, PyObject *kwargs)
     ftdb.module = FTDB_ENTRY_STRING(dbJSON, module);
     ftdb.directory = FTDB_ENTRY_STRING(dbJSON, directory);
     ftdb.release = FTDB_ENTRY_STRING(dbJSON, release);
+    /* Databases without the field were created with SHA-1 declaration hashes */
+    ftdb.hash_scheme = FTDB_ENTRY_STRING_OPTIONAL(dbJSON, hash_scheme);
+    if (!ftdb.hash_scheme) {
+        ftdb.hash_scheme = "sha1";
+    }
 
     ftdb.funcs_tree_calls_no_asm = FTDB_ENTRY_TYPE_OPTIONAL(dbJSON, funcs_tree_calls_no_asm, matrix_data);
     ftdb.funcs_tree_calls_no_known = FTDB_ENTRY_TYPE_OPTIONAL(dbJSON, funcs_tree_calls_no_known, matrix_data);
@@ -1990,6 +2050,8 @@ PyGetSetDef libftdb_ftdb_getset[] = {
     {"module", libftdb_ftdb_get_module, 0, "ftdb object module", 0},
     {"directory", libftdb_ftdb_get_directory, 0, "ftdb object directory", 0},
     {"release", libftdb_ftdb_get_release, 0, "ftdb object release", 0},
+    {"hash_scheme", libftdb_ftdb_get_hash_scheme, 0, "ftdb object declaration hash scheme", 0},
+    {"mapped", libftdb_ftdb_get_mapped, 0, "True when the ftdb image is mapped from its prelinked copy (False when it was unflattened)", 0},
     {"sources", libftdb_ftdb_get_sources, 0, "ftdb sources object", 0},
     {"source_info", libftdb_ftdb_get_sources_as_dict, 0, "ftdb source info object", 0},
     {"modules", libftdb_ftdb_get_modules, 0, "ftdb modules object", 0},
@@ -2062,6 +2124,7 @@ static PyTypeObject *__registered_types[] = {
     &libftdb_ftdbGlobalsIterType,
     &libftdb_ftdbTypesIterType,
     &libftdb_ftdbFopsIterType,
+    &libftdb_ftdbCollectionViewType,
     &libftdb_ftdbFuncsEntryType,
     &libftdb_ftdbFuncdeclsEntryType,
     &libftdb_ftdbUnresolvedfuncEntryType,
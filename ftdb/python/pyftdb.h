@@ -15,12 +15,14 @@
 #include "utils.h"
 #include <ftdb.h>
 #include "ftdb_entry.h"
+#include <prelink.h>
 #include <pthread.h>
 #include "uflat.h"
 
 #include <unflatten.hpp>
 
 int ftdb_maps(struct ftdb *ftdb, int show_stats);
+int ftdb_prelink(const char *image_path, const struct ftdb *ftdb);
 
 #define FTDB_MODULE_INIT_CHECK                                                                                                        \
     do {                                                                                                                              \
@@ -173,10 +175,12 @@ extern PyTypeObject libftdb_ftdbUnresolvedfuncEntryType;
 extern PyTypeObject libftdb_ftdbUnresolvedfuncsIterType;
 
 extern PySequenceMethods libftdb_ftdbCollectionIter_sequence_methods;
+extern PyTypeObject libftdb_ftdbCollectionViewType;
 
 struct ftdb_ref {
     const struct ftdb *ftdb;
     unsigned long refcount;
+    const struct prelink_header *mapped;
 };
 
 typedef struct {
@@ -205,6 +209,15 @@ typedef struct {
 
 } libftdb_ftdb_collection_iter_object;
 
+typedef struct {
+    PyObject_HEAD
+    const libftdb_ftdb_collection_object *collection;
+    PyTypeObject *entry_type;
+    unsigned long *entries; /* ascending indexes of the collection entries */
+    unsigned long entries_count;
+    const char *name;
+} libftdb_ftdb_collection_view_object;
+
 typedef struct {
     PyObject_HEAD
     const struct ftdb_fops_entry *entry;
@@ -333,6 +346,35 @@ PyObject *libftdb_ftdb_collection_repr(PyObject *self);
 PyObject *libftdb_ftdb_collection_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds);
 Py_ssize_t libftdb_ftdb_collection_sq_length(PyObject *self);
 
+struct ftdb_collection_filter_part {
+    int location; /* Match the entry location instead of the name */
+    const char *pattern;
+    int negate;
+};
+
+/* Arguments of the native entry count of the funcs, funcdecls and globals collections */
+struct ftdb_collection_count_args {
+    int has_fids;
+    unsigned long *fids;
+    unsigned long fids_count;
+    int has_mids;
+    unsigned long *mids;
+    unsigned long mids_count;
+    struct ftdb_collection_filter_part *parts;
+    unsigned long parts_count;
+    unsigned long *and_count; /* Number of the AND-ed parts in each of the OR-ed filters */
+    unsigned long or_count;
+};
+
+int libftdb_ftdb_collection_count_args_parse(PyObject *args, PyObject *kwargs, struct ftdb_collection_count_args *cargs);
+void libftdb_ftdb_collection_count_args_destroy(struct ftdb_collection_count_args *cargs);
+int libftdb_ftdb_collection_count_args_match(const struct ftdb_collection_count_args *cargs, const char *name, const char *location);
+
+unsigned long *libftdb_ftdb_csr_collect(const unsigned long *keys, unsigned long keys_count, unsigned long key_limit,
+                                        const unsigned long *offsets, const unsigned long *index, unsigned long *entries_count);
+PyObject *libftdb_ftdb_collection_view_by_keys(libftdb_ftdb_collection_object *collection, PyObject *args, PyTypeObject *entry_type,
+                                               const char *name, unsigned long key_limit, const unsigned long *offsets, const unsigned long *index);
+
 void libftdb_ftdb_collection_iter_dealloc(libftdb_ftdb_collection_iter_object *self);
 PyObject *libftdb_ftdb_collection_iter_new(PyTypeObject *subtype, PyObject *args, PyObject *kwds);
 
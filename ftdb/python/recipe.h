@@ -252,6 +252,7 @@ FUNCTION_DEFINE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_BAS_data_entryMap,
 );
 
 FUNCTION_DECLARE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_func_entryListMap);
+FUNCTION_DECLARE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_funcdecl_entryListMap);
 FUNCTION_DECLARE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_global_entryListMap);
 
 FUNCTION_DEFINE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_func_entryListMap,
@@ -266,6 +267,18 @@ FUNCTION_DEFINE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_func_entryListMap,
     );
 );
 
+FUNCTION_DEFINE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_funcdecl_entryListMap,
+    AGGREGATE_FLATTEN_STRUCT_TYPE_EMBEDDED_POINTER(ftdb_stringRef_funcdecl_entryListMap,node.__rb_parent_color,
+            ptr_clear_2lsb_bits,flatten_ptr_restore_2lsb_bits);
+    AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_funcdecl_entryListMap,node.rb_right);
+    AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_funcdecl_entryListMap,node.rb_left);
+    AGGREGATE_FLATTEN_STRING(key);
+    AGGREGATE_FLATTEN_TYPE_ARRAY(void*,entry_list,ATTR(entry_count));
+    FOREACH_POINTER(void*,entry,ATTR(entry_list),ATTR(entry_count),
+        FLATTEN_STRUCT(ftdb_funcdecl_entry,entry);
+    );
+);
+
 FUNCTION_DEFINE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_global_entryListMap,
     AGGREGATE_FLATTEN_STRUCT_TYPE_EMBEDDED_POINTER(ftdb_stringRef_global_entryListMap,node.__rb_parent_color,
             ptr_clear_2lsb_bits,flatten_ptr_restore_2lsb_bits);
@@ -375,6 +388,7 @@ FUNCTION_DEFINE_FLATTEN_STRUCT(ftdb,
     AGGREGATE_FLATTEN_STRING(module);
     AGGREGATE_FLATTEN_STRING(directory);
     AGGREGATE_FLATTEN_STRING(release);
+    AGGREGATE_FLATTEN_STRING(hash_scheme);
     AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_ulong_type_entryMap,refmap.rb_node);
     AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_type_entryMap,hrefmap.rb_node);
     AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_ulong_func_entryMap,frefmap.rb_node);
@@ -382,7 +396,7 @@ FUNCTION_DEFINE_FLATTEN_STRUCT(ftdb,
     AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_func_entryListMap,fnrefmap.rb_node);
     AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_ulong_funcdecl_entryMap,fdrefmap.rb_node);
     AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_funcdecl_entryMap,fdhrefmap.rb_node);
-    AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_func_entryListMap,fdnrefmap.rb_node);
+    AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_funcdecl_entryListMap,fdnrefmap.rb_node);
     AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_ulong_global_entryMap,grefmap.rb_node);
     AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_global_entryMap,ghrefmap.rb_node);
     AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_global_entryListMap,gnrefmap.rb_node);
@@ -406,6 +420,15 @@ FUNCTION_DEFINE_FLATTEN_STRUCT(ftdb,
 
     AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_ulong_static_funcs_map_entryMap,static_funcs_map_index.rb_node);
     AGGREGATE_FLATTEN_STRUCT_TYPE(ftdb_stringRef_BAS_data_entryMap,BAS_data_index.rb_node);
+
+    AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,fid_funcs_offsets,ATTR(fid_keys_count)+1);
+    AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,fid_funcs_index,ATTR(fid_funcs_index_count));
+    AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,fid_globals_offsets,ATTR(fid_keys_count)+1);
+    AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,fid_globals_index,ATTR(fid_globals_index_count));
+    AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,fid_funcdecls_offsets,ATTR(fid_keys_count)+1);
+    AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,fid_funcdecls_index,ATTR(fid_funcdecls_index_count));
+    AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,mid_funcs_offsets,ATTR(mid_keys_count)+1);
+    AGGREGATE_FLATTEN_TYPE_ARRAY(unsigned long,mid_funcs_index,ATTR(mid_funcs_index_count));
 );
 
 FUNCTION_DEFINE_FLATTEN_STRUCT(ftdb_func_entry,
@@ -209,7 +209,7 @@ class CASDatabase:
         """
         self.config = config
 
-    def load_db(self, db_file:str, debug: bool=False, quiet: bool=True) -> bool:
+    def load_db(self, db_file:str, debug: bool=False, quiet: bool=True, no_map_memory: bool = False, prelink: bool = False) -> bool:
         """
         Function uses libetrace.load to load database and applies config.
 
@@ -219,11 +219,15 @@ class CASDatabase:
         :type debug: bool, optional
         :param quiet: suppress verbose prints, defaults to True
         :type quiet: bool, optional
+        :param no_map_memory: prevents memory mapping of the prelinked image (<db_file>.mmap), defaults to False
+        :type no_map_memory: bool, optional
+        :param prelink: saves the prelinked image when there is no up-to-date one, defaults to False
+        :type prelink: bool, optional
         :return: True if load succeed otherwise False
         :rtype: bool
         """
 
-        self.db_loaded = self.db.load(db_file, debug=debug, quiet=quiet)
+        self.db_loaded = self.db.load(db_file, debug=debug, quiet=quiet, no_map_memory=no_map_memory, prelink=prelink)
         self.source_root = self.db.source_root
         assert self.config is not None, "Config is empty!"
         self.config.apply_source_root(self.source_root)
@@ -253,7 +257,7 @@ class CASDatabase:
         except:
             return "UNKNOWN"
 
-    def load_deps_db(self, db_file:str, debug: bool=False, quiet: bool=True, mp_safe: bool=True, no_map_memory: bool = False) -> bool:
+    def load_deps_db(self, db_file:str, debug: bool=False, quiet: bool=True, mp_safe: bool=True, no_map_memory: bool = False, prelink: bool = False) -> bool:
         """
         Function uses libetrace.load_deps to load database from given filename
 
@@ -267,11 +271,13 @@ class CASDatabase:
         :type mp_safe: bool, optional
         :param no_map_memory: prevents memory mapping, defaults to False
         :type no_map_memory: bool, optional
+        :param prelink: saves the prelinked image when there is no up-to-date one, defaults to False
+        :type prelink: bool, optional
         :return: True if load succeed otherwise False
         :rtype: bool
         """
 
-        self.cache_db_loaded = self.db.load_deps(db_file, debug=debug, quiet=quiet, mp_safe=mp_safe, no_map_memory=no_map_memory)
+        self.cache_db_loaded = self.db.load_deps(db_file, debug=debug, quiet=quiet, mp_safe=mp_safe, no_map_memory=no_map_memory, prelink=prelink)
         self.cache_db_path = db_file
         return self.cache_db_loaded
 
@@ -1175,23 +1181,20 @@ class CASDatabase:
         :type cache_db_filename: str
         :param debug: enable debug info output
         :type debug: bool
-        :return: True if `libetrace.create_nfsdb` succeds otherwise False
+        :return: True if `libetrace.create_nfsdb_from_json` succeds otherwise False
         :rtype: bool
         """
-        with open(json_db_filename, "rb") as fil:
-            print_mem_usage(debug, "Before load")
-            json_db = json.load(fil)
-            if len(json_db) > 0:
-                json_db[0]["r"]["p"] = 0  # fix parent process
-            print_mem_usage(debug, "After load / before create_nfsdb")
-            r = libetrace.create_nfsdb(json_db, src_root, set_version, exclude_command_patterns, shared_argvs, cache_db_filename)
-            print_mem_usage(debug, "After create_nfsdb")
-            return r
+        # The json database is parsed natively (including the fix of the root parent process)
+        print_mem_usage(debug, "Before create_nfsdb")
+        r = libetrace.create_nfsdb_from_json(json_db_filename, src_root, set_version, exclude_command_patterns, shared_argvs, cache_db_filename)
+        print_mem_usage(debug, "After create_nfsdb")
+        return r
 
     def create_deps_db_image(self, deps_cache_db_filename: str, depmap_filename: str, ddepmap_filename: str, use_pipes:bool, wrap_deps:bool,
                             jobs: int = multiprocessing.cpu_count(), deps_threshold: int = 90000, debug: bool = False):
         """
         Function calculates all modules dependencies and create dependencies image.
+        Direct and full dependencies of all modules are computed natively on a pool of threads.
 
         :param deps_cache_db_filename: output dependencies image path
         :type deps_cache_db_filename: str
@@ -1203,7 +1206,7 @@ class CASDatabase:
         :type use_pipes: bool
         :param wrap_deps: enable generation dependencies with wrapping process
         :type wrap_deps: bool
-        :param jobs: number of multiprocessing threads, defaults to multiprocessing.cpu_count()
+        :param jobs: number of dependency processing threads, defaults to multiprocessing.cpu_count()
         :type jobs: int, optional
         :param deps_threshold: max dependencies count - used to detect dependency generation issues, defaults to 90000
         :type deps_threshold: int, optional
@@ -1211,7 +1214,7 @@ class CASDatabase:
         :type debug: bool, optional
         """
 
-        all_modules = sorted([e.linked_path for e in self.filtered_execs_iter(has_linked_file=True) if not e.linked_path.startswith("/dev/")])
+        all_modules = sorted(set(e.linked_path for e in self.filtered_execs_iter(has_linked_file=True) if not e.linked_path.startswith("/dev/")))
 
         print("Number of all linked modules: %d" % (len(all_modules)))
 
@@ -1219,98 +1222,48 @@ class CASDatabase:
             print("No linked modules found! Check linker patterns in config.")
             exit(0)
 
-        def get_module_dependencies(module_path, dm, done_modules, all_mods):
-            linked_modules = [x[2] for x in dm[module_path] if x[2] in all_mods]
-            ret = set(linked_modules)
-            for module_path in linked_modules:
-                if module_path not in done_modules:
-                    done_modules.add(module_path)
-                    ret |= get_module_dependencies(module_path, dm, done_modules, all_mods)
-            return ret
-
-        global calc_deps
-
-        def calc_deps(module_path, direct=True, all_mods=all_modules):
-            ret = self.get_deps(module_path, direct_global=direct, all_modules=all_mods, use_pipes=use_pipes, wrap_deps=wrap_deps)
-            # print("[%d / %d] %s %s_deps(%d)" % (processed.value, len(allm), module_path, "direct" if direct is True else "full", len(ret[2])), flush=True)
-            with processed.get_lock():
-                processed.value += 1
-                pbar.n = processed.value
-                pbar.refresh()
-            return module_path, [(x.ptr[0], x.ptr[1], x.path) for x in ret[2]]
+        # Modules sharing the same exclusion config are processed with the same parameters
+        excludes: Dict[Tuple, int] = {}
+        modules = []
+        for module_path in all_modules:
+            excl_patterns, excl_commands, excl_commands_index = self.config.gen_excludes_for_path(module_path)
+            use_pipe_for_path = self.config.get_use_pipe_for_path(module_path, use_pipes)
+            key = (tuple(excl_patterns), tuple(excl_commands), tuple(excl_commands_index), use_pipe_for_path)
+            modules.append((module_path, excludes.setdefault(key, len(excludes))))
 
         print("")
-        print("Computing direct dependency list for all modules...")
-
-        pbar = progressbar(total=len(all_modules), disable=None)
-        processed = multiprocessing.Value('i', 0)
-        processed.value = 0
-
-        pool = multiprocessing.Pool(jobs)
-        results = pool.map(calc_deps, all_modules)
-        pool.close()
-        pool.join()
+        print("Computing direct and full dependency lists for all modules...")
 
-        pbar.n = processed.value
-        pbar.refresh()
-        pbar.close()
-
-        depmap = {d[0]: d[1] for d in results}
-        depmap_keys = list(depmap.keys())
-        del results
+        ddeps_counts, deps_counts = self.db.create_deps_image(deps_cache_db_filename, modules,
+                        excludes=[{"exclude_patterns": list(k[0]), "exclude_commands": list(k[1]), "exclude_commands_index": list(k[2]),
+                                   "use_pipes": k[3], "wrap_deps": wrap_deps} for k in excludes],
+                        jobs=jobs, deps_threshold=int(deps_threshold) if deps_threshold else 0,
+                        ddepmap_filename=ddepmap_filename, depmap_filename=depmap_filename, show_stats=True, debug=debug)
 
         print("")
         print("# Sorted list of direct dependencies count")
 
         mismatch_list = list()
-        for k, v in sorted(depmap.items(), key=lambda item: len(item[1]), reverse=True):
-            print("  %s: %d" % (k, len(v)))
-            if deps_threshold and len(v) > int(deps_threshold):
-                mismatch_list.append((k, len(v)))
-        
+        for k, v in sorted(ddeps_counts.items(), key=lambda item: item[1], reverse=True):
+            print("  %s: %d" % (k, v))
+            if deps_threshold and v > int(deps_threshold):
+                mismatch_list.append((k, v))
+
         if len(mismatch_list) > 0:
             print("ERROR: Number of modules with direct dependency list that exceeds the predefined threshold [%d]: %d" % (int(deps_threshold), len(mismatch_list)))
             for m, n in mismatch_list:
                 print("  %s: %d" % (m, n))
             print("Exiting due dependency mismatch errors (%d errors)" % (len(mismatch_list)))
             sys.exit(len(mismatch_list))
-
-        print("Saving {} ...".format(ddepmap_filename))
-        with open(ddepmap_filename, "w", encoding=sys.getfilesystemencoding()) as f:
-            json.dump(obj=depmap, fp=f, indent=4)
         printdbg("written {}".format(ddepmap_filename), debug)
 
-        # Compute full dependency list for all modules
-        global get_full_deps
-        def get_full_deps(lm):
-            return calc_deps(lm, direct=False, all_mods=depmap_keys)
-
-        print("")
-        print("Computing full dependency list for all modules...")
-
-        pbar = progressbar(total=len(all_modules), disable=None)
-        processed = multiprocessing.Value('i', 1)
-        processed.value = 0
-
-        pool = multiprocessing.Pool(jobs)
-        results = pool.map(get_full_deps, depmap)
-        pool.close()
-        pool.join()
-
-        pbar.n = processed.value
-        pbar.refresh()
-        pbar.close()
-
-        full_depmap = {r[0]: r[1] for r in results}
-        del results
-
         mismatch_list = list()
         print("")
         print("# Sorted list of full dependencies count")
-        for k, v in sorted(full_depmap.items(), key=lambda item: len(item[1]), reverse=True):
-            print("  %s: %d" % (k, len(v)))
-            if deps_threshold and len(v) > int(deps_threshold):
-                mismatch_list.append((k, len(v)))
+        for k, v in sorted(deps_counts.items(), key=lambda item: item[1], reverse=True):
+            print("  %s: %d" % (k, v))
+            if deps_threshold and v > int(deps_threshold):
+                mismatch_list.append((k, v))
 
         if len(mismatch_list) > 0:
             print("Number of modules with full dependency list that exceeds the predefined threshold [%d]: %d" % (int(deps_threshold), len(mismatch_list)))
@@ -1319,13 +1272,7 @@ class CASDatabase:
             print("Exiting due dependency mismatch errors (%d errors)" % (len(mismatch_list)))
             sys.exit(len(mismatch_list))
 
-        print("Saving {} ...".format(depmap_filename))
-        with open(depmap_filename, "w", encoding=sys.getfilesystemencoding()) as f:
-            json.dump(obj=full_depmap, fp=f, indent=4)
         printdbg("Written {}".format(depmap_filename), debug)
-
-        print("Writing {} ".format(deps_cache_db_filename))
-        assert self.db.create_deps_cache(full_depmap, depmap, deps_cache_db_filename, True)
         printdbg("Written {} ".format(deps_cache_db_filename), debug)
 
     @staticmethod
@@ -1491,10 +1438,6 @@ class CASDatabase:
         clangxx_input_execs = []
         gxx_input_execs = []
         comp_pids: Set[int] = set()
-        gcc_spec_patterns = re.compile("|".join([fnmatch.translate(pattern) for pattern in self.config.gcc_spec]))
-        gpp_spec_patterns = re.compile("|".join([fnmatch.translate(pattern) for pattern in self.config.gpp_spec]))
-        clang_spec_patterns = re.compile("|".join([fnmatch.translate(pattern) for pattern in self.config.clang_spec]))
-        clangpp_spec_patterns = re.compile("|".join([fnmatch.translate(pattern) for pattern in self.config.clangpp_spec]))
         cc1_patterns = re.compile("|".join([fnmatch.translate(pattern) for pattern in ["*cc1", "*cc1plus"]]))
         coll_patterns = re.compile("|".join([fnmatch.translate(pattern) for pattern in ["*/collect*"]]))
         comps_filename = os.path.join(workdir, ".nfsdb.comps.json")
@@ -1582,55 +1525,32 @@ class CASDatabase:
             start_time = time.time()
 
             if new_database or not os.path.exists(link_filename):
-                linked_pattern = re.compile("|".join([fnmatch.translate(pattern) for pattern in self.config.ld_spec]))
-                ared_pattern = re.compile("|".join([fnmatch.translate(pattern) for pattern in self.config.ar_spec]))
+                scan = self.db.post_process_scan(self.config.ld_spec, self.config.ar_spec, [], compilations=False, jobs=jobs)
                 l_size = 0
                 a_size = 0
 
-                for e in self.db.iter():
-                    if linked_pattern.match(e.binary):
-                        effective_args: List[str] = self.get_effective_args(e.argv, e.cwd)
-                        if "-o" in effective_args:
-                            outidx = effective_args.index("-o")
-                            if outidx < len(effective_args)-1:
-                                lnkm = os.path.normpath(os.path.join(e.cwd, effective_args[outidx+1]))
-                                if os.path.splitext(lnkm)[1] == ".o" and outidx < len(effective_args)-2:
-                                    if os.path.basename(effective_args[outidx+2]) == ".tmp_%s" % (os.path.basename(lnkm)):
-                                        continue
-                                if lnkm.startswith("/dev/"):
-                                    continue
-                                assert e.ptr not in out_linked
-                                out_linked[e.ptr] = {"l": lnkm, "t": 1}
-                                l_size += 1
-                        elif "--output" in effective_args:
-                            outidx = effective_args.index("--output")
-                            if outidx < len(effective_args)-1:
-                                assert e.ptr not in out_linked
-                                out_linked[e.ptr] = {"l": os.path.normpath(os.path.join(e.cwd, effective_args[outidx+1])), "t": 1}
-                                l_size += 1
-                    if ared_pattern.match(e.binary):
-                        effective_args: List[str] = self.get_effective_args(e.argv, e.cwd)
-                        armod = next((x for x in effective_args if x.endswith(".a") or x.endswith(".a.tmp") or x.endswith(".lib") or x.endswith("built-in.o")), None)
-                        if armod:
-                            if not os.path.isabs(armod):
-                                armod = os.path.normpath(os.path.join(e.cwd, armod))
-                            if armod.endswith(".a.tmp"):
-                                # There are some places in Android build system where ar creates '.a.tmp' archive file only to mv it to '.a' archive right away
-                                # Work around that by setting the linking process as the parent bash invocation (which does the ar and mv altogether)
-                                if len(e.pipe_eids) > 0:
-                                    pipes = [(pp.pid, pp.index) for pp in e.pipe_eids]
-                                    we_l = [x for x in self.get_eids(pipes) if len(x.argv) > 0]
-                                    if len(we_l) > 0:
-                                        if e.ptr not in out_linked:
-                                            out_linked[we_l[0].ptr] = {"l": os.path.normpath(os.path.join(e.cwd, armod[:-4])), "t": 0}
-                                            a_size += 1
-                            else:
-                                # Ignore potential linked files not opened for write (e.g. ar t <archive_file>)
-                                for x in e.opens:
-                                    if x.path == armod and (x.mode & 0x03) > 0:
-                                        if e.ptr not in out_linked:
-                                            out_linked[e.ptr] = {"l": armod, "t": 0}
-                                            a_size += 1
+                for ptr, link_type, lnkm, written in scan["linked"]:
+                    if link_type == 1:
+                        assert ptr not in out_linked
+                        out_linked[ptr] = {"l": lnkm, "t": 1}
+                        l_size += 1
+                    elif lnkm.endswith(".a.tmp"):
+                        # There are some places in Android build system where ar creates '.a.tmp' archive file only to mv it to '.a' archive right away
+                        # Work around that by setting the linking process as the parent bash invocation (which does the ar and mv altogether)
+                        e = self.get_exec_at_pos(ptr)
+                        if len(e.pipe_eids) > 0:
+                            pipes = [(pp.pid, pp.index) for pp in e.pipe_eids]
+                            we_l = [x for x in self.get_eids(pipes) if len(x.argv) > 0]
+                            if len(we_l) > 0:
+                                if e.ptr not in out_linked:
+                                    out_linked[we_l[0].ptr] = {"l": os.path.normpath(os.path.join(e.cwd, lnkm[:-4])), "t": 0}
+                                    a_size += 1
+                    elif written:
+                        # Ignore potential linked files not opened for write (e.g. ar t <archive_file>)
+                        if ptr not in out_linked:
+                            out_linked[ptr] = {"l": lnkm, "t": 0}
+                            a_size += 1
+                del scan
 
                 with open(link_filename, "w", encoding=sys.getfilesystemencoding()) as f:
                     f.write(json.dumps(out_linked, indent=4))
@@ -1666,6 +1586,9 @@ class CASDatabase:
 
             start_time = time.time()
             libetrace_dir = os.path.dirname(os.path.realpath(__file__))
+            # Executors run compiler commands through batch mode workers, a batch covers exec_batch_size executions
+            exec_batch_size = 32
+            exec_batch_jobs = max(1, multiprocessing.cpu_count() // max(1, jobs))
 
             compilation_start_time = time.time()
 
@@ -1673,7 +1596,6 @@ class CASDatabase:
                 print_mem_usage(debug, "Before processing compilations")
                 print("creating compilations input map ...")
 
-                fork_map: Dict[int, Set[int]] = {}
                 clang_input_execs = []
                 clangpp_input_execs = []
                 gcc_input_execs = []
@@ -1681,65 +1603,55 @@ class CASDatabase:
 
                 clangxx_compilers: Set[str] = set()
 
-                pbar = progressbar(total=len(self.db), disable=None)
+                # Written paths, forks and compiler executions are extracted natively, compilers are probed below
+                scan = self.db.post_process_scan([], [], [self.config.clangpp_spec, self.config.clang_spec, self.config.gcc_spec, self.config.gpp_spec],
+                                                 linked=False, compilations=do_compilations, jobs=jobs)
+                wr_map = scan["written"]
+                fork_map: Dict[int, Set[int]] = scan["forks"]
+
+                pbar = progressbar(total=len(scan["compilers"]), disable=None)
 
                 # region execs collection
-                for n, ex in enumerate(self.db):
+                for n, (ptr, compiler) in enumerate(scan["compilers"]):
                     pbar.n = n
                     pbar.refresh()
-                    if ex.return_code != 0:
-                        continue
-                    written_paths = {op.path for op in ex.opens if op.mode & 3 >= 1}
-
-                    if len(written_paths) > 0:
-                        if ex.eid.pid in wr_map:
-                            wr_map[ex.eid.pid].update(written_paths)
-                        else:
-                            wr_map[ex.eid.pid] = written_paths
-
-                    c = {ch.eid.pid for ch in ex.childs}
-                    if len(c) > 0:
-                        if ex.eid.pid in fork_map:
-                            fork_map[ex.eid.pid].update(c)
-                        else:
-                            fork_map[ex.eid.pid] = c
-
-                    if do_compilations and ex.binary != '':
-                        b = os.path.realpath(ex.binary) if ex.binary.endswith("/cc") or ex.binary.endswith("/c++") else ex.binary
-                        if clangpp_spec_patterns.match(b):
-                            effective_args: List[str] = self.get_effective_args(ex.argv, ex.cwd)
-                            clangpp_pattern_match_execs.append(ex.ptr)
-                            if ("-cc1" in effective_args or ((("-c" in effective_args) or ("-S" in effective_args)) and self.have_integrated_cc1(ex.binary, "-fno-integrated-cc1" not in effective_args, test_file))) \
-                                and "-o" in effective_args and ("-emit-llvm-bc" not in effective_args or allow_llvm_bc) \
-                                and not self.clang_ir_generation(effective_args) and not self.clang_pp_input(effective_args) \
-                                and "-analyze" not in effective_args and ex.eid.pid not in comp_pids and comp_pids.add(ex.eid.pid) is None:
-                                clangpp_execs.append(ex.ptr)
-                                if not effective_args[-1] == "-":
-                                    clangpp_input_execs.append(ex)
-                                if self.have_integrated_cc1(ex.binary, "-fno-integrated-cc1" not in effective_args, test_file):
-                                    integrated_clang_compilers.add(ex.binary)
-                        elif clang_spec_patterns.match(b):
-                            effective_args: List[str] = self.get_effective_args(ex.argv, ex.cwd)
-                            clang_pattern_match_execs.append(ex.ptr)
-                            if ("-cc1" in effective_args or ((("-c" in effective_args) or ("-S" in effective_args)) and self.have_integrated_cc1(ex.binary, "-fno-integrated-cc1" not in effective_args, test_file))) \
-                                and "-o" in effective_args and ("-emit-llvm-bc" not in effective_args or allow_llvm_bc) \
-                                and not self.clang_ir_generation(effective_args) and not self.clang_pp_input(effective_args) \
-                                and "-analyze" not in effective_args and ex.eid.pid not in comp_pids and comp_pids.add(ex.eid.pid) is None:
-                                clang_execs.append(ex.ptr)
-                                if not effective_args[-1] == "-":
-                                    clang_input_execs.append(ex)
-                                if self.have_integrated_cc1(ex.binary, "-fno-integrated-cc1" not in effective_args, test_file):
-                                    integrated_clang_compilers.add(ex.binary)
-                        elif gcc_spec_patterns.match(b):
-                            effective_args: List[str] = self.get_effective_args(ex.argv, ex.cwd)
-                            gcc_comp_pids.append(ex.ptr)
-                            if "-" not in effective_args:
-                                gcc_input_execs.append(ex)
-                        elif gpp_spec_patterns.match(b):
-                            effective_args: List[str] = self.get_effective_args(ex.argv, ex.cwd)
-                            gpp_comp_pids.append(ex.ptr)
-                            if "-" not in effective_args:
-                                gpp_input_execs.append(ex)
+                    ex = self.get_exec_at_pos(ptr)
+                    if compiler == 0:
+                        effective_args: List[str] = self.get_effective_args(ex.argv, ex.cwd)
+                        clangpp_pattern_match_execs.append(ex.ptr)
+                        if ("-cc1" in effective_args or ((("-c" in effective_args) or ("-S" in effective_args)) and self.have_integrated_cc1(ex.binary, "-fno-integrated-cc1" not in effective_args, test_file))) \
+                            and "-o" in effective_args and ("-emit-llvm-bc" not in effective_args or allow_llvm_bc) \
+                            and not self.clang_ir_generation(effective_args) and not self.clang_pp_input(effective_args) \
+                            and "-analyze" not in effective_args and ex.eid.pid not in comp_pids and comp_pids.add(ex.eid.pid) is None:
+                            clangpp_execs.append(ex.ptr)
+                            if not effective_args[-1] == "-":
+                                clangpp_input_execs.append(ex)
+                            if self.have_integrated_cc1(ex.binary, "-fno-integrated-cc1" not in effective_args, test_file):
+                                integrated_clang_compilers.add(ex.binary)
+                    elif compiler == 1:
+                        effective_args: List[str] = self.get_effective_args(ex.argv, ex.cwd)
+                        clang_pattern_match_execs.append(ex.ptr)
+                        if ("-cc1" in effective_args or ((("-c" in effective_args) or ("-S" in effective_args)) and self.have_integrated_cc1(ex.binary, "-fno-integrated-cc1" not in effective_args, test_file))) \
+                            and "-o" in effective_args and ("-emit-llvm-bc" not in effective_args or allow_llvm_bc) \
+                            and not self.clang_ir_generation(effective_args) and not self.clang_pp_input(effective_args) \
+                            and "-analyze" not in effective_args and ex.eid.pid not in comp_pids and comp_pids.add(ex.eid.pid) is None:
+                            clang_execs.append(ex.ptr)
+                            if not effective_args[-1] == "-":
+                                clang_input_execs.append(ex)
+                            if self.have_integrated_cc1(ex.binary, "-fno-integrated-cc1" not in effective_args, test_file):
+                                integrated_clang_compilers.add(ex.binary)
+                    elif compiler == 2:
+                        effective_args: List[str] = self.get_effective_args(ex.argv, ex.cwd)
+                        gcc_comp_pids.append(ex.ptr)
+                        if "-" not in effective_args:
+                            gcc_input_execs.append(ex)
+                    elif compiler == 3:
+                        effective_args: List[str] = self.get_effective_args(ex.argv, ex.cwd)
+                        gpp_comp_pids.append(ex.ptr)
+                        if "-" not in effective_args:
+                            gpp_input_execs.append(ex)
+
+                del scan
 
                 print("input map created in [%.2fs]" % (time.time()-start_time))
                 start_time = time.time()
@@ -1833,27 +1745,17 @@ class CASDatabase:
                         
                         #region clang_executor
                         def clang_executor(worker_idx):
-                            worker = exec_worker.ExecWorker(os.path.join(libetrace_dir, "worker"))
+                            worker = exec_worker.ExecWorker(os.path.join(libetrace_dir, "worker"), exec_batch_jobs)
 
                             printdbg("Worker {} starting...".format(worker_idx), debug)
 
-                            while True:
-                                with cur_iter.get_lock():
-                                    if cur_iter.value < max_iter:
-                                        qpos = cur_iter.value
-                                        cur_iter.value += 1
-                                    else:
-                                        break
-                                with processed.get_lock():
-                                    processed.value += 1
-                                    pbar.n = processed.value
-                                    pbar.refresh()
+                            def process(qpos):
                                 ptr, compiler_type = clangxx_input_execs[qpos]
                                 exe:libetrace.nfsdbEntry = self.get_exec_at_pos(ptr)
 
                                 if not clang_c.quickcheck(exe.binary, exe.argv):
                                     skipped()
-                                    continue
+                                    return
 
                                 argv: List[str] = exe.argv.copy()
 
@@ -1861,16 +1763,15 @@ class CASDatabase:
                                     have_int_cc1 = self.have_integrated_cc1(os.path.join(exe.cwd, exe.binary), "-fno-integrated-cc1" not in argv, test_file)
                                 except FileNotFoundError:
                                     failed()
-                                    continue
+                                    return
                                 
                                 try:
-                                    stdout0, stderr0, ret_code0 = worker.runCmd(exe.cwd, exe.binary, argv[1:] + ["-###"])
+                                    stdout0, stderr0, ret_code0 = yield (exe.cwd, exe.binary, argv[1:] + ["-###"], None, True)
                                 except exec_worker.ExecWorkerException:
-                                    worker.initialize()
                                     print("Exception while running -###")
                                     print ("[%s] %s" % (exe.cwd, " ".join(argv[1:] + ["-###"])))
                                     failed()
-                                    continue
+                                    return
 
                                 lns = stderr0.splitlines()
                                 idx = [k for k, u in enumerate(lns) if "(in-process)" in u]
@@ -1890,13 +1791,13 @@ class CASDatabase:
                                 if "-cc1as" in argv:
                                     skipped()
                                     # Remove clang invocations with -cc1as (it's not actual C/C++ compilation which generates errors later)
-                                    continue
+                                    return
 
                                 arg_fn = clang_c.extract_comp_file(argv, exe.cwd, self.config.clang_tailopts)
                                 if arg_fn is None:
                                     printd (f"Error: {arg_fn} - cannot find compiled file!", ptr, True)
                                     failed()
-                                    continue
+                                    return
                                 if os.path.isabs(arg_fn):
                                     fn = arg_fn
                                 else:
@@ -1909,32 +1810,31 @@ class CASDatabase:
                                         failed()
                                     else:
                                         skipped()
-                                    continue
+                                    return
                                 # fn - the path to the compiled file that exists
                                 try:
                                     argv = clang_c.fix_argv(argv, compiler_type, arg_fn)
                                 except IndexError:
                                     store_output(ptr, "Parameter error - no -o arg ", argv, stdout0, stderr0, ret_code0)
                                     failed()
-                                    continue
+                                    return
 
                                 try:
-                                    stdout1, stderr1, ret_code1 = worker.runCmd(exe.cwd, exe.binary, argv[1:], "")  # last parameter is empty stdin for clang
+                                    stdout1, stderr1, ret_code1 = yield (exe.cwd, exe.binary, argv[1:], "")  # last parameter is empty stdin for clang
                                     if ret_code1 != 0 and debug:
                                         print(f"[ERROR] - running \ncwd: {exe.cwd} \nbin: {exe.binary} \nargs: {argv[1:]}\nstdout:\n {stdout1}\nstderr:\n {stderr1}", flush=True)
 
                                 except exec_worker.ExecWorkerException as e:
-                                    worker.initialize()
                                     printd (f"Failed to process defs from clang output.", ptr, True)
                                     printd (f"cmd = {argv}", ptr)
                                     printd (f"err = {e}", ptr)
                                     failed()                                    
-                                    continue
+                                    return
 
                                 if not clang_c.allow_pp_in_compilations and '-E' in exe.argv:
                                     store_output(ptr, "PP in compilations are not allowed", argv, stdout1, stderr1, ret_code1, show_in_log=False)
                                     skipped()
-                                    continue
+                                    return
 
                                 compiler_path = os.path.join(exe.cwd, self.maybe_compiler_binary(exe.binary))
                                 comp_objs = clang_c.get_object_files(exe.eid.pid, have_int_cc1, fork_map, rev_fork_map, wr_map)
@@ -1950,7 +1850,7 @@ class CASDatabase:
                                 except clang.IncludeParseException as e:
                                     store_output(ptr, "Failed to process defs from clang output",argv, stdout1, stderr1, ret_code1)
                                     failed()
-                                    continue
+                                    return
 
                                 src_type = clang_c.get_source_type(argv, compiler_type, os.path.splitext(fn)[1])
                                 absfn = os.path.realpath(os.path.normpath(os.path.join(exe.cwd, fn)))
@@ -1958,7 +1858,7 @@ class CASDatabase:
                                 if absfn.startswith("/dev/"):
                                     printdbg("\nSkipping bogus file {} ".format(absfn), debug)
                                     skipped()
-                                    continue
+                                    return
                                 write_queue.put({ptr: {
                                         "f": [absfn],
                                         "i": includes,
@@ -1972,6 +1872,20 @@ class CASDatabase:
                                 with found_comps.get_lock():
                                     found_comps.value += 1
 
+                            while True:
+                                with cur_iter.get_lock():
+                                    if cur_iter.value < max_iter:
+                                        qpos = cur_iter.value
+                                        cur_iter.value = min(max_iter, qpos + exec_batch_size)
+                                        qend = cur_iter.value
+                                    else:
+                                        break
+                                with processed.get_lock():
+                                    processed.value += qend - qpos
+                                    pbar.n = processed.value
+                                    pbar.refresh()
+                                exec_worker.run_batched(worker, [process(q) for q in range(qpos, qend)])
+
                         print("Searching for clang compilations ... (%d candidates; %d jobs)" % (len(clangxx_input_execs), jobs))
                         print_mem_usage(debug)
                         print(flush=True)
@@ -2043,20 +1957,10 @@ class CASDatabase:
                         input_compiler_path = None # TODO -make parameter of this!
                         #region gcc_executor
                         def gcc_executor(worker_idx):
-                            worker = exec_worker.ExecWorker(os.path.join(libetrace_dir, "worker"))
+                            worker = exec_worker.ExecWorker(os.path.join(libetrace_dir, "worker"), exec_batch_jobs)
                             printdbg("Worker {} starting...".format(worker_idx),debug)
 
-                            while True:
-                                with cur_iter.get_lock():
-                                    if cur_iter.value < max_iter:
-                                        qpos = cur_iter.value
-                                        cur_iter.value += 1
-                                    else:
-                                        break
-                                with processed.get_lock():
-                                    processed.value += 1
-                                    pbar.n = processed.value
-                                    pbar.refresh()
+                            def process(qpos):
                                 ptr, compiler_type = gxx_input_execs[qpos]
                                 exe:libetrace.nfsdbEntry = self.get_exec_at_pos(ptr)
                                 argv: List[str] = exe.argv.copy()
@@ -2065,17 +1969,16 @@ class CASDatabase:
                                 # GET TRIPLE HASH
                                 if len(argv) == 2 and (argv[1] == "--version" or argv[1] == "-dumpmachine" or argv[1] == "-print-file-name=plugin"):
                                     skipped()
-                                    continue
+                                    return
                                 try:
                                     if os.path.exists(cwd) and os.path.exists(bin):
-                                        stdout0, stderr0, ret0 = worker.runCmd(cwd, bin, argv[1:] + ["-###"])
+                                        stdout0, stderr0, ret0 = yield (cwd, bin, argv[1:] + ["-###"], None, True)
                                         out0 = stdout0 + "\n" + stderr0
                                     else:
                                         print(f"Command or cwd does not exist cwd={cwd} bin={bin} ptr={ptr}")
                                         failed()
-                                        continue
+                                        return
                                 except exec_worker.ExecWorkerException as e:
-                                    worker.initialize()
                                     print("**********************************\n"\
                                         "ERROR = {}\n"\
                                         "cwd   = {}\n"\
@@ -2083,7 +1986,7 @@ class CASDatabase:
                                         "argv  = {}\n"\
                                         "**********************************".format(e,cwd,bin," ".join(argv[1:] + ["-###"])))
                                     failed()
-                                    continue
+                                    return
 
                                 lns = [shlex.split(x)
                                         for x in out0.splitlines()
@@ -2098,7 +2001,7 @@ class CASDatabase:
                                     else:
                                         store_output(ptr, f"ERROR: No CC1 patterns gcc compilation command", [bin] + argv[1:] + ['-###'], stdout0, stderr0, ret0)
                                         failed()
-                                    continue
+                                    return
 
                                 nargv = [bin if input_compiler_path is None else input_compiler_path] + argv[1:]
                                 if '-D__ASSEMBLY__' in nargv:
@@ -2108,7 +2011,7 @@ class CASDatabase:
                                                 skip=True
                                         if skip:
                                             skipped()
-                                            continue
+                                            return
                                         else:
                                             print( " ".join(nargv))
                                             pass
@@ -2126,30 +2029,28 @@ class CASDatabase:
                                 if "-E" in nargv or "-pipe" in nargv or "-o" in nargv or "-c" not in nargv:
                                     printd(f"Params issue: {nargv}", ptr, True)
                                     failed()
-                                    continue
+                                    return
                                 # GET PLUGIN OUTPUT
                                 try:
-                                    stdout1, stderr1, ret1 = worker.runCmd(cwd, nargv[0], nargv[1:], "")
+                                    stdout1, stderr1, ret1 = yield (cwd, nargv[0], nargv[1:], "", True)
                                     output = stdout1 + "\n" + stderr1
                                 except exec_worker.ExecWorkerException:
-                                    worker.initialize()
                                     printd(f"Exception while running gcc -fplugin command: {nargv}", ptr, True)
                                     failed()
-                                    continue
+                                    return
                                 if ret1 != 0:
                                     if "Permission denied" in output:
                                         try:
-                                            stdout1, stderr1, ret2 = worker.runCmd("/tmp/", nargv[0], nargv[1:], "")
+                                            stdout1, stderr1, ret2 = yield ("/tmp/", nargv[0], nargv[1:], "")
                                             output = stdout1 + "\n" + stderr1
                                         except exec_worker.ExecWorkerException:
-                                            worker.initialize()
                                             printd ("Exception while running gcc -fplugin command: {nargv}", ptr, True)
                                             failed()
-                                            continue
+                                            return
                                         if ret2 != 0:
                                             store_output(ptr, f"Error getting input files from gcc compilation command (permission retry)", nargv, stdout1, stderr1, ret2)
                                             failed()
-                                            continue
+                                            return
                                     # else:
                                     #     store_output(pos, f"Error getting input files from gcc compilation command", nargv, stdout1, stderr1, ret1)
                                     #     failed()
@@ -2160,11 +2061,11 @@ class CASDatabase:
                                 if not all((os.path.exists(os.path.join(cwd, x)) for x in fns)):
                                     store_output(ptr, f"Missing gcc compilation input files", nargv, stdout1, stderr1, ret1)
                                     failed()
-                                    continue
+                                    return
                                 if len(fns) == 0:
                                     store_output(ptr, f"Error getting input files from gcc compilation command", nargv, stdout1, stderr1, ret1)
                                     failed()
-                                    continue
+                                    return
                                 # Spawn the child to read all include paths and preprocessor definitions
                                 nargv = [bin] + argv[1:]
                                 while '-include' in nargv:
@@ -2192,18 +2093,17 @@ class CASDatabase:
                                 nargv.append('-')
                                 # GET COMPILATION DATA
                                 try:
-                                    stdout3, stderr3, ret3 = worker.runCmd(cwd, nargv[0], nargv[1:], "")
+                                    stdout3, stderr3, ret3 = yield (cwd, nargv[0], nargv[1:], "")
                                     out3 = stdout3 + "\n" + stderr3
                                 except exec_worker.ExecWorkerException:
-                                    worker.initialize()
                                     printd(f"Exception {nargv}", ptr)
                                     failed()
-                                    continue
+                                    return
 
                                 if ret3 != 0:
                                     store_output(ptr, f"Error getting compilation data", nargv, stdout3, stderr3, ret3)
                                     failed()
-                                    continue
+                                    return
 
                                 compiler_path = os.path.join(cwd, self.maybe_compiler_binary(bin))
                                 exe_dct = exe.json()
@@ -2241,7 +2141,7 @@ class CASDatabase:
                                     else:
                                         store_output(ptr, f"Error getting input files from gcc compilation command\noutput = {fns}\noutput = {out_fns}", nargv, stdout3, stderr3, ret3)
                                         skipped()
-                                    continue
+                                    return
 
                                 write_queue.put({ptr: {
                                         "f": list(out_fns),
@@ -2256,6 +2156,20 @@ class CASDatabase:
                                 with found_comps.get_lock():
                                     found_comps.value += 1
 
+                            while True:
+                                with cur_iter.get_lock():
+                                    if cur_iter.value < max_iter:
+                                        qpos = cur_iter.value
+                                        cur_iter.value = min(max_iter, qpos + exec_batch_size)
+                                        qend = cur_iter.value
+                                    else:
+                                        break
+                                with processed.get_lock():
+                                    processed.value += qend - qpos
+                                    pbar.n = processed.value
+                                    pbar.refresh()
+                                exec_worker.run_batched(worker, [process(q) for q in range(qpos, qend)])
+
                         print("Searching for gcc compilations ... (%d candidates; %d jobs)" % (len(gxx_input_execs), jobs))
                         print_mem_usage(debug)
                         print(flush=True)
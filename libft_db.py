@@ -31,8 +31,8 @@ class FTDatabase:
         self.db_loaded = False
         self.db_path = None
     
-    def load_db(self, db_path: str, quiet:bool=True, debug:bool=False) -> bool:
-        self.db_loaded = self.db.load(db_path, quiet=quiet, debug=debug)
+    def load_db(self, db_path: str, quiet:bool=True, debug:bool=False, no_map_memory:bool=False, prelink:bool=False) -> bool:
+        self.db_loaded = self.db.load(db_path, quiet=quiet, debug=debug, no_map_memory=no_map_memory, prelink=prelink)
         self.db_path = db_path
         return self.db_loaded
 
@@ -53,6 +53,9 @@ class FTDatabase:
     def get_release(self) -> str:
         return self.db.release
 
+    def get_hash_scheme(self) -> str:
+        return self.db.hash_scheme
+
     def get_sources(self, fids=None) -> List[ftdbSourceEntry]:
         if fids is None:
             return [ftdbSourceEntry(s[0], s[1]) for s in list(self.db.sources)]
@@ -63,20 +66,37 @@ class FTDatabase:
             return [ftdbModuleEntry(md[0], md[1]) for md in list(self.db.modules)]
         return [ftdbModuleEntry(mid, self.db.modules[mid]) for mid in set(mids) if mid < len(self.db.modules)]
 
-    def get_funcs(self, fids: Optional[List[int]]=None):
+    def get_funcs(self, fids: Optional[List[int]]=None, mids: Optional[List[int]]=None):
+        if mids is not None:
+            return self.db.funcs.entries_by_mids(mids)
         if fids is None:
             return self.db.funcs
-        return [func for func in self.db.funcs if set(func.fids).intersection(fids)]
+        return self.db.funcs.entries_by_fids(fids)
 
     def get_funcdecls(self, fids:Optional[List[int]]=None):
         if fids is None:
             return self.db.funcdecls
-        return [fd for fd in self.db.funcdecls if fd.fid in fids]
+        return self.db.funcdecls.entries_by_fids(fids)
 
-    def get_globs(self, fids: Optional[List[int]]=None):
+    def get_globs(self, fids: Optional[List[int]]=None, mids: Optional[List[int]]=None):
+        if mids is not None:
+            # There is no module index of globals
+            mids = set(mids)
+            return [glob for glob in self.db.globals if mids.intersection(glob.mids)]
         if fids is None:
             return self.db.globals
-        return [glob for glob in self.db.globals if glob.fid in fids]
+        return self.db.globals.entries_by_fids(fids)
+
+    def count_funcs(self, fids: Optional[List[int]]=None, flt: Optional[List]=None, mids: Optional[List[int]]=None) -> int:
+        if mids is not None:
+            return self.db.funcs.count(filter=flt, mids=mids)
+        return self.db.funcs.count(fids=fids, filter=flt)
+
+    def count_funcdecls(self, fids: Optional[List[int]]=None, flt: Optional[List]=None) -> int:
+        return self.db.funcdecls.count(fids=fids, filter=flt)
+
+    def count_globs(self, fids: Optional[List[int]]=None, flt: Optional[List]=None) -> int:
+        return self.db.globals.count(fids=fids, filter=flt)
 
     def get_types(self):
         return self.db.types
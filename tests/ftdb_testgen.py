@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+
+# Shared parts of the libftdb tests which compare a native query with its Python implementation on a generated
+# database (and optionally on a given database image): the common command line, a random database generator and
+# the driver which builds the generated image and runs the per-test check
+
+import libftdb
+import sys
+import os
+import argparse
+import random
+import tempfile
+
+def argument_parser(description, entries=2000):
+	parser = argparse.ArgumentParser(description=description, formatter_class=argparse.RawDescriptionHelpFormatter)
+	parser.add_argument("ftdb_path", action="store", nargs="?", help="Optional ftdb image checked in addition to the generated database")
+	parser.add_argument("-n", "--entries", action="store", type=int, default=entries, help="Number of generated functions (and globals)")
+	parser.add_argument("-s", "--seed", action="store", type=int, default=0, help="Random seed")
+	return parser
+
+words = ["dev", "init", "read", "write", "probe", "get", "set", "irq", "buf", "lock", "x", "_", "a1"]
+
+def random_name(rnd):
+	return "_".join(rnd.choice(words) for _ in range(rnd.randint(1, 3)))
+
+def random_location(rnd, sources):
+	return "%s:%d:%d" % (rnd.choice(sources), rnd.randint(1, 2000), rnd.randint(1, 80))
+
+def random_ids(rnd, count, limit=4):
+	return sorted(rnd.sample(range(count), rnd.randint(1, min(count, limit))))
+
+def func_entry(rnd, id, fids, mids, name, location):
+	literals = {"integer": [], "character": [], "floating": [], "string": []}
+	return {"name": name, "id": id, "fid": fids[0], "fids": fids, "mids": mids, "nargs": 0, "variadic": False,
+		"firstNonDeclStmt": "", "linkage": rnd.choice(["internal", "external"]), "attributes": [], "hash": "h%d" % id,
+		"cshash": "c%d" % id, "body": "{}", "unpreprocessed_body": "{}", "declbody": "void %s(void)" % name,
+		"signature": "void %s(void)" % name, "declhash": "d%d" % id, "location": location, "start_loc": location,
+		"end_loc": location, "refcount": 1, "literals": literals, "declcount": 0, "taint": {}, "calls": [],
+		"call_info": [], "callrefs": [], "refcalls": [], "refcall_info": [], "refcallrefs": [], "switches": [],
+		"csmap": [], "locals": [], "derefs": [], "ifs": [], "asm": [], "globalrefs": [], "globalrefInfo": [],
+		"funrefs": [], "refs": [], "decls": [], "types": [0]}
+
+def funcdecl_entry(rnd, id, fid, name, location):
+	return {"name": name, "id": id, "fid": fid, "nargs": 0, "variadic": False, "linkage": rnd.choice(["internal", "external"]),
+		"decl": "void %s(void)" % name, "signature": "void %s(void)" % name, "declhash": "d%d" % id, "location": location,
+		"refcount": 1, "types": [0]}
+
+def global_entry(rnd, id, fid, mids, name, location):
+	literals = {"integer": [], "character": [], "floating": [], "string": []}
+	return {"name": name, "hash": "g%d" % id, "id": id, "def": "int %s" % name, "globalrefs": [], "refs": [], "funrefs": [],
+		"decls": [], "fid": fid, "mids": mids, "type": 0, "linkage": rnd.choice(["internal", "external"]), "location": location,
+		"deftype": rnd.randint(0, 2), "hasinit": 0, "init": "", "literals": literals}
+
+def random_db(seed, n, source_count=50, module_count=10):
+	"""
+	Generates the JSON database with n functions, n/2 function declarations and n globals with random names, locations,
+	file ids (several per function) and module ids
+	"""
+	rnd = random.Random(seed)
+	sources = ["/src/%s/%s.c" % (rnd.choice(words), random_name(rnd)) for _ in range(source_count)]
+	modules = ["/out/%s.ko" % random_name(rnd) for _ in range(module_count)]
+	funcs = []
+	funcdecls = []
+	globs = []
+	for i in range(n):
+		fids = random_ids(rnd, len(sources))
+		funcs.append(func_entry(rnd, i, fids, random_ids(rnd, len(modules)) if rnd.random() < 0.8 else [],
+			random_name(rnd), random_location(rnd, [sources[x] for x in fids])))
+	for i in range(n//2):
+		fid = rnd.randrange(len(sources))
+		funcdecls.append(funcdecl_entry(rnd, n+i, fid, random_name(rnd), random_location(rnd, [sources[fid]])))
+	for i in range(n):
+		fid = rnd.randrange(len(sources))
+		globs.append(global_entry(rnd, i, fid, random_ids(rnd, len(modules)), random_name(rnd), random_location(rnd, [sources[fid]])))
+	types = [{"id": 0, "fid": 0, "hash": "t0", "class": "builtin", "qualifiers": "", "size": 0, "str": "void",
+		"refcount": len(funcs) + len(funcdecls), "refs": []}]
+	return {"funcs": funcs, "funcdecls": funcdecls, "unresolvedfuncs": [], "globals": globs, "types": types, "fops": [],
+		"source_info": [{"name": x, "id": i} for i, x in enumerate(sources)],
+		"module_info": [{"name": x, "id": i} for i, x in enumerate(modules)],
+		"version": "test", "module": "test", "directory": "/src", "release": "test"}
+
+def run(args, check):
+	"""
+	Builds the image of the generated database in a temporary directory and calls check(path, name) for it and for the
+	optional args.ftdb_path image; check returns the number of mismatches found
+	"""
+	errors = 0
+	with tempfile.TemporaryDirectory() as root:
+		db_filename = os.path.join(root, "test.ftdb.img")
+		if libftdb.create_ftdb(random_db(args.seed, args.entries), db_filename) is False:
+			sys.exit("Failed to create the generated database")
+		errors += check(db_filename, "generated database")
+
+	if args.ftdb_path:
+		errors += check(args.ftdb_path, args.ftdb_path)
+
+	if errors:
+		sys.exit("%d mismatches found" % errors)
+	print("OK")
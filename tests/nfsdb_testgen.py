@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+
+# Shared parts of the libetrace tests which compare a native query with its Python implementation on a generated
+# database (and optionally on a given database image): the common command line, a random entries generator and
+# the driver which builds the generated image and runs the per-test check
+
+import libetrace
+import sys
+import os
+import argparse
+import random
+import tempfile
+
+def argument_parser(description, entries=5000):
+	parser = argparse.ArgumentParser(description=description, formatter_class=argparse.RawDescriptionHelpFormatter)
+	parser.add_argument('db_path', action="store", nargs="?", help="Optional nfsdb image checked in addition to the generated database")
+	parser.add_argument("-n", "--entries", action="store", type=int, default=entries, help="Number of generated entries")
+	parser.add_argument("-s", "--seed", action="store", type=int, default=0, help="Random seed")
+	return parser
+
+def link_parents(entries):
+	"""Fills the children lists from the parent of every entry (entries are indexed by pid-1)"""
+	for e in entries:
+		if e["r"]["p"] > 0:
+			entries[e["r"]["p"]-1]["c"].append({"p": e["p"], "f": 0})
+	return entries
+
+def random_entries(seed, n, binaries, cwds, words, paths, modes, parents=True):
+	"""Generates n entries with random binaries, working directories, arguments and opened files"""
+	rnd = random.Random(seed)
+	entries = []
+	for pid in range(1, n+1):
+		b = rnd.choice(binaries)
+		argv = ([os.path.basename(b)] if b else []) + [rnd.choice(words) for _ in range(rnd.randint(0, 4))]
+		opens = []
+		for _ in range(rnd.randint(0, 4)):
+			opens.append({"p": rnd.choice(paths), "m": rnd.choice(modes)})
+		entries.append({"p": pid, "x": 0, "r": {"p": max(0, pid-rnd.randint(1, 3)) if parents else 0, "x": 0}, "c": [], "b": b,
+			"w": rnd.choice(cwds), "v": argv, "o": opens, "i": [], "!": 0})
+	return link_parents(entries) if parents else entries
+
+def run(args, generate, check, src_root="/"):
+	"""
+	Builds the image of the database returned by generate(root) in a temporary directory root and calls check(nfsdb, name)
+	for it and for the optional args.db_path image; check returns the number of mismatches found
+	"""
+	errors = 0
+	with tempfile.TemporaryDirectory() as root:
+		db_filename = os.path.join(root, "test.nfsdb.img")
+		libetrace.create_nfsdb(generate(root), src_root, "test", [], [], db_filename)
+		nfsdb = libetrace.nfsdb()
+		nfsdb.load(db_filename, quiet=True)
+		errors += check(nfsdb, "generated database")
+
+	if args.db_path:
+		nfsdb = libetrace.nfsdb()
+		nfsdb.load(args.db_path, quiet=True)
+		errors += check(nfsdb, args.db_path)
+
+	if errors:
+		sys.exit("%d mismatches found" % errors)
+	print("OK")
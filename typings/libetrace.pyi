@@ -2,7 +2,7 @@
 """
 Libetrace module  - API of nfsdb database.
 """
-from typing import overload, Iterator, List, Dict, Tuple, Set, Optional, Sized
+from typing import overload, Iterator, List, Dict, Tuple, Set, Optional, Sized, Union, Any, Iterable
 
 class error(Exception):
     pass
@@ -30,6 +30,16 @@ class nfsdb:
     Set of thread numbers used in all processes in the database
     """
 
+    mapped: bool
+    """
+    True when the database image is mapped from its prelinked copy (False when it was unflattened)
+    """
+
+    deps_mapped: bool
+    """
+    True when the dependency image is mapped from its prelinked copy (False when it was unflattened)
+    """
+
     filemap: Dict[str,List[nfsdbEntryOpenfile]]
     """
     Map of path:str -> list: nfsdbEntryOpenfile
@@ -94,7 +104,7 @@ class nfsdb:
 
     def __init__(self) -> None: ...
 
-    def load(self, cache_filename: str, debug: bool=False, quiet: bool=True, mp_safe: bool=True, no_map_memory: bool = False) -> bool:
+    def load(self, cache_filename: str, debug: bool=False, quiet: bool=True, mp_safe: bool=True, no_map_memory: bool = False, prelink: bool = False) -> bool:
         """
         Loads database from given filename
 
@@ -106,12 +116,14 @@ class nfsdb:
         :type quiet: bool
         :param mp_safe: load database in read-only mode slower but safer when using multiprocessing
         :type mp_safe: bool
-        :param no_map_memory: ??
+        :param no_map_memory: unflatten the image instead of mapping its prelinked copy
         :type no_map_memory: bool
+        :param prelink: save the prelinked copy of the image when there is no up-to-date one
+        :type prelink: bool
         :return: True if load succeed otherwise False
         """
 
-    def load_deps(self, cache_filename: str, debug: bool=False, quiet: bool=True, mp_safe: bool=True, no_map_memory: bool = False) -> bool:
+    def load_deps(self, cache_filename: str, debug: bool=False, quiet: bool=True, mp_safe: bool=True, no_map_memory: bool = False, prelink: bool = False) -> bool:
         """
         Loads dependencies database from given filename
 
@@ -123,8 +135,10 @@ class nfsdb:
         :type quiet: bool
         :param mp_safe: load database in read-only mode slower but safer when using multiprocessing
         :type mp_safe: bool
-        :param no_map_memory: ??
+        :param no_map_memory: unflatten the image instead of mapping its prelinked copy
         :type no_map_memory: bool
+        :param prelink: save the prelinked copy of the image when there is no up-to-date one
+        :type prelink: bool
         :return: True if load succeed otherwise False
         """
     def create_deps_cache(self, depmap, direct_depmap, deps_cache_db_filename, show_stats=False) -> bool:
@@ -141,6 +155,33 @@ class nfsdb:
         :type show_stats: bool, optional
         """
 
+    def create_deps_image(self, deps_cache_db_filename:str, modules:List[Union[str,Tuple[str,int]]], excludes:Optional[List[Dict]]=None,
+                        jobs:Optional[int]=None, deps_threshold:int=0, ddepmap_filename:Optional[str]=None,
+                        depmap_filename:Optional[str]=None, show_stats:bool=False, debug:bool=False) -> Tuple[Dict[str,int],Optional[Dict[str,int]]]:
+        """
+        Function computes direct and full dependencies of given modules on a pool of threads and writes the dependencies cache file.
+        Nothing is written when the number of dependencies of any module exceeds the threshold.
+
+        :param deps_cache_db_filename: output filename
+        :type deps_cache_db_filename: str
+        :param modules: module paths or tuples of module path and index of its parameters in `excludes`
+        :type modules: List[str | Tuple[str,int]]
+        :param excludes: list of `fdeps` keyword arguments (exclude_patterns, exclude_commands_index, use_pipes, wrap_deps, ...; `dep_graph` is not supported)
+        :type excludes: List[Dict], optional
+        :param jobs: number of threads, defaults to the number of cpus
+        :type jobs: int, optional
+        :param deps_threshold: max dependencies count of a single module (0 disables the check), defaults to 0
+        :type deps_threshold: int, optional
+        :param ddepmap_filename: where to write the direct dependency map in json format
+        :type ddepmap_filename: str, optional
+        :param depmap_filename: where to write the full dependency map in json format
+        :type depmap_filename: str, optional
+        :param show_stats: show statistics, defaults to False
+        :type show_stats: bool, optional
+        :return: direct and full dependency counts for each module (full counts are None when direct dependencies exceed the threshold)
+        :rtype: Tuple[Dict[str,int], Dict[str,int] | None]
+        """
+
     def iter(self, ) -> Iterator[nfsdbEntry]:
         """
         Returns iterator over executables
@@ -249,6 +290,22 @@ class nfsdb:
         Returns list of opens as nfsdbEntryOpenfile iterator.
         """
 
+    def opens_filter(self, file_filter: Optional[List]=None) -> "nfsdbOpensFilter":
+        """
+        Compiles the opens filter (in the filtered_opens format) into the native filter.
+
+        :param file_filter: filters list
+        :return: compiled filter of nfsdbEntryOpenfile objects
+        """
+
+    def commands_filter(self, exec_filter: Optional[List]=None) -> "nfsdbCommandsFilter":
+        """
+        Compiles the execs filter (in the filtered_execs format) into the native filter.
+
+        :param exec_filter: filters list
+        :return: compiled filter of nfsdbEntry objects
+        """
+
     def opens(self, ) -> List[nfsdbEntryOpenfile]:
         """
         Returns list of opens as `nfsdbEntryOpenfile` instances list.
@@ -420,16 +477,42 @@ class nfsdb:
         :rtype: bool
         """
 
-    def precompute_command_patterns(self, excl_commands:List[str])-> Optional[Dict]:
+    def precompute_command_patterns(self, excl_commands:List[str], jobs: int = 0)-> Optional[Dict]:
         """
         Function calculate exclude command patterns for executables using database nfsdbEntry
 
         :param excl_commands: patterns of excluded commands
         :type excl_commands: List[str]
+        :param jobs: number of matching threads, defaults to 0 (number of available cores)
+        :type jobs: int, optional
         :return: precomputed command patterns dict or None if function failed
         :rtype: dict | None
         """
 
+    def post_process_scan(self, ld_spec: List[str], ar_spec: List[str], compiler_specs: List[List[str]],
+                          linked: bool = True, compilations: bool = True, jobs: int = 0) -> Dict[str, Any]:
+        """
+        Function extracts linked module and compilation candidates for the database post processing on a pool of threads.
+        Spec patterns are matched against binary paths (an empty spec matches every binary).
+
+        :param ld_spec: linker binary patterns
+        :type ld_spec: List[str]
+        :param ar_spec: archiver binary patterns
+        :type ar_spec: List[str]
+        :param compiler_specs: lists of compiler binary patterns, the first matching list wins
+        :type compiler_specs: List[List[str]]
+        :param linked: extract linked module candidates, defaults to True
+        :type linked: bool, optional
+        :param compilations: extract compilation candidates, defaults to True
+        :type compilations: bool, optional
+        :param jobs: number of threads, defaults to 0 (number of available cores)
+        :type jobs: int, optional
+        :return: dict with "linked" list of (ptr, type, path, written) in entry order (type 1 - linker, 0 - archiver),
+            "compilers" list of (ptr, compiler spec index) of successful executions, "written" map of pid to written paths
+            and "forks" map of pid to child pids (both for successful executions)
+        :rtype: Dict[str, Any]
+        """
+
 def image_version(image_filename: str) -> str:
     """Function returns database image version
 
@@ -463,7 +546,7 @@ def parse_nfsdb(tracer_db_filename:str, json_db_filename:str, threads:str) -> Op
     """
 
 
-def precompute_command_patterns(excl_commands: List[str], process_map: Dict, debug: bool = False) -> Optional[Dict]:
+def precompute_command_patterns(excl_commands: List[str], process_map: Dict, debug: bool = False, jobs: int = 0) -> Optional[Dict]:
     """
     Function calculate exclude command patterns for executables using process map dict
 
@@ -473,6 +556,8 @@ def precompute_command_patterns(excl_commands: List[str], process_map: Dict, deb
     :type process_map: Dict
     :param debug: display debug information on stdout, defaults to False
     :type debug: bool, optional
+    :param jobs: number of matching threads, defaults to 0 (number of available cores)
+    :type jobs: int, optional
     :return: precomputed command patterns dict or None if function failed
     :rtype: dict | None
     """
@@ -482,7 +567,7 @@ def is_ELF_or_LLVM_BC_file(written_files: List[str]):...
 
 def is_ELF_file(written_files: List[str]):...
 
-def create_nfsdb(db: dict, src_root: str, set_version: str, pcp_patterns: list, shared_argvs: List[str], cache_db_filename: str, show_stats: bool = False) -> bool:
+def create_nfsdb(db: dict, src_root: str, set_version: str, pcp_patterns: list, shared_argvs: List[str], cache_db_filename: str, show_stats: bool = False, jobs: int = 0) -> bool:
     """
     Function takes database in dict format and stores it to highly-optimized image file (.nfsdb.img).
 
@@ -500,6 +585,33 @@ def create_nfsdb(db: dict, src_root: str, set_version: str, pcp_patterns: list,
     :type shared_argvs: List[str]
     :param show_stats: show stats while building database, defaults to False
     :type show_stats: bool, optional
+    :param jobs: number of threads building the database maps, defaults to 0 (number of available cores)
+    :type jobs: int, optional
+    :return: True if success otherwise False
+    :rtype: bool
+    """
+
+def create_nfsdb_from_json(json_db_filename: str, src_root: str, set_version: str, pcp_patterns: list, shared_argvs: List[str], cache_db_filename: str, show_stats: bool = False, jobs: int = 0) -> bool:
+    """
+    Function parses database file in json format (.nfsdb.json) natively and stores it to highly-optimized image file (.nfsdb.img).
+    Produces the same image as `create_nfsdb` with the loaded json database (with parent of the first process set to 0).
+
+    :param json_db_filename: filename of json database
+    :type json_db_filename: str
+    :param src_root: tracing process start dir
+    :type src_root: str
+    :param set_version: database version
+    :type set_version: str
+    :param pcp_patterns: precompiled patterns list
+    :type pcp_patterns: list
+    :param shared_argvs: list of shared library generation switches to be searched in linking command
+    :type shared_argvs: List[str]
+    :param cache_db_filename: filename of cache database
+    :type cache_db_filename: str
+    :param show_stats: show stats while building database, defaults to False
+    :type show_stats: bool, optional
+    :param jobs: number of threads building the database maps, defaults to 0 (number of available cores)
+    :type jobs: int, optional
     :return: True if success otherwise False
     :rtype: bool
     """
@@ -819,11 +931,72 @@ class nfsdbFilteredIter(Iterator, Sized):
     Iterator for filtered opens path results.
     """
 
+class nfsdbIter(Iterator, Sized):
+    """
+    Iterator for database executions.
+    """
+
+    def sorted_window(self, key: str, start: int = 0, stop: Optional[int] = None, reverse: bool = False) -> List[nfsdbEntry]:
+        """
+        Function returns the [start, stop) window of the remaining iterator items sorted by a given key.
+        Only the window items are created (the items are partially sorted in the library).
+
+        :param key: sorting key (one of bin, cwd, cmd, argv, pid)
+        :type key: str
+        :param start: first position of the window, defaults to 0
+        :type start: int, optional
+        :param stop: position past the last one of the window, defaults to None (all remaining items)
+        :type stop: int | None, optional
+        :param reverse: sort in descending order (items with equal keys keep the iteration order), defaults to False
+        :type reverse: bool, optional
+        :return: list of items in the window
+        :rtype: List[nfsdbEntry]
+        """
+
+    def count(self, distinct: Optional[str] = None) -> int:
+        """
+        Function returns the number of the remaining iterator items (or the number of distinct values
+        of a given sorting key of the items) without creating the items.
+
+        :param distinct: sorting key (bin, cwd, cmd, argv, pid) of the counted distinct values, defaults to None (count all items)
+        :type distinct: str | None, optional
+        :return: number of items
+        :rtype: int
+        """
+
 class nfsdbOpensIter(Iterator, Sized):
     """
     Iterator for filtered opens path results.
     """
 
+    def sorted_window(self, key: str, start: int = 0, stop: Optional[int] = None, reverse: bool = False) -> List[nfsdbEntryOpenfile]:
+        """
+        Function returns the [start, stop) window of the remaining iterator items sorted by a given key.
+        Only the window items are created (the items are partially sorted in the library).
+
+        :param key: sorting key (one of path, original_path, mode, exec)
+        :type key: str
+        :param start: first position of the window, defaults to 0
+        :type start: int, optional
+        :param stop: position past the last one of the window, defaults to None (all remaining items)
+        :type stop: int | None, optional
+        :param reverse: sort in descending order (items with equal keys keep the iteration order), defaults to False
+        :type reverse: bool, optional
+        :return: list of items in the window
+        :rtype: List[nfsdbEntryOpenfile]
+        """
+
+    def count(self, distinct: Optional[str] = None) -> int:
+        """
+        Function returns the number of the remaining iterator items (or the number of distinct values
+        of a given sorting key of the items) without creating the items.
+
+        :param distinct: sorting key (path, original_path, mode, exec) of the counted distinct values, defaults to None (count all items)
+        :type distinct: str | None, optional
+        :return: number of items
+        :rtype: int
+        """
+
 class nfsdbFilteredOpensPathsIter(Iterator, Sized):
     """
     Iterator for filtered opens path results.
@@ -834,11 +1007,97 @@ class nfsdbFilteredOpensIter(Iterator, Sized):
     Iterator for filtered opens results.
     """
 
+    def sorted_window(self, key: str, start: int = 0, stop: Optional[int] = None, reverse: bool = False) -> List[nfsdbEntryOpenfile]:
+        """
+        Function returns the [start, stop) window of the remaining iterator items sorted by a given key.
+        Only the window items are created (the items are partially sorted in the library).
+
+        :param key: sorting key (one of path, original_path, mode, exec)
+        :type key: str
+        :param start: first position of the window, defaults to 0
+        :type start: int, optional
+        :param stop: position past the last one of the window, defaults to None (all remaining items)
+        :type stop: int | None, optional
+        :param reverse: sort in descending order (items with equal keys keep the iteration order), defaults to False
+        :type reverse: bool, optional
+        :return: list of items in the window
+        :rtype: List[nfsdbEntryOpenfile]
+        """
+
+    def count(self, distinct: Optional[str] = None) -> int:
+        """
+        Function returns the number of the remaining iterator items (or the number of distinct values
+        of a given sorting key of the items) without creating the items.
+
+        :param distinct: sorting key (path, original_path, mode, exec) of the counted distinct values, defaults to None (count all items)
+        :type distinct: str | None, optional
+        :return: number of items
+        :rtype: int
+        """
+
+class nfsdbOpensFilter:
+    """
+    Compiled filter of opens.
+    """
+
+    def __call__(self, opn: nfsdbEntryOpenfile) -> bool:
+        """
+        Function checks if a given open matches the filter.
+        """
+
+    def filter(self, opens: Iterable[nfsdbEntryOpenfile]) -> List[nfsdbEntryOpenfile]:
+        """
+        Function returns the opens matching the filter (in the given order).
+        """
+
+class nfsdbCommandsFilter:
+    """
+    Compiled filter of execs.
+    """
+
+    def __call__(self, exe: nfsdbEntry) -> bool:
+        """
+        Function checks if a given exec matches the filter.
+        """
+
+    def filter(self, execs: Iterable[nfsdbEntry]) -> List[nfsdbEntry]:
+        """
+        Function returns the execs matching the filter (in the given order).
+        """
+
 class nfsdbFilteredCommandsIter(Iterator, Sized):
     """
     Iterator for filtered execs results.
     """
 
+    def sorted_window(self, key: str, start: int = 0, stop: Optional[int] = None, reverse: bool = False) -> List[nfsdbEntry]:
+        """
+        Function returns the [start, stop) window of the remaining iterator items sorted by a given key.
+        Only the window items are created (the items are partially sorted in the library).
+
+        :param key: sorting key (one of bin, cwd, cmd, argv, pid)
+        :type key: str
+        :param start: first position of the window, defaults to 0
+        :type start: int, optional
+        :param stop: position past the last one of the window, defaults to None (all remaining items)
+        :type stop: int | None, optional
+        :param reverse: sort in descending order (items with equal keys keep the iteration order), defaults to False
+        :type reverse: bool, optional
+        :return: list of items in the window
+        :rtype: List[nfsdbEntry]
+        """
+
+    def count(self, distinct: Optional[str] = None) -> int:
+        """
+        Function returns the number of the remaining iterator items (or the number of distinct values
+        of a given sorting key of the items) without creating the items.
+
+        :param distinct: sorting key (bin, cwd, cmd, argv, pid) of the counted distinct values, defaults to None (count all items)
+        :type distinct: str | None, optional
+        :return: number of items
+        :rtype: int
+        """
+
 class nfsdbCputime():
     """
     Chronological CPU threads
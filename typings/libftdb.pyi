@@ -19,8 +19,10 @@ class ftdb:
     funcs_tree_funrefs_no_known_no_asm: Incomplete
     globals: Incomplete
     globs_tree_globalrefs: Incomplete
+    hash_scheme: Incomplete
     init_data: Incomplete
     known_data: Incomplete
+    mapped: bool
     module: Incomplete
     module_info: Incomplete
     modules: Incomplete
@@ -102,6 +104,18 @@ class ftdbFopsIter:
     def __next__(self):
         """Implement next(self)."""
 
+class ftdbCollectionView:
+    indexes: Incomplete
+    @classmethod
+    def __init__(cls, *args, **kwargs) -> None:
+        """Create and return a new object.  See help(type) for accurate signature."""
+    def __getitem__(self, index):
+        """Return self[index]."""
+    def __iter__(self):
+        """Implement iter(self)."""
+    def __len__(self) -> int:
+        """Return len(self)."""
+
 class ftdbFuncCallInfoEntry:
     args: Incomplete
     csid: Incomplete
@@ -429,6 +443,10 @@ class ftdbFuncdecls:
         """Check whether there is a funcdecl entry with a given id"""
     def contains_name(self, *args, **kwargs):
         """Check whether there is a funcdecl entry with a given name"""
+    def count(self, *args, **kwargs):
+        """Returns the number of funcdecl entries from the given files (if any) matching a given filter"""
+    def entries_by_fids(self, *args, **kwargs):
+        """Returns the view of the funcdecl entries from any of the given files"""
     def entry_by_hash(self, *args, **kwargs):
         """Returns the ftdb funcdecl entry with a given hash value"""
     def entry_by_id(self, *args, **kwargs):
@@ -455,6 +473,12 @@ class ftdbFuncs:
         """Check whether there is a func entry with a given id"""
     def contains_name(self, *args, **kwargs):
         """Check whether there is a func entry with a given name"""
+    def count(self, *args, **kwargs):
+        """Returns the number of func entries defined in any of the given files or modules (if any) matching a given filter"""
+    def entries_by_fids(self, *args, **kwargs):
+        """Returns the view of the func entries from any of the given files"""
+    def entries_by_mids(self, *args, **kwargs):
+        """Returns the view of the func entries from any of the given modules"""
     def entry_by_hash(self, *args, **kwargs):
         """Returns the ftdb func entry with a given hash value"""
     def entry_by_id(self, *args, **kwargs):
@@ -540,6 +564,10 @@ class ftdbGlobals:
         """Check whether there is a global entry with a given id"""
     def contains_name(self, *args, **kwargs):
         """Check whether there is a global entry with a given name"""
+    def count(self, *args, **kwargs):
+        """Returns the number of global entries from the given files (if any) matching a given filter"""
+    def entries_by_fids(self, *args, **kwargs):
+        """Returns the view of the global entries from any of the given files"""
     def entry_by_hash(self, *args, **kwargs):
         """Returns the ftdb global entry with a given hash value"""
     def entry_by_id(self, *args, **kwargs):